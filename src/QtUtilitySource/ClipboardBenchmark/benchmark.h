@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace Benchmark
+{
+    struct Resolution
+    {
+        const char* name;
+        int width;
+        int height;
+    };
+
+    const Resolution RESOLUTIONS[] =
+    {
+        { "1080p", 1920, 1080 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    // suite 는 썸네일부터 8K 까지
+    const Resolution SUITE_RESOLUTIONS[] =
+    {
+        { "thumbnail", 256, 256 },
+        { "720p", 1280, 720 },
+        { "1080p", 1920, 1080 },
+        { "1440p", 2560, 1440 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    struct Timing
+    {
+        double median;
+        double min;
+        double max;
+    };
+
+    // 한 번 워밍업한 뒤 iterations 번 실행한 시간 (ms)
+    template<typename Fn>
+    Timing Measure(int iterations, Fn fn)
+    {
+        fn();
+
+        std::vector<double> samples;
+        samples.reserve(std::max(iterations, 1));
+        for (int i = 0; i < std::max(iterations, 1); ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::sort(samples.begin(), samples.end());
+        return Timing{ samples[samples.size() / 2], samples.front(), samples.back() };
+    }
+
+    // 한 번 워밍업한 뒤 iterations 번 실행한 시간의 중앙값 (ms)
+    template<typename Fn>
+    double MedianMilliseconds(int iterations, Fn fn)
+    {
+        return Measure(iterations, fn).median;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "legacybitmap.h"
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QImage>
+
+HBITMAP LegacyToHBITMAP(const QImage& image)
+{
+    QByteArray byteArray;
+    QBuffer buffer(&byteArray);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "BMP");
+
+    BITMAPFILEHEADER* bmpFileHeader = (BITMAPFILEHEADER*)byteArray.constData();
+    BITMAPINFOHEADER* bmpInfoHeader = (BITMAPINFOHEADER*)(byteArray.constData() + sizeof(BITMAPFILEHEADER));
+
+    // 원래 코드는 GetDC 를 두 번 호출하고 해제하지 않았다. 반복 측정을 위해 여기서만 해제한다
+    HDC hdc = GetDC(NULL);
+    HBITMAP hBitmap = CreateCompatibleBitmap(hdc, bmpInfoHeader->biWidth, bmpInfoHeader->biHeight);
+    SetDIBits(hdc, hBitmap, 0, bmpInfoHeader->biHeight, byteArray.constData() + bmpFileHeader->bfOffBits, (BITMAPINFO*)bmpInfoHeader, DIB_RGB_COLORS);
+    ReleaseDC(NULL, hdc);
+
+    return hBitmap;
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <windows.h>
+
+class QImage;
+
+// 비교용으로 남겨둔 이전 ClipboardWorker::toHBITMAP (BMP 로 저장한 뒤 다시 읽는 방식)
+HBITMAP LegacyToHBITMAP(const QImage& image);
\ No newline at end of file
@@ -0,0 +1,724 @@
+#include "benchmark.h"
+#include "legacybitmap.h"
+#include "suite.h"
+
+#include "bufferpool.h"
+#include "clipboardhistory.h"
+#include "clipboardreader.h"
+#include "dibsection.h"
+#include "encodedclipboardsource.h"
+#include "framediff.h"
+#include "gdipluscontext.h"
+#include "log.h"
+#include "memoryclipboardbackend.h"
+#include "memorytracker.h"
+#include "pixelbuffer.h"
+#include "pixmapclipboardsource.h"
+#include "pngencoder.h"
+#include "threadpool.h"
+#include "tiledpipeline.h"
+#include "win32clipboardbackend.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QGuiApplication>
+#include <QImage>
+#include <QStringList>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const int ITERATIONS = 10;
+
+    PixelBuffer createTestPixels(int width, int height)
+    {
+        PixelBuffer pixels = PixelBuffer::Allocate(width, height, PixelConverter::Format::BGRA);
+        if (pixels.IsNull())
+            return pixels;
+
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = pixels.ScanLine(y);
+            for (int x = 0; x < width; ++x)
+            {
+                row[x * 4 + 0] = static_cast<uint8_t>(x);
+                row[x * 4 + 1] = static_cast<uint8_t>(y);
+                row[x * 4 + 2] = static_cast<uint8_t>(x + y);
+                row[x * 4 + 3] = 0xFF;
+            }
+        }
+        return pixels;
+    }
+
+    template<typename Fn>
+    double measureOnce(Fn fn)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void printResult(const char* resolution, const char* path, double milliseconds)
+    {
+        if (milliseconds < 0.0)
+            std::printf("%-6s %-16s %10s\n", resolution, path, "failed");
+        else
+            std::printf("%-6s %-16s %10.2f ms\n", resolution, path, milliseconds);
+    }
+
+    template<typename Fn>
+    double measureBitmap(Fn createBitmap)
+    {
+        bool failed = false;
+        double milliseconds = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+        {
+            HBITMAP hBitmap = createBitmap();
+            if (hBitmap == NULL)
+                failed = true;
+            DeleteObject(hBitmap);
+        });
+
+        return failed ? -1.0 : milliseconds;
+    }
+
+    void runBitmapBenchmark(ThreadPool& pool)
+    {
+        std::printf("toHBITMAP (median of %d, threads %d)\n", ITERATIONS, pool.MaxThreadCount());
+
+        for (const Benchmark::Resolution& resolution : Benchmark::RESOLUTIONS)
+        {
+            PixelBuffer pixels = createTestPixels(resolution.width, resolution.height);
+            if (pixels.IsNull())
+            {
+                printResult(resolution.name, "allocation", -1.0);
+                continue;
+            }
+
+            QImage image(pixels.ConstBits(), pixels.Width(), pixels.Height(), pixels.Stride(), QImage::Format_ARGB32);
+
+            printResult(resolution.name, "bmp round-trip", measureBitmap([&]() { return LegacyToHBITMAP(image); }));
+            printResult(resolution.name, "dib section", measureBitmap([&]() { return DibSection::Create(pixels.View()); }));
+            printResult(resolution.name, "dib section mt", measureBitmap([&]() { return DibSection::Create(pixels.View(), &pool); }));
+        }
+    }
+
+    // 예전에는 static 초기화와 g_Clipboard 생성에서 (첫 창을 띄우기 전에) 하던 초기화.
+    // 지금은 처음 복사하거나 Warmup 할 때 하므로 그만큼 시작이 빨라진다. 첫 호출(cold)은 DLL 로드, 창 클래스 등록을 포함한다
+    void runStartupBenchmark(ThreadPool& pool)
+    {
+        std::printf("startup cost deferred to first use (cold, then median of %d)\n", ITERATIONS);
+
+        auto gdiplus = []()
+        {
+            Gdiplus::GdiplusStartupInput input;
+            ULONG_PTR token = 0;
+            if (Gdiplus::GdiplusStartup(&token, &input, NULL) == Gdiplus::Ok)
+                Gdiplus::GdiplusShutdown(token);
+        };
+        auto backend = [&pool]()
+        {
+            Win32ClipboardBackend backend(&pool);
+        };
+        auto thread = []()
+        {
+            std::thread worker([]() {});
+            worker.join();
+        };
+
+        const double cold[] = { measureOnce(gdiplus), measureOnce(backend), measureOnce(thread) };
+        const double warm[] = { Benchmark::MedianMilliseconds(ITERATIONS, gdiplus), Benchmark::MedianMilliseconds(ITERATIONS, backend),
+                                Benchmark::MedianMilliseconds(ITERATIONS, thread) };
+        const char* names[] = { "gdi+", "clipboard window", "worker thread" };
+
+        double saved = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            std::printf("%-6s %-16s %10.2f ms cold %10.2f ms warm\n", "start", names[i], cold[i], warm[i]);
+            saved += cold[i];
+        }
+        std::printf("%-6s %-16s %10.2f ms saved before the first window\n", "start", "total", saved);
+    }
+
+    // 꺼진 level 의 LOG_DEBUG 는 level 만 확인하고 끝난다. 예전처럼 stream 을 만들고 인자를 붙인 뒤 handler 가 버리는 경우와 비교
+    // log.cpp 의 handler 중 flight recorder 로 보내는 부분만 (파일에는 쓰지 않는다)
+    void captureOnlyHandler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+    {
+        const Log::Level level = type == QtDebugMsg ? Log::Level::Debug : Log::Level::Info;
+        if (!Log::IsEnabled(level) && Log::IsCaptured(level) && FlightRecorder::IsEnabled())
+        {
+            QByteArray text = msg.toUtf8();
+            FlightRecorder::Record(static_cast<int>(level), text.constData(), static_cast<size_t>(text.size()));
+        }
+    }
+
+    void runLogLevelBenchmark()
+    {
+        const int SUPPRESSED_CALLS = 10000000;
+        const int FORMATTED_CALLS = 100000;
+
+        QtMessageHandler previousHandler = qInstallMessageHandler(captureOnlyHandler);
+        const int previousLevel = Log::TraceLevel();
+        const bool previousRecorder = FlightRecorder::IsEnabled();
+        Log::SetFlightRecorderEnabled(false);
+        Log::SetTraceLevel(static_cast<int>(Log::Level::Info));
+
+        const QString text("clipboard");
+        const double suppressed = measureOnce([&]()
+        {
+            for (int i = 0; i < SUPPRESSED_CALLS; ++i)
+                LOG_DEBUG << text << i;
+        });
+        const double suppressedFormat = measureOnce([&]()
+        {
+            for (int i = 0; i < SUPPRESSED_CALLS; ++i)
+                LOGF_DEBUG("{} {}", "clipboard", i);
+        });
+        const double formatted = measureOnce([&]()
+        {
+            for (int i = 0; i < FORMATTED_CALLS; ++i)
+                qDebug() << __FUNCTION__ << text << i;
+        });
+
+        // flight recorder 를 켜도 LOG_DEBUG 는 level 만 보고, LOGF_DEBUG 는 문자열 하나를 만들어 ring 에 넣는다
+        Log::SetFlightRecorderEnabled(true);
+        const double captured = measureOnce([&]()
+        {
+            for (int i = 0; i < SUPPRESSED_CALLS; ++i)
+                LOG_DEBUG << text << i;
+        });
+        const double capturedFormat = measureOnce([&]()
+        {
+            for (int i = 0; i < FORMATTED_CALLS; ++i)
+                LOGF_DEBUG("{} {}", "clipboard", i);
+        });
+        Log::SetFlightRecorderEnabled(previousRecorder);
+        FlightRecorder::Take();
+
+        Log::SetTraceLevel(previousLevel);
+        qInstallMessageHandler(previousHandler);
+
+        std::printf("log level gating (trace level 3)\n");
+        std::printf("%-6s %-22s %10.2f ns per call\n", "log", "LOG_DEBUG off", suppressed * 1000000.0 / SUPPRESSED_CALLS);
+        std::printf("%-6s %-22s %10.2f ns per call\n", "log", "LOGF_DEBUG off", suppressedFormat * 1000000.0 / SUPPRESSED_CALLS);
+        std::printf("%-6s %-22s %10.2f ns per call\n", "log", "ungated qDebug", formatted * 1000000.0 / FORMATTED_CALLS);
+        std::printf("%-6s %-22s %10.2f ns per call\n", "log", "LOG_DEBUG recorder on", captured * 1000000.0 / SUPPRESSED_CALLS);
+        std::printf("%-6s %-22s %10.2f ns per call\n", "log", "LOGF_DEBUG recorder on", capturedFormat * 1000000.0 / FORMATTED_CALLS);
+    }
+
+    // 파일에 그대로 이어 쓴다. binary 면 열 때 preamble 을 먼저 쓴다
+    class FileSink : public LogSink
+    {
+    public:
+        FileSink(const QString& path, bool binary)
+            : file_(path)
+            , binary_(binary)
+        {}
+
+        bool Write(const char* data, size_t size) override
+        {
+            if (!file_.isOpen())
+            {
+                if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate))
+                    return false;
+                if (binary_)
+                {
+                    std::string preamble = BinaryLog::Preamble();
+                    file_.write(preamble.data(), static_cast<qint64>(preamble.size()));
+                }
+            }
+            return file_.write(data, static_cast<qint64>(size)) == static_cast<qint64>(size);
+        }
+
+        void Flush() override
+        {
+            file_.flush();
+        }
+
+    private:
+        QFile file_;
+        bool binary_;
+    };
+
+    AsyncLogWriter* textLogWriter = nullptr;
+
+    // log.cpp 의 handler 에서 stderr 출력만 뺀 것
+    void textLogHandler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+    {
+        if (textLogWriter)
+            textLogWriter->Push(Log::FormatRecord(type, msg));
+    }
+
+    // 같은 LOGF_INFO 를 text(문자열로 만들어 handler 로) 와 binary(값만 스레드 buffer 에) 로 남겨 파일에 다 쓸 때까지의 시간 비교
+    void runLogThroughputBenchmark()
+    {
+        const int RECORDS = 200000;
+        const QString directory = QDir::tempPath();
+        const int previousLevel = Log::TraceLevel();
+        Log::SetTraceLevel(static_cast<int>(Log::Level::Info));
+
+        std::printf("log throughput (%d records of LOGF_INFO, until written)\n", RECORDS);
+
+        AsyncLogWriter::Options options;
+        options.overflowPolicy = AsyncLogWriter::OverflowPolicy::Block;
+
+        QtMessageHandler previousHandler = qInstallMessageHandler(textLogHandler);
+        const double text = measureOnce([&]()
+        {
+            AsyncLogWriter writer(std::unique_ptr<LogSink>(new FileSink(directory + "/ClipboardBenchmark.log", false)), options);
+            textLogWriter = &writer;
+            for (int i = 0; i < RECORDS; ++i)
+                LOGF_INFO("copy {} took {} ms", i, 1.5);
+            writer.Flush();
+            textLogWriter = nullptr;
+        });
+        qInstallMessageHandler(previousHandler);
+
+        const double binary = measureOnce([&]()
+        {
+            BinaryLog::Open(std::unique_ptr<LogSink>(new FileSink(directory + "/ClipboardBenchmark.blog", true)), options);
+            for (int i = 0; i < RECORDS; ++i)
+                LOGF_INFO("copy {} took {} ms", i, 1.5);
+            BinaryLog::Close();
+        });
+
+        Log::SetTraceLevel(previousLevel);
+
+        const double textBytes = QFile(directory + "/ClipboardBenchmark.log").size();
+        const double binaryBytes = QFile(directory + "/ClipboardBenchmark.blog").size();
+        std::printf("%-6s %-16s %10.2f ms %10.0f records/s %8.1f MB\n", "log", "text", text, RECORDS / text * 1000.0, textBytes / 1048576.0);
+        std::printf("%-6s %-16s %10.2f ms %10.0f records/s %8.1f MB\n", "log", "binary", binary, RECORDS / binary * 1000.0, binaryBytes / 1048576.0);
+    }
+
+    uint64_t renderedBytes(const ClipboardBackend& backend)
+    {
+        uint64_t bytes = 0;
+        for (int i = 0; i < CLIPBOARD_FORMAT_COUNT; ++i)
+            bytes += backend.Stats(static_cast<ClipboardFormat>(i)).renderedBytes;
+        return bytes;
+    }
+
+    // 모든 포맷을 바로 만드는 경우와 PNG 만 붙여넣는 경우 비교
+    void runDelayedRenderingBenchmark(ThreadPool& pool)
+    {
+        std::printf("delayed rendering (median of %d, memory backend)\n", ITERATIONS);
+
+        for (const Benchmark::Resolution& resolution : Benchmark::RESOLUTIONS)
+        {
+            PixelBuffer pixels = createTestPixels(resolution.width, resolution.height);
+            if (pixels.IsNull())
+            {
+                printResult(resolution.name, "allocation", -1.0);
+                continue;
+            }
+
+            auto encoded = std::make_shared<std::vector<uint8_t>>();
+            PngEncoder encoder(PngEncoder::Options(), &pool);
+            encoder.Encode(pixels.View(), [&encoded](const uint8_t* data, size_t size)
+            {
+                encoded->insert(encoded->end(), data, data + size);
+                return true;
+            });
+
+            PixmapClipboardSource::EncodedBytes png;
+            png.owner = encoded;
+            png.data = encoded->data();
+            png.size = encoded->size();
+            auto source = std::make_shared<PixmapClipboardSource>(pixels, png, &pool);
+
+            MemoryClipboardBackend eager;
+            printResult(resolution.name, "eager all", Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                eager.Publish(source);
+                eager.RenderAll();
+            }));
+
+            MemoryClipboardBackend delayed;
+            printResult(resolution.name, "delayed png", Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                delayed.Publish(source);
+                delayed.Request(ClipboardFormat::Png, nullptr);
+            }));
+
+            std::printf("%-6s %-16s %10.1f MB -> %.1f MB per copy\n", resolution.name, "rendered",
+                        renderedBytes(eager) / (ITERATIONS + 1) / 1048576.0,
+                        renderedBytes(delayed) / (ITERATIONS + 1) / 1048576.0);
+        }
+    }
+
+    // 같은 크기의 이미지를 반복해서 복사할 때 버퍼를 새로 할당하는 경우와 pool 에서 다시 쓰는 경우 비교
+    void runBufferPoolBenchmark(ThreadPool& pool)
+    {
+        std::printf("buffer pool (median of %d)\n", ITERATIONS);
+
+        for (const Benchmark::Resolution& resolution : Benchmark::RESOLUTIONS)
+        {
+            PixelBuffer pixels = createTestPixels(resolution.width, resolution.height);
+            if (pixels.IsNull())
+            {
+                printResult(resolution.name, "allocation", -1.0);
+                continue;
+            }
+
+            // 변환 결과를 새 버퍼에 쓰고 PNG 를 인코딩하는 한 번의 복사
+            auto copyOnce = [&](BufferPool* buffers)
+            {
+                PixelBuffer target = PixelBuffer::Allocate(pixels.Width(), pixels.Height(), PixelConverter::Format::BGRA, buffers);
+                PixelConverter::ConvertRows(pixels.ConstBits(), pixels.Stride(), pixels.Format(),
+                                            target.Bits(), target.Stride(), PixelConverter::Format::BGRA,
+                                            pixels.Width(), pixels.Height());
+
+                ByteBuffer png(buffers);
+                PngEncoder encoder(PngEncoder::Options(), &pool, buffers);
+                encoder.Encode(target.View(), [&png](const uint8_t* data, size_t size)
+                {
+                    return png.Append(data, size);
+                });
+            };
+
+            printResult(resolution.name, "new buffers", Benchmark::MedianMilliseconds(ITERATIONS, [&]() { copyOnce(nullptr); }));
+
+            BufferPool buffers(256 * 1024 * 1024);
+            printResult(resolution.name, "pooled buffers", Benchmark::MedianMilliseconds(ITERATIONS, [&]() { copyOnce(&buffers); }));
+
+            BufferPoolStats stats = buffers.Stats();
+            std::printf("%-6s %-16s %llu / %llu reused, pooled %.1f MB, peak in use %.1f MB\n", resolution.name, "pool",
+                        static_cast<unsigned long long>(stats.reuses), static_cast<unsigned long long>(stats.acquires),
+                        stats.pooledBytes / 1048576.0, stats.peakOutstandingBytes / 1048576.0);
+        }
+    }
+
+    QByteArray saveImage(const QImage& image, const char* format)
+    {
+        QByteArray bytes;
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, format);
+        return bytes;
+    }
+
+    // 파일에서 읽은 이미지를 복사할 때: decode 후 PNG 로 다시 인코딩하는 경우와 원본을 그대로 올리는 경우 비교
+    void runPassthroughBenchmark(ThreadPool& pool)
+    {
+        std::printf("source passthrough (median of %d, memory backend, PNG + JFIF requested)\n", ITERATIONS);
+
+        for (const Benchmark::Resolution& resolution : Benchmark::RESOLUTIONS)
+        {
+            PixelBuffer pixels = createTestPixels(resolution.width, resolution.height);
+            if (pixels.IsNull())
+            {
+                printResult(resolution.name, "allocation", -1.0);
+                continue;
+            }
+
+            QImage image(pixels.ConstBits(), pixels.Width(), pixels.Height(), pixels.Stride(), QImage::Format_ARGB32);
+            const struct
+            {
+                const char* name;
+                QByteArray bytes;
+            } files[] =
+            {
+                { "png", saveImage(image, "PNG") },
+                { "jpeg", saveImage(image, "JPG") },
+            };
+
+            for (const auto& file : files)
+            {
+                MemoryClipboardBackend backend;
+
+                // 이전 방식: 원본을 decode 한 뒤 PNG 로 다시 인코딩해서 올린다
+                double reencode = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+                {
+                    QImage decoded = QImage::fromData(file.bytes).convertToFormat(QImage::Format_ARGB32);
+                    ImageView view = { decoded.constBits(), decoded.width(), decoded.height(), decoded.bytesPerLine(), PixelConverter::Format::BGRA };
+
+                    auto encoded = std::make_shared<std::vector<uint8_t>>();
+                    PngEncoder(PngEncoder::Options(), &pool).Encode(view, [&encoded](const uint8_t* data, size_t size)
+                    {
+                        encoded->insert(encoded->end(), data, data + size);
+                        return true;
+                    });
+
+                    PixmapClipboardSource::EncodedBytes png = { encoded, encoded->data(), encoded->size() };
+                    backend.Publish(std::make_shared<PixmapClipboardSource>(PixelBuffer(), png, &pool));
+                    backend.Request(ClipboardFormat::Png, nullptr);
+                });
+
+                // 원본을 그대로 올리고 픽셀 포맷은 요청이 없으므로 decode 하지 않는다
+                bool decoded = false;
+                double passthrough = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+                {
+                    auto bytes = std::make_shared<QByteArray>(file.bytes);
+                    PixmapClipboardSource::EncodedBytes encoded = { bytes, reinterpret_cast<const uint8_t*>(bytes->constData()), static_cast<size_t>(bytes->size()) };
+
+                    EncodedImage encodedImage = EncodedImage::Probe(encoded);
+                    auto source = std::make_shared<EncodedClipboardSource>(encodedImage, PixelBuffer(), nullptr);
+                    backend.Publish(source);
+                    backend.Request(encodedImage.kind == EncodedImage::Kind::Png ? ClipboardFormat::Png : ClipboardFormat::Jfif, nullptr);
+                    decoded = decoded || source->IsDecoded();
+                });
+
+                char path[32];
+                std::snprintf(path, sizeof(path), "%s re-encode", file.name);
+                printResult(resolution.name, path, reencode);
+                std::snprintf(path, sizeof(path), "%s passthrough", file.name);
+                printResult(resolution.name, path, decoded ? -1.0 : passthrough);
+                std::printf("%-6s %-16s %10.2f ms saved per copy (%.1f MB source)\n", resolution.name, file.name,
+                            reencode - passthrough, file.bytes.size() / 1048576.0);
+            }
+        }
+    }
+
+    void runReadBenchmark(ThreadPool& pool)
+    {
+        std::printf("clipboard read (median of %d, memory backend)\n", ITERATIONS);
+
+        for (const Benchmark::Resolution& resolution : Benchmark::RESOLUTIONS)
+        {
+            PixelBuffer pixels = createTestPixels(resolution.width, resolution.height);
+            if (pixels.IsNull())
+            {
+                printResult(resolution.name, "allocation", -1.0);
+                continue;
+            }
+
+            auto encoded = std::make_shared<std::vector<uint8_t>>();
+            PngEncoder(PngEncoder::Options(), &pool).Encode(pixels.View(), [&encoded](const uint8_t* data, size_t size)
+            {
+                encoded->insert(encoded->end(), data, data + size);
+                return true;
+            });
+
+            MemoryClipboardBackend backend;
+            PixmapClipboardSource::EncodedBytes png = { encoded, encoded->data(), encoded->size() };
+            backend.Publish(std::make_shared<PixmapClipboardSource>(pixels, png, &pool));
+
+            std::vector<uint8_t> dib;
+            backend.Request(ClipboardFormat::DibV5, &dib);
+
+            // 이전 방식: 전체 PNG 를 복사해 두고 QImage 로 decode
+            double qtDecode = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                std::vector<uint8_t> copied;
+                backend.Request(ClipboardFormat::Png, &copied);
+                QImage image = QImage::fromData(copied.data(), static_cast<int>(copied.size()), "PNG");
+            });
+
+            ClipboardReader reader(&pool);
+            QImage image;
+            auto allocate = [&image](int width, int height, bool hasAlpha)
+            {
+                image = QImage(width, height, hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+                ClipboardReader::Target target = { image.bits(), image.bytesPerLine() };
+                return target;
+            };
+
+            bool failed = false;
+            double streamDecode = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                failed = !reader.Read(backend, allocate).ok || failed;
+            });
+            printResult(resolution.name, "png qt", qtDecode);
+            printResult(resolution.name, "png stream", failed ? -1.0 : streamDecode);
+
+            // 다른 프로그램이 DIBV5 만 올린 경우
+            backend.SetData(ClipboardFormat::DibV5, dib);
+            double dibDecode = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                failed = !reader.Read(backend, allocate).ok || failed;
+            });
+            printResult(resolution.name, "dibv5", failed ? -1.0 : dibDecode);
+        }
+    }
+
+    // 주석 도구처럼 작은 영역만 고친 이미지를 반복해서 넣는 경우
+    void runIncrementalBenchmark(ThreadPool& pool)
+    {
+        std::printf("incremental re-encode (median of %d, 256 x 128 edit)\n", ITERATIONS);
+
+        for (const Benchmark::Resolution& resolution : Benchmark::RESOLUTIONS)
+        {
+            PixelBuffer frames[2] = { createTestPixels(resolution.width, resolution.height), createTestPixels(resolution.width, resolution.height) };
+            if (frames[0].IsNull() || frames[1].IsNull())
+            {
+                printResult(resolution.name, "allocation", -1.0);
+                continue;
+            }
+
+            // alpha 는 그대로 두고 색만 바꾼다
+            for (int y = resolution.height / 2; y < resolution.height / 2 + 128; ++y)
+            {
+                uint8_t* row = frames[1].ScanLine(y);
+                for (int x = resolution.width / 2; x < resolution.width / 2 + 256; ++x)
+                    std::memset(row + x * 4, 0x40, 3);
+            }
+
+            auto discard = [](const uint8_t*, size_t) { return true; };
+
+            int frame = 0;
+            double full = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                PngEncoder(PngEncoder::Options(), &pool).Encode(frames[frame ^= 1].View(), discard);
+            });
+
+            IncrementalPngEncoder encoder(PngEncoder::Options(), &pool);
+            encoder.Encode(frames[0].View(), std::vector<RowRange>(), discard);
+            frame = 0;
+            double incremental = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                const PixelBuffer& previous = frames[frame];
+                const PixelBuffer& current = frames[frame ^= 1];
+                encoder.Encode(current.View(), FrameDiff::ChangedRows(previous.View(), current.View(), &pool), discard);
+            });
+
+            IncrementalPngEncoder::Stats stats = encoder.LastStats();
+            printResult(resolution.name, "full", full);
+            printResult(resolution.name, "incremental", incremental);
+            std::printf("%-6s %-16s %d / %d bands\n", resolution.name, "re-encoded", stats.encodedBands, stats.bandCount);
+        }
+    }
+
+    // history 에서 되돌리는 시간을 PNG 를 다시 만드는 시간과 비교
+    void runHistoryBenchmark(ThreadPool& pool)
+    {
+        std::printf("history restore (median of %d)\n", ITERATIONS);
+
+        BufferPool buffers(256 * 1024 * 1024);
+        for (const Benchmark::Resolution& resolution : Benchmark::RESOLUTIONS)
+        {
+            PixelBuffer pixels = createTestPixels(resolution.width, resolution.height);
+            if (pixels.IsNull())
+            {
+                printResult(resolution.name, "allocation", -1.0);
+                continue;
+            }
+
+            ClipboardHistory history(1024 * 1024 * 1024, 1, &pool, &buffers);
+            ClipboardHistory::Item item;
+            item.pixels = pixels;
+            uint64_t id = history.Add(item);
+            if (id == 0)
+            {
+                printResult(resolution.name, "add", -1.0);
+                continue;
+            }
+
+            auto discard = [](const uint8_t*, size_t) { return true; };
+            double encode = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                PngEncoder(PngEncoder::Options(), &pool, &buffers).Encode(pixels.View(), discard);
+            });
+
+            bool failed = false;
+            double restore = Benchmark::MedianMilliseconds(ITERATIONS, [&]()
+            {
+                ClipboardHistory::Item restored;
+                failed = !history.Restore(id, &restored) || failed;
+            });
+
+            ClipboardHistoryStats stats = history.Stats();
+            printResult(resolution.name, "png re-encode", encode);
+            printResult(resolution.name, "compress", stats.lastCompressMilliseconds);
+            printResult(resolution.name, "restore", failed ? -1.0 : restore);
+            std::printf("%-6s %-16s %.2fx (%.1f MB -> %.1f MB)\n", resolution.name, "ratio", stats.CompressionRatio(),
+                        stats.rawBytes / 1048576.0, stats.storedBytes / 1048576.0);
+        }
+    }
+
+    // 원본 없이 row 를 만들어 내는 가상의 큰 이미지로 tile 단위 처리의 메모리 상한을 확인
+    void runTiledBenchmark(ThreadPool& pool, int width, int height, bool withDib)
+    {
+        std::printf("tiled pipeline %dx%d (%s)\n", width, height, withDib ? "dib + png" : "png only");
+
+        PixelBuffer dib;
+        if (withDib)
+        {
+            dib = PixelBuffer::Allocate(width, height, PixelConverter::Format::BGRA);
+            if (dib.IsNull())
+            {
+                printResult("tiled", "allocation", -1.0);
+                return;
+            }
+        }
+
+        auto readRows = [width](int firstRow, int rowCount, uint8_t* dest, int destStride)
+        {
+            for (int y = 0; y < rowCount; ++y)
+            {
+                uint8_t* row = dest + static_cast<size_t>(y) * destStride;
+                int imageY = firstRow + y;
+                for (int x = 0; x < width; ++x)
+                {
+                    row[x * 4 + 0] = static_cast<uint8_t>(x ^ imageY);
+                    row[x * 4 + 1] = static_cast<uint8_t>((x >> 4) + (imageY >> 4));
+                    row[x * 4 + 2] = static_cast<uint8_t>(imageY);
+                    row[x * 4 + 3] = 0;
+                }
+            }
+            return true;
+        };
+
+        uint64_t pngBytes = 0;
+        auto countBytes = [&pngBytes](const uint8_t*, size_t size)
+        {
+            pngBytes += size;
+            return true;
+        };
+
+        TiledPipeline pipeline(TiledPipeline::Options(), &pool);
+        TiledPipeline::Result result;
+        // 한 번 실행에도 오래 걸리므로 반복하지 않는다
+        auto start = std::chrono::steady_clock::now();
+        result = pipeline.Run(width, height, PixelConverter::Format::BGRX, readRows,
+                              withDib ? dib.Bits() : nullptr, dib.Stride(), countBytes);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        MemoryTracker::ProcessMemory memory = MemoryTracker::QueryProcessMemory();
+        printResult("tiled", result.ok ? "run" : "failed", result.ok ? milliseconds : -1.0);
+        std::printf("tiles %d x %d rows, working set %.1f MB, output %.1f MB, png %.1f MB, process peak %.1f MB\n",
+                    result.tileCount, result.tileRows, result.workingSetBytes / 1048576.0,
+                    dib.ByteCount() / 1048576.0, pngBytes / 1048576.0, memory.peakWorkingSetBytes / 1048576.0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication a(argc, argv);
+
+    // --suite [--json path ...]: 크기, 내용별 변환/인코딩 측정만 JSON 으로 (CMake 의 ClipboardBenchmarkSuite 와 같음)
+    if (QCoreApplication::arguments().contains("--suite"))
+    {
+        std::vector<std::string> args;
+        for (const QString& argument : QCoreApplication::arguments().mid(1))
+            args.push_back(argument.toStdString());
+        return BenchmarkSuite::Main(args);
+    }
+
+    ThreadPool pool;
+    // 다른 측정이 GDI+, clipboard 창을 먼저 쓰기 전에 cold 시간을 잰다
+    runStartupBenchmark(pool);
+    runLogLevelBenchmark();
+    runLogThroughputBenchmark();
+    runBitmapBenchmark(pool);
+    runDelayedRenderingBenchmark(pool);
+    runBufferPoolBenchmark(pool);
+    runPassthroughBenchmark(pool);
+    runReadBenchmark(pool);
+    runIncrementalBenchmark(pool);
+    runHistoryBenchmark(pool);
+
+    // --gigapixel: 32768 x 32768 (약 10억 픽셀) 을 PNG 로만 인코딩
+    if (QCoreApplication::arguments().contains("--gigapixel"))
+        runTiledBenchmark(pool, 32768, 32768, false);
+    else
+        runTiledBenchmark(pool, 8192, 8192, true);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,478 @@
+#include "suite.h"
+
+#include "bufferpool.h"
+#include "formatpolicy.h"
+#include "memoryclipboardbackend.h"
+#include "pixelconverter.h"
+#include "pixmapclipboardsource.h"
+#include "pngencoder.h"
+#include "threadpool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+namespace
+{
+    const int DEFAULT_ITERATIONS = 5;
+    const int CONVERT_GRAIN = 64;
+    const size_t POOL_LIMIT = 512 * 1024 * 1024; // 512MB
+
+    std::vector<std::string> split(const std::string& text)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            if (!item.empty())
+                items.push_back(item);
+        }
+        return items;
+    }
+
+    bool parseResolution(const std::string& name, Benchmark::Resolution* resolution)
+    {
+        for (const Benchmark::Resolution& candidate : Benchmark::SUITE_RESOLUTIONS)
+        {
+            if (name == candidate.name)
+            {
+                *resolution = candidate;
+                return true;
+            }
+        }
+
+        // 이름에 없는 크기는 1024x768 처럼
+        int width = 0;
+        int height = 0;
+        char x = 0;
+        std::stringstream stream(name);
+        if (!(stream >> width >> x >> height) || x != 'x' || width <= 0 || height <= 0)
+            return false;
+
+        // 이름은 문자열 상수만 가리키므로 목록에 없는 크기는 "custom"
+        *resolution = Benchmark::Resolution{ "custom", width, height };
+        return true;
+    }
+
+    bool parseStage(const std::string& name, BenchmarkSuite::Stage* stage)
+    {
+        for (BenchmarkSuite::Stage candidate : BenchmarkSuite::STAGES)
+        {
+            if (name == BenchmarkSuite::StageName(candidate))
+            {
+                *stage = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 복사 대상의 실제 포맷: 불투명한 캡처는 RGBA8888, alpha 가 있는 QPixmap 은 premultiplied
+    PixelConverter::Format inputFormat(TestImage::Content content)
+    {
+        return content == TestImage::Content::Alpha ? PixelConverter::Format::BGRAPremultiplied : PixelConverter::Format::RGBA;
+    }
+
+    const char* platformName()
+    {
+#if defined(_WIN32)
+        return "windows";
+#elif defined(__APPLE__)
+        return "macos";
+#else
+        return "linux";
+#endif
+    }
+
+    void appendNumber(std::string& json, const char* name, double value, bool comma = true)
+    {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "\"%s\":%.4f%s", name, value, comma ? "," : "");
+        json += buffer;
+    }
+
+    void appendInteger(std::string& json, const char* name, uint64_t value, bool comma = true)
+    {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "\"%s\":%llu%s", name, static_cast<unsigned long long>(value), comma ? "," : "");
+        json += buffer;
+    }
+
+    void appendString(std::string& json, const char* name, const char* value, bool comma = true)
+    {
+        // 이름은 모두 코드 안의 상수이므로 escape 하지 않는다
+        json += '"';
+        json += name;
+        json += "\":\"";
+        json += value;
+        json += comma ? "\"," : "\"";
+    }
+
+    void printResult(const BenchmarkSuite::Result& result)
+    {
+        if (!result.ok)
+        {
+            std::fprintf(stderr, "%-10s %-11s %-11s %10s\n", result.resolution.name, TestImage::ContentName(result.content),
+                         BenchmarkSuite::StageName(result.stage), "failed");
+            return;
+        }
+
+        std::fprintf(stderr, "%-10s %-11s %-11s %10.2f ms %10.1f MB\n", result.resolution.name, TestImage::ContentName(result.content),
+                     BenchmarkSuite::StageName(result.stage), result.milliseconds.median, result.outputBytes / 1048576.0);
+    }
+
+    class Runner
+    {
+    public:
+        explicit Runner(const BenchmarkSuite::Options& options)
+            : options_(options)
+            , pool_(options.threads)
+            , buffers_(POOL_LIMIT)
+        {}
+
+        BenchmarkSuite::Result Run(BenchmarkSuite::Stage stage, TestImage::Content content, const Benchmark::Resolution& resolution,
+                                   const PixelBuffer& input)
+        {
+            BenchmarkSuite::Result result = { stage, content, resolution, false, {}, 0 };
+            switch (stage)
+            {
+                case BenchmarkSuite::Stage::Convert:
+                    result.ok = convert(input, &result);
+                    break;
+                case BenchmarkSuite::Stage::DibV5:
+                    result.ok = dibV5(input, &result);
+                    break;
+                case BenchmarkSuite::Stage::Png:
+                    result.ok = png(input, &result);
+                    break;
+                case BenchmarkSuite::Stage::SetAndCopy:
+                    result.ok = setAndCopy(input, &result);
+                    break;
+            }
+            return result;
+        }
+
+        int ThreadCount() const
+        {
+            return pool_.MaxThreadCount();
+        }
+
+    private:
+        bool convert(const PixelBuffer& input, BenchmarkSuite::Result* result)
+        {
+            PixelBuffer target = PixelBuffer::Allocate(input.Width(), input.Height(), PixelConverter::Format::BGRA, &buffers_);
+            if (target.IsNull())
+                return false;
+
+            result->milliseconds = Benchmark::Measure(options_.iterations, [&]()
+            {
+                pool_.ParallelFor(0, input.Height(), CONVERT_GRAIN, [&](int begin, int end)
+                {
+                    PixelConverter::ConvertRows(input.ConstScanLine(begin), input.Stride(), input.Format(),
+                                                target.ScanLine(begin), target.Stride(), PixelConverter::Format::BGRA,
+                                                input.Width(), end - begin);
+                });
+            });
+            result->outputBytes = target.ByteCount();
+            return true;
+        }
+
+        bool dibV5(const PixelBuffer& input, BenchmarkSuite::Result* result)
+        {
+            PixmapClipboardSource source(input, PixmapClipboardSource::EncodedBytes(), &pool_);
+            const size_t size = source.FormatSize(ClipboardFormat::DibV5);
+            ByteBuffer dib(&buffers_);
+            if (size == 0 || !dib.Resize(size))
+                return false;
+
+            bool ok = true;
+            result->milliseconds = Benchmark::Measure(options_.iterations, [&]()
+            {
+                ok = source.Render(ClipboardFormat::DibV5, dib.Data(), size) && ok;
+            });
+            result->outputBytes = size;
+            return ok;
+        }
+
+        bool png(const PixelBuffer& input, BenchmarkSuite::Result* result)
+        {
+            bool ok = true;
+            size_t size = 0;
+            result->milliseconds = Benchmark::Measure(options_.iterations, [&]()
+            {
+                ByteBuffer png = encodePng(input);
+                ok = !png.IsEmpty() && ok;
+                size = png.Size();
+            });
+            result->outputBytes = size;
+            return ok;
+        }
+
+        // ClipboardWorker 의 SetPixmapData, CopyToClipboard 와 같은 순서. 다른 프로그램이 한 포맷을 붙여넣는 것까지
+        bool setAndCopy(const PixelBuffer& input, BenchmarkSuite::Result* result)
+        {
+            FormatPolicy policy;
+            MemoryClipboardBackend backend;
+            const FormatPolicy::Image image = { input.Width(), input.Height(), PixelConverter::HasAlpha(input.Format()) };
+
+            bool ok = true;
+            uint64_t bytes = 0;
+            result->milliseconds = Benchmark::Measure(options_.iterations, [&]()
+            {
+                ByteBuffer png(&buffers_);
+                if (policy.ShouldEncodePng(image))
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    png = encodePng(input);
+                    policy.RecordPngEncode(static_cast<uint64_t>(input.Width()) * input.Height(),
+                                           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+
+                PixmapClipboardSource::EncodedBytes encoded = { png.Owner(), png.ConstData(), png.Size() };
+                std::shared_ptr<const ClipboardSource> source = std::make_shared<PixmapClipboardSource>(input, encoded, &pool_);
+                FormatPolicy::Report report = policy.Choose(image, source->Formats(), !png.IsEmpty());
+                source = std::make_shared<PolicyClipboardSource>(source, report);
+                if (!backend.Publish(source))
+                {
+                    ok = false;
+                    return;
+                }
+
+                // 붙여넣는 쪽은 PNG 를 먼저 찾는다
+                std::vector<ClipboardFormat> formats = backend.AvailableFormats();
+                ClipboardFormat format = formats.empty() ? ClipboardFormat::DibV5 : formats.front();
+                for (ClipboardFormat available : formats)
+                {
+                    if (available == ClipboardFormat::Png)
+                        format = available;
+                }
+
+                std::vector<uint8_t> pasted;
+                ok = backend.Request(format, &pasted) && ok;
+                bytes = png.Size() + pasted.size();
+            });
+            result->outputBytes = bytes;
+            return ok;
+        }
+
+        ByteBuffer encodePng(const PixelBuffer& input)
+        {
+            ByteBuffer png(&buffers_);
+            png.Reserve(input.ByteCount() / 4);
+            PngEncoder encoder(PngEncoder::Options(), &pool_, &buffers_);
+            bool encoded = encoder.Encode(input.View(), [&png](const uint8_t* data, size_t size)
+            {
+                return png.Append(data, size);
+            });
+            return encoded ? png : ByteBuffer();
+        }
+
+    private:
+        const BenchmarkSuite::Options& options_;
+        ThreadPool pool_;
+        BufferPool buffers_;
+    };
+}
+
+namespace BenchmarkSuite
+{
+    const char* StageName(Stage stage)
+    {
+        switch (stage)
+        {
+            case Stage::Convert:
+                return "convert";
+            case Stage::DibV5:
+                return "dibv5";
+            case Stage::Png:
+                return "png";
+            case Stage::SetAndCopy:
+                return "set-copy";
+        }
+        return "";
+    }
+
+    // Options struct
+
+    Options::Options()
+        : iterations(DEFAULT_ITERATIONS)
+        , threads(0)
+        , resolutions(std::begin(Benchmark::SUITE_RESOLUTIONS), std::end(Benchmark::SUITE_RESOLUTIONS))
+        , contents(std::begin(TestImage::CONTENTS), std::end(TestImage::CONTENTS))
+        , stages(std::begin(STAGES), std::end(STAGES))
+        , jsonPath()
+    {}
+
+    bool ParseArguments(const std::vector<std::string>& args, Options* options, std::string* error)
+    {
+        auto fail = [error](const std::string& message)
+        {
+            if (error)
+                *error = message;
+            return false;
+        };
+
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& name = args[i];
+            if (name.compare(0, 2, "--") != 0)
+                continue;
+            // --suite 처럼 값이 없는 flag 는 다른 실행 모드가 쓴다
+            if (name != "--json" && name != "--iterations" && name != "--threads" && name != "--sizes" && name != "--content" && name != "--stages")
+                continue;
+            if (i + 1 >= args.size())
+                return fail("missing value for " + name);
+
+            const std::string& value = args[++i];
+            if (name == "--json")
+            {
+                options->jsonPath = value;
+            }
+            else if (name == "--iterations")
+            {
+                options->iterations = std::atoi(value.c_str());
+                if (options->iterations <= 0)
+                    return fail("invalid iterations: " + value);
+            }
+            else if (name == "--threads")
+            {
+                options->threads = std::atoi(value.c_str());
+            }
+            else if (name == "--sizes")
+            {
+                options->resolutions.clear();
+                for (const std::string& item : split(value))
+                {
+                    Benchmark::Resolution resolution;
+                    if (!parseResolution(item, &resolution))
+                        return fail("unknown size: " + item);
+                    options->resolutions.push_back(resolution);
+                }
+            }
+            else if (name == "--content")
+            {
+                options->contents.clear();
+                for (const std::string& item : split(value))
+                {
+                    TestImage::Content content;
+                    if (!TestImage::ParseContent(item, &content))
+                        return fail("unknown content: " + item);
+                    options->contents.push_back(content);
+                }
+            }
+            else
+            {
+                options->stages.clear();
+                for (const std::string& item : split(value))
+                {
+                    Stage stage;
+                    if (!parseStage(item, &stage))
+                        return fail("unknown stage: " + item);
+                    options->stages.push_back(stage);
+                }
+            }
+        }
+        return true;
+    }
+
+    std::vector<Result> Run(const Options& options)
+    {
+        Runner runner(options);
+        std::fprintf(stderr, "clipboard worker suite (median of %d, threads %d, %s)\n", options.iterations, runner.ThreadCount(),
+                     PixelConverter::IsaName(PixelConverter::ActiveIsa()));
+
+        std::vector<Result> results;
+        for (const Benchmark::Resolution& resolution : options.resolutions)
+        {
+            for (TestImage::Content content : options.contents)
+            {
+                // 이미지는 크기, 내용마다 한 번만 만든다
+                PixelBuffer input = TestImage::Create(content, resolution.width, resolution.height, inputFormat(content));
+                for (Stage stage : options.stages)
+                {
+                    Result result = { stage, content, resolution, false, {}, 0 };
+                    if (!input.IsNull())
+                        result = runner.Run(stage, content, resolution, input);
+
+                    printResult(result);
+                    results.push_back(result);
+                }
+            }
+        }
+        return results;
+    }
+
+    std::string ToJson(const Options& options, const std::vector<Result>& results)
+    {
+        std::string json = "{";
+        appendString(json, "suite", "clipboard-worker");
+        appendString(json, "platform", platformName());
+        appendString(json, "isa", PixelConverter::IsaName(PixelConverter::ActiveIsa()));
+        appendString(json, "pngPreset", PngEncoder::PresetName(PngEncoder::Options().preset));
+        appendInteger(json, "iterations", static_cast<uint64_t>(options.iterations));
+        appendInteger(json, "threads", static_cast<uint64_t>(options.threads > 0 ? options.threads : ThreadPool::DefaultThreadCount()));
+        json += "\"results\":[";
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& result = results[i];
+            const uint64_t pixels = static_cast<uint64_t>(result.resolution.width) * result.resolution.height;
+
+            json += i == 0 ? "\n{" : ",\n{";
+            appendString(json, "stage", StageName(result.stage));
+            appendString(json, "content", TestImage::ContentName(result.content));
+            appendString(json, "resolution", result.resolution.name);
+            appendInteger(json, "width", static_cast<uint64_t>(result.resolution.width));
+            appendInteger(json, "height", static_cast<uint64_t>(result.resolution.height));
+            json += result.ok ? "\"ok\":true," : "\"ok\":false,";
+            appendNumber(json, "medianMilliseconds", result.milliseconds.median);
+            appendNumber(json, "minMilliseconds", result.milliseconds.min);
+            appendNumber(json, "maxMilliseconds", result.milliseconds.max);
+            appendNumber(json, "megapixelsPerSecond", result.ok && result.milliseconds.median > 0 ? pixels / (result.milliseconds.median * 1000.0) : 0.0);
+            appendInteger(json, "outputBytes", result.outputBytes, false);
+            json += '}';
+        }
+        json += "\n]}\n";
+        return json;
+    }
+
+    int Main(const std::vector<std::string>& args)
+    {
+        Options options;
+        std::string error;
+        if (!ParseArguments(args, &options, &error))
+        {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            std::fprintf(stderr, "usage: [--json path] [--iterations n] [--threads n] [--sizes thumbnail,4K,1024x768] "
+                                 "[--content photo,screenshot,flat-ui,alpha] [--stages convert,dibv5,png,set-copy]\n");
+            return 2;
+        }
+
+        std::vector<Result> results = Run(options);
+        std::string json = ToJson(options, results);
+        if (options.jsonPath.empty())
+        {
+            std::fputs(json.c_str(), stdout);
+        }
+        else
+        {
+            std::ofstream file(options.jsonPath, std::ios::binary);
+            file << json;
+            if (!file)
+            {
+                std::fprintf(stderr, "cannot write %s\n", options.jsonPath.c_str());
+                return 1;
+            }
+        }
+
+        for (const Result& result : results)
+        {
+            if (!result.ok)
+                return 1;
+        }
+        return 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "benchmark.h"
+#include "testimage.h"
+
+#include <string>
+#include <vector>
+
+// Qt, Win32 없이 도는 변환, DIBV5, PNG, SetPixmapData -> CopyToClipboard 구간 측정. 결과는 JSON 으로 남긴다
+namespace BenchmarkSuite
+{
+    enum class Stage
+    {
+        Convert,        // 입력 포맷 -> BGRA
+        DibV5,          // CF_DIBV5 렌더링
+        Png,            // PNG 인코딩
+        SetAndCopy,     // PNG 준비, 포맷 선택, memory backend 에 올리고 붙여넣기 한 번
+    };
+
+    const Stage STAGES[] = { Stage::Convert, Stage::DibV5, Stage::Png, Stage::SetAndCopy };
+
+    const char* StageName(Stage stage);
+
+    struct Options
+    {
+        Options();
+
+        int iterations;
+        int threads;                    // 0 이면 기본값
+        std::vector<Benchmark::Resolution> resolutions;
+        std::vector<TestImage::Content> contents;
+        std::vector<Stage> stages;
+        std::string jsonPath;           // 비어 있으면 JSON 을 stdout 에 쓴다
+    };
+
+    struct Result
+    {
+        Stage stage;
+        TestImage::Content content;
+        Benchmark::Resolution resolution;
+        bool ok;
+        Benchmark::Timing milliseconds;
+        uint64_t outputBytes;           // 만들어진 데이터 크기 (PNG, DIBV5 등)
+    };
+
+    // --json path --iterations n --threads n --sizes 4K,8K --content photo,alpha --stages png
+    bool ParseArguments(const std::vector<std::string>& args, Options* options, std::string* error = nullptr);
+
+    std::vector<Result> Run(const Options& options);
+    std::string ToJson(const Options& options, const std::vector<Result>& results);
+
+    // 실행 파일 진입점. 측정이 하나라도 실패하면 1
+    int Main(const std::vector<std::string>& args);
+}
\ No newline at end of file
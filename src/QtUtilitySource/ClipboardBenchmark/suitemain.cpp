@@ -0,0 +1,10 @@
+#include "suite.h"
+
+#include <string>
+#include <vector>
+
+// Qt, Win32 없이 빌드되는 benchmark (CMake). Windows 에서는 ClipboardBenchmark --suite 로도 실행할 수 있다
+int main(int argc, char *argv[])
+{
+    return BenchmarkSuite::Main(std::vector<std::string>(argv + 1, argv + argc));
+}
\ No newline at end of file
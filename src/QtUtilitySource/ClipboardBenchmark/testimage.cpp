@@ -0,0 +1,293 @@
+#include "testimage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const int PHOTO_GRID = 64;
+
+    // 재현 가능한 잡음 (xorshift32)
+    class Random
+    {
+    public:
+        explicit Random(uint32_t seed)
+            : state_(seed != 0 ? seed : 1)
+        {}
+
+        uint32_t Next()
+        {
+            state_ ^= state_ << 13;
+            state_ ^= state_ >> 17;
+            state_ ^= state_ << 5;
+            return state_;
+        }
+
+        int Range(int begin, int end)
+        {
+            return begin + static_cast<int>(Next() % static_cast<uint32_t>(std::max(end - begin, 1)));
+        }
+
+    private:
+        uint32_t state_;
+    };
+
+    uint8_t clampByte(int value)
+    {
+        return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+    }
+
+    void setPixel(uint8_t* pixel, uint32_t bgr, uint8_t alpha = 0xFF)
+    {
+        pixel[0] = static_cast<uint8_t>(bgr);
+        pixel[1] = static_cast<uint8_t>(bgr >> 8);
+        pixel[2] = static_cast<uint8_t>(bgr >> 16);
+        pixel[3] = alpha;
+    }
+
+    void fillRect(PixelBuffer& pixels, int left, int top, int width, int height, uint32_t bgr)
+    {
+        const int right = std::min(left + width, pixels.Width());
+        const int bottom = std::min(top + height, pixels.Height());
+        for (int y = std::max(top, 0); y < bottom; ++y)
+        {
+            uint8_t* row = pixels.ScanLine(y);
+            for (int x = std::max(left, 0); x < right; ++x)
+                setPixel(row + x * 4, bgr);
+        }
+    }
+
+    void strokeRect(PixelBuffer& pixels, int left, int top, int width, int height, uint32_t bgr)
+    {
+        fillRect(pixels, left, top, width, 1, bgr);
+        fillRect(pixels, left, top + height - 1, width, 1, bgr);
+        fillRect(pixels, left, top, 1, height, bgr);
+        fillRect(pixels, left + width - 1, top, 1, height, bgr);
+    }
+
+    // 격자 점의 색을 bilinear 로 이어 큰 색 변화를 만들고 픽셀마다 잡음을 더한다
+    void drawPhoto(PixelBuffer& pixels, int left, int top, int width, int height, uint32_t seed)
+    {
+        Random random(seed);
+        const int columns = width / PHOTO_GRID + 2;
+        const int rows = height / PHOTO_GRID + 2;
+        std::vector<uint8_t> grid(static_cast<size_t>(columns) * rows * 3);
+        for (uint8_t& value : grid)
+            value = static_cast<uint8_t>(random.Range(16, 240));
+
+        for (int y = 0; y < height && top + y < pixels.Height(); ++y)
+        {
+            uint8_t* row = pixels.ScanLine(top + y);
+            const int gy = y / PHOTO_GRID;
+            const int fy = y % PHOTO_GRID;
+            for (int x = 0; x < width && left + x < pixels.Width(); ++x)
+            {
+                const int gx = x / PHOTO_GRID;
+                const int fx = x % PHOTO_GRID;
+                const uint8_t* c00 = &grid[(static_cast<size_t>(gy) * columns + gx) * 3];
+                const uint8_t* c01 = c00 + 3;
+                const uint8_t* c10 = c00 + columns * 3;
+                const uint8_t* c11 = c10 + 3;
+                const int noise = static_cast<int>(random.Next() & 15) - 8;
+
+                uint8_t* pixel = row + (left + x) * 4;
+                for (int c = 0; c < 3; ++c)
+                {
+                    const int topValue = c00[c] * (PHOTO_GRID - fx) + c01[c] * fx;
+                    const int bottomValue = c10[c] * (PHOTO_GRID - fx) + c11[c] * fx;
+                    pixel[c] = clampByte((topValue * (PHOTO_GRID - fy) + bottomValue * fy) / (PHOTO_GRID * PHOTO_GRID) + noise);
+                }
+                pixel[3] = 0xFF;
+            }
+        }
+    }
+
+    // 8 x 12 칸마다 획 몇 개로 된 글자 모양
+    void drawText(PixelBuffer& pixels, int left, int top, int width, int lines, Random& random)
+    {
+        const uint32_t ink = 0x202020;
+        for (int line = 0; line < lines; ++line)
+        {
+            const int baseline = top + line * 18;
+            const int length = random.Range(width / 3, width);
+            for (int x = 0; x + 8 <= length; x += 8)
+            {
+                // 단어 사이 공백
+                if (random.Range(0, 6) == 0)
+                    continue;
+
+                const uint32_t strokes = random.Next();
+                if (strokes & 1)
+                    fillRect(pixels, left + x + 1, baseline, 1, 12, ink);
+                if (strokes & 2)
+                    fillRect(pixels, left + x + 5, baseline + 3, 1, 9, ink);
+                if (strokes & 4)
+                    fillRect(pixels, left + x + 1, baseline + 3, 5, 1, ink);
+                if (strokes & 8)
+                    fillRect(pixels, left + x + 1, baseline + 11, 5, 1, ink);
+                if (strokes & 16)
+                    fillRect(pixels, left + x + 1, baseline + 7, 5, 1, ink);
+            }
+        }
+    }
+
+    void drawScreenshot(PixelBuffer& pixels)
+    {
+        Random random(0x5C4EE);
+        fillRect(pixels, 0, 0, pixels.Width(), pixels.Height(), 0x3A6EA5);
+
+        // 겹쳐진 창
+        const int windowCount = std::max(1, pixels.Width() * pixels.Height() / (1280 * 720) * 3);
+        for (int i = 0; i < windowCount; ++i)
+        {
+            const int width = random.Range(pixels.Width() / 3, pixels.Width());
+            const int height = random.Range(pixels.Height() / 3, pixels.Height());
+            const int left = random.Range(0, pixels.Width() - width + 1);
+            const int top = random.Range(0, pixels.Height() - height + 1);
+
+            fillRect(pixels, left, top, width, height, 0xF0F0F0);
+            fillRect(pixels, left, top, width, 24, 0xD6D3CE);
+            strokeRect(pixels, left, top, width, height, 0x808080);
+            drawText(pixels, left + 12, top + 36, width - 24, std::max(0, (height - 48) / 18), random);
+
+            // 창 안의 사진이나 아이콘 영역
+            if (width > 64 && height > 64 && random.Range(0, 2) == 0)
+                drawPhoto(pixels, left + width / 2, top + height / 3, width / 2 - 12, height / 2, random.Next());
+        }
+    }
+
+    void drawFlatUi(PixelBuffer& pixels)
+    {
+        const uint32_t palette[] = { 0xFAFAFA, 0xEEEEEE, 0x1E88E5, 0x43A047, 0xE53935, 0x424242, 0xFFC107 };
+        Random random(0xF1A7);
+        fillRect(pixels, 0, 0, pixels.Width(), pixels.Height(), palette[0]);
+
+        // 상단 바, 옆 메뉴, 카드와 버튼
+        fillRect(pixels, 0, 0, pixels.Width(), std::max(pixels.Height() / 16, 8), palette[2]);
+        fillRect(pixels, 0, pixels.Height() / 16, pixels.Width() / 6, pixels.Height(), palette[1]);
+
+        const int cardCount = std::max(4, pixels.Width() * pixels.Height() / (256 * 256));
+        for (int i = 0; i < cardCount; ++i)
+        {
+            const int width = random.Range(std::max(pixels.Width() / 12, 8), std::max(pixels.Width() / 4, 9));
+            const int height = random.Range(std::max(pixels.Height() / 12, 8), std::max(pixels.Height() / 4, 9));
+            const int left = random.Range(pixels.Width() / 6, pixels.Width());
+            const int top = random.Range(pixels.Height() / 16, pixels.Height());
+
+            fillRect(pixels, left, top, width, height, 0xFFFFFF);
+            strokeRect(pixels, left, top, width, height, palette[1]);
+            fillRect(pixels, left + width / 8, top + height * 2 / 3, width / 3, height / 5, palette[random.Range(2, 7)]);
+        }
+    }
+
+    // 부드러운 가장자리의 원과 아래쪽 반투명 그림자. straight alpha
+    void drawAlpha(PixelBuffer& pixels)
+    {
+        const int width = pixels.Width();
+        const int height = pixels.Height();
+        std::memset(pixels.Bits(), 0, static_cast<size_t>(pixels.Stride()) * height);
+
+        const float centerX = width * 0.5f;
+        const float centerY = height * 0.45f;
+        const float radius = std::min(width, height) * 0.35f;
+        const float edge = std::max(radius * 0.02f, 1.5f);
+        const float shadowOffset = radius * 0.08f;
+
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = pixels.ScanLine(y);
+            for (int x = 0; x < width; ++x)
+            {
+                const float dx = x + 0.5f - centerX;
+                const float dy = y + 0.5f - centerY;
+                const float distance = std::sqrt(dx * dx + dy * dy);
+                const float coverage = std::min(std::max((radius - distance) / edge, 0.0f), 1.0f);
+
+                const float shadowY = dy - shadowOffset;
+                const float shadowDistance = std::sqrt(dx * dx + shadowY * shadowY);
+                const float shadow = std::min(std::max((radius + shadowOffset * 2 - shadowDistance) / (shadowOffset * 2), 0.0f), 1.0f) * 0.4f;
+
+                uint8_t* pixel = row + x * 4;
+                if (coverage > 0.0f)
+                {
+                    pixel[0] = static_cast<uint8_t>(255 * x / std::max(width - 1, 1));
+                    pixel[1] = static_cast<uint8_t>(160 + 95 * y / std::max(height - 1, 1));
+                    pixel[2] = 0x40;
+                    pixel[3] = static_cast<uint8_t>(std::lround(255 * (coverage + shadow * (1 - coverage))));
+                }
+                else if (shadow > 0.0f)
+                {
+                    pixel[3] = static_cast<uint8_t>(std::lround(255 * shadow));
+                }
+            }
+        }
+    }
+}
+
+namespace TestImage
+{
+    const char* ContentName(Content content)
+    {
+        switch (content)
+        {
+            case Content::Photo:
+                return "photo";
+            case Content::Screenshot:
+                return "screenshot";
+            case Content::FlatUi:
+                return "flat-ui";
+            case Content::Alpha:
+                return "alpha";
+        }
+        return "";
+    }
+
+    bool ParseContent(const std::string& name, Content* content)
+    {
+        for (Content candidate : CONTENTS)
+        {
+            if (name == ContentName(candidate))
+            {
+                *content = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    PixelBuffer Create(Content content, int width, int height, PixelConverter::Format format)
+    {
+        PixelBuffer pixels = PixelBuffer::Allocate(width, height, PixelConverter::Format::BGRA);
+        if (pixels.IsNull())
+            return pixels;
+
+        switch (content)
+        {
+            case Content::Photo:
+                drawPhoto(pixels, 0, 0, width, height, 0x9107);
+                break;
+            case Content::Screenshot:
+                drawScreenshot(pixels);
+                break;
+            case Content::FlatUi:
+                drawFlatUi(pixels);
+                break;
+            case Content::Alpha:
+                drawAlpha(pixels);
+                break;
+        }
+
+        if (format == PixelConverter::Format::BGRA)
+            return pixels;
+
+        PixelBuffer converted = PixelBuffer::Allocate(width, height, format);
+        if (converted.IsNull())
+            return converted;
+
+        PixelConverter::ConvertRows(pixels.ConstBits(), pixels.Stride(), PixelConverter::Format::BGRA,
+                                    converted.Bits(), converted.Stride(), format, width, height);
+        return converted;
+    }
+}
\ No newline at end of file
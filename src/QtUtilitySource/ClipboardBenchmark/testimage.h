@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pixelbuffer.h"
+
+#include <string>
+
+// benchmark 용 합성 이미지. 압축률과 변환 경로가 실제 복사 대상과 비슷하도록 내용 종류별로 만든다
+namespace TestImage
+{
+    enum class Content
+    {
+        Photo,          // 부드러운 색 변화 + 잡음. PNG 가 잘 줄지 않는다
+        Screenshot,     // 밝은 배경의 창, 글자 모양, 일부 사진 영역
+        FlatUi,         // 단색 면과 1px 테두리. PNG 가 아주 잘 줄어든다
+        Alpha,          // 투명 배경 위의 부드러운 가장자리와 반투명 그림자
+    };
+
+    const Content CONTENTS[] = { Content::Photo, Content::Screenshot, Content::FlatUi, Content::Alpha };
+
+    const char* ContentName(Content content);
+    bool ParseContent(const std::string& name, Content* content);
+
+    // 같은 인자면 항상 같은 픽셀. format 이 premultiplied 면 변환해서 돌려준다
+    PixelBuffer Create(Content content, int width, int height, PixelConverter::Format format = PixelConverter::Format::BGRA);
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "asynclogwriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+    const size_t DEFAULT_MAX_RECORDS = 8192;
+    const size_t DEFAULT_MAX_BYTES = 4 * 1024 * 1024; // 4MB
+}
+
+// Options struct
+
+AsyncLogWriter::Options::Options()
+    : maxQueuedRecords(DEFAULT_MAX_RECORDS)
+    , maxQueuedBytes(DEFAULT_MAX_BYTES)
+    , overflowPolicy(OverflowPolicy::DropAndReport)
+    , writeRetryCount(3)
+    , writeRetryMilliseconds(100)
+{}
+
+// Public
+
+AsyncLogWriter::AsyncLogWriter(std::unique_ptr<LogSink> sink, const Options& options)
+    : sink_(std::move(sink))
+    , options_(options)
+    , mutex_()
+    , notEmpty_()
+    , notFull_()
+    , written_()
+    , queue_()
+    , queuedBytes_(0)
+    , pushedSequence_(0)
+    , writtenSequence_(0)
+    , unreportedDrops_(0)
+    , stop_(false)
+    , stats_()
+    , thread_()
+    , threadId_()
+{
+    options_.maxQueuedRecords = std::max<size_t>(options_.maxQueuedRecords, 1);
+    queue_.reserve(std::min<size_t>(options_.maxQueuedRecords, 1024));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    thread_ = std::thread(&AsyncLogWriter::run, this);
+    threadId_ = thread_.get_id();
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    notEmpty_.notify_all();
+    notFull_.notify_all();
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+bool AsyncLogWriter::Push(std::string record)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    auto isFull = [this, &record]()
+    {
+        // 하나도 없을 때는 크기가 커도 받는다
+        return !queue_.empty()
+            && (queue_.size() >= options_.maxQueuedRecords || queuedBytes_ + record.size() > options_.maxQueuedBytes);
+    };
+
+    if (isFull())
+    {
+        // writer 스레드 안에서 나온 로그(sink 의 경고 등)는 기다리면 멈추므로 버린다
+        const bool canBlock = options_.overflowPolicy == OverflowPolicy::Block && std::this_thread::get_id() != threadId_;
+        if (canBlock)
+        {
+            ++stats_.blockedPushes;
+            notFull_.wait(lock, [this, &isFull]()
+            {
+                return stop_ || !isFull() || options_.overflowPolicy != OverflowPolicy::Block;
+            });
+        }
+
+        if (isFull() || stop_)
+        {
+            ++stats_.dropped;
+            ++unreportedDrops_;
+            return false;
+        }
+    }
+
+    queuedBytes_ += record.size();
+    queue_.push_back(std::move(record));
+    ++pushedSequence_;
+    ++stats_.pushed;
+    stats_.maxQueuedRecords = std::max(stats_.maxQueuedRecords, queue_.size());
+
+    // writer 가 batch 를 쓰는 중이면 깨울 필요가 없다
+    if (queue_.size() == 1)
+        notEmpty_.notify_one();
+    return true;
+}
+
+bool AsyncLogWriter::Flush(int timeoutMilliseconds)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // writer 스레드에서 기다리면 끝나지 않는다
+    if (std::this_thread::get_id() == threadId_)
+        return false;
+
+    const uint64_t target = pushedSequence_;
+    auto done = [this, target]() { return writtenSequence_ >= target || stop_; };
+    if (timeoutMilliseconds < 0)
+    {
+        written_.wait(lock, done);
+        return writtenSequence_ >= target;
+    }
+
+    return written_.wait_for(lock, std::chrono::milliseconds(timeoutMilliseconds), done) && writtenSequence_ >= target;
+}
+
+void AsyncLogWriter::SetOverflowPolicy(OverflowPolicy policy)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.overflowPolicy = policy;
+    }
+
+    // Block 에서 바뀌었으면 기다리던 스레드가 버리고 돌아가게 한다
+    notFull_.notify_all();
+}
+
+AsyncLogWriter::OverflowPolicy AsyncLogWriter::GetOverflowPolicy() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return options_.overflowPolicy;
+}
+
+AsyncLogWriter::Stats AsyncLogWriter::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+const char* AsyncLogWriter::OverflowPolicyName(OverflowPolicy policy)
+{
+    switch (policy)
+    {
+        case OverflowPolicy::Block:
+            return "block";
+        case OverflowPolicy::Drop:
+            return "drop";
+        case OverflowPolicy::DropAndReport:
+            return "drop and report";
+    }
+    return "";
+}
+
+// Private
+
+void AsyncLogWriter::run()
+{
+    std::vector<std::string> batch;
+    batch.reserve(queue_.capacity());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        notEmpty_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (queue_.empty() && stop_)
+            break;
+
+        // 쌓인 것을 통째로 가져와 lock 밖에서 쓴다
+        batch.swap(queue_);
+        queuedBytes_ = 0;
+        uint64_t droppedToReport = 0;
+        if (options_.overflowPolicy == OverflowPolicy::DropAndReport)
+            droppedToReport = unreportedDrops_;
+        unreportedDrops_ = 0;
+        lock.unlock();
+        notFull_.notify_all();
+
+        writeBatch(batch, droppedToReport);
+
+        lock.lock();
+        writtenSequence_ += batch.size();
+        batch.clear();
+        written_.notify_all();
+    }
+
+    // 마지막 batch 뒤에 버린 것
+    if (options_.overflowPolicy == OverflowPolicy::DropAndReport && unreportedDrops_ != 0)
+    {
+        const uint64_t droppedToReport = unreportedDrops_;
+        unreportedDrops_ = 0;
+        lock.unlock();
+        writeBatch(batch, droppedToReport);
+        lock.lock();
+    }
+
+    // 끝난 뒤의 Flush 가 기다리지 않게 한다
+    writtenSequence_ = pushedSequence_;
+    written_.notify_all();
+}
+
+void AsyncLogWriter::writeBatch(std::vector<std::string>& batch, uint64_t droppedToReport)
+{
+    size_t bytes = 0;
+    for (const std::string& record : batch)
+        bytes += record.size();
+
+    std::string buffer;
+    buffer.reserve(bytes + 64);
+    if (droppedToReport != 0)
+    {
+        char line[64];
+        std::snprintf(line, sizeof(line), "[Log] %llu messages dropped\n", static_cast<unsigned long long>(droppedToReport));
+        buffer += line;
+    }
+    for (const std::string& record : batch)
+        buffer += record;
+
+    bool ok = sink_->Write(buffer.data(), buffer.size());
+    for (int retry = 0; !ok && retry < options_.writeRetryCount; ++retry)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(options_.writeRetryMilliseconds));
+        ok = sink_->Write(buffer.data(), buffer.size());
+    }
+    if (ok)
+        sink_->Flush();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.batches;
+    if (ok)
+        stats_.written += batch.size();
+    else
+        stats_.failed += batch.size();
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 로그가 최종적으로 쓰이는 곳. writer 스레드에서만 호출된다
+class LogSink
+{
+public:
+    virtual ~LogSink() {}
+
+    // 여러 record 를 이어 붙인 한 묶음. 실패하면 false
+    virtual bool Write(const char* data, size_t size) = 0;
+    virtual void Flush() {}
+};
+
+// 로그를 남기는 스레드는 record 를 queue 에 넣기만 하고, writer 스레드 하나가 모아서 sink 에 쓴다.
+// 파일 열기, 크기 확인, 재시도 같은 느린 일이 GUI 스레드에서 일어나지 않는다
+class AsyncLogWriter
+{
+public:
+    // queue 가 가득 찼을 때
+    enum class OverflowPolicy
+    {
+        Block,          // 자리가 날 때까지 기다린다 (로그를 잃지 않음)
+        Drop,           // 버리고 개수만 센다
+        DropAndReport,  // 버리고, 자리가 나면 버린 개수를 로그에 한 줄 남긴다
+    };
+
+    struct Options
+    {
+        Options();
+
+        size_t maxQueuedRecords;
+        size_t maxQueuedBytes;
+        OverflowPolicy overflowPolicy;
+        int writeRetryCount;            // sink 가 실패하면 writer 스레드에서 다시 시도할 횟수
+        int writeRetryMilliseconds;
+    };
+
+    struct Stats
+    {
+        uint64_t pushed;
+        uint64_t written;
+        uint64_t dropped;               // queue 가 가득 차서 버린 것
+        uint64_t failed;                // sink 가 끝내 쓰지 못한 것
+        uint64_t batches;
+        uint64_t blockedPushes;         // Block 으로 기다린 횟수
+        size_t maxQueuedRecords;        // 가장 많이 쌓였을 때
+    };
+
+public:
+    explicit AsyncLogWriter(std::unique_ptr<LogSink> sink, const Options& options = Options());
+    // 남은 record 를 모두 쓰고 스레드를 끝낸다
+    ~AsyncLogWriter();
+
+    AsyncLogWriter(const AsyncLogWriter&) = delete;
+    AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+public:
+    // record 는 줄바꿈까지 포함한 한 줄. 버렸으면 false
+    bool Push(std::string record);
+
+    // 지금까지 넣은 record 가 sink 에 쓰일 때까지 기다린다 (fatal, 종료 직전). 시간 안에 끝나지 않으면 false
+    bool Flush(int timeoutMilliseconds = -1);
+
+    void SetOverflowPolicy(OverflowPolicy policy);
+    OverflowPolicy GetOverflowPolicy() const;
+    Stats GetStats() const;
+
+    static const char* OverflowPolicyName(OverflowPolicy policy);
+
+private:
+    void run();
+    void writeBatch(std::vector<std::string>& batch, uint64_t droppedToReport);
+
+private:
+    std::unique_ptr<LogSink> sink_;
+    Options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::condition_variable written_;
+    std::vector<std::string> queue_;
+    size_t queuedBytes_;
+    uint64_t pushedSequence_;       // 받아들인 record 수
+    uint64_t writtenSequence_;      // sink 에 넘긴 record 수 (실패 포함)
+    uint64_t unreportedDrops_;
+    bool stop_;
+    Stats stats_;
+    std::thread thread_;
+    std::thread::id threadId_;
+};
\ No newline at end of file
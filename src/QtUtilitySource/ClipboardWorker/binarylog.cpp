@@ -0,0 +1,435 @@
+#include "binarylog.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int FLUSH_INTERVAL_MILLISECONDS = 200;
+
+    struct Site
+    {
+        int level;
+        const char* function;
+        const char* format;
+    };
+
+    struct State
+    {
+        std::mutex mutex;
+        std::vector<Site> sites;
+        std::vector<std::shared_ptr<BinaryLog::Internal::ThreadBuffer>> buffers;
+        std::shared_ptr<AsyncLogWriter> writer;
+        std::thread flusher;
+        std::condition_variable flusherCondition;
+        bool stopping = false;
+        BinaryLog::Stats stats = {};
+
+        // Close 하지 않고 끝나는 경우
+        ~State()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            flusherCondition.notify_all();
+            if (flusher.joinable())
+                flusher.join();
+        }
+    };
+
+    State& state()
+    {
+        static State instance;
+        return instance;
+    }
+
+    uint32_t currentThreadId()
+    {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentThreadId());
+#else
+        return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+    }
+
+    uint32_t currentProcessId()
+    {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+        return static_cast<uint32_t>(getpid());
+#endif
+    }
+
+    void resetChunk(std::string& data)
+    {
+        data.clear();
+        data.reserve(BinaryLog::Internal::CHUNK_BYTES + 256);
+        data.resize(BinaryLog::Internal::CHUNK_HEADER_BYTES);
+    }
+
+    void writeFrameHeader(char* out, BinaryLog::Frame frame, size_t payloadBytes)
+    {
+        const uint32_t size = static_cast<uint32_t>(payloadBytes);
+        out[0] = static_cast<char>(frame);
+        std::memcpy(out + 1, &size, sizeof(size));
+    }
+
+    void appendText(std::string& out, const char* text)
+    {
+        const uint32_t size = static_cast<uint32_t>(std::strlen(text));
+        BinaryLog::Internal::appendRaw(out, size);
+        out.append(text, size);
+    }
+
+    std::string siteFrame(uint32_t id, const Site& site)
+    {
+        std::string frame(BinaryLog::FRAME_HEADER_BYTES, '\0');
+        BinaryLog::Internal::appendRaw(frame, id);
+        frame.push_back(static_cast<char>(site.level));
+        appendText(frame, site.function);
+        appendText(frame, site.format);
+        writeFrameHeader(&frame[0], BinaryLog::Frame::Site, frame.size() - BinaryLog::FRAME_HEADER_BYTES);
+        return frame;
+    }
+
+    std::vector<std::shared_ptr<BinaryLog::Internal::ThreadBuffer>> registeredBuffers()
+    {
+        State& current = state();
+        std::lock_guard<std::mutex> lock(current.mutex);
+        return current.buffers;
+    }
+
+    void submitAll()
+    {
+        for (const std::shared_ptr<BinaryLog::Internal::ThreadBuffer>& buffer : registeredBuffers())
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            BinaryLog::Internal::Submit(*buffer);
+        }
+    }
+
+    // 한가한 스레드의 buffer 가 오래 남아 있지 않도록 주기적으로 넘긴다
+    void runFlusher()
+    {
+        State& current = state();
+        std::unique_lock<std::mutex> lock(current.mutex);
+        while (!current.stopping)
+        {
+            current.flusherCondition.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MILLISECONDS));
+            if (current.stopping)
+                break;
+
+            lock.unlock();
+            submitAll();
+            lock.lock();
+        }
+    }
+
+    // 스레드가 끝날 때 남은 record 를 넘기고 목록에서 뺀다
+    struct LocalHolder
+    {
+        std::shared_ptr<BinaryLog::Internal::ThreadBuffer> buffer;
+
+        ~LocalHolder()
+        {
+            if (!buffer)
+                return;
+
+            {
+                std::lock_guard<std::mutex> lock(buffer->mutex);
+                BinaryLog::Internal::Submit(*buffer);
+            }
+
+            State& current = state();
+            std::lock_guard<std::mutex> lock(current.mutex);
+            for (size_t i = 0; i < current.buffers.size(); ++i)
+            {
+                if (current.buffers[i] == buffer)
+                {
+                    current.buffers.erase(current.buffers.begin() + i);
+                    break;
+                }
+            }
+        }
+    };
+
+    template<typename T>
+    bool readRaw(const char* data, size_t size, size_t* offset, T* value)
+    {
+        if (size - *offset < sizeof(T))
+            return false;
+
+        std::memcpy(value, data + *offset, sizeof(T));
+        *offset += sizeof(T);
+        return true;
+    }
+
+    bool readArgument(const char* data, size_t size, size_t* offset, std::string* text)
+    {
+        uint8_t type = 0;
+        if (!readRaw(data, size, offset, &type))
+            return false;
+
+        char number[64];
+        switch (static_cast<BinaryLog::ArgumentType>(type))
+        {
+            case BinaryLog::ArgumentType::Int:
+            {
+                int64_t value = 0;
+                if (!readRaw(data, size, offset, &value))
+                    return false;
+                std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+                *text += number;
+                return true;
+            }
+            case BinaryLog::ArgumentType::UInt:
+            {
+                uint64_t value = 0;
+                if (!readRaw(data, size, offset, &value))
+                    return false;
+                std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value));
+                *text += number;
+                return true;
+            }
+            case BinaryLog::ArgumentType::Double:
+            {
+                // qDebug 와 같은 6 자리
+                double value = 0.0;
+                if (!readRaw(data, size, offset, &value))
+                    return false;
+                std::snprintf(number, sizeof(number), "%g", value);
+                *text += number;
+                return true;
+            }
+            case BinaryLog::ArgumentType::Bool:
+            {
+                uint8_t value = 0;
+                if (!readRaw(data, size, offset, &value))
+                    return false;
+                *text += value ? "true" : "false";
+                return true;
+            }
+            case BinaryLog::ArgumentType::String:
+            {
+                uint32_t length = 0;
+                if (!readRaw(data, size, offset, &length) || size - *offset < length)
+                    return false;
+                text->append(data + *offset, length);
+                *offset += length;
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+namespace BinaryLog
+{
+    namespace Internal
+    {
+        std::atomic<bool> open(false);
+
+        ThreadBuffer& LocalBuffer()
+        {
+            thread_local LocalHolder holder;
+            if (!holder.buffer)
+            {
+                holder.buffer = std::make_shared<ThreadBuffer>();
+                holder.buffer->threadId = currentThreadId();
+                holder.buffer->records = 0;
+                resetChunk(holder.buffer->data);
+
+                State& current = state();
+                std::lock_guard<std::mutex> lock(current.mutex);
+                current.buffers.push_back(holder.buffer);
+            }
+            return *holder.buffer;
+        }
+
+        void Submit(ThreadBuffer& buffer)
+        {
+            if (buffer.data.size() <= CHUNK_HEADER_BYTES)
+                return;
+
+            writeFrameHeader(&buffer.data[0], Frame::Chunk, buffer.data.size() - FRAME_HEADER_BYTES);
+            std::memcpy(&buffer.data[FRAME_HEADER_BYTES], &buffer.threadId, sizeof(buffer.threadId));
+
+            std::shared_ptr<AsyncLogWriter> writer;
+            {
+                State& current = state();
+                std::lock_guard<std::mutex> lock(current.mutex);
+                writer = current.writer;
+                if (writer)
+                {
+                    current.stats.records += buffer.records;
+                    current.stats.bytes += buffer.data.size();
+                    ++current.stats.chunks;
+                }
+            }
+
+            // 닫혀 있으면 버린다. Push 는 lock 밖에서 (writer 스레드가 Preamble 에서 같은 lock 을 잡는다)
+            if (writer)
+                writer->Push(std::move(buffer.data));
+
+            buffer.records = 0;
+            resetChunk(buffer.data);
+        }
+
+        bool FormatArguments(const char* format, size_t formatSize, const char* data, size_t size, size_t* offset, int count, std::string* text)
+        {
+            int used = 0;
+            for (size_t i = 0; i < formatSize; ++i)
+            {
+                if (format[i] == '{' && i + 1 < formatSize && format[i + 1] == '}' && used < count)
+                {
+                    if (!readArgument(data, size, offset, text))
+                        return false;
+                    ++used;
+                    ++i;
+                    continue;
+                }
+                text->push_back(format[i]);
+            }
+
+            for (; used < count; ++used)
+            {
+                text->push_back(' ');
+                if (!readArgument(data, size, offset, text))
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    void Open(std::unique_ptr<LogSink> sink, const AsyncLogWriter::Options& options)
+    {
+        Close();
+
+        AsyncLogWriter::Options writerOptions = options;
+        if (writerOptions.overflowPolicy == AsyncLogWriter::OverflowPolicy::DropAndReport)
+            writerOptions.overflowPolicy = AsyncLogWriter::OverflowPolicy::Drop;
+
+        State& current = state();
+        std::lock_guard<std::mutex> lock(current.mutex);
+        current.writer = std::make_shared<AsyncLogWriter>(std::move(sink), writerOptions);
+        current.stopping = false;
+        current.flusher = std::thread(runFlusher);
+        Internal::open.store(true, std::memory_order_relaxed);
+    }
+
+    void Close()
+    {
+        State& current = state();
+        std::shared_ptr<AsyncLogWriter> writer;
+        std::thread flusher;
+        {
+            std::lock_guard<std::mutex> lock(current.mutex);
+            if (!current.writer)
+                return;
+
+            Internal::open.store(false, std::memory_order_relaxed);
+            current.stopping = true;
+            flusher = std::move(current.flusher);
+        }
+        current.flusherCondition.notify_all();
+        if (flusher.joinable())
+            flusher.join();
+
+        submitAll();
+
+        {
+            std::lock_guard<std::mutex> lock(current.mutex);
+            writer = std::move(current.writer);
+        }
+        // 소멸자가 남은 chunk 를 모두 쓴다
+        writer.reset();
+    }
+
+    bool Flush(int timeoutMilliseconds)
+    {
+        submitAll();
+
+        std::shared_ptr<AsyncLogWriter> writer;
+        {
+            State& current = state();
+            std::lock_guard<std::mutex> lock(current.mutex);
+            writer = current.writer;
+        }
+        return writer ? writer->Flush(timeoutMilliseconds) : true;
+    }
+
+    std::string Preamble()
+    {
+        std::string preamble(FRAME_HEADER_BYTES, '\0');
+        Internal::appendRaw(preamble, MAGIC);
+        Internal::appendRaw(preamble, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()));
+        Internal::appendRaw(preamble, Internal::NowNanoseconds());
+        Internal::appendRaw(preamble, currentProcessId());
+        writeFrameHeader(&preamble[0], Frame::Start, preamble.size() - FRAME_HEADER_BYTES);
+
+        State& current = state();
+        std::lock_guard<std::mutex> lock(current.mutex);
+        for (size_t i = 0; i < current.sites.size(); ++i)
+            preamble += siteFrame(static_cast<uint32_t>(i), current.sites[i]);
+        return preamble;
+    }
+
+    size_t CompleteLength(const char* data, size_t size)
+    {
+        size_t offset = 0;
+        while (size - offset >= FRAME_HEADER_BYTES)
+        {
+            const uint8_t frame = static_cast<uint8_t>(data[offset]);
+            uint32_t payloadBytes = 0;
+            std::memcpy(&payloadBytes, data + offset + 1, sizeof(payloadBytes));
+            if (frame < static_cast<uint8_t>(Frame::Start) || frame > static_cast<uint8_t>(Frame::Chunk)
+                || size - offset - FRAME_HEADER_BYTES < payloadBytes)
+                break;
+
+            offset += FRAME_HEADER_BYTES + payloadBytes;
+        }
+        return offset;
+    }
+
+    Stats GetStats()
+    {
+        State& current = state();
+        std::lock_guard<std::mutex> lock(current.mutex);
+        Stats stats = current.stats;
+        stats.sites = static_cast<uint32_t>(current.sites.size());
+        return stats;
+    }
+
+    uint32_t RegisterSite(int level, const char* function, const char* format)
+    {
+        Site site = { level, function ? function : "", format ? format : "" };
+
+        uint32_t id = 0;
+        std::shared_ptr<AsyncLogWriter> writer;
+        {
+            State& current = state();
+            std::lock_guard<std::mutex> lock(current.mutex);
+            id = static_cast<uint32_t>(current.sites.size());
+            current.sites.push_back(site);
+            writer = current.writer;
+        }
+
+        // 이 site 의 record 보다 먼저 queue 에 들어간다
+        if (writer)
+            writer->Push(siteFrame(id, site));
+        return id;
+    }
+}
\ No newline at end of file
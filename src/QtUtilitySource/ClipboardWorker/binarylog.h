@@ -0,0 +1,184 @@
+#pragma once
+
+#include "asynclogwriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+// 호출 위치마다 format 을 한 번만 등록해 두고, 로그 한 줄은 시간, site id, 인자 원본 값만 스레드별 buffer 에 남긴다.
+// 문자열로 만드는 일은 나중에 BinaryLogDecoder(LogDecoder 도구)가 한다.
+// 파일은 frame 의 연속이다: [Frame u8][payload 크기 u32][payload]. 값은 모두 little endian
+//  Start: magic u32, 벽시계 ms i64, steady ns i64, pid u32       (파일을 열 때마다. 이후 record 의 시간 기준)
+//  Site:  id u32, level u8, 함수 이름, format                     (문자열은 길이 u32 + bytes)
+//  Chunk: 스레드 id u32, record 의 연속                          (record: site u32, steady ns i64, 인자 수 u8, 인자들)
+namespace BinaryLog
+{
+    enum class Frame : uint8_t
+    {
+        Start = 1,
+        Site = 2,
+        Chunk = 3,
+    };
+
+    // 인자 앞의 1 byte
+    enum class ArgumentType : uint8_t
+    {
+        Int = 'i',      // int64
+        UInt = 'u',     // uint64
+        Double = 'd',
+        Bool = 'b',     // uint8
+        String = 's',   // 길이 u32 + bytes
+    };
+
+    const uint32_t MAGIC = 0x474C4243; // "CBLG"
+    const size_t FRAME_HEADER_BYTES = 5;
+
+    struct Stats
+    {
+        uint64_t records;
+        uint64_t chunks;
+        uint64_t bytes;
+        uint32_t sites;
+    };
+
+    namespace Internal
+    {
+        extern std::atomic<bool> open;
+
+        const size_t CHUNK_HEADER_BYTES = FRAME_HEADER_BYTES + sizeof(uint32_t);
+        const size_t CHUNK_BYTES = 32 * 1024;
+
+        // 주인 스레드와 주기적인 flush 만 잡으므로 거의 경합하지 않는다
+        struct ThreadBuffer
+        {
+            std::mutex mutex;
+            std::string data;       // Chunk frame header 자리를 포함
+            uint32_t threadId;
+            uint64_t records;
+        };
+
+        ThreadBuffer& LocalBuffer();
+        // 쌓인 record 를 Chunk frame 으로 writer 에 넘긴다. buffer.mutex 를 잡은 채로 호출
+        void Submit(ThreadBuffer& buffer);
+        // data 의 offset 부터 count 개의 인자를 읽어 format 의 {} 자리에 넣는다. 남는 인자는 공백으로 이어 붙인다
+        bool FormatArguments(const char* format, size_t formatSize, const char* data, size_t size, size_t* offset, int count, std::string* text);
+
+        inline int64_t NowNanoseconds()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        template<typename T>
+        inline void appendRaw(std::string& out, const T& value)
+        {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        inline void appendArgument(std::string& out, bool value)
+        {
+            out.push_back(static_cast<char>(ArgumentType::Bool));
+            out.push_back(value ? 1 : 0);
+        }
+
+        inline void appendArgument(std::string& out, double value)
+        {
+            out.push_back(static_cast<char>(ArgumentType::Double));
+            appendRaw(out, value);
+        }
+
+        inline void appendArgument(std::string& out, float value)
+        {
+            appendArgument(out, static_cast<double>(value));
+        }
+
+        inline void appendString(std::string& out, const char* value, size_t size)
+        {
+            out.push_back(static_cast<char>(ArgumentType::String));
+            appendRaw(out, static_cast<uint32_t>(size));
+            out.append(value, size);
+        }
+
+        inline void appendArgument(std::string& out, const char* value)
+        {
+            if (value)
+                appendString(out, value, std::char_traits<char>::length(value));
+            else
+                appendString(out, "(null)", 6);
+        }
+
+        inline void appendArgument(std::string& out, const std::string& value)
+        {
+            appendString(out, value.data(), value.size());
+        }
+
+        template<typename T>
+        inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type appendArgument(std::string& out, T value)
+        {
+            out.push_back(static_cast<char>(ArgumentType::Int));
+            appendRaw(out, static_cast<int64_t>(value));
+        }
+
+        template<typename T>
+        inline typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type appendArgument(std::string& out, T value)
+        {
+            out.push_back(static_cast<char>(ArgumentType::UInt));
+            appendRaw(out, static_cast<uint64_t>(value));
+        }
+    }
+
+    inline bool IsOpen()
+    {
+        return Internal::open.load(std::memory_order_relaxed);
+    }
+
+    // sink 는 파일을 (새로) 열 때마다 Preamble() 을 먼저 써야 한다 (회전 후에도 decode 할 수 있도록).
+    // queue 가 차면 기다린다. text 한 줄을 끼워 넣는 DropAndReport 는 Drop 으로 바꾼다
+    void Open(std::unique_ptr<LogSink> sink, const AsyncLogWriter::Options& options = AsyncLogWriter::Options());
+    // 스레드별 buffer 를 모두 쓰고 닫는다
+    void Close();
+    // 스레드별 buffer 를 넘기고 파일에 쓰일 때까지 기다린다
+    bool Flush(int timeoutMilliseconds = -1);
+    // Start frame 과 지금까지 등록된 Site frame
+    std::string Preamble();
+    // 앞에서부터 온전한 frame 이 끝나는 곳까지의 길이. 비정상 종료로 끊긴 파일을 이어 쓸 때 쓴다
+    size_t CompleteLength(const char* data, size_t size);
+    Stats GetStats();
+
+    // 호출 위치마다 한 번 (function-local static). format 은 문자열 상수
+    uint32_t RegisterSite(int level, const char* function, const char* format);
+
+    template<typename... Args>
+    void Write(uint32_t site, const Args&... args)
+    {
+        Internal::ThreadBuffer& buffer = Internal::LocalBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+
+        std::string& data = buffer.data;
+        Internal::appendRaw(data, site);
+        Internal::appendRaw(data, Internal::NowNanoseconds());
+        data.push_back(static_cast<char>(sizeof...(Args)));
+        (Internal::appendArgument(data, args), ...);
+        ++buffer.records;
+
+        if (data.size() >= Internal::CHUNK_BYTES)
+            Internal::Submit(buffer);
+    }
+
+    // binary 로그가 꺼져 있을 때 text 로그에 쓸 문자열. decoder 가 만드는 것과 같다
+    template<typename... Args>
+    std::string FormatText(const char* format, const Args&... args)
+    {
+        std::string arguments;
+        (Internal::appendArgument(arguments, args), ...);
+
+        std::string text;
+        size_t offset = 0;
+        Internal::FormatArguments(format, std::char_traits<char>::length(format), arguments.data(), arguments.size(), &offset, static_cast<int>(sizeof...(Args)), &text);
+        return text;
+    }
+}
\ No newline at end of file
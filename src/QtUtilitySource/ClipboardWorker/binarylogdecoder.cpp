@@ -0,0 +1,234 @@
+#include "binarylogdecoder.h"
+
+#include "binarylog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    struct Site
+    {
+        int level;
+        std::string function;
+        std::string format;
+    };
+
+    struct Record
+    {
+        int64_t nanoseconds;
+        std::string text;           // [Level] 뒤의 내용
+        const char* levelName;
+    };
+
+    struct Session
+    {
+        int64_t unixMilliseconds;
+        int64_t steadyNanoseconds;
+        uint32_t processId;
+        std::unordered_map<uint32_t, Site> sites;
+        std::vector<Record> records;
+    };
+
+    const char* levelName(int level)
+    {
+        switch (level)
+        {
+            case 1:
+                return "Critical";
+            case 2:
+                return "Warning";
+            case 3:
+                return "Info";
+            default:
+                return "Debug";
+        }
+    }
+
+    template<typename T>
+    bool readRaw(const char* data, size_t size, size_t* offset, T* value)
+    {
+        if (size - *offset < sizeof(T))
+            return false;
+
+        std::memcpy(value, data + *offset, sizeof(T));
+        *offset += sizeof(T);
+        return true;
+    }
+
+    bool readText(const char* data, size_t size, size_t* offset, std::string* text)
+    {
+        uint32_t length = 0;
+        if (!readRaw(data, size, offset, &length) || size - *offset < length)
+            return false;
+
+        text->assign(data + *offset, length);
+        *offset += length;
+        return true;
+    }
+
+    bool readStart(const char* data, size_t size, Session* session)
+    {
+        size_t offset = 0;
+        uint32_t magic = 0;
+        return readRaw(data, size, &offset, &magic) && magic == BinaryLog::MAGIC
+            && readRaw(data, size, &offset, &session->unixMilliseconds)
+            && readRaw(data, size, &offset, &session->steadyNanoseconds)
+            && readRaw(data, size, &offset, &session->processId);
+    }
+
+    bool readSite(const char* data, size_t size, Session* session)
+    {
+        size_t offset = 0;
+        uint32_t id = 0;
+        uint8_t level = 0;
+        Site site;
+        if (!readRaw(data, size, &offset, &id) || !readRaw(data, size, &offset, &level)
+            || !readText(data, size, &offset, &site.function) || !readText(data, size, &offset, &site.format))
+            return false;
+
+        site.level = level;
+        session->sites[id] = site;
+        return true;
+    }
+
+    bool readChunk(const char* data, size_t size, Session* session, BinaryLogDecoder::Result* result)
+    {
+        size_t offset = 0;
+        uint32_t threadId = 0;
+        if (!readRaw(data, size, &offset, &threadId))
+            return false;
+
+        while (offset < size)
+        {
+            uint32_t siteId = 0;
+            Record record;
+            uint8_t count = 0;
+            if (!readRaw(data, size, &offset, &siteId) || !readRaw(data, size, &offset, &record.nanoseconds) || !readRaw(data, size, &offset, &count))
+                return false;
+
+            auto site = session->sites.find(siteId);
+            if (site == session->sites.end())
+            {
+                ++result->unknownSites;
+                record.levelName = "Debug";
+                record.text = "(unknown site " + std::to_string(siteId) + ")";
+                if (!BinaryLog::Internal::FormatArguments("", 0, data, size, &offset, count, &record.text))
+                    return false;
+            }
+            else
+            {
+                record.levelName = levelName(site->second.level);
+                record.text = site->second.function;
+                record.text.push_back(' ');
+                if (!BinaryLog::Internal::FormatArguments(site->second.format.data(), site->second.format.size(), data, size, &offset, count, &record.text))
+                    return false;
+            }
+
+            session->records.push_back(std::move(record));
+            ++result->records;
+        }
+        return true;
+    }
+
+    void writeSession(Session& session, std::string* text)
+    {
+        std::stable_sort(session.records.begin(), session.records.end(), [](const Record& a, const Record& b)
+        {
+            return a.nanoseconds < b.nanoseconds;
+        });
+
+        char prefix[128];
+        for (const Record& record : session.records)
+        {
+            const int64_t unixMilliseconds = session.unixMilliseconds + (record.nanoseconds - session.steadyNanoseconds) / 1000000;
+            std::snprintf(prefix, sizeof(prefix), "[%s][%u] [%s] ", BinaryLogDecoder::FormatTimestamp(unixMilliseconds).c_str(), session.processId, record.levelName);
+            *text += prefix;
+            *text += record.text;
+            text->push_back('\n');
+        }
+        session.records.clear();
+    }
+}
+
+namespace BinaryLogDecoder
+{
+    bool Decode(const std::string& bytes, std::string* text, Result* result)
+    {
+        Result local = {};
+        Result& decoded = result ? *result : local;
+        decoded = Result();
+
+        Session session = {};
+        bool started = false;
+        size_t offset = 0;
+        while (offset < bytes.size())
+        {
+            uint8_t frame = 0;
+            uint32_t payloadBytes = 0;
+            if (!readRaw(bytes.data(), bytes.size(), &offset, &frame) || !readRaw(bytes.data(), bytes.size(), &offset, &payloadBytes)
+                || bytes.size() - offset < payloadBytes)
+            {
+                decoded.truncated = true;
+                break;
+            }
+
+            const char* payload = bytes.data() + offset;
+            offset += payloadBytes;
+
+            bool ok = false;
+            switch (static_cast<BinaryLog::Frame>(frame))
+            {
+                case BinaryLog::Frame::Start:
+                {
+                    // 다음 파일 또는 다음 실행. 앞의 record 를 먼저 내보낸다
+                    if (started)
+                        writeSession(session, text);
+                    session = Session();
+                    ok = readStart(payload, payloadBytes, &session);
+                    started = ok;
+                    ++decoded.sessions;
+                    break;
+                }
+                case BinaryLog::Frame::Site:
+                    ok = started && readSite(payload, payloadBytes, &session);
+                    break;
+                case BinaryLog::Frame::Chunk:
+                    ok = started && readChunk(payload, payloadBytes, &session, &decoded);
+                    break;
+            }
+
+            if (!ok)
+            {
+                if (!started)
+                    return false;
+                decoded.truncated = true;
+                break;
+            }
+        }
+
+        if (started)
+            writeSession(session, text);
+        return started;
+    }
+
+    std::string FormatTimestamp(int64_t unixMilliseconds)
+    {
+        const std::time_t seconds = static_cast<std::time_t>(unixMilliseconds / 1000);
+        std::tm local = {};
+#ifdef _WIN32
+        localtime_s(&local, &seconds);
+#else
+        localtime_r(&seconds, &local);
+#endif
+
+        char text[64];
+        std::snprintf(text, sizeof(text), "%04d-%02d-%02d %02d:%02d:%02d.%03d", local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                      local.tm_hour, local.tm_min, local.tm_sec, static_cast<int>(unixMilliseconds % 1000));
+        return text;
+    }
+}
\ No newline at end of file
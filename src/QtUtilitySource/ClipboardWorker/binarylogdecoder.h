@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// BinaryLog 파일을 text 로그와 같은 형식([날짜 시각][pid] [Level] 함수 메시지)으로 바꾼다.
+// 한 Start frame 부터 다음 Start frame 까지의 record 는 스레드에 상관없이 시간 순으로 정렬한다
+namespace BinaryLogDecoder
+{
+    struct Result
+    {
+        uint64_t records;
+        uint64_t sessions;          // Start frame 수
+        uint64_t unknownSites;      // Site frame 이 없어 format 을 모르는 record
+        bool truncated;             // 마지막 frame 이 잘렸거나 깨졌다 (쓰는 중 종료)
+    };
+
+    // 처음이 Start frame 이 아니면 false
+    bool Decode(const std::string& bytes, std::string* text, Result* result = nullptr);
+
+    // 1970 년부터의 ms 를 지역 시각 yyyy-MM-dd hh:mm:ss.zzz 로
+    std::string FormatTimestamp(int64_t unixMilliseconds);
+}
\ No newline at end of file
@@ -0,0 +1,353 @@
+#include "bufferpool.h"
+#include "memorytracker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    const size_t MIN_POOLED_BYTES = 64 * 1024;
+
+    uint8_t* allocateTracked(size_t bytes)
+    {
+        uint8_t* data = new (std::nothrow) uint8_t[bytes];
+        if (data != nullptr)
+            MemoryTracker::Allocated(bytes);
+        return data;
+    }
+
+    void releaseTracked(uint8_t* data, size_t bytes)
+    {
+        delete[] data;
+        MemoryTracker::Released(bytes);
+    }
+
+    class TrackedDeleter
+    {
+    public:
+        explicit TrackedDeleter(size_t bytes)
+            : bytes_(bytes)
+        {}
+
+        void operator()(uint8_t* data) const
+        {
+            releaseTracked(data, bytes_);
+        }
+
+    private:
+        size_t bytes_;
+    };
+}
+
+struct BufferPool::State
+{
+    struct Block
+    {
+        uint8_t* data;
+        size_t bytes;
+    };
+
+    std::mutex mutex;
+    std::list<Block> pooled;    // 앞쪽이 최근에 반납된 것
+    BufferPoolStats stats;
+
+    // 넘치는 block 을 목록에서 빼 둔다. 실제 해제는 lock 밖에서
+    void evictLocked(size_t keepBytes, std::vector<Block>& evicted)
+    {
+        while (stats.pooledBytes > keepBytes && !pooled.empty())
+        {
+            Block block = pooled.back();
+            pooled.pop_back();
+            stats.pooledBytes -= block.bytes;
+            --stats.pooledCount;
+            stats.trimmedBytes += block.bytes;
+            evicted.push_back(block);
+        }
+    }
+
+    static void ReleaseEvicted(const std::vector<Block>& evicted)
+    {
+        for (const Block& block : evicted)
+            releaseTracked(block.data, block.bytes);
+    }
+
+    // 마지막 참조가 사라지면 해제하지 않고 pool 에 돌려준다
+    class Deleter
+    {
+    public:
+        Deleter(std::shared_ptr<State> state, size_t bytes)
+            : state_(std::move(state))
+            , bytes_(bytes)
+        {}
+
+        void operator()(uint8_t* data) const
+        {
+            std::vector<Block> evicted;
+            {
+                std::lock_guard<std::mutex> lock(state_->mutex);
+                BufferPoolStats& stats = state_->stats;
+                ++stats.releases;
+                stats.outstandingBytes -= bytes_;
+
+                // 최근에 쓴 block 일수록 page 가 살아 있을 가능성이 높으므로 앞에 둔다
+                state_->pooled.push_front({ data, bytes_ });
+                stats.pooledBytes += bytes_;
+                ++stats.pooledCount;
+                state_->evictLocked(stats.retainLimit, evicted);
+            }
+            ReleaseEvicted(evicted);
+        }
+
+    private:
+        std::shared_ptr<State> state_;
+        size_t bytes_;
+    };
+};
+
+BufferPool::BufferPool(size_t retainLimit)
+    : state_(std::make_shared<State>())
+{
+    state_->stats = BufferPoolStats();
+    state_->stats.retainLimit = retainLimit;
+}
+
+BufferPool::~BufferPool()
+{
+    // 빌려 간 버퍼는 state 를 잡고 있다가 반납될 때 바로 해제된다
+    SetRetainLimit(0);
+}
+
+size_t BufferPool::MinPooledBytes()
+{
+    return MIN_POOLED_BYTES;
+}
+
+size_t BufferPool::SizeClass(size_t bytes)
+{
+    if (bytes <= MIN_POOLED_BYTES)
+        return MIN_POOLED_BYTES;
+
+    size_t power = MIN_POOLED_BYTES;
+    while (power <= bytes / 2)
+        power *= 2;
+
+    size_t step = power / 4;
+    return (bytes + step - 1) / step * step;
+}
+
+std::shared_ptr<uint8_t> BufferPool::Allocate(BufferPool* pool, size_t bytes, size_t* capacity)
+{
+    if (pool != nullptr)
+        return pool->Acquire(bytes, capacity);
+
+    if (capacity)
+        *capacity = 0;
+    if (bytes == 0)
+        return nullptr;
+
+    uint8_t* data = allocateTracked(bytes);
+    if (data == nullptr)
+        return nullptr;
+
+    if (capacity)
+        *capacity = bytes;
+    return std::shared_ptr<uint8_t>(data, TrackedDeleter(bytes));
+}
+
+std::shared_ptr<uint8_t> BufferPool::Acquire(size_t bytes, size_t* capacity)
+{
+    // 작은 버퍼는 일반 heap 이 더 잘 다루므로 보관하지 않는다
+    if (bytes < MIN_POOLED_BYTES)
+        return Allocate(nullptr, bytes, capacity);
+
+    if (capacity)
+        *capacity = 0;
+
+    const size_t classBytes = SizeClass(bytes);
+    uint8_t* data = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        BufferPoolStats& stats = state_->stats;
+        ++stats.acquires;
+
+        auto found = std::find_if(state_->pooled.begin(), state_->pooled.end(), [classBytes](const State::Block& block)
+        {
+            return block.bytes == classBytes;
+        });
+        if (found != state_->pooled.end())
+        {
+            data = found->data;
+            state_->pooled.erase(found);
+            stats.pooledBytes -= classBytes;
+            --stats.pooledCount;
+            ++stats.reuses;
+        }
+    }
+
+    if (data == nullptr)
+    {
+        data = allocateTracked(classBytes);
+
+        // 주소 공간이 모자라면 보관 중인 것을 모두 놓고 한 번 더 시도
+        if (data == nullptr)
+        {
+            Trim(0);
+            data = allocateTracked(classBytes);
+        }
+        if (data == nullptr)
+            return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        BufferPoolStats& stats = state_->stats;
+        stats.outstandingBytes += classBytes;
+        stats.peakOutstandingBytes = std::max(stats.peakOutstandingBytes, stats.outstandingBytes);
+    }
+
+    if (capacity)
+        *capacity = classBytes;
+    return std::shared_ptr<uint8_t>(data, State::Deleter(state_, classBytes));
+}
+
+void BufferPool::SetRetainLimit(size_t bytes)
+{
+    std::vector<State::Block> evicted;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stats.retainLimit = bytes;
+        state_->evictLocked(bytes, evicted);
+    }
+    State::ReleaseEvicted(evicted);
+}
+
+size_t BufferPool::RetainLimit() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->stats.retainLimit;
+}
+
+void BufferPool::Trim(size_t keepBytes)
+{
+    std::vector<State::Block> evicted;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->evictLocked(keepBytes, evicted);
+    }
+    State::ReleaseEvicted(evicted);
+}
+
+BufferPoolStats BufferPool::Stats() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->stats;
+}
+
+// ByteBuffer
+
+ByteBuffer::ByteBuffer(BufferPool* pool)
+    : pool_(pool)
+    , data_()
+    , size_(0)
+    , capacity_(0)
+{}
+
+bool ByteBuffer::IsEmpty() const
+{
+    return size_ == 0;
+}
+
+size_t ByteBuffer::Size() const
+{
+    return size_;
+}
+
+size_t ByteBuffer::Capacity() const
+{
+    return capacity_;
+}
+
+const uint8_t* ByteBuffer::ConstData() const
+{
+    return data_.get();
+}
+
+uint8_t* ByteBuffer::Data()
+{
+    return data_.get();
+}
+
+std::shared_ptr<const void> ByteBuffer::Owner() const
+{
+    return data_;
+}
+
+bool ByteBuffer::Reserve(size_t capacity)
+{
+    if (capacity <= capacity_)
+        return true;
+
+    return reallocate(capacity);
+}
+
+bool ByteBuffer::Resize(size_t size)
+{
+    if (size > capacity_)
+    {
+        // 조금씩 늘어나도 복사가 반복되지 않도록 1.5 배씩 키운다
+        if (!reallocate(std::max(size, capacity_ + capacity_ / 2)))
+            return false;
+    }
+
+    size_ = size;
+    return true;
+}
+
+bool ByteBuffer::Append(const uint8_t* data, size_t size)
+{
+    size_t offset = size_;
+    if (!Resize(size_ + size))
+        return false;
+
+    std::memcpy(data_.get() + offset, data, size);
+    return true;
+}
+
+void ByteBuffer::ShrinkToFit()
+{
+    if (size_ == 0)
+    {
+        Clear();
+        return;
+    }
+
+    if (capacity_ - size_ > size_)
+        reallocate(size_);
+}
+
+void ByteBuffer::Clear()
+{
+    data_.reset();
+    size_ = 0;
+    capacity_ = 0;
+}
+
+bool ByteBuffer::reallocate(size_t capacity)
+{
+    size_t allocated = 0;
+    std::shared_ptr<uint8_t> data = BufferPool::Allocate(pool_, capacity, &allocated);
+    if (!data)
+        return false;
+
+    if (size_ > 0)
+        std::memcpy(data.get(), data_.get(), size_);
+
+    data_ = std::move(data);
+    capacity_ = allocated;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct BufferPoolStats
+{
+    uint64_t acquires;
+    uint64_t reuses;                // 보관 중이던 버퍼를 다시 쓴 횟수
+    uint64_t releases;
+    uint64_t trimmedBytes;          // 보관 한도나 Trim 으로 해제한 누적 크기
+    size_t pooledCount;
+    size_t pooledBytes;             // 반납되어 보관 중인 버퍼
+    size_t outstandingBytes;        // 빌려 가서 사용 중인 버퍼
+    size_t peakOutstandingBytes;
+    size_t retainLimit;
+};
+
+// 픽셀과 인코딩 결과에 쓰는 큰 버퍼를 size class 별로 보관했다가 다시 빌려준다.
+// 매번 새로 할당하면 heap 이 조각나고, OS 에서 새로 받은 page 를 채우느라 page fault 가 생긴다.
+// 빌려 간 버퍼는 pool 보다 오래 살아도 되며, 모든 함수는 thread-safe
+class BufferPool
+{
+public:
+    explicit BufferPool(size_t retainLimit);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // 이보다 작은 버퍼는 보관하지 않는다
+    static size_t MinPooledBytes();
+    // bytes 를 담을 수 있는 size class. 2 의 거듭제곱을 4 단계로 나눠 낭비가 25% 를 넘지 않는다
+    static size_t SizeClass(size_t bytes);
+    // pool 이 null 이면 보관 없이 할당한다. capacity 에는 실제로 쓸 수 있는 크기가 들어간다
+    static std::shared_ptr<uint8_t> Allocate(BufferPool* pool, size_t bytes, size_t* capacity = nullptr);
+
+public:
+    std::shared_ptr<uint8_t> Acquire(size_t bytes, size_t* capacity = nullptr);
+
+    // 보관할 최대 크기. 넘치면 오래 쓰지 않은 것부터 해제
+    void SetRetainLimit(size_t bytes);
+    size_t RetainLimit() const;
+    // 보관 중인 버퍼가 keepBytes 이하가 될 때까지 오래된 것부터 해제
+    void Trim(size_t keepBytes = 0);
+    BufferPoolStats Stats() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> state_;
+};
+
+// pool 에서 빌린 연속된 byte 버퍼. 모자라면 더 큰 size class 로 옮긴다.
+// 복사하면 데이터를 공유하므로 다 채운 뒤에는 읽기 전용으로 쓴다
+class ByteBuffer
+{
+public:
+    explicit ByteBuffer(BufferPool* pool = nullptr);
+
+public:
+    bool IsEmpty() const;
+    size_t Size() const;
+    size_t Capacity() const;
+    const uint8_t* ConstData() const;
+    uint8_t* Data();
+    // 데이터의 수명을 잡고 있는 handle (clipboard source 등에 넘길 때)
+    std::shared_ptr<const void> Owner() const;
+
+    bool Reserve(size_t capacity);
+    // 늘어난 부분은 초기화하지 않는다
+    bool Resize(size_t size);
+    bool Append(const uint8_t* data, size_t size);
+    // 남는 공간이 데이터보다 크면 작은 버퍼로 옮긴다
+    void ShrinkToFit();
+    // 버퍼를 pool 에 돌려준다
+    void Clear();
+
+private:
+    bool reallocate(size_t capacity);
+
+private:
+    BufferPool* pool_;
+    std::shared_ptr<uint8_t> data_;
+    size_t size_;
+    size_t capacity_;
+};
\ No newline at end of file
@@ -0,0 +1,15 @@
+#include "cancellationtoken.h"
+
+CancellationToken::CancellationToken()
+    : canceled_(std::make_shared<std::atomic<bool>>(false))
+{}
+
+void CancellationToken::Cancel()
+{
+    canceled_->store(true, std::memory_order_relaxed);
+}
+
+bool CancellationToken::IsCanceled() const
+{
+    return canceled_->load(std::memory_order_relaxed);
+}
\ No newline at end of file
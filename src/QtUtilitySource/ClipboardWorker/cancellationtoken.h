@@ -0,0 +1,18 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+// 작업 취소 요청을 여러 스레드에서 공유하기 위한 토큰 (복사하면 상태 공유)
+class CancellationToken
+{
+public:
+    CancellationToken();
+
+public:
+    void Cancel();
+    bool IsCanceled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> canceled_;
+};
\ No newline at end of file
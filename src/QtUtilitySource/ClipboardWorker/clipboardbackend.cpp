@@ -0,0 +1,216 @@
+#include "clipboardbackend.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    double elapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+const char* ClipboardFormatName(ClipboardFormat format)
+{
+    switch (format)
+    {
+        case ClipboardFormat::Png:
+            return "PNG";
+        case ClipboardFormat::DibV5:
+            return "CF_DIBV5";
+        case ClipboardFormat::Bitmap:
+            return "CF_BITMAP";
+        case ClipboardFormat::Jfif:
+            return "JFIF";
+    }
+    return "";
+}
+
+const char* ClipboardFailureName(ClipboardFailure failure)
+{
+    switch (failure)
+    {
+        case ClipboardFailure::None:
+            return "none";
+        case ClipboardFailure::InvalidSource:
+            return "invalid source";
+        case ClipboardFailure::Busy:
+            return "clipboard busy";
+        case ClipboardFailure::Canceled:
+            return "canceled";
+        case ClipboardFailure::Error:
+            return "error";
+    }
+    return "";
+}
+
+// RetryPolicy struct
+
+ClipboardBackend::RetryPolicy::RetryPolicy()
+    : maxAttempts(10)
+    , initialDelayMilliseconds(5)
+    , maxDelayMilliseconds(200)
+    , timeoutMilliseconds(2000)
+{}
+
+// Public
+
+ClipboardBackend::ClipboardBackend()
+    : statsMutex_()
+    , stats_()
+    , retryPolicy_()
+    , contention_()
+{}
+
+ClipboardBackend::~ClipboardBackend()
+{}
+
+bool ClipboardBackend::Publish(std::shared_ptr<const ClipboardSource> source, Result* result, const CancellationToken* token)
+{
+    if (!preparePublish(source))
+    {
+        if (result)
+            *result = Result{ ClipboardFailure::InvalidSource, 0, 0, 0 };
+        return false;
+    }
+
+    bool published = retry([this, &source]
+    {
+        return tryPublish(source);
+    }, result, token);
+
+    finishPublish(published);
+    return published;
+}
+
+bool ClipboardBackend::Read(ClipboardFormat format, const Reader& reader, Result* result, const CancellationToken* token)
+{
+    if (format == ClipboardFormat::Bitmap || !reader)
+    {
+        if (result)
+            *result = Result{ ClipboardFailure::InvalidSource, 0, 0, 0 };
+        return false;
+    }
+
+    return retry([this, format, &reader]
+    {
+        return tryRead(format, reader);
+    }, result, token);
+}
+
+ClipboardBackend::FormatStats ClipboardBackend::Stats(ClipboardFormat format) const
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_[static_cast<int>(format)];
+}
+
+void ClipboardBackend::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats_ = {};
+}
+
+void ClipboardBackend::SetRetryPolicy(const RetryPolicy& policy)
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    retryPolicy_ = policy;
+    retryPolicy_.maxAttempts = std::max(retryPolicy_.maxAttempts, 1);
+}
+
+ClipboardBackend::RetryPolicy ClipboardBackend::GetRetryPolicy() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return retryPolicy_;
+}
+
+ClipboardBackend::ContentionStats ClipboardBackend::Contention() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return contention_;
+}
+
+// Protected
+
+void ClipboardBackend::recordPromised(ClipboardFormat format)
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    ++stats_[static_cast<int>(format)].promised;
+}
+
+void ClipboardBackend::recordRendered(ClipboardFormat format, uint64_t bytes, double milliseconds)
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    FormatStats& stats = stats_[static_cast<int>(format)];
+    ++stats.rendered;
+    stats.renderedBytes += bytes;
+    stats.renderMilliseconds += milliseconds;
+}
+
+// Private
+
+bool ClipboardBackend::retry(const std::function<Attempt()>& attempt, Result* result, const CancellationToken* token)
+{
+    const RetryPolicy policy = GetRetryPolicy();
+    const auto start = std::chrono::steady_clock::now();
+
+    Result done = { ClipboardFailure::None, 0, 0, 0 };
+    double delay = policy.initialDelayMilliseconds;
+    while (true)
+    {
+        if (token && token->IsCanceled())
+        {
+            done.failure = ClipboardFailure::Canceled;
+            break;
+        }
+
+        const auto attemptStart = std::chrono::steady_clock::now();
+        ++done.attempts;
+        Attempt outcome = attempt();
+        if (outcome == Attempt::Done)
+            break;
+        if (outcome == Attempt::Failed)
+        {
+            done.failure = ClipboardFailure::Error;
+            break;
+        }
+
+        // 열지 못한 시도부터 다음 시도 직전까지를 다른 프로그램이 잡고 있던 시간으로 본다
+        const double elapsed = elapsedMilliseconds(start);
+        const bool timedOut = policy.timeoutMilliseconds > 0 && elapsed + delay > policy.timeoutMilliseconds;
+        if (done.attempts >= policy.maxAttempts || timedOut)
+        {
+            done.contendedMilliseconds += elapsedMilliseconds(attemptStart);
+            done.failure = ClipboardFailure::Busy;
+            break;
+        }
+
+        {
+            Trace::Span span("clipboard backoff");
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(delay));
+        }
+        done.contendedMilliseconds += elapsedMilliseconds(attemptStart);
+        delay = std::min(delay * 2, policy.maxDelayMilliseconds);
+    }
+    done.totalMilliseconds = elapsedMilliseconds(start);
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        ++contention_.operations;
+        if (done.attempts > 1 || done.failure == ClipboardFailure::Busy)
+        {
+            ++contention_.contended;
+            contention_.retries += done.attempts - 1;
+            contention_.contendedMilliseconds += done.contendedMilliseconds;
+            contention_.maxContendedMilliseconds = std::max(contention_.maxContendedMilliseconds, done.contendedMilliseconds);
+        }
+        if (done.failure == ClipboardFailure::Busy)
+            ++contention_.busyFailures;
+    }
+
+    if (result)
+        *result = done;
+    return done.failure == ClipboardFailure::None;
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "cancellationtoken.h"
+#include "pixelbuffer.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+enum class ClipboardFormat
+{
+    Png,
+    DibV5,
+    Bitmap,
+    Jfif,       // 원본이 JPEG 일 때 파일 그대로
+};
+
+const int CLIPBOARD_FORMAT_COUNT = 4;
+
+const char* ClipboardFormatName(ClipboardFormat format);
+
+// Publish, Read 가 실패한 이유
+enum class ClipboardFailure
+{
+    None,
+    InvalidSource,      // source 가 없거나 올릴 포맷이 없음
+    Busy,               // 다른 프로그램이 clipboard 를 열고 있어 재시도 한도 안에 열지 못함
+    Canceled,
+    Error,              // 그 밖의 실패 (OS 호출 실패, 읽을 포맷 없음 등)
+};
+
+const char* ClipboardFailureName(ClipboardFailure failure);
+
+// clipboard 에 올릴 데이터를 포맷별로 만들어 주는 쪽. 여러 스레드에서 호출될 수 있으므로 내용은 바뀌지 않아야 한다
+class ClipboardSource
+{
+public:
+    virtual ~ClipboardSource() {}
+
+    virtual std::vector<ClipboardFormat> Formats() const = 0;
+    // Formats 중 올릴 때 바로 렌더링할 것. 나머지는 요청이 올 때 렌더링한다
+    virtual std::vector<ClipboardFormat> EagerFormats() const { return std::vector<ClipboardFormat>(); }
+
+    // 메모리 포맷(Png, DibV5, Jfif): backend 가 FormatSize 만큼 할당한 메모리에 Render 가 직접 쓴다
+    virtual size_t FormatSize(ClipboardFormat format) const = 0;
+    virtual bool Render(ClipboardFormat format, uint8_t* dest, size_t size) const = 0;
+
+    // handle 포맷(Bitmap): backend 가 이 픽셀로 직접 만든다
+    virtual ImageView Pixels() const = 0;
+};
+
+// 실제 clipboard 와 연결되는 부분. 포맷은 약속만 해두고 요청이 올 때 렌더링한다.
+// clipboard 는 한 번에 한 프로그램만 열 수 있으므로 (clipboard 관리자, 원격 데스크톱 등)
+// 열지 못하면 RetryPolicy 에 따라 간격을 두 배씩 늘려 가며 다시 시도한다
+class ClipboardBackend
+{
+public:
+    struct FormatStats
+    {
+        int promised;
+        int rendered;
+        uint64_t renderedBytes;
+        double renderMilliseconds;
+    };
+
+    struct RetryPolicy
+    {
+        RetryPolicy();
+
+        int maxAttempts;                    // 첫 시도 포함
+        double initialDelayMilliseconds;    // 두 번째 시도 전 대기. 이후 두 배씩
+        double maxDelayMilliseconds;
+        double timeoutMilliseconds;         // 첫 시도부터 이 시간이 지나면 포기 (0 이면 제한 없음)
+    };
+
+    struct Result
+    {
+        ClipboardFailure failure;
+        int attempts;
+        double contendedMilliseconds;       // 다른 프로그램이 clipboard 를 잡고 있어 기다린 시간
+        double totalMilliseconds;
+    };
+
+    // 다른 프로그램 때문에 기다린 기록 (Publish, Read 모두)
+    struct ContentionStats
+    {
+        uint64_t operations;
+        uint64_t contended;                 // 한 번 이상 기다린 횟수
+        uint64_t retries;
+        uint64_t busyFailures;              // 끝내 열지 못한 횟수
+        double contendedMilliseconds;
+        double maxContendedMilliseconds;
+    };
+
+    // data 는 reader 가 호출되는 동안만 유효하다. 처리에 실패하면 false
+    using Reader = std::function<bool(const uint8_t* data, size_t size)>;
+
+    ClipboardBackend();
+    virtual ~ClipboardBackend();
+
+    ClipboardBackend(const ClipboardBackend&) = delete;
+    ClipboardBackend& operator=(const ClipboardBackend&) = delete;
+
+public:
+    // 이전 내용을 지우고 source 의 포맷들을 clipboard 에 올린다.
+    // 기다리는 동안 미리 렌더링해 둔 데이터는 버리지 않고 다음 시도에 그대로 쓴다.
+    // 이 호출 안에서만 가지고 있으므로 올리지 못하고 끝나면 다음 Publish 는 다시 렌더링한다
+    bool Publish(std::shared_ptr<const ClipboardSource> source, Result* result = nullptr, const CancellationToken* token = nullptr);
+
+    // 붙여넣기. 지금 clipboard 에 있는 포맷 중 이 backend 가 아는 것
+    virtual std::vector<ClipboardFormat> AvailableFormats() const = 0;
+    // 메모리 포맷(Png, DibV5, Jfif) 만 읽을 수 있다
+    bool Read(ClipboardFormat format, const Reader& reader, Result* result = nullptr, const CancellationToken* token = nullptr);
+
+    FormatStats Stats(ClipboardFormat format) const;
+    void ResetStats();
+
+    void SetRetryPolicy(const RetryPolicy& policy);
+    RetryPolicy GetRetryPolicy() const;
+    ContentionStats Contention() const;
+
+protected:
+    enum class Attempt
+    {
+        Done,
+        Busy,       // 다른 프로그램이 clipboard 를 열고 있음. 잠시 뒤 다시 시도
+        Failed,
+    };
+
+    // 첫 시도 전에 한 번. clipboard 를 열지 않고 할 수 있는 일 (바로 올릴 포맷의 렌더링 등)
+    virtual bool preparePublish(const std::shared_ptr<const ClipboardSource>& source) { return source != nullptr; }
+    virtual Attempt tryPublish(const std::shared_ptr<const ClipboardSource>& source) = 0;
+    // 마지막에 한 번. 올리지 못했으면 preparePublish 에서 만든 것을 정리
+    virtual void finishPublish(bool /*published*/) {}
+    virtual Attempt tryRead(ClipboardFormat format, const Reader& reader) = 0;
+
+    void recordPromised(ClipboardFormat format);
+    void recordRendered(ClipboardFormat format, uint64_t bytes, double milliseconds);
+
+private:
+    bool retry(const std::function<Attempt()>& attempt, Result* result, const CancellationToken* token);
+
+private:
+    mutable std::mutex statsMutex_;
+    std::array<FormatStats, CLIPBOARD_FORMAT_COUNT> stats_;
+    RetryPolicy retryPolicy_;
+    ContentionStats contention_;
+};
\ No newline at end of file
@@ -0,0 +1,423 @@
+#include "clipboardhistory.h"
+#include "contenthash.h"
+#include "lz4block.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+    // block 하나를 압축하는 데 1ms 안팎. 풀 때도 이 단위로 나눠 병렬로 처리한다
+    const size_t BLOCK_BYTES = 256 * 1024;
+
+    double elapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    size_t pixelBytes(const PixelBuffer& pixels)
+    {
+        return pixels.IsNull() ? 0 : static_cast<size_t>(pixels.Width()) * 4 * static_cast<size_t>(pixels.Height());
+    }
+
+    bool sameBytes(const uint8_t* a, const uint8_t* b, size_t size)
+    {
+        return size == 0 || a == b || std::memcmp(a, b, size) == 0;
+    }
+}
+
+// ClipboardHistoryStats struct
+
+double ClipboardHistoryStats::CompressionRatio() const
+{
+    return storedBytes == 0 ? 0.0 : static_cast<double>(rawBytes) / static_cast<double>(storedBytes);
+}
+
+// Item struct
+
+ClipboardHistory::Item::Item()
+    : pixels()
+    , png()
+    , source()
+{}
+
+// Public
+
+ClipboardHistory::ClipboardHistory(size_t budgetBytes, size_t maxEntries, ThreadPool* pool, BufferPool* buffers)
+    : pool_(pool)
+    , buffers_(buffers)
+    , mutex_()
+    , entries_()
+    , byHash_()
+    , nextId_(0)
+    , stats_()
+{
+    stats_.budgetBytes = budgetBytes;
+    stats_.maxEntries = maxEntries;
+}
+
+uint64_t ClipboardHistory::Add(const Item& item)
+{
+    if (item.pixels.IsNull() && item.png.IsEmpty() && item.source.size == 0)
+        return 0;
+
+    const uint64_t hash = contentHash(item);
+    Entry candidate;
+    bool hasCandidate = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.adds;
+        if (stats_.maxEntries == 0 || stats_.budgetBytes == 0)
+            return 0;
+
+        auto found = byHash_.find(hash);
+        if (found != byHash_.end())
+        {
+            candidate = *found->second;
+            hasCandidate = true;
+        }
+    }
+
+    // hash 만 같은 다른 이미지를 돌려주지 않도록 내용까지 확인한다. 압축 버퍼는 공유되므로 lock 밖에서 비교한다
+    if (hasCandidate && sameContent(candidate, item))
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = findLocked(candidate.info.id);
+        if (found != entries_.end())
+        {
+            ++stats_.duplicates;
+            entries_.splice(entries_.begin(), entries_, found);
+            return candidate.info.id;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    Entry entry;
+    entry.hash = hash;
+    entry.format = item.pixels.Format();
+    entry.rowsPerBlock = 0;
+    entry.compressed = ByteBuffer(buffers_);
+    entry.png = item.png;
+    entry.source = item.source;
+    if (!item.pixels.IsNull() && !compressPixels(item.pixels, &entry))
+        return 0;
+
+    entry.info.width = item.pixels.Width();
+    entry.info.height = item.pixels.Height();
+    entry.info.hasPng = !item.png.IsEmpty();
+    entry.info.hasSource = item.source.size != 0;
+    entry.info.rawBytes = pixelBytes(item.pixels) + item.png.Size() + item.source.size;
+    entry.info.storedBytes = entry.compressed.Size() + item.png.Size() + item.source.size;
+
+    const double milliseconds = elapsedMilliseconds(start);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.lastCompressMilliseconds = milliseconds;
+    if (entry.info.storedBytes > stats_.budgetBytes)
+        return 0;
+
+    // 같은 hash 의 이전 항목 (압축하는 사이 들어온 같은 이미지이거나 충돌) 은 남겨 두고 새 항목으로 찾게 한다
+    entry.info.id = ++nextId_;
+    stats_.rawBytes += entry.info.rawBytes;
+    stats_.storedBytes += entry.info.storedBytes;
+    entries_.push_front(std::move(entry));
+    byHash_[hash] = entries_.begin();
+
+    const uint64_t id = entries_.front().info.id;
+    evictLocked();
+    return id;
+}
+
+bool ClipboardHistory::Restore(uint64_t id, Item* item)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // 압축 버퍼는 공유되므로 lock 밖에서 풀어도 그 사이 지워지지 않는다
+    Entry entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = findLocked(id);
+        if (found == entries_.end())
+            return false;
+
+        entries_.splice(entries_.begin(), entries_, found);
+        entry = *found;
+    }
+
+    Item restored;
+    restored.png = entry.png;
+    restored.source = entry.source;
+    if (!entry.blocks.empty() && !decompressPixels(entry, &restored.pixels))
+        return false;
+
+    const double milliseconds = elapsedMilliseconds(start);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.restores;
+        stats_.lastRestoreMilliseconds = milliseconds;
+        stats_.totalRestoreMilliseconds += milliseconds;
+    }
+
+    if (item)
+        *item = restored;
+    return true;
+}
+
+bool ClipboardHistory::Remove(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = findLocked(id);
+    if (found == entries_.end())
+        return false;
+
+    eraseLocked(found);
+    return true;
+}
+
+void ClipboardHistory::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    byHash_.clear();
+    stats_.rawBytes = 0;
+    stats_.storedBytes = 0;
+    stats_.entryCount = 0;
+}
+
+std::vector<ClipboardHistory::EntryInfo> ClipboardHistory::Entries() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<EntryInfo> infos;
+    infos.reserve(entries_.size());
+    for (const Entry& entry : entries_)
+        infos.push_back(entry.info);
+    return infos;
+}
+
+void ClipboardHistory::SetBudget(size_t budgetBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.budgetBytes = budgetBytes;
+    evictLocked();
+}
+
+void ClipboardHistory::SetMaxEntries(size_t maxEntries)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.maxEntries = maxEntries;
+    evictLocked();
+}
+
+ClipboardHistoryStats ClipboardHistory::Stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// Private
+
+bool ClipboardHistory::compressPixels(const PixelBuffer& pixels, Entry* entry) const
+{
+    const size_t rowBytes = static_cast<size_t>(pixels.Width()) * 4;
+    const int height = pixels.Height();
+    const int rowsPerBlock = static_cast<int>(std::max<size_t>(1, BLOCK_BYTES / rowBytes));
+    const int blockCount = (height + rowsPerBlock - 1) / rowsPerBlock;
+    const size_t slotBytes = Lz4Block::CompressBound(rowBytes * rowsPerBlock);
+
+    // block 마다 최대 크기 자리를 잡고 병렬로 압축한 뒤 앞으로 당겨 붙인다
+    ByteBuffer& compressed = entry->compressed;
+    if (!compressed.Resize(slotBytes * blockCount))
+        return false;
+
+    std::vector<Block> blocks(blockCount);
+    uint8_t* base = compressed.Data();
+    const bool packed = static_cast<size_t>(pixels.Stride()) == rowBytes;
+
+    auto compressBlocks = [&](int begin, int end)
+    {
+        std::vector<uint8_t> rows;
+        for (int i = begin; i < end; ++i)
+        {
+            const int firstRow = i * rowsPerBlock;
+            const int rowCount = std::min(rowsPerBlock, height - firstRow);
+            const size_t rawBytes = rowBytes * rowCount;
+
+            // stride 에 padding 이 있으면 row 를 이어 붙인 뒤 압축
+            const uint8_t* source = pixels.ConstScanLine(firstRow);
+            if (!packed)
+            {
+                rows.resize(rawBytes);
+                for (int y = 0; y < rowCount; ++y)
+                    std::memcpy(rows.data() + rowBytes * y, pixels.ConstScanLine(firstRow + y), rowBytes);
+                source = rows.data();
+            }
+
+            uint8_t* slot = base + slotBytes * i;
+            size_t size = Lz4Block::Compress(source, rawBytes, slot, slotBytes);
+
+            Block& block = blocks[i];
+            block.stored = size == 0 || size >= rawBytes;
+            if (block.stored)
+            {
+                std::memcpy(slot, source, rawBytes);
+                size = rawBytes;
+            }
+            block.size = size;
+        }
+    };
+
+    if (pool_)
+        pool_->ParallelFor(0, blockCount, 1, compressBlocks);
+    else
+        compressBlocks(0, blockCount);
+
+    size_t offset = 0;
+    for (int i = 0; i < blockCount; ++i)
+    {
+        Block& block = blocks[i];
+        std::memmove(base + offset, base + slotBytes * i, block.size);
+        block.offset = offset;
+        offset += block.size;
+    }
+
+    compressed.Resize(offset);
+    compressed.ShrinkToFit();
+
+    entry->rowsPerBlock = rowsPerBlock;
+    entry->blocks = std::move(blocks);
+    return true;
+}
+
+bool ClipboardHistory::decompressPixels(const Entry& entry, PixelBuffer* pixels) const
+{
+    PixelBuffer restored = PixelBuffer::Allocate(entry.info.width, entry.info.height, entry.format, buffers_);
+    if (restored.IsNull())
+        return false;
+
+    // Allocate 는 row 사이 padding 이 없으므로 block 을 제자리에 바로 푼다
+    const size_t rowBytes = static_cast<size_t>(entry.info.width) * 4;
+    const uint8_t* base = entry.compressed.ConstData();
+    std::atomic<bool> failed(false);
+
+    auto decompressBlocks = [&](int begin, int end)
+    {
+        for (int i = begin; i < end && !failed; ++i)
+        {
+            const Block& block = entry.blocks[i];
+            const int firstRow = i * entry.rowsPerBlock;
+            const int rowCount = std::min(entry.rowsPerBlock, entry.info.height - firstRow);
+            const size_t rawBytes = rowBytes * rowCount;
+            uint8_t* dest = restored.ScanLine(firstRow);
+
+            if (block.stored)
+                std::memcpy(dest, base + block.offset, rawBytes);
+            else if (!Lz4Block::Decompress(base + block.offset, block.size, dest, rawBytes))
+                failed = true;
+        }
+    };
+
+    const int blockCount = static_cast<int>(entry.blocks.size());
+    if (pool_)
+        pool_->ParallelFor(0, blockCount, 1, decompressBlocks);
+    else
+        decompressBlocks(0, blockCount);
+
+    if (failed)
+        return false;
+
+    *pixels = restored;
+    return true;
+}
+
+bool ClipboardHistory::sameContent(const Entry& entry, const Item& item) const
+{
+    if (entry.info.width != item.pixels.Width() || entry.info.height != item.pixels.Height()
+        || (!item.pixels.IsNull() && entry.format != item.pixels.Format())
+        || entry.png.Size() != item.png.Size() || entry.source.size != item.source.size)
+        return false;
+
+    if (!sameBytes(entry.png.ConstData(), item.png.ConstData(), item.png.Size())
+        || !sameBytes(entry.source.data, item.source.data, item.source.size))
+        return false;
+
+    // block 하나씩 풀어 비교한다. 다시 압축하는 것보다 싸다
+    const size_t rowBytes = static_cast<size_t>(entry.info.width) * 4;
+    const uint8_t* base = entry.compressed.ConstData();
+    std::vector<uint8_t> rows;
+    for (size_t i = 0; i < entry.blocks.size(); ++i)
+    {
+        const Block& block = entry.blocks[i];
+        const int firstRow = static_cast<int>(i) * entry.rowsPerBlock;
+        const int rowCount = std::min(entry.rowsPerBlock, entry.info.height - firstRow);
+        const size_t rawBytes = rowBytes * rowCount;
+
+        const uint8_t* data = base + block.offset;
+        if (!block.stored)
+        {
+            rows.resize(rawBytes);
+            if (!Lz4Block::Decompress(data, block.size, rows.data(), rawBytes))
+                return false;
+            data = rows.data();
+        }
+
+        for (int y = 0; y < rowCount; ++y)
+        {
+            if (std::memcmp(data + rowBytes * y, item.pixels.ConstScanLine(firstRow + y), rowBytes) != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+uint64_t ClipboardHistory::contentHash(const Item& item) const
+{
+    uint64_t hash = 0;
+    if (!item.pixels.IsNull())
+    {
+        hash = ContentHash::Hash(item.pixels.ConstBits(), static_cast<size_t>(item.pixels.Width()) * 4,
+                                 static_cast<size_t>(item.pixels.Stride()), item.pixels.Height(), pool_);
+        hash = ContentHash::Combine(hash, static_cast<uint64_t>(item.pixels.Width()));
+        hash = ContentHash::Combine(hash, static_cast<uint64_t>(item.pixels.Height()));
+        hash = ContentHash::Combine(hash, static_cast<uint64_t>(item.pixels.Format()));
+    }
+
+    // 픽셀 없이 인코딩된 파일만 있는 경우는 파일 내용으로 구분한다
+    if (item.source.size != 0)
+        hash = ContentHash::Combine(hash, ContentHash::Hash(item.source.data, item.source.size, item.source.size, 1));
+    else if (item.pixels.IsNull())
+        hash = ContentHash::Combine(hash, ContentHash::Hash(item.png.ConstData(), item.png.Size(), item.png.Size(), 1));
+
+    return hash;
+}
+
+ClipboardHistory::EntryList::iterator ClipboardHistory::findLocked(uint64_t id)
+{
+    return std::find_if(entries_.begin(), entries_.end(), [id](const Entry& entry) { return entry.info.id == id; });
+}
+
+void ClipboardHistory::eraseLocked(EntryList::iterator entry)
+{
+    stats_.rawBytes -= entry->info.rawBytes;
+    stats_.storedBytes -= entry->info.storedBytes;
+    auto indexed = byHash_.find(entry->hash);
+    if (indexed != byHash_.end() && indexed->second == entry)
+        byHash_.erase(indexed);
+    entries_.erase(entry);
+    stats_.entryCount = entries_.size();
+}
+
+void ClipboardHistory::evictLocked()
+{
+    while (!entries_.empty() && (stats_.storedBytes > stats_.budgetBytes || entries_.size() > stats_.maxEntries))
+    {
+        eraseLocked(std::prev(entries_.end()));
+        ++stats_.evictions;
+    }
+    stats_.entryCount = entries_.size();
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "bufferpool.h"
+#include "pixelbuffer.h"
+#include "pixmapclipboardsource.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+struct ClipboardHistoryStats
+{
+    size_t entryCount;
+    uint64_t rawBytes;              // 보관 중인 항목을 압축하지 않았을 때의 크기
+    uint64_t storedBytes;           // 실제로 들고 있는 크기
+    uint64_t adds;
+    uint64_t duplicates;            // 같은 이미지라 새로 압축하지 않은 횟수
+    uint64_t evictions;
+    uint64_t restores;
+    double lastCompressMilliseconds;
+    double lastRestoreMilliseconds;
+    double totalRestoreMilliseconds;
+    size_t budgetBytes;
+    size_t maxEntries;
+
+    // raw / stored (보관 중인 항목이 없으면 0)
+    double CompressionRatio() const;
+};
+
+// 최근에 clipboard 에 올린 이미지를 압축해서 보관한다.
+// 픽셀은 row block 단위로 LZ4 압축하고, 이미 압축된 PNG 와 원본 파일은 그대로 공유한다.
+// 되돌릴 때는 압축만 풀면 되므로 변환과 PNG 인코딩을 다시 하지 않는다. 모든 함수는 thread-safe
+class ClipboardHistory
+{
+public:
+    struct Item
+    {
+        Item();
+
+        PixelBuffer pixels;
+        ByteBuffer png;
+        PixmapClipboardSource::EncodedBytes source;     // 원본 파일 (없으면 size 0)
+    };
+
+    struct EntryInfo
+    {
+        uint64_t id;
+        int width;
+        int height;
+        bool hasPng;
+        bool hasSource;
+        size_t rawBytes;
+        size_t storedBytes;
+    };
+
+public:
+    ClipboardHistory(size_t budgetBytes, size_t maxEntries, ThreadPool* pool = nullptr, BufferPool* buffers = nullptr);
+
+    ClipboardHistory(const ClipboardHistory&) = delete;
+    ClipboardHistory& operator=(const ClipboardHistory&) = delete;
+
+public:
+    // 보관한 항목의 id, 0 이면 보관하지 않은 것 (비었거나 budget 보다 큼).
+    // 같은 이미지가 이미 있으면 (hash 가 같고 내용도 같으면) 다시 압축하지 않고 그 항목을 가장 최근으로 옮긴다
+    uint64_t Add(const Item& item);
+    // 픽셀은 새 버퍼에 풀고 PNG, 원본은 보관 중인 것을 공유한다
+    bool Restore(uint64_t id, Item* item);
+    bool Remove(uint64_t id);
+    void Clear();
+
+    // 최근 것부터
+    std::vector<EntryInfo> Entries() const;
+
+    void SetBudget(size_t budgetBytes);
+    void SetMaxEntries(size_t maxEntries);
+    ClipboardHistoryStats Stats() const;
+
+private:
+    // 각 block 은 따로 압축해서 병렬로 풀 수 있다
+    struct Block
+    {
+        size_t offset;
+        size_t size;
+        bool stored;            // 압축해도 줄지 않아 그대로 둔 block
+    };
+
+    struct Entry
+    {
+        EntryInfo info;
+        uint64_t hash;
+        PixelConverter::Format format;
+        int rowsPerBlock;
+        std::vector<Block> blocks;
+        ByteBuffer compressed;
+        ByteBuffer png;
+        PixmapClipboardSource::EncodedBytes source;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    bool compressPixels(const PixelBuffer& pixels, Entry* entry) const;
+    bool decompressPixels(const Entry& entry, PixelBuffer* pixels) const;
+    bool sameContent(const Entry& entry, const Item& item) const;
+    uint64_t contentHash(const Item& item) const;
+    EntryList::iterator findLocked(uint64_t id);
+    void eraseLocked(EntryList::iterator entry);
+    void evictLocked();
+
+private:
+    ThreadPool* pool_;
+    BufferPool* buffers_;
+    mutable std::mutex mutex_;
+    EntryList entries_;
+    std::unordered_map<uint64_t, EntryList::iterator> byHash_;
+    uint64_t nextId_;
+    ClipboardHistoryStats stats_;
+};
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "clipboardreader.h"
+#include "bufferpool.h"
+#include "cancellationtoken.h"
+#include "dibdecoder.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    // progress 와 취소 확인 단위
+    const size_t FEED_BYTES = 256 * 1024;
+
+    double elapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool isAvailable(const std::vector<ClipboardFormat>& formats, ClipboardFormat format)
+    {
+        return std::find(formats.begin(), formats.end(), format) != formats.end();
+    }
+}
+
+ClipboardReader::ClipboardReader(ThreadPool* pool, BufferPool* buffers)
+    : pool_(pool)
+    , buffers_(buffers)
+{}
+
+ClipboardReader::Result ClipboardReader::Read(ClipboardBackend& backend, const Allocator& allocate, const Progress& progress,
+                                              const CancellationToken* token) const
+{
+    Result result = {};
+    if (!allocate)
+        return result;
+
+    std::vector<ClipboardFormat> formats = backend.AvailableFormats();
+
+    // PNG 는 alpha 가 정확하고 원본이 작아서 clipboard 를 짧게 연다
+    if (isAvailable(formats, ClipboardFormat::Png) && readPng(backend, allocate, progress, token, &result))
+        return result;
+
+    // 열지 못했으면 DIBV5 로 다시 기다리지 않는다
+    if ((token && token->IsCanceled()) || result.failure == ClipboardFailure::Busy)
+        return result;
+
+    if (isAvailable(formats, ClipboardFormat::DibV5))
+        readDibV5(backend, allocate, progress, token, &result);
+
+    return result;
+}
+
+bool ClipboardReader::readPng(ClipboardBackend& backend, const Allocator& allocate, const Progress& progress,
+                              const CancellationToken* token, Result* result) const
+{
+    auto start = std::chrono::steady_clock::now();
+
+    ByteBuffer png(buffers_);
+    ClipboardBackend::Result read = {};
+    bool copied = backend.Read(ClipboardFormat::Png, [&png](const uint8_t* data, size_t size)
+    {
+        return png.Append(data, size);
+    }, &read, token);
+
+    result->format = ClipboardFormat::Png;
+    result->sourceBytes = png.Size();
+    result->readMilliseconds = elapsedMilliseconds(start) - read.contendedMilliseconds;
+    result->failure = read.failure;
+    result->contendedMilliseconds = read.contendedMilliseconds;
+    if (!copied)
+        return false;
+
+    // interlace 등 지원하지 않는 PNG 는 DIBV5 로 넘긴다
+    PngStreamDecoder::Info info;
+    if (!PngStreamDecoder::ReadInfo(png.ConstData(), png.Size(), &info) || info.interlaced)
+        return false;
+
+    start = std::chrono::steady_clock::now();
+
+    PngStreamDecoder decoder([&allocate](const PngStreamDecoder::Info& info)
+    {
+        return allocate(info.width, info.height, info.hasAlpha);
+    });
+
+    for (size_t offset = 0; offset < png.Size() && !decoder.IsFinished(); offset += FEED_BYTES)
+    {
+        if (token && token->IsCanceled())
+            return false;
+
+        if (!decoder.Feed(png.ConstData() + offset, std::min(FEED_BYTES, png.Size() - offset)))
+            return false;
+
+        if (progress)
+            progress(decoder.RowsDecoded(), info.height);
+    }
+
+    result->decodeMilliseconds = elapsedMilliseconds(start);
+    if (!decoder.IsFinished())
+        return false;
+
+    result->ok = true;
+    result->width = info.width;
+    result->height = info.height;
+    result->hasAlpha = decoder.ImageInfo().hasAlpha;
+    return true;
+}
+
+bool ClipboardReader::readDibV5(ClipboardBackend& backend, const Allocator& allocate, const Progress& progress,
+                                const CancellationToken* token, Result* result) const
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // 따로 복사하지 않고 clipboard 메모리에서 결과 row 로 바로 옮긴다
+    DibDecoder::Info info = {};
+    bool hasAlpha = false;
+    size_t sourceBytes = 0;
+    ClipboardBackend::Result read = {};
+    bool decoded = backend.Read(ClipboardFormat::DibV5, [&](const uint8_t* data, size_t size)
+    {
+        sourceBytes = size;
+        if (!DibDecoder::Parse(data, size, &info))
+            return false;
+
+        Target target = allocate(info.width, info.height, info.hasAlpha);
+        if (target.bits == nullptr || target.stride < info.width * 4)
+            return false;
+
+        return DibDecoder::DecodeRows(data, info, target.bits, target.stride, pool_, &hasAlpha);
+    }, &read, token);
+
+    result->format = ClipboardFormat::DibV5;
+    result->sourceBytes = sourceBytes;
+    result->readMilliseconds = elapsedMilliseconds(start) - read.contendedMilliseconds;
+    result->decodeMilliseconds = 0.0;
+    result->failure = read.failure;
+    result->contendedMilliseconds += read.contendedMilliseconds;
+    if (!decoded)
+        return false;
+
+    if (progress)
+        progress(info.height, info.height);
+
+    result->ok = true;
+    result->width = info.width;
+    result->height = info.height;
+    result->hasAlpha = hasAlpha;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "clipboardbackend.h"
+#include "pngdecoder.h"
+
+#include <cstddef>
+#include <functional>
+
+class BufferPool;
+class CancellationToken;
+class ThreadPool;
+
+// clipboard 의 이미지를 읽어 decode 한다. PNG 가 있으면 PNG, 없거나 decode 할 수 없으면 DIBV5.
+// clipboard 는 원본 byte 를 복사하는 동안만 열어 두고, decode 는 닫은 뒤에 한다 (DIBV5 는 row 를 바로 옮긴다)
+class ClipboardReader
+{
+public:
+    using Target = PngStreamDecoder::Target;
+    // 크기가 정해지면 호출된다. 결과는 BGRA 이며 hasAlpha 가 아니면 alpha 는 0xFF
+    using Allocator = std::function<Target(int width, int height, bool hasAlpha)>;
+    using Progress = std::function<void(int rowsDone, int height)>;
+
+    struct Result
+    {
+        bool ok;
+        ClipboardFormat format;
+        int width;
+        int height;
+        bool hasAlpha;
+        size_t sourceBytes;
+        double readMilliseconds;    // clipboard 를 열고 있던 시간
+        double decodeMilliseconds;
+        ClipboardFailure failure;   // clipboard 를 열지 못했거나 취소된 경우
+        double contendedMilliseconds;   // 다른 프로그램이 clipboard 를 잡고 있어 기다린 시간
+    };
+
+public:
+    explicit ClipboardReader(ThreadPool* pool = nullptr, BufferPool* buffers = nullptr);
+
+public:
+    Result Read(ClipboardBackend& backend, const Allocator& allocate, const Progress& progress = Progress(),
+                const CancellationToken* token = nullptr) const;
+
+private:
+    bool readPng(ClipboardBackend& backend, const Allocator& allocate, const Progress& progress,
+                 const CancellationToken* token, Result* result) const;
+    bool readDibV5(ClipboardBackend& backend, const Allocator& allocate, const Progress& progress,
+                   const CancellationToken* token, Result* result) const;
+
+private:
+    ThreadPool* pool_;
+    BufferPool* buffers_;
+};
\ No newline at end of file
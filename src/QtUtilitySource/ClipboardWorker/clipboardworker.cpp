@@ -1,42 +1,120 @@
 #include "clipboardworker.h"
+#include "clipboardreader.h"
+#include "contenthash.h"
+#include "encodedclipboardsource.h"
+#include "framediff.h"
+#include "imagewrap.h"
 #include "log.h"
-#include "gdipluscontext.h"
-
-#include <QBuffer>
+#include "memorytracker.h"
+#include "pixelconverter.h"
+#include "pixmapclipboardsource.h"
+#include "threadpool.h"
+#include "trace.h"
+#include "win32clipboardbackend.h"
+
+#include <QFile>
 #include <QPixmap>
 #include <QImage>
 #include <QDebug>
 
-#include <future>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <mutex>
-
-using namespace Gdiplus;
-using namespace std::chrono_literals;
+#include <vector>
 
 namespace
 {
-    class GlobalDeleter
+    const size_t DEFAULT_CACHE_BUDGET = 128 * 1024 * 1024; // 128MB
+    const size_t DEFAULT_BUFFER_POOL_LIMIT = 128 * 1024 * 1024; // 128MB
+    const size_t DEFAULT_HISTORY_BUDGET = 256 * 1024 * 1024; // 256MB
+    const size_t DEFAULT_HISTORY_ENTRIES = 20;
+    const int WARMUP_IMAGE_SIZE = 64;
+
+    double elapsedMilliseconds(std::chrono::steady_clock::time_point start)
     {
-    public:
-        void operator()(HGLOBAL hGlobal) const {
-            if (hGlobal)
-            {
-                GlobalUnlock(hGlobal);
-                GlobalFree(hGlobal);
-            }
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 원본 파일을 decode 해서 변환 kernel 이 읽을 수 있는 픽셀로 만든다
+    PixelBuffer decodeImage(const QByteArray& bytes)
+    {
+        QImage image = QImage::fromData(bytes);
+        if (image.isNull())
+        {
+            LOG_WARNING << "Decode failed:" << bytes.size() << "bytes";
+            return PixelBuffer();
         }
-    };
+
+        PixelConverter::Format format;
+        if (!ImageWrap::ToPixelFormat(image.format(), &format))
+            image = image.convertToFormat(QImage::Format_ARGB32);
+
+        return ImageWrap::Wrap(std::move(image));
+    }
+
+    EncodedImage probeEncodedImage(const QByteArray& bytes, std::shared_ptr<const void> owner = nullptr)
+    {
+        PixmapClipboardSource::EncodedBytes encoded;
+        encoded.owner = owner;
+        encoded.data = reinterpret_cast<const uint8_t*>(bytes.constData());
+        encoded.size = static_cast<size_t>(bytes.size());
+        return EncodedImage::Probe(encoded);
+    }
 }
 
 ClipboardWorker::ClipboardWorker()
     : QObject()
-    , copyToClipboardFuture_()
-    , setPixmapFuture_()
+    , createdAt_(std::chrono::steady_clock::now())
+    , thread_()
+    , threadOnce_()
+    , jobMutex_()
+    , jobCondition_()
+    , jobs_()
+    , runningJob_()
+    , hasRunningJob_(false)
+    , stop_(false)
+    , nextJobId_(0)
+    , threadPool_(std::make_unique<ThreadPool>())
+    , bufferPool_(std::make_unique<BufferPool>(DEFAULT_BUFFER_POOL_LIMIT))
+    , pngPreset_(PngEncoder::Preset::Fast)
+    , backend_()
+    , backendCreated_(false)
+    , backendMutex_()
     , pixmapData_()
-{}
+    , payloadCache_(DEFAULT_CACHE_BUDGET)
+    , history_(DEFAULT_HISTORY_BUDGET, DEFAULT_HISTORY_ENTRIES, threadPool_.get(), bufferPool_.get())
+    , memoryReport_()
+    , formatPolicy_()
+    , formatReport_()
+    , incrementalEncoding_(true)
+    , incrementalPng_()
+    , previousFrame_()
+    , pixmapDataMutex_()
+    , startup_()
+    , startupMutex_()
+{
+    // 스레드와 clipboard 창은 처음 쓸 때 만든다. 여기서는 메모리만 잡는다
+    incrementalPng_ = std::make_unique<IncrementalPngEncoder>(PngEncoder::Options(), threadPool_.get(), bufferPool_.get());
+    startup_.constructMilliseconds = elapsedMilliseconds(createdAt_);
+}
 
 ClipboardWorker::~ClipboardWorker()
 {
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+        stop_ = true;
+        jobs_.clear();
+        if (hasRunningJob_)
+            runningJob_.token.Cancel();
+    }
+    jobCondition_.notify_all();
+
+    if (thread_.joinable())
+        thread_.join();
+
+    // backend 가 렌더링에 thread pool 을 쓰므로 먼저 정리
+    SetBackend(nullptr);
     pixmapData_.Clear();
 }
 
@@ -48,265 +126,1192 @@ ClipboardWorker& ClipboardWorker::instance()
 
 // Public
 
-bool ClipboardWorker::SetPixmapData(const QPixmap& pixmap, bool waitToBeforeProcess)
+quint64 ClipboardWorker::SetPixmapData(const QPixmap& pixmap)
 {
-    LOG_INFO;
+    LOGF_INFO("{}x{}", pixmap.width(), pixmap.height());
+
+    // QPixmap 은 GUI 스레드에서만 다뤄야 하므로 여기서 QImage 로 바꾼다 (raster 에서는 복사 없음)
+    return queueImage(pixmap.toImage(), static_cast<quint64>(pixmap.cacheKey()));
+}
+
+quint64 ClipboardWorker::SetPixmapData(QImage&& image)
+{
+    LOGF_INFO("{}x{}", image.width(), image.height());
 
-    if (IsRunningSetPixmapData())
+    quint64 imageKey = static_cast<quint64>(image.cacheKey());
+    return queueImage(std::move(image), imageKey);
+}
+
+quint64 ClipboardWorker::SetPixmapData(RawImage image)
+{
+    LOGF_INFO("{}x{}", image.view.width, image.view.height);
+
+    Job job;
+    job.input = PixelBuffer::Wrap(image.view, std::move(image.release));
+    job.imageKey = 0;
+    if (job.input.IsNull())
+    {
+        LOG_WARNING << "Invalid raw image";
+        return 0;
+    }
+
+    return queueSetPixmapJob(job);
+}
+
+quint64 ClipboardWorker::SetPixmapData(TiledImage image)
+{
+    LOGF_INFO("{}x{}", image.width, image.height);
+
+    if (image.width <= 0 || image.height <= 0 || !image.readRows)
+    {
+        LOG_WARNING << "Invalid tiled image";
+        return 0;
+    }
+
+    Job job;
+    job.imageKey = 0;
+    job.tiled = std::move(image);
+    return queueSetPixmapJob(job);
+}
+
+quint64 ClipboardWorker::SetPixmapData(const QPixmap& pixmap, const QByteArray& sourceBytes)
+{
+    LOGF_INFO("{}x{} source: {} bytes", pixmap.width(), pixmap.height(), sourceBytes.size());
+
+    // 원본이 pixmap 과 다른 이미지(크기 변경 등)면 원본은 쓰지 않는다
+    EncodedImage encoded = probeEncodedImage(sourceBytes);
+    if (encoded.IsNull() || encoded.width != pixmap.width() || encoded.height != pixmap.height())
     {
-        if (waitToBeforeProcess)
+        LOG_WARNING << "Source bytes do not match pixmap, re-encode";
+        return SetPixmapData(pixmap);
+    }
+
+    return queueImage(pixmap.toImage(), static_cast<quint64>(pixmap.cacheKey()), sourceBytes);
+}
+
+quint64 ClipboardWorker::SetEncodedData(const QByteArray& sourceBytes)
+{
+    LOGF_INFO("source: {} bytes", sourceBytes.size());
+
+    EncodedImage encoded = probeEncodedImage(sourceBytes);
+    if (encoded.IsNull())
+    {
+        LOG_WARNING << "Unsupported source bytes:" << sourceBytes.size();
+        return 0;
+    }
+
+    Job job;
+    job.imageKey = 0;
+    job.sourceBytes = sourceBytes;
+    return queueSetPixmapJob(job);
+}
+
+bool ClipboardWorker::IsRunningSetPixmapData(quint64 jobId) const
+{
+    return isQueued(JobType::SetPixmap, jobId);
+}
+quint64 ClipboardWorker::CopyToClipboard(bool waitSetPixmapData)
+{
+    LOGF_INFO("wait: {}", waitSetPixmapData);
+
+    Job job;
+    job.type = JobType::Copy;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+
+        bool pixmapPending = (hasRunningJob_ && runningJob_.type == JobType::SetPixmap)
+            || std::any_of(jobs_.begin(), jobs_.end(), [](const Job& queued) { return queued.type == JobType::SetPixmap; });
+
+        if (pixmapPending && !waitSetPixmapData)
         {
-            LOG_INFO << "Wait to before process";
-            setPixmapFuture_.wait();
+            LOG_WARNING << "SetPixmapData is running";
+            return 0;
         }
-        else
+
+        // 아직 시작하지 않은 Copy 가 있으면 합친다
+        auto queuedCopy = std::find_if(jobs_.begin(), jobs_.end(), [](const Job& queued)
+        {
+            return queued.type == JobType::Copy;
+        });
+        if (queuedCopy != jobs_.end())
         {
-            LOG_WARNING << "SetPixmapData is already running";
-            return false;
+            LOGF_INFO("Coalesced to queued job: {}", queuedCopy->id);
+            return queuedCopy->id;
         }
+
+        job.id = ++nextJobId_;
+        jobs_.push_back(job);
     }
+    startThread();
+    jobCondition_.notify_one();
 
-    // async 
-    setPixmapFuture_ = std::async(std::launch::async, &ClipboardWorker::setPixmapDataImpl, this, pixmap);
+    LOGF_INFO("Queued job: {}", job.id);
+    return job.id;
+}
 
-    return true;
+bool ClipboardWorker::IsRunningCopyToClipboard(quint64 jobId) const
+{
+    return isQueued(JobType::Copy, jobId);
 }
 
-bool ClipboardWorker::IsRunningSetPixmapData() const
+quint64 ClipboardWorker::ReadImageAsync()
 {
-    if (!setPixmapFuture_.valid())
-        return false;
+    LOGF_INFO("");
+
+    Job job;
+    job.type = JobType::Read;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+
+        // 아직 시작하지 않은 Read 가 있으면 합친다
+        auto queuedRead = std::find_if(jobs_.begin(), jobs_.end(), [](const Job& queued)
+        {
+            return queued.type == JobType::Read;
+        });
+        if (queuedRead != jobs_.end())
+        {
+            LOGF_INFO("Coalesced to queued job: {}", queuedRead->id);
+            return queuedRead->id;
+        }
+
+        job.id = ++nextJobId_;
+        jobs_.push_back(job);
+    }
+    startThread();
+    jobCondition_.notify_one();
+
+    LOGF_INFO("Queued job: {}", job.id);
+    return job.id;
+}
+
+bool ClipboardWorker::IsRunningReadImage(quint64 jobId) const
+{
+    return isQueued(JobType::Read, jobId);
+}
+
+void ClipboardWorker::SetMaxThreadCount(int maxThreadCount)
+{
+    LOG_INFO << maxThreadCount;
+    threadPool_->SetMaxThreadCount(maxThreadCount);
+}
+
+int ClipboardWorker::MaxThreadCount() const
+{
+    return threadPool_->MaxThreadCount();
+}
+
+void ClipboardWorker::SetBackend(std::shared_ptr<ClipboardBackend> backend)
+{
+    std::lock_guard<std::mutex> lock(backendMutex_);
+    backend_ = backend;
+    backendCreated_ = true;
+}
 
-    return setPixmapFuture_.wait_for(0ms) != std::future_status::ready;
+std::shared_ptr<ClipboardBackend> ClipboardWorker::Backend() const
+{
+    std::lock_guard<std::mutex> lock(backendMutex_);
+    if (!backendCreated_)
+    {
+        // clipboard 창 스레드를 만들고 창이 준비될 때까지 기다린다
+        auto start = std::chrono::steady_clock::now();
+        backend_ = std::make_shared<Win32ClipboardBackend>(threadPool_.get());
+        backendCreated_ = true;
+
+        std::lock_guard<std::mutex> startupLock(startupMutex_);
+        startup_.backendMilliseconds = elapsedMilliseconds(start);
+        startup_.backendCreated = true;
+        LOG_INFO << "Backend created:" << startup_.backendMilliseconds << "ms";
+    }
+    return backend_;
+}
+
+void ClipboardWorker::SetPngPreset(PngEncoder::Preset preset)
+{
+    LOG_INFO << PngEncoder::PresetName(preset);
+    pngPreset_ = preset;
+}
+
+PngEncoder::Preset ClipboardWorker::PngPreset() const
+{
+    return pngPreset_;
 }
 
-bool ClipboardWorker::CopyToClipboard(bool waitSetPixmapData)
+ClipboardWorker::MemoryReport ClipboardWorker::LastMemoryReport() const
+{
+    std::lock_guard<std::mutex> lock(pixmapDataMutex_);
+    return memoryReport_;
+}
+
+void ClipboardWorker::SetCacheBudget(qint64 bytes)
+{
+    LOG_INFO << bytes;
+    payloadCache_.SetBudget(static_cast<size_t>(std::max<qint64>(bytes, 0)));
+}
+
+qint64 ClipboardWorker::CacheBudget() const
+{
+    return static_cast<qint64>(payloadCache_.Budget());
+}
+
+LruCacheStats ClipboardWorker::CacheStats() const
+{
+    return payloadCache_.Stats();
+}
+
+void ClipboardWorker::SetBufferPoolLimit(qint64 bytes)
+{
+    LOG_INFO << bytes;
+    bufferPool_->SetRetainLimit(static_cast<size_t>(std::max<qint64>(bytes, 0)));
+}
+
+qint64 ClipboardWorker::BufferPoolLimit() const
+{
+    return static_cast<qint64>(bufferPool_->RetainLimit());
+}
+
+void ClipboardWorker::TrimBufferPool(qint64 keepBytes)
+{
+    LOG_INFO << keepBytes;
+    bufferPool_->Trim(static_cast<size_t>(std::max<qint64>(keepBytes, 0)));
+}
+
+BufferPoolStats ClipboardWorker::BufferStats() const
+{
+    return bufferPool_->Stats();
+}
+
+void ClipboardWorker::SetFormatPolicy(const FormatPolicy::Options& options)
+{
+    LOG_INFO << "Eager:" << options.eagerMaxBytes << "PNG min:" << options.pngMinPixels
+             << "PNG budget:" << options.pngBudgetMilliseconds << "DIB max:" << options.dibMaxPixels
+             << "BITMAP max:" << options.bitmapMaxPixels;
+    formatPolicy_.SetOptions(options);
+}
+
+FormatPolicy::Options ClipboardWorker::FormatPolicyOptions() const
+{
+    return formatPolicy_.GetOptions();
+}
+
+FormatPolicy::Report ClipboardWorker::LastFormatReport() const
+{
+    std::lock_guard<std::mutex> lock(pixmapDataMutex_);
+    return formatReport_;
+}
+
+void ClipboardWorker::SetIncrementalEncoding(bool enabled)
+{
+    LOG_INFO << enabled;
+    incrementalEncoding_ = enabled;
+}
+
+bool ClipboardWorker::IsIncrementalEncoding() const
+{
+    return incrementalEncoding_;
+}
+
+void ClipboardWorker::SetHistoryBudget(qint64 bytes)
+{
+    LOG_INFO << bytes;
+    history_.SetBudget(static_cast<size_t>(std::max<qint64>(bytes, 0)));
+}
+
+void ClipboardWorker::SetHistoryMaxEntries(int maxEntries)
+{
+    LOG_INFO << maxEntries;
+    history_.SetMaxEntries(static_cast<size_t>(std::max(maxEntries, 0)));
+}
+
+std::vector<ClipboardHistory::EntryInfo> ClipboardWorker::HistoryEntries() const
+{
+    return history_.Entries();
+}
+
+ClipboardHistoryStats ClipboardWorker::HistoryStats() const
+{
+    return history_.Stats();
+}
+
+void ClipboardWorker::ClearHistory()
 {
     LOG_INFO;
+    history_.Clear();
+}
 
-    if (IsRunningCopyToClipboard())
+quint64 ClipboardWorker::RestoreFromHistory(quint64 entryId)
+{
+    LOGF_INFO("entry: {}", entryId);
+
+    Job job;
+    job.type = JobType::Restore;
+    job.historyId = entryId;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+
+        // 아직 시작하지 않은 Restore 가 있으면 마지막 요청으로 바꾼다
+        auto queuedRestore = std::find_if(jobs_.begin(), jobs_.end(), [](const Job& queued)
+        {
+            return queued.type == JobType::Restore;
+        });
+        if (queuedRestore != jobs_.end())
+        {
+            LOGF_INFO("Coalesced to queued job: {}", queuedRestore->id);
+            queuedRestore->historyId = entryId;
+            return queuedRestore->id;
+        }
+
+        job.id = ++nextJobId_;
+        jobs_.push_back(job);
+    }
+    startThread();
+    jobCondition_.notify_one();
+
+    LOGF_INFO("Queued job: {}", job.id);
+    return job.id;
+}
+
+bool ClipboardWorker::IsRunningRestoreFromHistory(quint64 jobId) const
+{
+    return isQueued(JobType::Restore, jobId);
+}
+
+void ClipboardWorker::SetTracing(bool enabled)
+{
+    LOG_INFO << enabled;
+    Trace::SetEnabled(enabled);
+}
+
+bool ClipboardWorker::IsTracing() const
+{
+    return Trace::IsEnabled();
+}
+
+bool ClipboardWorker::ExportTrace(const QString& path) const
+{
+    std::string json = Trace::ToChromeJson();
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
     {
-        LOG_WARNING << "CopyToClipboard is already running";
+        LOG_WARNING << "Open failed:" << path;
         return false;
     }
 
-    // async 
-    copyToClipboardFuture_ = std::async(std::launch::async, &ClipboardWorker::copyToClipboardImpl, this, waitSetPixmapData);
+    if (file.write(json.data(), static_cast<qint64>(json.size())) != static_cast<qint64>(json.size()))
+    {
+        LOG_WARNING << "Write failed:" << path;
+        return false;
+    }
 
+    LOG_INFO << path << "events:" << Trace::Events().size() << "dropped:" << Trace::DroppedCount();
     return true;
 }
 
-bool ClipboardWorker::IsRunningCopyToClipboard() const
+void ClipboardWorker::Warmup()
 {
-    if (!copyToClipboardFuture_.valid())
-        return false;
+    LOG_INFO;
+
+    if (GetStartupReport().warmedUp)
+        return;
+
+    Job job;
+    job.type = JobType::Warmup;
+
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+
+        auto queuedWarmup = std::find_if(jobs_.begin(), jobs_.end(), [](const Job& queued)
+        {
+            return queued.type == JobType::Warmup;
+        });
+        if (queuedWarmup != jobs_.end())
+            return;
+
+        job.id = ++nextJobId_;
+        jobs_.push_back(job);
+    }
+    startThread();
+    jobCondition_.notify_one();
+}
 
-    return copyToClipboardFuture_.wait_for(0ms) != std::future_status::ready;
+ClipboardWorker::StartupReport ClipboardWorker::GetStartupReport() const
+{
+    std::lock_guard<std::mutex> lock(startupMutex_);
+    return startup_;
 }
 
 // Private
 
-void ClipboardWorker::setPixmapDataImpl(const QPixmap& pixmap)
+quint64 ClipboardWorker::queueImage(QImage&& image, quint64 imageKey, const QByteArray& sourceBytes)
 {
-    LOG_INFO;
+    if (image.isNull())
+    {
+        LOG_WARNING << "Image is null";
+        return 0;
+    }
 
-    static std::mutex mutex;
-    std::lock_guard<std::mutex> lock(mutex);
+    Job job;
+    job.imageKey = imageKey;
+    job.sourceBytes = sourceBytes;
+    // 바로 읽을 수 없는 포맷은 job.image 로 넘겨 worker 에서 변환
+    job.input = ImageWrap::Wrap(std::move(image), &job.image);
 
-    LOG_INFO << "Start";
+    return queueSetPixmapJob(job);
+}
 
-    QImage image = pixmap.toImage();
+quint64 ClipboardWorker::queueSetPixmapJob(Job job)
+{
+    job.type = JobType::SetPixmap;
+    job.id = ++nextJobId_;
 
-    pixmapData_.Clear();
-    pixmapData_.bitmap = imageToBitmap(image);
-    pixmapData_.hBitmap = toHBITMAP(image);
-    pixmapData_.bytes = pixmapToBytes(pixmap);
+    std::vector<quint64> canceledIds;
+    {
+        std::lock_guard<std::mutex> lock(jobMutex_);
+
+        // 최신 요청만 처리: 대기 중인 SetPixmap 은 제거, 실행 중인 것은 취소
+        auto removed = std::remove_if(jobs_.begin(), jobs_.end(), [&canceledIds](const Job& queued)
+        {
+            if (queued.type != JobType::SetPixmap)
+                return false;
+
+            canceledIds.push_back(queued.id);
+            return true;
+        });
+        jobs_.erase(removed, jobs_.end());
+
+        if (hasRunningJob_ && runningJob_.type == JobType::SetPixmap)
+        {
+            LOGF_INFO("Cancel running job: {}", runningJob_.id);
+            runningJob_.token.Cancel();
+        }
+
+        // 대기 중인 Copy 가 새 이미지를 복사하도록 그 앞에 넣는다
+        auto firstCopy = std::find_if(jobs_.begin(), jobs_.end(), [](const Job& queued)
+        {
+            return queued.type == JobType::Copy;
+        });
+        jobs_.insert(firstCopy, job);
+    }
+    startThread();
+    jobCondition_.notify_one();
+
+    for (quint64 canceledId : canceledIds)
+    {
+        LOGF_INFO("Superseded job: {}", canceledId);
+        notifyCanceled(canceledId);
+    }
 
-    LOG_INFO << "Finished";
+    LOGF_INFO("Queued job: {}", job.id);
+    return job.id;
 }
 
-void ClipboardWorker::copyToClipboardImpl(bool waitSetPixmapData)
+void ClipboardWorker::run()
 {
-    LOG_INFO;
-
-    if (IsRunningSetPixmapData())
+    while (true)
     {
-        if (waitSetPixmapData)
+        Job job;
         {
-            LOG_INFO << "Wait to SetPixmapData";
-            setPixmapFuture_.wait();
+            std::unique_lock<std::mutex> lock(jobMutex_);
+            jobCondition_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+
+            if (stop_)
+                break;
+
+            job = jobs_.front();
+            jobs_.pop_front();
+            runningJob_ = job;
+            hasRunningJob_ = true;
         }
+
+        if (job.type == JobType::SetPixmap)
+            setPixmapDataImpl(job);
+        else if (job.type == JobType::Copy)
+            copyToClipboardImpl(job);
+        else if (job.type == JobType::Read)
+            readImageImpl(job);
+        else if (job.type == JobType::Restore)
+            restoreFromHistoryImpl(job);
         else
+            warmupImpl();
+
         {
-            LOG_WARNING << "SetPixmapData is running";
-            return;
+            std::lock_guard<std::mutex> lock(jobMutex_);
+            runningJob_ = Job();
+            hasRunningJob_ = false;
         }
     }
+}
 
-    if (pixmapData_.IsEmpty())
+bool ClipboardWorker::isQueued(JobType type, quint64 jobId) const
+{
+    std::lock_guard<std::mutex> lock(jobMutex_);
+
+    auto matches = [type, jobId](const Job& job)
     {
-        LOG_WARNING << "PixmapData is empty";
+        return job.type == type && (jobId == 0 || job.id == jobId);
+    };
+
+    if (hasRunningJob_ && matches(runningJob_))
+        return true;
+
+    return std::any_of(jobs_.begin(), jobs_.end(), matches);
+}
+
+void ClipboardWorker::setPixmapDataImpl(const Job& job)
+{
+    LOGF_INFO("Start job: {}", job.id);
+    Trace::Span span("SetPixmapData");
+
+    // 이전 데이터를 먼저 해제해야 peak 가 한 장 분량으로 유지된다
+    {
+        std::lock_guard<std::mutex> dataLock(pixmapDataMutex_);
+        pixmapData_.Clear();
+    }
+
+    MemoryTracker::ResetPeak();
+
+    PngEncoder::Preset pngPreset = pngPreset_;
+
+    const bool incremental = incrementalEncoding_;
+    if (!incremental)
+    {
+        previousFrame_ = PreviousFrame();
+        incrementalPng_->Reset();
+    }
+
+    PixmapData data;
+    data.jobId = job.id;
+    if (!job.sourceBytes.isEmpty())
+    {
+        // 원본 파일을 그대로 올리므로 PNG 인코딩은 하지 않는다. 픽셀이 없으면 붙여넣을 때 decode
+        data.sourceBytes = job.sourceBytes;
+        data.pixels = job.input;
+        if (data.pixels.IsNull() && !job.image.isNull())
+            data.pixels = imageToPixelBuffer(job.image);
+    }
+    else if (job.tiled.readRows)
+    {
+        // 원본 전체를 올리지 않고 결과 버퍼와 PNG 만 만든다. 내용을 미리 볼 수 없으므로 cache 는 쓰지 않는다
+        // 실패하면 data 는 비어 있는 채로 남는다
+        if (!tiledImageToPixmapData(job.tiled, pngPreset, job.token, &data))
+            LOG_WARNING << "Tiled image failed";
+    }
+    else
+    {
+        // 바로 읽을 수 없는 포맷은 BGRA 로 변환해서 쓴다. 다시 복사한 이미지는 cache 에서 찾으므로 변환도 하지 않는다.
+        // 내용으로만 찾을 수 있는 이미지(imageKey 가 없는)는 먼저 변환한다
+        PixelBuffer input = job.input;
+        if (input.IsNull() && job.imageKey == 0)
+            input = imageToPixelBuffer(job.image);
+
+        const int width = input.IsNull() ? job.image.width() : input.Width();
+        const int height = input.IsNull() ? job.image.height() : input.Height();
+        const PixelConverter::Format format = input.IsNull() ? PixelConverter::Format::BGRA : input.Format();
+
+        // 작은 불투명 이미지나 측정한 인코딩 시간이 너무 긴 이미지는 PNG 를 만들지 않는다
+        const char* pngReason = "";
+        FormatPolicy::Image image = { width, height, PixelConverter::HasAlpha(format) };
+        bool encodePng = width > 0 && height > 0 && formatPolicy_.ShouldEncodePng(image, &pngReason);
+        LOGF_INFO("Encode PNG: {} {}", encodePng, pngReason);
+
+        PayloadKey key = payloadKey(job.imageKey, width, height, format, input, pngPreset, encodePng);
+        PixmapData cached;
+        const bool cacheHit = payloadCache_.Find(key, &cached);
+        if (cacheHit)
+        {
+            LOGF_INFO("Cache hit: {}", key.imageKey);
+            data.pixels = cached.pixels;
+            data.pngBytes = cached.pngBytes;
+        }
+        else if (input.IsNull())
+        {
+            input = imageToPixelBuffer(job.image);
+        }
+
+        if (!cacheHit && !input.IsNull())
+        {
+            // 원본 메모리를 그대로 들고 있다가 DIB 는 붙여넣을 때 만들고, PNG 는 여기서 row band 단위로 병렬 인코딩
+            if (encodePng && !job.token.IsCanceled())
+                data.pngBytes = pixelBufferToPng(input, pngPreset, job.token, incremental);
+
+            // 다음 이미지는 이것과 비교한다. incrementalPng_ 가 가진 압축 결과와 항상 같은 이미지여야 한다
+            if (incremental && !data.pngBytes.IsEmpty())
+            {
+                previousFrame_.source = job.image;
+                previousFrame_.pixels = input;
+            }
+
+            data.pixels = input;
+            if (!job.token.IsCanceled() && !data.IsEmpty())
+                payloadCache_.Insert(key, data, static_cast<size_t>(data.ResidentBytes()));
+        }
+    }
+
+    if (job.token.IsCanceled())
+    {
+        LOGF_INFO("Canceled job: {}", job.id);
+        notifyCanceled(job.id);
         return;
     }
 
-    // Ʈ
-    Bitmap* bitmap = pixmapData_.bitmap;
-    QByteArray data = pixmapData_.bytes;
+    // 변환, 읽기에 실패했으면 일부만 만든 데이터를 두지 않는다
+    if (data.IsEmpty())
+    {
+        LOG_WARNING << "Failed job:" << job.id;
+        notifyPixmapDataFailed(job.id);
+        return;
+    }
+
+    span.SetBytes(static_cast<uint64_t>(data.ResidentBytes()));
+    MemoryTracker::ProcessMemory processMemory = MemoryTracker::QueryProcessMemory();
+
+    MemoryReport report;
+    report.pixelBytes = static_cast<qint64>(data.pixels.ByteCount());
+    report.encodedBytes = static_cast<qint64>(data.pngBytes.Size()) + data.sourceBytes.size();
+    report.residentBytes = data.ResidentBytes();
+    report.peakBytes = static_cast<qint64>(MemoryTracker::PeakBytes());
+    report.processWorkingSetBytes = static_cast<qint64>(processMemory.workingSetBytes);
+    report.processPeakWorkingSetBytes = static_cast<qint64>(processMemory.peakWorkingSetBytes);
+    report.cacheBytes = static_cast<qint64>(payloadCache_.Stats().bytes);
+    report.pooledBytes = static_cast<qint64>(bufferPool_->Stats().pooledBytes);
+
+    {
+        std::lock_guard<std::mutex> dataLock(pixmapDataMutex_);
+        pixmapData_ = data;
+        memoryReport_ = report;
+    }
+
+    LOGF_INFO("Memory resident: {} peak: {} working set: {} peak working set: {} pooled: {}",
+              report.residentBytes, report.peakBytes, report.processWorkingSetBytes, report.processPeakWorkingSetBytes, report.pooledBytes);
+    LOGF_INFO("Finished");
+}
+
+void ClipboardWorker::copyToClipboardImpl(const Job& job)
+{
+    LOGF_INFO("Job: {}", job.id);
+
+    Trace::Span span("CopyToClipboard");
 
-    // hGlobal 
-    HGLOBAL hGlobal = createDIBv5Header(bitmap);
-    if (hGlobal == nullptr)
+    // 같은 스레드에서 순서대로 처리되므로 앞선 SetPixmap 은 이미 끝난 상태
+    PixmapData data = pixmapData();
+    if (data.IsEmpty())
+    {
+        LOG_WARNING << "PixmapData is empty";
+        return;
+    }
+
+    ClipboardFailure failure = publishPixmapData(data, job.token);
+    if (failure != ClipboardFailure::None)
+    {
+        notifyCopyFailed(data.jobId, failure);
         return;
+    }
+
+    quint64 pixmapJobId = data.jobId;
+    QMetaObject::invokeMethod(this, [this, pixmapJobId]()
+    {
+        emit sig_clipboard_copied(pixmapJobId);
+    }, Qt::QueuedConnection);
+
+    // 올린 뒤에 압축하므로 복사 시간에는 들어가지 않는다
+    span.SetBytes(static_cast<uint64_t>(data.ResidentBytes()));
+    addToHistory(data);
+}
+
+void ClipboardWorker::readImageImpl(const Job& job)
+{
+    LOGF_INFO("Job: {}", job.id);
+    Trace::Span span("ReadImage");
+
+    QImage image;
+    std::shared_ptr<ClipboardBackend> backend = Backend();
+    if (!backend)
+    {
+        LOG_WARNING << "Backend is null";
+    }
+    else
+    {
+        // decode 결과를 QImage 에 바로 쓴다
+        auto allocate = [&image](int width, int height, bool hasAlpha)
+        {
+            image = QImage(width, height, hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+            ClipboardReader::Target target = { image.isNull() ? nullptr : image.bits(), image.bytesPerLine() };
+            return target;
+        };
+
+        // progress 는 1% 단위로만 알린다
+        const quint64 jobId = job.id;
+        int lastPercent = -1;
+        auto progress = [this, jobId, &lastPercent](int rowsDone, int height)
+        {
+            int percent = height > 0 ? static_cast<int>(static_cast<qint64>(rowsDone) * 100 / height) : 100;
+            if (percent == lastPercent)
+                return;
+
+            lastPercent = percent;
+            QMetaObject::invokeMethod(this, [this, jobId, rowsDone, height]()
+            {
+                emit sig_image_read_progress(jobId, rowsDone, height);
+            }, Qt::QueuedConnection);
+        };
+
+        ClipboardReader reader(threadPool_.get(), bufferPool_.get());
+        ClipboardReader::Result result = reader.Read(*backend, allocate, progress, &job.token);
+        if (result.ok)
+        {
+            span.SetBytes(result.sourceBytes);
+            LOGF_INFO("Format: {} Size: {}x{} Source: {} bytes Read: {} ms Decode: {} ms", ClipboardFormatName(result.format),
+                      result.width, result.height, result.sourceBytes, result.readMilliseconds, result.decodeMilliseconds);
+        }
+        else if (result.failure == ClipboardFailure::Busy)
+        {
+            LOG_WARNING << "Clipboard busy, waited:" << result.contendedMilliseconds << "ms";
+            image = QImage();
+        }
+        else
+        {
+            LOG_WARNING << "No readable image";
+            image = QImage();
+        }
+    }
 
-    std::unique_ptr<void, GlobalDeleter> hGlobalPtr(hGlobal);
+    const quint64 readJobId = job.id;
+    QMetaObject::invokeMethod(this, [this, readJobId, image]()
+    {
+        emit sig_image_read(readJobId, image);
+    }, Qt::QueuedConnection);
+}
 
-    // hGlobalPNG 
-    HGLOBAL hGlobalPNG = createPNGClipboardData(data);
-    if (hGlobalPNG == nullptr)
+void ClipboardWorker::restoreFromHistoryImpl(const Job& job)
+{
+    LOGF_INFO("Job: {} entry: {}", job.id, job.historyId);
+    Trace::Span span("history restore");
+
+    ClipboardHistory::Item item;
+    if (!history_.Restore(job.historyId, &item))
+    {
+        LOG_WARNING << "History entry not found:" << job.historyId;
         return;
+    }
+
+    PixmapData data;
+    data.jobId = job.id;
+    data.pixels = item.pixels;
+    data.pngBytes = item.png;
+    // addToHistory 에서 QByteArray 로 잡아 둔 원본
+    if (item.source.size != 0)
+        data.sourceBytes = *std::static_pointer_cast<const QByteArray>(item.source.owner);
 
-    std::unique_ptr<void, GlobalDeleter> hGlobalPNGPtr(hGlobalPNG);
+    span.SetBytes(static_cast<uint64_t>(data.ResidentBytes()));
+    ClipboardHistoryStats stats = history_.Stats();
+    LOGF_INFO("Restored: {}x{} in {} ms ratio: {}", data.pixels.Width(), data.pixels.Height(),
+              stats.lastRestoreMilliseconds, stats.CompressionRatio());
 
-    UINT customFormatPNG = RegisterClipboardFormatW(L"PNG");
-    if (!OpenClipboard(NULL))
+    // 이후 CopyToClipboard 도 이 이미지를 올린다
+    {
+        std::lock_guard<std::mutex> dataLock(pixmapDataMutex_);
+        pixmapData_ = data;
+    }
+
+    ClipboardFailure failure = publishPixmapData(data, job.token);
+    if (failure != ClipboardFailure::None)
+    {
+        notifyCopyFailed(job.id, failure);
         return;
+    }
 
-    EmptyClipboard();
-    SetClipboardData(customFormatPNG, hGlobalPNGPtr.release());
-    SetClipboardData(CF_DIBV5, hGlobalPtr.release());
-    SetClipboardData(CF_BITMAP, pixmapData_.hBitmap);
+    const quint64 restoreJobId = job.id;
+    QMetaObject::invokeMethod(this, [this, restoreJobId]()
+    {
+        emit sig_clipboard_copied(restoreJobId);
+    }, Qt::QueuedConnection);
+}
 
-    CloseClipboard();
+void ClipboardWorker::warmupImpl()
+{
+    Trace::Span span("warmup");
+    auto start = std::chrono::steady_clock::now();
+
+    // clipboard 창 스레드
+    Backend();
+
+    // CPU 기능 확인과 pool 스레드 생성
+    PixelConverter::ActiveIsa();
+    threadPool_->ParallelFor(0, threadPool_->MaxThreadCount(), 1, [](int, int) {});
+
+    // zlib 상태와 band 버퍼를 한 번 써 본다. 결과는 버린다
+    PixelBuffer pixels = PixelBuffer::Allocate(WARMUP_IMAGE_SIZE, WARMUP_IMAGE_SIZE, PixelConverter::Format::BGRA, bufferPool_.get());
+    if (!pixels.IsNull())
+    {
+        std::memset(pixels.Bits(), 0, pixels.ByteCount());
+        PngEncoder(PngEncoder::Options(), threadPool_.get(), bufferPool_.get()).Encode(pixels.View(), [](const uint8_t*, size_t)
+        {
+            return true;
+        });
+    }
 
-    QMetaObject::invokeMethod(this, &ClipboardWorker::sig_clipboard_copied, Qt::QueuedConnection);
+    std::lock_guard<std::mutex> lock(startupMutex_);
+    startup_.warmupMilliseconds = elapsedMilliseconds(start);
+    startup_.warmedUp = true;
+    LOG_INFO << "Warmed up:" << startup_.warmupMilliseconds << "ms";
 }
 
-Bitmap* ClipboardWorker::imageToBitmap(const QImage& image)
+ClipboardFailure ClipboardWorker::publishPixmapData(const PixmapData& data, const CancellationToken& token)
 {
-    LOG_INFO;
-    LOG_INFO << "Image size: " << image.size();
+    Trace::Span span("publish");
 
-    int imageWidth = image.width();
-    int imageHeight = image.height();
+    std::shared_ptr<ClipboardBackend> backend = Backend();
+    if (!backend)
+    {
+        LOG_WARNING << "Backend is null";
+        return ClipboardFailure::Error;
+    }
 
-    Bitmap* bitmap = new Bitmap(imageWidth, imageHeight, PixelFormat32bppARGB);
+    // 포맷은 약속만 하고 실제 데이터는 붙여넣을 때 만든다
+    std::shared_ptr<const ClipboardSource> source;
+    FormatPolicy::Image image = { data.pixels.Width(), data.pixels.Height(), PixelConverter::HasAlpha(data.pixels.Format()) };
+    bool pngEncoded = !data.pngBytes.IsEmpty();
+    if (!data.sourceBytes.isEmpty())
+    {
+        // QByteArray 는 암시적 공유이므로 복사 없이 source 가 원본을 잡고 있는다
+        auto sourceBytes = std::make_shared<QByteArray>(data.sourceBytes);
+        EncodedImage encoded = probeEncodedImage(*sourceBytes, sourceBytes);
+
+        // 픽셀이 없으면 header 로 판단. JPEG 는 alpha 가 없다
+        if (data.pixels.IsNull())
+            image = { encoded.width, encoded.height, encoded.kind != EncodedImage::Kind::Jpeg };
+        pngEncoded = encoded.kind == EncodedImage::Kind::Png;
+
+        PngEncoder::Options pngOptions;
+        pngOptions.preset = pngPreset_;
+        source = std::make_shared<EncodedClipboardSource>(encoded, data.pixels, [sourceBytes]()
+        {
+            return decodeImage(*sourceBytes);
+        }, pngOptions, threadPool_.get(), bufferPool_.get());
+    }
+    else
+    {
+        // source 가 PNG 버퍼를 공유해서 잡고 있다가 붙여넣을 때 clipboard 메모리로 한 번만 복사한다
+        PixmapClipboardSource::EncodedBytes png;
+        png.owner = data.pngBytes.Owner();
+        png.data = data.pngBytes.ConstData();
+        png.size = data.pngBytes.Size();
+        source = std::make_shared<PixmapClipboardSource>(data.pixels, png, threadPool_.get());
+    }
 
-    // QImage ͸ Bitmap 
-    for (int y = 0; y < imageHeight; ++y) {
-        for (int x = 0; x < imageWidth; ++x) {
-            QColor color = image.pixelColor(x, y);
-            Color gpColor(color.alpha(), color.red(), color.green(), color.blue());
-            bitmap->SetPixel(x, y, gpColor.GetValue());
-        }
+    FormatPolicy::Report report = formatPolicy_.Choose(image, source->Formats(), pngEncoded);
+    LOGF_INFO("Formats chosen: {}", report.ToString());
+    {
+        std::lock_guard<std::mutex> dataLock(pixmapDataMutex_);
+        formatReport_ = report;
+    }
+    source = std::make_shared<PolicyClipboardSource>(source, report);
+
+    // 다른 프로그램이 clipboard 를 열고 있으면 backend 가 간격을 늘려 가며 다시 시도한다
+    ClipboardBackend::Result result = {};
+    bool published = backend->Publish(source, &result, &token);
+    if (result.attempts > 1 || !published)
+    {
+        LOGF_INFO("Publish attempts: {} contended: {} ms total: {} ms", result.attempts, result.contendedMilliseconds,
+                  result.totalMilliseconds);
     }
 
-    return bitmap;
+    if (!published)
+    {
+        LOG_WARNING << "Publish failed:" << ClipboardFailureName(result.failure);
+        return result.failure;
+    }
+
+    return ClipboardFailure::None;
 }
 
-QByteArray ClipboardWorker::pixmapToBytes(const QPixmap& pixmap)
+void ClipboardWorker::addToHistory(const PixmapData& data)
 {
-    QByteArray data;
-    QBuffer buffer(&data);
-    pixmap.save(&buffer, "PNG");
+    Trace::Span span("history add", nullptr, static_cast<uint64_t>(data.ResidentBytes()));
 
-    return data;
+    ClipboardHistory::Item item;
+    item.pixels = data.pixels;
+    item.png = data.pngBytes;
+    if (!data.sourceBytes.isEmpty())
+    {
+        // QByteArray 는 암시적 공유이므로 복사 없이 잡아 두었다가 restore 에서 그대로 꺼낸다
+        auto sourceBytes = std::make_shared<QByteArray>(data.sourceBytes);
+        item.source.owner = sourceBytes;
+        item.source.data = reinterpret_cast<const uint8_t*>(sourceBytes->constData());
+        item.source.size = static_cast<size_t>(sourceBytes->size());
+    }
+
+    quint64 entryId = history_.Add(item);
+    ClipboardHistoryStats stats = history_.Stats();
+    LOGF_INFO("History entry: {} entries: {} stored: {} ratio: {} compress: {} ms", entryId, stats.entryCount, stats.storedBytes,
+              stats.CompressionRatio(), stats.lastCompressMilliseconds);
 }
 
-HGLOBAL ClipboardWorker::createDIBv5Header(Bitmap* image)
+PixelBuffer ClipboardWorker::imageToPixelBuffer(const QImage& image)
 {
-    int width = image->GetWidth();
-    int height = image->GetHeight();
+    LOGF_INFO("Image size: {}x{} format: {}", image.width(), image.height(), static_cast<int>(image.format()));
 
-    HGLOBAL hGlobal = GlobalAlloc(GMEM_MOVEABLE, sizeof(BITMAPV5HEADER) + width * height * 4);
-    if (!hGlobal)
-        return nullptr;
+    if (image.isNull())
+        return PixelBuffer();
 
-    BITMAPV5HEADER* dibv5Data = (BITMAPV5HEADER*)GlobalLock(hGlobal);
-    if (!dibv5Data)
-        return nullptr;
+    Trace::Span span("convert", nullptr, static_cast<uint64_t>(image.sizeInBytes()));
 
-    dibv5Data->bV5Size = sizeof(BITMAPV5HEADER);
-    dibv5Data->bV5Width = width;
-    dibv5Data->bV5Height = -height;
-    dibv5Data->bV5Planes = 1;
-    dibv5Data->bV5BitCount = 32;
-    dibv5Data->bV5Compression = BI_BITFIELDS;
-    dibv5Data->bV5SizeImage = 0;
-    dibv5Data->bV5XPelsPerMeter = 0;
-    dibv5Data->bV5YPelsPerMeter = 0;
-    dibv5Data->bV5ClrUsed = 0;
-    dibv5Data->bV5ClrImportant = 0;
-    dibv5Data->bV5RedMask = 0x00FF0000;
-    dibv5Data->bV5GreenMask = 0x0000FF00;
-    dibv5Data->bV5BlueMask = 0x000000FF;
-    dibv5Data->bV5AlphaMask = 0xFF000000;
+    // 직전에 변환한 이미지와 크기, 포맷이 같으면 달라진 row 만 변환한다
+    if (incrementalEncoding_ && previousFrame_.source.size() == image.size() && previousFrame_.source.format() == image.format()
+        && previousFrame_.pixels.Width() == image.width() && previousFrame_.pixels.Height() == image.height())
+    {
+        PixelBuffer pixels = convertChangedRows(image);
+        if (!pixels.IsNull())
+            return pixels;
+    }
 
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            Gdiplus::Color pixelColor;
-            image->GetPixel(x, y, &pixelColor);
+    // 변환 kernel 이 읽을 수 없는 포맷만 한 번 변환하고 결과를 그대로 감싼다
+    PixelBuffer pixels = ImageWrap::Wrap(image.convertToFormat(QImage::Format_ARGB32));
+    if (pixels.IsNull())
+        LOG_WARNING << "Image conversion failed";
 
-            ARGB* destPixel = (ARGB*)((BYTE*)dibv5Data + sizeof(BITMAPV5HEADER)) + (y * width) + x;
-            *destPixel = pixelColor.GetValue();
-        }
+    return pixels;
+}
+
+PixelBuffer ClipboardWorker::convertChangedRows(const QImage& image)
+{
+    const PixelBuffer& previous = previousFrame_.pixels;
+    const int width = image.width();
+    const int height = image.height();
+
+    PixelBuffer pixels = PixelBuffer::Allocate(width, height, PixelConverter::Format::BGRA, bufferPool_.get());
+    if (pixels.IsNull())
+        return pixels;
+
+    const QImage& source = previousFrame_.source;
+    const size_t rowBytes = (static_cast<size_t>(width) * image.depth() + 7) / 8;
+    std::vector<RowRange> changedRows = FrameDiff::ChangedRows(source.constBits(), static_cast<size_t>(source.bytesPerLine()),
+                                                               image.constBits(), static_cast<size_t>(image.bytesPerLine()),
+                                                               rowBytes, height, threadPool_.get());
+
+    // 바뀌지 않은 row 는 직전 결과에서 복사
+    auto copyRows = [&](int begin, int end)
+    {
+        for (int y = begin; y < end; ++y)
+            std::memcpy(pixels.ScanLine(y), previous.ConstScanLine(y), static_cast<size_t>(width) * 4);
+    };
+
+    int copied = 0;
+    for (const RowRange& range : changedRows)
+    {
+        threadPool_->ParallelFor(copied, range.begin, 64, copyRows);
+        copied = range.end;
+
+        QImage converted = image.copy(0, range.begin, width, range.end - range.begin).convertToFormat(QImage::Format_ARGB32);
+        if (converted.isNull())
+            return PixelBuffer();
+
+        for (int y = 0; y < converted.height(); ++y)
+            std::memcpy(pixels.ScanLine(range.begin + y), converted.constScanLine(y), static_cast<size_t>(width) * 4);
+    }
+    threadPool_->ParallelFor(copied, height, 64, copyRows);
+
+    LOGF_INFO("Converted rows: {}/{}", FrameDiff::RowCount(changedRows), height);
+    return pixels;
+}
+
+bool ClipboardWorker::tiledImageToPixmapData(const TiledImage& image, PngEncoder::Preset preset, const CancellationToken& token, PixmapData* data)
+{
+    LOGF_INFO("Image size: {}x{}", image.width, image.height);
+    Trace::Span span("tiled pipeline", nullptr, static_cast<uint64_t>(image.width) * image.height * 4);
+
+    PixelBuffer pixels = PixelBuffer::Allocate(image.width, image.height, PixelConverter::Format::BGRA, bufferPool_.get());
+    if (pixels.IsNull())
+    {
+        LOG_WARNING << "PixelBuffer allocation failed";
+        return false;
     }
 
-    GlobalUnlock(hGlobal);
-    return hGlobal;
+    ByteBuffer pngBytes(bufferPool_.get());
+    TiledPipeline::Options options;
+    options.png.preset = preset;
+    TiledPipeline pipeline(options, threadPool_.get(), bufferPool_.get());
+    TiledPipeline::Result result = pipeline.Run(image.width, image.height, image.format, image.readRows,
+        pixels.Bits(), pixels.Stride(), [&pngBytes](const uint8_t* bytes, size_t size)
+        {
+            return pngBytes.Append(bytes, size);
+        }, &token);
+
+    LOGF_INFO("Tiles: {} rows per tile: {} working set: {}", result.tileCount, result.tileRows, result.workingSetBytes);
+
+    if (!result.ok)
+    {
+        if (!token.IsCanceled())
+            LOG_WARNING << "Tiled pipeline failed";
+        return false;
+    }
+
+    pngBytes.ShrinkToFit();
+
+    data->pixels = pixels;
+    data->pngBytes = pngBytes;
+    return true;
+}
+
+ByteBuffer ClipboardWorker::pixelBufferToPng(const PixelBuffer& pixels, PngEncoder::Preset preset, const CancellationToken& token, bool incremental)
+{
+    LOGF_INFO("Preset: {}", PngEncoder::PresetName(preset));
+
+    PngEncoder::Options options;
+    options.preset = preset;
+
+    // band 결과를 pool 버퍼에 바로 이어 붙인다. 모자라면 한 단계 큰 size class 로 옮긴다
+    ByteBuffer bytes(bufferPool_.get());
+    bytes.Reserve(pixels.ByteCount() / 4);
+    auto sink = [&bytes](const uint8_t* data, size_t size)
+    {
+        return bytes.Append(data, size);
+    };
+
+    Trace::Span span("png encode", incremental ? "incremental" : "full");
+    auto start = std::chrono::steady_clock::now();
+    bool encoded = false;
+    bool fullEncode = true;
+    if (incremental)
+    {
+        // 직전에 인코딩한 이미지와 달라진 row band 만 다시 압축하고 나머지는 압축 결과를 그대로 쓴다
+        std::vector<RowRange> changedRows = FrameDiff::ChangedRows(previousFrame_.pixels.View(), pixels.View(), threadPool_.get());
+        incrementalPng_->SetOptions(options);
+        encoded = incrementalPng_->Encode(pixels.View(), changedRows, sink, &token);
+
+        IncrementalPngEncoder::Stats stats = incrementalPng_->LastStats();
+        fullEncode = stats.encodedBands == stats.bandCount;
+        LOGF_INFO("Encoded bands: {}/{} changed rows: {}", stats.encodedBands, stats.bandCount, stats.changedRows);
+    }
+    else
+    {
+        PngEncoder encoder(options, threadPool_.get(), bufferPool_.get());
+        encoded = encoder.Encode(pixels.View(), sink, &token);
+    }
+
+    if (!encoded)
+    {
+        if (!token.IsCanceled())
+            LOG_WARNING << "PNG encoding failed";
+        return ByteBuffer();
+    }
+
+    // 다음 이미지의 포맷을 고를 때 쓴다
+    formatPolicy_.RecordPngEncode(static_cast<uint64_t>(pixels.Width()) * pixels.Height(),
+                                  std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+                                  !fullEncode);
+
+    bytes.ShrinkToFit();
+    span.SetBytes(bytes.Size());
+    return bytes;
 }
 
-HGLOBAL ClipboardWorker::createPNGClipboardData(QByteArray bytes)
+ClipboardWorker::PayloadKey ClipboardWorker::payloadKey(quint64 imageKey, int width, int height, PixelConverter::Format format,
+                                                        const PixelBuffer& pixels, PngEncoder::Preset preset, bool encodePng) const
 {
-    std::vector<BYTE> pngData(bytes.begin(), bytes.end());
+    PayloadKey key;
+    key.imageKey = imageKey;
+    key.contentHash = 0;
+    key.width = width;
+    key.height = height;
+    key.imageFormat = static_cast<int>(format);
+    key.pngPreset = encodePng ? static_cast<int>(preset) : -1;
+
+    // cacheKey 는 QImage, QPixmap 의 내용이 바뀌면(detach) 달라지므로 그것만으로 찾는다. 없으면(RawImage) 내용으로
+    if (imageKey == 0 && !pixels.IsNull())
+    {
+        key.contentHash = ContentHash::Hash(pixels.ConstBits(), static_cast<size_t>(pixels.Width()) * 4,
+                                            static_cast<size_t>(pixels.Stride()), pixels.Height(), threadPool_.get());
+    }
 
-    HGLOBAL hGlobalPNG = GlobalAlloc(GMEM_MOVEABLE, pngData.size());
-    if (!hGlobalPNG)
-        return nullptr;
+    return key;
+}
 
-    BYTE* pDataPNG = static_cast<BYTE*>(GlobalLock(hGlobalPNG));
-    if (!pDataPNG)
-        return nullptr;
+ClipboardWorker::PixmapData ClipboardWorker::pixmapData() const
+{
+    std::lock_guard<std::mutex> lock(pixmapDataMutex_);
+    return pixmapData_;
+}
 
-    memcpy(pDataPNG, pngData.data(), pngData.size());
-    GlobalUnlock(hGlobalPNG);
-    return hGlobalPNG;
+void ClipboardWorker::notifyCanceled(quint64 jobId)
+{
+    QMetaObject::invokeMethod(this, [this, jobId]()
+    {
+        emit sig_pixmap_data_canceled(jobId);
+    }, Qt::QueuedConnection);
 }
 
-HBITMAP ClipboardWorker::toHBITMAP(const QImage& image)
+void ClipboardWorker::notifyPixmapDataFailed(quint64 jobId)
 {
-    // QImage BMP  QByteArray 
-    QByteArray byteArray;
-    QBuffer buffer(&byteArray);
-    buffer.open(QIODevice::WriteOnly);
-    image.save(&buffer, "BMP");
+    QMetaObject::invokeMethod(this, [this, jobId]()
+    {
+        emit sig_pixmap_data_failed(jobId);
+    }, Qt::QueuedConnection);
+}
+
+void ClipboardWorker::startThread()
+{
+    // 첫 작업이 들어올 때 한 번
+    std::call_once(threadOnce_, [this]()
+    {
+        auto start = std::chrono::steady_clock::now();
+        thread_ = std::thread(&ClipboardWorker::run, this);
 
-    // BITMAPFILEHEADER BITMAPINFOHEADER 
-    BITMAPFILEHEADER* bmpFileHeader = (BITMAPFILEHEADER*)byteArray.constData();
-    BITMAPINFOHEADER* bmpInfoHeader = (BITMAPINFOHEADER*)(byteArray.constData() + sizeof(BITMAPFILEHEADER));
+        std::lock_guard<std::mutex> lock(startupMutex_);
+        startup_.threadMilliseconds = elapsedMilliseconds(start);
+        startup_.threadStarted = true;
+    });
+}
 
-    // HBITMAP   ȼ  
-    HBITMAP hBitmap = CreateCompatibleBitmap(GetDC(NULL), bmpInfoHeader->biWidth, bmpInfoHeader->biHeight);
-    SetDIBits(GetDC(NULL), hBitmap, 0, bmpInfoHeader->biHeight, byteArray.constData() + bmpFileHeader->bfOffBits, (BITMAPINFO*)bmpInfoHeader, DIB_RGB_COLORS);
+void ClipboardWorker::notifyCopyFailed(quint64 jobId, ClipboardFailure failure)
+{
+    // 취소는 실패로 알리지 않는다
+    if (failure == ClipboardFailure::Canceled)
+        return;
 
-    return hBitmap;
+    const QString reason = QString::fromLatin1(ClipboardFailureName(failure));
+    QMetaObject::invokeMethod(this, [this, jobId, reason]()
+    {
+        emit sig_clipboard_copy_failed(jobId, reason);
+    }, Qt::QueuedConnection);
 }
 
 // PixmapData struct
 
 void ClipboardWorker::PixmapData::Clear()
 {
-    if (hBitmap)
-        DeleteObject(hBitmap);
+    jobId = 0;
+    pixels = PixelBuffer();
+    pngBytes.Clear();
+    sourceBytes = QByteArray();
+}
 
-    if (bitmap)
-        delete bitmap;
+bool ClipboardWorker::PixmapData::IsEmpty() const
+{
+    return pixels.IsNull() && pngBytes.IsEmpty() && sourceBytes.isEmpty();
+}
 
-    hBitmap = nullptr;
-    bitmap = nullptr;
-    bytes = QByteArray();
+qint64 ClipboardWorker::PixmapData::ResidentBytes() const
+{
+    return static_cast<qint64>(pixels.ByteCount() + pngBytes.Size()) + sourceBytes.size();
 }
 
-bool ClipboardWorker::PixmapData::IsEmpty() const
+// PayloadKey struct
+
+bool ClipboardWorker::PayloadKey::operator==(const PayloadKey& other) const
+{
+    return imageKey == other.imageKey
+        && contentHash == other.contentHash
+        && width == other.width
+        && height == other.height
+        && imageFormat == other.imageFormat
+        && pngPreset == other.pngPreset;
+}
+
+size_t ClipboardWorker::PayloadKeyHash::operator()(const PayloadKey& key) const
 {
-    return hBitmap == nullptr && bitmap == nullptr && bytes.isEmpty();
+    return static_cast<size_t>(ContentHash::Combine(key.contentHash, key.imageKey));
 }
\ No newline at end of file
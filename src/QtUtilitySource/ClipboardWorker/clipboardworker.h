@@ -1,22 +1,33 @@
 #pragma once
 
+#include "bufferpool.h"
+#include "cancellationtoken.h"
+#include "clipboardbackend.h"
+#include "clipboardhistory.h"
+#include "formatpolicy.h"
+#include "lrucache.h"
+#include "pixelbuffer.h"
+#include "pngencoder.h"
+#include "tiledpipeline.h"
+
 #include <QObject>
+#include <QByteArray>
+#include <QImage>
+#include <QPixmap>
 
-#include <future>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <memory>
-#include <windows.h>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #define g_Clipboard ClipboardWorker::instance()
 
-namespace Gdiplus
-{
-    class Bitmap;
-}
-
-class QImage;
-class QPixmap;
-class QByteArray;
-class GdiplusContext;
+class ThreadPool;
 
 class ClipboardWorker : public QObject
 {
@@ -30,37 +41,242 @@ public:
 
     static ClipboardWorker& instance();
 
+public:
+    struct MemoryReport
+    {
+        qint64 pixelBytes;
+        qint64 encodedBytes;
+        qint64 residentBytes;
+        qint64 peakBytes;
+        qint64 processWorkingSetBytes;
+        qint64 processPeakWorkingSetBytes;
+        qint64 cacheBytes;
+        qint64 pooledBytes;
+    };
+
+    // 처음 쓸 때 초기화한 부분별 소요 시간 (ms). 프로그램 시작 때 내던 비용이 이만큼 뒤로 밀린다
+    struct StartupReport
+    {
+        double constructMilliseconds;   // instance() 첫 호출
+        double threadMilliseconds;      // worker 스레드 시작 (첫 작업 요청)
+        double backendMilliseconds;     // 기본 clipboard backend (Win32 는 clipboard 창 스레드까지)
+        double warmupMilliseconds;      // Warmup 전체 (thread pool, PNG 인코더, 아직 없었으면 backend 포함)
+        bool threadStarted;
+        bool backendCreated;
+        bool warmedUp;
+    };
+
+    // 호출한 쪽이 소유한 32bpp 픽셀. 복사 없이 그대로 읽으며,
+    // release 는 worker 와 clipboard 가 더 이상 view 를 쓰지 않을 때 (임의의 스레드에서) 한 번 호출된다
+    struct RawImage
+    {
+        ImageView view;
+        std::function<void()> release;
+    };
+
+    // 한 번에 메모리에 올리기 어려운 큰 이미지. readRows 로 위쪽부터 tile 단위로 읽는다
+    struct TiledImage
+    {
+        int width;
+        int height;
+        PixelConverter::Format format;
+        TiledPipeline::RowReader readRows;
+    };
+
 private:
+    // CF_DIBV5, CF_BITMAP, PNG 는 모두 pixels 에서 만든다
     struct PixmapData
     {
-        HBITMAP hBitmap;
-        Gdiplus::Bitmap* bitmap;
-        QByteArray bytes;
+        quint64 jobId;
+        PixelBuffer pixels;
+        ByteBuffer pngBytes;
+        QByteArray sourceBytes;     // 원본 파일 (PNG, JPEG). 있으면 pngBytes 대신 그대로 올린다
 
         void Clear();
         bool IsEmpty() const;
+        qint64 ResidentBytes() const;
+    };
+
+    // 같은 이미지를 다시 복사하면 변환과 인코딩을 건너뛰기 위한 key
+    struct PayloadKey
+    {
+        quint64 imageKey;       // QImage, QPixmap 의 cacheKey
+        quint64 contentHash;    // imageKey 가 없을 때(RawImage)만
+        int width;
+        int height;
+        int imageFormat;
+        int pngPreset;          // PNG 를 만들지 않았으면 -1
+
+        bool operator==(const PayloadKey& other) const;
+    };
+
+    struct PayloadKeyHash
+    {
+        size_t operator()(const PayloadKey& key) const;
+    };
+
+    using PayloadCache = LruCache<PayloadKey, PixmapData, PayloadKeyHash>;
+
+    // 같은 크기의 이미지를 반복해서 넣을 때 달라진 row 만 다시 처리하기 위한 직전 이미지
+    struct PreviousFrame
+    {
+        QImage source;          // 변환해서 쓴 경우 변환 전 원본
+        PixelBuffer pixels;     // incrementalPng_ 가 마지막으로 인코딩한 픽셀
+    };
+
+    enum class JobType
+    {
+        SetPixmap,
+        Copy,
+        Read,
+        Restore,
+        Warmup,
+    };
+
+    struct Job
+    {
+        JobType type;
+        quint64 id;
+        PixelBuffer input;      // 복사 없이 감싼 원본
+        QImage image;           // input 으로 바로 쓸 수 없는 포맷이면 worker 에서 변환
+        quint64 imageKey;
+        TiledImage tiled;       // readRows 가 있으면 tile 단위로 처리
+        QByteArray sourceBytes; // 원본 파일 byte. 있으면 다시 인코딩하지 않는다
+        quint64 historyId;      // Restore 할 history 항목
+        CancellationToken token;
     };
 
 public:
-    bool SetPixmapData(const QPixmap& pixmap, bool waitToBeforeProcess = true);
-    bool IsRunningSetPixmapData() const;
-    bool CopyToClipboard(bool waitSetPixmapData = true);
-    bool IsRunningCopyToClipboard() const;
+    // 반환값은 job id, 0 이면 요청이 거절된 것
+    quint64 SetPixmapData(const QPixmap& pixmap);
+    quint64 SetPixmapData(QImage&& image);
+    quint64 SetPixmapData(RawImage image);
+    quint64 SetPixmapData(TiledImage image);
+    // pixmap 을 읽어 온 원본 파일 (PNG, JPEG). 같은 이미지면 PNG 를 다시 인코딩하지 않고 원본을 그대로 올린다
+    quint64 SetPixmapData(const QPixmap& pixmap, const QByteArray& sourceBytes);
+    // pixmap 없이 원본 파일만. DIB 등 픽셀 포맷은 붙여넣을 때 처음 decode 한다
+    quint64 SetEncodedData(const QByteArray& sourceBytes);
+    bool IsRunningSetPixmapData(quint64 jobId = 0) const;
+    quint64 CopyToClipboard(bool waitSetPixmapData = true);
+    bool IsRunningCopyToClipboard(quint64 jobId = 0) const;
+    // clipboard 의 이미지를 worker 에서 읽는다. 결과는 sig_image_read 로 받는다
+    quint64 ReadImageAsync();
+    bool IsRunningReadImage(quint64 jobId = 0) const;
+    // 이미지 처리에 쓰는 최대 스레드 수 (worker 스레드 포함, 0 이면 기본값)
+    void SetMaxThreadCount(int maxThreadCount);
+    int MaxThreadCount() const;
+    // 기본은 Win32 clipboard. 테스트에서는 MemoryClipboardBackend 로 바꿀 수 있다
+    void SetBackend(std::shared_ptr<ClipboardBackend> backend);
+    std::shared_ptr<ClipboardBackend> Backend() const;
+    // 다음 SetPixmapData 부터 적용
+    void SetPngPreset(PngEncoder::Preset preset);
+    PngEncoder::Preset PngPreset() const;
+    MemoryReport LastMemoryReport() const;
+    // 최근에 만든 clipboard 데이터를 보관할 최대 크기 (0 이면 cache 사용 안 함)
+    void SetCacheBudget(qint64 bytes);
+    qint64 CacheBudget() const;
+    LruCacheStats CacheStats() const;
+    // 반납된 픽셀/인코딩 버퍼를 다시 쓰기 위해 보관할 최대 크기
+    void SetBufferPoolLimit(qint64 bytes);
+    qint64 BufferPoolLimit() const;
+    // 보관 중인 버퍼를 keepBytes 만 남기고 해제 (메모리가 부족할 때 등)
+    void TrimBufferPool(qint64 keepBytes = 0);
+    BufferPoolStats BufferStats() const;
+    // 이미지 크기와 측정한 인코딩 시간으로 올릴 포맷을 고르는 기준
+    void SetFormatPolicy(const FormatPolicy::Options& options);
+    FormatPolicy::Options FormatPolicyOptions() const;
+    // 마지막 CopyToClipboard 에서 고른 포맷
+    FormatPolicy::Report LastFormatReport() const;
+    // 직전 이미지와 달라진 row band 만 다시 변환, 압축한다 (기본 켜짐).
+    // 직전 이미지를 비교용으로 들고 있으므로 RawImage 의 release 는 다음 이미지가 처리된 뒤에 호출된다
+    void SetIncrementalEncoding(bool enabled);
+    bool IsIncrementalEncoding() const;
+    // 복사한 이미지를 압축해서 보관하는 최근 목록의 최대 크기와 개수 (0 이면 보관하지 않음)
+    void SetHistoryBudget(qint64 bytes);
+    void SetHistoryMaxEntries(int maxEntries);
+    // 최근 것부터
+    std::vector<ClipboardHistory::EntryInfo> HistoryEntries() const;
+    ClipboardHistoryStats HistoryStats() const;
+    void ClearHistory();
+    // 보관한 이미지를 변환, 인코딩 없이 압축만 풀어 다시 올린다. 끝나면 반환한 job id 로 sig_clipboard_copied
+    quint64 RestoreFromHistory(quint64 entryId);
+    bool IsRunningRestoreFromHistory(quint64 jobId = 0) const;
+    // 단계별 실행 구간을 메모리에 남긴다 (기본 꺼짐). 꺼져 있으면 비용이 거의 없다
+    void SetTracing(bool enabled);
+    bool IsTracing() const;
+    // 지금까지 남은 구간을 Chrome trace JSON 으로 저장 (chrome://tracing, ui.perfetto.dev 에서 열기)
+    bool ExportTrace(const QString& path) const;
+    // 첫 복사 때 할 초기화(worker 스레드, clipboard 창, thread pool 스레드 등)를 미리 한다.
+    // 바로 돌아오며 worker 스레드에서 실행되므로 첫 창을 띄운 뒤 idle 시간에 호출하면 된다
+    void Warmup();
+    StartupReport GetStartupReport() const;
 
 signals:
-    void sig_clipboard_copied();
+    // pixmapJobId: 실제로 clipboard 에 들어간 SetPixmapData 의 job id
+    void sig_clipboard_copied(quint64 pixmapJobId);
+    void sig_pixmap_data_canceled(quint64 pixmapJobId);
+    // 이미지를 변환하거나 읽지 못한 경우. 이전 데이터는 이미 지웠으므로 CopyToClipboard 는 아무것도 올리지 않는다
+    void sig_pixmap_data_failed(quint64 pixmapJobId);
+    // 다른 프로그램이 clipboard 를 놓지 않는 등으로 올리지 못한 경우. 데이터는 남아 있으므로 CopyToClipboard 로 다시 시도할 수 있다.
+    // 재시도 횟수와 간격은 Backend()->SetRetryPolicy 로 정한다
+    void sig_clipboard_copy_failed(quint64 pixmapJobId, QString reason);
+    // 읽을 수 있는 이미지가 없거나 실패하면 image 는 null
+    void sig_image_read(quint64 readJobId, QImage image);
+    void sig_image_read_progress(quint64 readJobId, int rowsDone, int height);
 
 private:
-    void setPixmapDataImpl(const QPixmap& pixmap);
-    void copyToClipboardImpl(bool waitSetPixmapData);
-    Gdiplus::Bitmap* imageToBitmap(const QImage& image);
-    QByteArray pixmapToBytes(const QPixmap& pixmap);
-    HGLOBAL createDIBv5Header(Gdiplus::Bitmap* image);
-    HGLOBAL createPNGClipboardData(QByteArray bytes);
-    HBITMAP toHBITMAP(const QImage& image);
+    quint64 queueImage(QImage&& image, quint64 imageKey, const QByteArray& sourceBytes = QByteArray());
+    quint64 queueSetPixmapJob(Job job);
+    void run();
+    bool isQueued(JobType type, quint64 jobId) const;
+    void setPixmapDataImpl(const Job& job);
+    void copyToClipboardImpl(const Job& job);
+    void readImageImpl(const Job& job);
+    void restoreFromHistoryImpl(const Job& job);
+    void warmupImpl();
+    void startThread();
+    ClipboardFailure publishPixmapData(const PixmapData& data, const CancellationToken& token);
+    void addToHistory(const PixmapData& data);
+    PixelBuffer imageToPixelBuffer(const QImage& image);
+    PixelBuffer convertChangedRows(const QImage& image);
+    bool tiledImageToPixmapData(const TiledImage& image, PngEncoder::Preset preset, const CancellationToken& token, PixmapData* data);
+    ByteBuffer pixelBufferToPng(const PixelBuffer& pixels, PngEncoder::Preset preset, const CancellationToken& token, bool incremental = false);
+    PayloadKey payloadKey(quint64 imageKey, int width, int height, PixelConverter::Format format, const PixelBuffer& pixels,
+                          PngEncoder::Preset preset, bool encodePng) const;
+    PixmapData pixmapData() const;
+    void notifyCanceled(quint64 jobId);
+    void notifyPixmapDataFailed(quint64 jobId);
+    void notifyCopyFailed(quint64 jobId, ClipboardFailure failure);
 
 private:
-    std::future<void> copyToClipboardFuture_;
-    std::future<void> setPixmapFuture_;
+    std::chrono::steady_clock::time_point createdAt_;
+    std::thread thread_;
+    std::once_flag threadOnce_;
+    mutable std::mutex jobMutex_;
+    std::condition_variable jobCondition_;
+    std::deque<Job> jobs_;
+    Job runningJob_;
+    bool hasRunningJob_;
+    bool stop_;
+    std::atomic<quint64> nextJobId_;
+    std::unique_ptr<ThreadPool> threadPool_;
+    std::unique_ptr<BufferPool> bufferPool_;
+    std::atomic<PngEncoder::Preset> pngPreset_;
+    // 기본 backend 는 Backend() 를 처음 호출할 때 만든다
+    mutable std::shared_ptr<ClipboardBackend> backend_;
+    mutable bool backendCreated_;
+    mutable std::mutex backendMutex_;
     PixmapData pixmapData_;
+    PayloadCache payloadCache_;
+    ClipboardHistory history_;
+    MemoryReport memoryReport_;
+    FormatPolicy formatPolicy_;
+    FormatPolicy::Report formatReport_;
+    std::atomic<bool> incrementalEncoding_;
+    // worker 스레드에서만 사용
+    std::unique_ptr<IncrementalPngEncoder> incrementalPng_;
+    PreviousFrame previousFrame_;
+    mutable std::mutex pixmapDataMutex_;
+    mutable StartupReport startup_;     // Backend() 에서도 기록
+    mutable std::mutex startupMutex_;
 };
\ No newline at end of file
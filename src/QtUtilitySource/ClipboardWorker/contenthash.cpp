@@ -0,0 +1,111 @@
+#include "contenthash.h"
+#include "threadpool.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const int ROWS_PER_BAND = 64;
+
+    const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t rotl(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline uint64_t read64(const uint8_t* p)
+    {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t accumulate(uint64_t acc, uint64_t input)
+    {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    inline uint64_t avalanche(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    // xxHash64 와 같은 방식의 4 lane 누적. 한 band 의 row 들을 하나의 stream 으로 본다
+    uint64_t hashRows(const uint8_t* bits, size_t rowBytes, size_t stride, int begin, int end)
+    {
+        uint64_t lanes[4] = { PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1 };
+        uint64_t tail = PRIME5;
+
+        for (int y = begin; y < end; ++y)
+        {
+            const uint8_t* p = bits + static_cast<size_t>(y) * stride;
+            const uint8_t* rowEnd = p + rowBytes;
+
+            for (; p + 32 <= rowEnd; p += 32)
+            {
+                lanes[0] = accumulate(lanes[0], read64(p));
+                lanes[1] = accumulate(lanes[1], read64(p + 8));
+                lanes[2] = accumulate(lanes[2], read64(p + 16));
+                lanes[3] = accumulate(lanes[3], read64(p + 24));
+            }
+            for (; p + 8 <= rowEnd; p += 8)
+                tail = rotl(tail ^ accumulate(0, read64(p)), 27) * PRIME1 + PRIME4;
+            for (; p < rowEnd; ++p)
+                tail = rotl(tail ^ (*p * PRIME5), 11) * PRIME1;
+        }
+
+        uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+        h = ContentHash::Combine(h, tail);
+        return avalanche(h + static_cast<uint64_t>(end - begin) * rowBytes);
+    }
+}
+
+uint64_t ContentHash::Hash(const uint8_t* bits, size_t rowBytes, size_t stride, int height, ThreadPool* pool)
+{
+    if (bits == nullptr || height <= 0)
+        return 0;
+
+    // band 별 hash 를 순서대로 합치므로 스레드 수와 관계없이 결과가 같다
+    const int bandCount = (height + ROWS_PER_BAND - 1) / ROWS_PER_BAND;
+    std::vector<uint64_t> bandHashes(bandCount);
+
+    auto hashBands = [&](int begin, int end)
+    {
+        for (int band = begin; band < end; ++band)
+        {
+            int firstRow = band * ROWS_PER_BAND;
+            int lastRow = firstRow + ROWS_PER_BAND < height ? firstRow + ROWS_PER_BAND : height;
+            bandHashes[band] = hashRows(bits, rowBytes, stride, firstRow, lastRow);
+        }
+    };
+
+    if (pool)
+        pool->ParallelFor(0, bandCount, 4, hashBands);
+    else
+        hashBands(0, bandCount);
+
+    uint64_t h = PRIME5 + static_cast<uint64_t>(height) * rowBytes;
+    for (uint64_t bandHash : bandHashes)
+        h = Combine(h, bandHash);
+
+    return avalanche(h);
+}
+
+uint64_t ContentHash::Combine(uint64_t seed, uint64_t value)
+{
+    seed ^= accumulate(0, value);
+    return rotl(seed, 27) * PRIME1 + PRIME4;
+}
\ No newline at end of file
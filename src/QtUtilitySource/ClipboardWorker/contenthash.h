@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+namespace ContentHash
+{
+    // 픽셀 내용으로 만든 64bit hash. row 당 rowBytes 만 읽으므로 stride padding 은 결과에 영향이 없다
+    uint64_t Hash(const uint8_t* bits, size_t rowBytes, size_t stride, int height, ThreadPool* pool = nullptr);
+
+    uint64_t Combine(uint64_t seed, uint64_t value);
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "dibdecoder.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+    const uint32_t BI_RGB_COMPRESSION = 0;
+    const uint32_t BI_BITFIELDS_COMPRESSION = 3;
+    const size_t INFO_HEADER_SIZE = 40;     // BITMAPINFOHEADER
+    const size_t V4_HEADER_SIZE = 108;      // BITMAPV4HEADER 부터 mask 가 header 안에 있다
+    const int ROWS_PER_BAND = 64;
+
+    uint32_t readUint32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+            | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    uint16_t readUint16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    // 8bit 폭의 mask 만 지원. byte 단위 shift 를 돌려준다
+    bool maskShift(uint32_t mask, int* shift)
+    {
+        for (int s = 0; s <= 24; s += 8)
+        {
+            if (mask == (0xFFu << s))
+            {
+                *shift = s;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool isStandardMasks(const uint32_t masks[4])
+    {
+        return masks[0] == 0x00FF0000 && masks[1] == 0x0000FF00 && masks[2] == 0x000000FF
+            && (masks[3] == 0 || masks[3] == 0xFF000000);
+    }
+}
+
+bool DibDecoder::Parse(const uint8_t* data, size_t size, Info* info)
+{
+    if (data == nullptr || size < INFO_HEADER_SIZE)
+        return false;
+
+    const size_t headerSize = readUint32(data);
+    if (headerSize < INFO_HEADER_SIZE || headerSize > size)
+        return false;
+
+    const int32_t width = static_cast<int32_t>(readUint32(data + 4));
+    const int32_t height = static_cast<int32_t>(readUint32(data + 8));
+    const int bitCount = readUint16(data + 14);
+    const uint32_t compression = readUint32(data + 16);
+    const uint32_t colorsUsed = readUint32(data + 32);
+
+    if (width <= 0 || height == 0 || height == INT32_MIN || (bitCount != 24 && bitCount != 32))
+        return false;
+    if (compression != BI_RGB_COMPRESSION && !(compression == BI_BITFIELDS_COMPRESSION && bitCount == 32))
+        return false;
+
+    info->width = width;
+    info->height = height < 0 ? -height : height;
+    info->topDown = height < 0;
+    info->bitCount = bitCount;
+
+    size_t offset = headerSize;
+    if (compression == BI_BITFIELDS_COMPRESSION)
+    {
+        // BITMAPINFOHEADER 는 header 뒤에 mask 3 개가 온다
+        const uint8_t* masks = data + INFO_HEADER_SIZE;
+        if (headerSize < V4_HEADER_SIZE)
+        {
+            if (size < headerSize + 12)
+                return false;
+            masks = data + headerSize;
+            offset += 12;
+        }
+        info->masks[0] = readUint32(masks);
+        info->masks[1] = readUint32(masks + 4);
+        info->masks[2] = readUint32(masks + 8);
+        info->masks[3] = headerSize >= V4_HEADER_SIZE ? readUint32(masks + 12) : 0;
+
+        int shift;
+        for (int i = 0; i < 4; ++i)
+        {
+            if ((i < 3 || info->masks[i] != 0) && !maskShift(info->masks[i], &shift))
+                return false;
+        }
+    }
+    else
+    {
+        info->masks[0] = 0x00FF0000;
+        info->masks[1] = 0x0000FF00;
+        info->masks[2] = 0x000000FF;
+        // BI_RGB 32bpp 의 4번째 byte 는 프로그램마다 의미가 달라서 쓰지 않는다
+        info->masks[3] = 0;
+    }
+    info->hasAlpha = bitCount == 32 && info->masks[3] != 0;
+
+    // 24/32bpp 에도 color table 이 붙어 있을 수 있다
+    offset += static_cast<size_t>(colorsUsed) * 4;
+
+    info->srcStride = (static_cast<size_t>(width) * bitCount + 31) / 32 * 4;
+    info->pixelOffset = offset;
+
+    if (offset > size || info->srcStride * static_cast<size_t>(info->height) > size - offset)
+        return false;
+
+    return true;
+}
+
+bool DibDecoder::DecodeRows(const uint8_t* data, const Info& info, uint8_t* dest, int destStride, ThreadPool* pool,
+                            bool* hasAlpha)
+{
+    if (data == nullptr || dest == nullptr || destStride < info.width * 4)
+        return false;
+
+    if (hasAlpha)
+        *hasAlpha = info.hasAlpha;
+
+    const uint8_t* pixels = data + info.pixelOffset;
+    const bool standard = info.bitCount == 32 && isStandardMasks(info.masks);
+
+    int shifts[4] = { 16, 8, 0, 24 };
+    if (info.bitCount == 32 && !standard)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            if (info.masks[i] != 0)
+                maskShift(info.masks[i], &shifts[i]);
+        }
+    }
+
+    auto decode = [&](int begin, int end)
+    {
+        for (int y = begin; y < end; ++y)
+        {
+            // bottom-up 이면 마지막 row 가 이미지의 맨 위
+            int srcY = info.topDown ? y : info.height - 1 - y;
+            const uint8_t* src = pixels + static_cast<size_t>(srcY) * info.srcStride;
+            uint8_t* row = dest + static_cast<size_t>(y) * destStride;
+
+            if (standard)
+            {
+                std::memcpy(row, src, static_cast<size_t>(info.width) * 4);
+                if (!info.hasAlpha)
+                {
+                    for (int x = 0; x < info.width; ++x)
+                        row[x * 4 + 3] = 0xFF;
+                }
+            }
+            else if (info.bitCount == 32)
+            {
+                for (int x = 0; x < info.width; ++x)
+                {
+                    uint32_t pixel = readUint32(src + x * 4);
+                    row[x * 4 + 0] = static_cast<uint8_t>(pixel >> shifts[2]);
+                    row[x * 4 + 1] = static_cast<uint8_t>(pixel >> shifts[1]);
+                    row[x * 4 + 2] = static_cast<uint8_t>(pixel >> shifts[0]);
+                    row[x * 4 + 3] = info.hasAlpha ? static_cast<uint8_t>(pixel >> shifts[3]) : 0xFF;
+                }
+            }
+            else
+            {
+                for (int x = 0; x < info.width; ++x)
+                {
+                    row[x * 4 + 0] = src[x * 3 + 0];
+                    row[x * 4 + 1] = src[x * 3 + 1];
+                    row[x * 4 + 2] = src[x * 3 + 2];
+                    row[x * 4 + 3] = 0xFF;
+                }
+            }
+        }
+    };
+
+    auto run = [pool, &info](const std::function<void(int, int)>& fn)
+    {
+        if (pool)
+            pool->ParallelFor(0, info.height, ROWS_PER_BAND, fn);
+        else
+            fn(0, info.height);
+    };
+
+    run(decode);
+
+    // alpha mask 를 넣고도 alpha 를 모두 0 으로 두는 프로그램이 있다. 그러면 불투명으로 본다
+    if (info.hasAlpha)
+    {
+        std::atomic<bool> anyAlpha(false);
+        run([&](int begin, int end)
+        {
+            for (int y = begin; y < end && !anyAlpha; ++y)
+            {
+                const uint8_t* row = dest + static_cast<size_t>(y) * destStride;
+                for (int x = 0; x < info.width; ++x)
+                {
+                    if (row[x * 4 + 3] != 0)
+                    {
+                        anyAlpha = true;
+                        break;
+                    }
+                }
+            }
+        });
+
+        if (!anyAlpha)
+        {
+            if (hasAlpha)
+                *hasAlpha = false;
+
+            run([&](int begin, int end)
+            {
+                for (int y = begin; y < end; ++y)
+                {
+                    uint8_t* row = dest + static_cast<size_t>(y) * destStride;
+                    for (int x = 0; x < info.width; ++x)
+                        row[x * 4 + 3] = 0xFF;
+                }
+            });
+        }
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// clipboard 의 CF_DIB / CF_DIBV5 (BITMAPINFOHEADER 이후) 를 읽는다. windows.h 없이 동작
+namespace DibDecoder
+{
+    struct Info
+    {
+        int width;
+        int height;
+        bool topDown;
+        int bitCount;           // 24, 32 만 지원
+        bool hasAlpha;          // alpha mask 가 있는 32bpp
+        size_t pixelOffset;     // data 시작부터 첫 row 까지
+        size_t srcStride;
+        uint32_t masks[4];      // red, green, blue, alpha
+    };
+
+    // header 를 읽고 픽셀이 data 안에 모두 있는지 확인한다
+    bool Parse(const uint8_t* data, size_t size, Info* info);
+
+    // dest 에 위쪽 row 부터 BGRA 로 채운다 (hasAlpha 가 아니면 alpha 는 0xFF).
+    // hasAlpha 에는 결과에 alpha 가 남았는지 (alpha 가 모두 0 이라 불투명으로 바꿨으면 false)
+    bool DecodeRows(const uint8_t* data, const Info& info, uint8_t* dest, int destStride, ThreadPool* pool = nullptr,
+                    bool* hasAlpha = nullptr);
+}
\ No newline at end of file
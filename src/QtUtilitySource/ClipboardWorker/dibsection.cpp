@@ -0,0 +1,50 @@
+#include "dibsection.h"
+#include "pixelconverter.h"
+#include "threadpool.h"
+
+namespace
+{
+    const int ROWS_PER_BAND = 64;
+}
+
+HBITMAP DibSection::Create(const ImageView& image, ThreadPool* pool)
+{
+    if (image.bits == nullptr || image.width <= 0 || image.height <= 0)
+        return nullptr;
+
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = image.width;
+    info.bmiHeader.biHeight = -image.height;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    // DIB_RGB_COLORS 는 palette 를 쓰지 않으므로 DC 가 필요 없다
+    void* bits = nullptr;
+    HBITMAP hBitmap = CreateDIBSection(NULL, &info, DIB_RGB_COLORS, &bits, NULL, 0);
+    if (hBitmap == NULL || bits == nullptr)
+    {
+        if (hBitmap)
+            DeleteObject(hBitmap);
+        return nullptr;
+    }
+
+    // 32bpp 는 row 가 항상 DWORD 정렬이므로 stride 는 width * 4
+    uint8_t* destBits = static_cast<uint8_t*>(bits);
+    const int destStride = image.width * 4;
+    auto copyRows = [&](int begin, int end)
+    {
+        PixelConverter::ConvertRows(
+            image.ConstScanLine(begin), image.stride, image.format,
+            destBits + static_cast<size_t>(begin) * destStride, destStride, PixelConverter::Format::BGRA,
+            image.width, end - begin);
+    };
+
+    if (pool)
+        pool->ParallelFor(0, image.height, ROWS_PER_BAND, copyRows);
+    else
+        copyRows(0, image.height);
+
+    return hBitmap;
+}
\ No newline at end of file
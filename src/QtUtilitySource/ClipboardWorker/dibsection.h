@@ -0,0 +1,13 @@
+#pragma once
+
+#include "pixelbuffer.h"
+
+#include <windows.h>
+
+class ThreadPool;
+
+namespace DibSection
+{
+    // 32bpp top-down DIB section 을 만들고 픽셀을 한 번만 복사한다. 실패하면 nullptr
+    HBITMAP Create(const ImageView& image, ThreadPool* pool = nullptr);
+}
\ No newline at end of file
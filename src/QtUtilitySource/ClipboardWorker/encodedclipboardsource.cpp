@@ -0,0 +1,249 @@
+#include "encodedclipboardsource.h"
+#include "trace.h"
+
+#include <cstring>
+
+namespace
+{
+    const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+
+    uint32_t readUint32(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+            | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    uint16_t readUint16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    bool probePng(const uint8_t* data, size_t size, int* width, int* height)
+    {
+        // signature(8) + IHDR length(4) + type(4) + width(4) + height(4)
+        if (size < 24 || std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0 || std::memcmp(data + 12, "IHDR", 4) != 0)
+            return false;
+
+        *width = static_cast<int>(readUint32(data + 16));
+        *height = static_cast<int>(readUint32(data + 20));
+        return true;
+    }
+
+    bool probeJpeg(const uint8_t* data, size_t size, int* width, int* height)
+    {
+        if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+            return false;
+
+        // SOF marker 가 나올 때까지 segment 를 건너뛴다
+        size_t offset = 2;
+        while (offset + 4 <= size)
+        {
+            if (data[offset] != 0xFF)
+                return false;
+
+            uint8_t marker = data[offset + 1];
+            if (marker == 0xFF)
+            {
+                ++offset;   // fill byte
+                continue;
+            }
+            if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+            {
+                offset += 2;
+                continue;
+            }
+            if (marker == 0xD9 || marker == 0xDA)
+                return false;   // 크기 정보 없이 image data 에 도달
+
+            uint16_t length = readUint16(data + offset + 2);
+            if (length < 2)
+                return false;
+
+            // SOF0~SOF15 중 DHT(C4), JPG(C8), DAC(CC) 는 제외
+            bool isStartOfFrame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if (isStartOfFrame)
+            {
+                if (offset + 9 > size)
+                    return false;
+
+                *height = readUint16(data + offset + 5);
+                *width = readUint16(data + offset + 7);
+                return true;
+            }
+
+            offset += 2 + length;
+        }
+        return false;
+    }
+}
+
+// EncodedImage struct
+
+bool EncodedImage::IsNull() const
+{
+    return kind == Kind::Unknown || width <= 0 || height <= 0 || bytes.data == nullptr || bytes.size == 0;
+}
+
+EncodedImage EncodedImage::Probe(const PixmapClipboardSource::EncodedBytes& bytes)
+{
+    EncodedImage image;
+    image.kind = Kind::Unknown;
+    image.width = 0;
+    image.height = 0;
+    image.bytes = bytes;
+
+    if (bytes.data == nullptr)
+        return image;
+
+    if (probePng(bytes.data, bytes.size, &image.width, &image.height))
+        image.kind = Kind::Png;
+    else if (probeJpeg(bytes.data, bytes.size, &image.width, &image.height))
+        image.kind = Kind::Jpeg;
+
+    return image;
+}
+
+// EncodedClipboardSource
+
+EncodedClipboardSource::EncodedClipboardSource(const EncodedImage& image, const PixelBuffer& pixels, Decoder decode,
+                                               const PngEncoder::Options& pngOptions, ThreadPool* pool, BufferPool* buffers)
+    : image_(image)
+    , decode_(std::move(decode))
+    , pngOptions_(pngOptions)
+    , pool_(pool)
+    , buffers_(buffers)
+    , mutex_()
+    , pixels_(pixels)
+    , decodeTried_(!pixels.IsNull())
+    , png_(buffers)
+    , pngTried_(false)
+{}
+
+std::vector<ClipboardFormat> EncodedClipboardSource::Formats() const
+{
+    std::vector<ClipboardFormat> formats;
+    if (image_.IsNull())
+        return formats;
+
+    // PNG 를 먼저 찾는 프로그램이 많으므로 JPEG 여도 PNG 는 약속해 두고, 요청이 오면 그때 만든다
+    formats.push_back(ClipboardFormat::Png);
+    if (image_.kind == EncodedImage::Kind::Jpeg)
+        formats.push_back(ClipboardFormat::Jfif);
+    formats.push_back(ClipboardFormat::DibV5);
+    formats.push_back(ClipboardFormat::Bitmap);
+    return formats;
+}
+
+size_t EncodedClipboardSource::FormatSize(ClipboardFormat format) const
+{
+    switch (format)
+    {
+        case ClipboardFormat::Png:
+            if (image_.kind == EncodedImage::Kind::Png)
+                return image_.bytes.size;
+            return convertedPng().Size();
+        case ClipboardFormat::Jfif:
+            return image_.kind == EncodedImage::Kind::Jpeg ? image_.bytes.size : 0;
+        case ClipboardFormat::DibV5:
+            // 크기는 header 에서 알 수 있으므로 여기서는 decode 하지 않는다
+            return PixmapClipboardSource::DibV5Size(image_.width, image_.height);
+        default:
+            return 0;
+    }
+}
+
+bool EncodedClipboardSource::Render(ClipboardFormat format, uint8_t* dest, size_t size) const
+{
+    if (dest == nullptr || size == 0 || size < FormatSize(format))
+        return false;
+
+    switch (format)
+    {
+        case ClipboardFormat::Png:
+            if (image_.kind == EncodedImage::Kind::Png)
+            {
+                std::memcpy(dest, image_.bytes.data, image_.bytes.size);
+                return true;
+            }
+            if (convertedPng().IsEmpty())
+                return false;
+            std::memcpy(dest, convertedPng().ConstData(), convertedPng().Size());
+            return true;
+        case ClipboardFormat::Jfif:
+            if (image_.kind != EncodedImage::Kind::Jpeg)
+                return false;
+            std::memcpy(dest, image_.bytes.data, image_.bytes.size);
+            return true;
+        case ClipboardFormat::DibV5:
+        {
+            const PixelBuffer& decoded = pixels();
+            if (decoded.IsNull() || decoded.Width() != image_.width || decoded.Height() != image_.height)
+                return false;
+
+            PixmapClipboardSource dib(decoded, PixmapClipboardSource::EncodedBytes(), pool_);
+            return dib.Render(ClipboardFormat::DibV5, dest, size);
+        }
+        default:
+            return false;
+    }
+}
+
+ImageView EncodedClipboardSource::Pixels() const
+{
+    return pixels().View();
+}
+
+bool EncodedClipboardSource::IsDecoded() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return decodeTried_ && !pixels_.IsNull();
+}
+
+bool EncodedClipboardSource::IsPngEncoded() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !png_.IsEmpty();
+}
+
+const PixelBuffer& EncodedClipboardSource::pixels() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!decodeTried_)
+    {
+        decodeTried_ = true;
+        if (decode_)
+        {
+            Trace::Span span("decode", nullptr, image_.bytes.size);
+            pixels_ = decode_();
+        }
+    }
+    return pixels_;
+}
+
+const ByteBuffer& EncodedClipboardSource::convertedPng() const
+{
+    const PixelBuffer& decoded = pixels();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pngTried_)
+    {
+        pngTried_ = true;
+        if (!decoded.IsNull())
+        {
+            Trace::Span span("png encode", "from decoded");
+            PngEncoder encoder(pngOptions_, pool_, buffers_);
+            ByteBuffer png(buffers_);
+            bool encoded = encoder.Encode(decoded.View(), [&png](const uint8_t* data, size_t size)
+            {
+                return png.Append(data, size);
+            });
+            span.SetBytes(png.Size());
+            if (encoded)
+            {
+                png.ShrinkToFit();
+                png_ = png;
+            }
+        }
+    }
+    return png_;
+}
\ No newline at end of file
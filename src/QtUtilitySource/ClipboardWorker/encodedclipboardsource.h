@@ -0,0 +1,75 @@
+#pragma once
+
+#include "bufferpool.h"
+#include "clipboardbackend.h"
+#include "pixelbuffer.h"
+#include "pixmapclipboardsource.h"
+#include "pngencoder.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+class ThreadPool;
+
+// 파일에 들어 있던 그대로의 인코딩 결과
+struct EncodedImage
+{
+    enum class Kind
+    {
+        Unknown,
+        Png,
+        Jpeg,
+    };
+
+    Kind kind;
+    int width;
+    int height;
+    PixmapClipboardSource::EncodedBytes bytes;
+
+    bool IsNull() const;
+
+    // 앞부분 header 만 읽어 종류와 크기를 알아낸다. 알 수 없으면 kind 가 Unknown
+    static EncodedImage Probe(const PixmapClipboardSource::EncodedBytes& bytes);
+};
+
+// 원본 파일의 byte 를 다시 인코딩하지 않고 그대로 올린다 (PNG 는 PNG 로, JPEG 는 JFIF 로).
+// 픽셀 포맷(DIBV5, BITMAP, JPEG 의 PNG)은 누가 요청할 때 처음 decode 해서 만든다
+class EncodedClipboardSource : public ClipboardSource
+{
+public:
+    using Decoder = std::function<PixelBuffer()>;
+
+    // pixels 가 이미 있으면 decode 하지 않고 그대로 쓴다
+    EncodedClipboardSource(const EncodedImage& image, const PixelBuffer& pixels, Decoder decode,
+                           const PngEncoder::Options& pngOptions = PngEncoder::Options(),
+                           ThreadPool* pool = nullptr, BufferPool* buffers = nullptr);
+
+public:
+    std::vector<ClipboardFormat> Formats() const override;
+    size_t FormatSize(ClipboardFormat format) const override;
+    bool Render(ClipboardFormat format, uint8_t* dest, size_t size) const override;
+    ImageView Pixels() const override;
+
+    // 지금까지 decode / PNG 인코딩을 했는지 (benchmark, log 용)
+    bool IsDecoded() const;
+    bool IsPngEncoded() const;
+
+private:
+    const PixelBuffer& pixels() const;
+    const ByteBuffer& convertedPng() const;
+
+private:
+    EncodedImage image_;
+    Decoder decode_;
+    PngEncoder::Options pngOptions_;
+    ThreadPool* pool_;
+    BufferPool* buffers_;
+
+    // 처음 요청될 때 한 번만 만들고 이후에는 바뀌지 않는다
+    mutable std::mutex mutex_;
+    mutable PixelBuffer pixels_;
+    mutable bool decodeTried_;
+    mutable ByteBuffer png_;
+    mutable bool pngTried_;
+};
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include "flightrecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const size_t DEFAULT_MEMORY_LIMIT = 4 * 1024 * 1024; // 4MB
+    const size_t DEFAULT_RECORDS_PER_THREAD = 512;
+    const size_t DEFAULT_MAX_RECORD_BYTES = 240;
+
+    // slot 하나: [sequence][시각][level, 길이][thread id][text words...]. 모두 atomic 이라 읽는 쪽이 쓰는 중인 slot 을 봐도 data race 가 아니다.
+    // sequence 는 쓰는 중 홀수, 다 쓰면 2 * (번호 + 1)
+    const size_t SLOT_HEADER_WORDS = 4;
+
+    struct Ring
+    {
+        Ring(size_t slotCount, size_t textWords)
+            : slots(slotCount)
+            , textWords(textWords)
+            , slotWords(SLOT_HEADER_WORDS + textWords)
+            , storage(new std::atomic<uint64_t>[slotCount * (SLOT_HEADER_WORDS + textWords)])
+            , published(0)
+            , taken(0)
+            , owned(true)
+            , next(nullptr)
+        {
+            for (size_t i = 0; i < slots * slotWords; ++i)
+                storage[i].store(0, std::memory_order_relaxed);
+        }
+
+        const size_t slots;
+        const size_t textWords;
+        const size_t slotWords;
+        std::unique_ptr<std::atomic<uint64_t>[]> storage;
+        std::atomic<uint64_t> published;    // 다 쓴 record 수. 주인 스레드만 올린다
+        std::atomic<uint64_t> taken;        // Take 가 여기까지 꺼냈다
+        std::atomic<bool> owned;            // 스레드가 끝나면 false. 다른 스레드가 다시 쓴다. 남은 record 의 thread id 는 slot 에 있다
+        Ring* next;                         // 목록에 넣은 뒤에는 바꾸지 않는다
+    };
+
+    std::atomic<Ring*> rings(nullptr);      // 넣기만 하는 목록. ring 은 프로세스가 끝날 때까지 두고 다시 쓴다
+    std::atomic<size_t> memoryBytes(0);
+    std::atomic<size_t> ringCount(0);
+    std::atomic<uint64_t> truncated(0);
+    std::atomic<uint64_t> overwritten(0);
+    std::atomic<uint64_t> rejectedThreads(0);
+
+    std::mutex optionsMutex;
+    FlightRecorder::Options options;
+    std::mutex takeMutex;
+
+    uint32_t currentThreadId()
+    {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentThreadId());
+#elif defined(__linux__)
+        // std::thread::id 는 끝난 스레드의 것을 바로 다시 쓴다
+        return static_cast<uint32_t>(syscall(SYS_gettid));
+#else
+        return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+    }
+
+    size_t ringBytes(size_t slots, size_t textWords)
+    {
+        return sizeof(Ring) + slots * (SLOT_HEADER_WORDS + textWords) * sizeof(uint64_t);
+    }
+
+    // 끝난 스레드의 ring 을 먼저 찾고, 없으면 상한 안에서 새로 만든다
+    Ring* acquireRing()
+    {
+        FlightRecorder::Options current;
+        {
+            std::lock_guard<std::mutex> lock(optionsMutex);
+            current = options;
+        }
+        const size_t textWords = (std::max<size_t>(current.maxRecordBytes, 8) + 7) / 8;
+        const size_t slots = std::max<size_t>(current.recordsPerThread, 1);
+
+        for (Ring* ring = rings.load(std::memory_order_acquire); ring; ring = ring->next)
+        {
+            bool expected = false;
+            if (ring->owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+                return ring;
+        }
+
+        const size_t bytes = ringBytes(slots, textWords);
+        size_t used = memoryBytes.load(std::memory_order_relaxed);
+        do
+        {
+            if (used + bytes > current.memoryLimitBytes)
+            {
+                rejectedThreads.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        } while (!memoryBytes.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+
+        Ring* ring = new Ring(slots, textWords);
+        ring->next = rings.load(std::memory_order_relaxed);
+        while (!rings.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        ringCount.fetch_add(1, std::memory_order_relaxed);
+        return ring;
+    }
+
+    struct LocalRing
+    {
+        Ring* ring = nullptr;
+        uint32_t threadId = 0;
+        bool rejected = false;      // 상한에 걸린 스레드는 다시 시도하지 않는다
+
+        ~LocalRing()
+        {
+            // 남은 record 는 다음 Take 까지 그대로 둔다
+            if (ring)
+                ring->owned.store(false, std::memory_order_release);
+        }
+    };
+
+    void readRing(Ring& ring, std::vector<FlightRecorder::Entry>* records)
+    {
+        const uint64_t published = ring.published.load(std::memory_order_acquire);
+        uint64_t first = ring.taken.load(std::memory_order_relaxed);
+        if (published > ring.slots && first < published - ring.slots)
+        {
+            overwritten.fetch_add(published - ring.slots - first, std::memory_order_relaxed);
+            first = published - ring.slots;
+        }
+
+        std::string text;
+        for (uint64_t number = first; number < published; ++number)
+        {
+            const std::atomic<uint64_t>* slot = ring.storage.get() + (number % ring.slots) * ring.slotWords;
+            const uint64_t sequence = slot[0].load(std::memory_order_acquire);
+            if (sequence != 2 * (number + 1))
+                continue;
+
+            FlightRecorder::Entry record;
+            record.unixMilliseconds = static_cast<int64_t>(slot[1].load(std::memory_order_relaxed));
+            const uint64_t meta = slot[2].load(std::memory_order_relaxed);
+            record.level = static_cast<int>(meta >> 32);
+            record.threadId = static_cast<uint32_t>(slot[3].load(std::memory_order_relaxed));
+            const size_t size = std::min<size_t>(static_cast<size_t>(meta & 0xFFFFFFFF), ring.textWords * 8);
+
+            text.resize(ring.textWords * 8);
+            for (size_t word = 0; word * 8 < size; ++word)
+            {
+                const uint64_t value = slot[SLOT_HEADER_WORDS + word].load(std::memory_order_relaxed);
+                std::memcpy(&text[word * 8], &value, sizeof(value));
+            }
+
+            // 읽는 사이에 덮어썼으면 버린다
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot[0].load(std::memory_order_relaxed) != sequence)
+                continue;
+
+            record.text.assign(text.data(), size);
+            records->push_back(std::move(record));
+        }
+        ring.taken.store(published, std::memory_order_relaxed);
+    }
+}
+
+namespace FlightRecorder
+{
+    namespace Internal
+    {
+        std::atomic<bool> enabled(false);
+    }
+
+    // Options struct
+
+    Options::Options()
+        : memoryLimitBytes(DEFAULT_MEMORY_LIMIT)
+        , recordsPerThread(DEFAULT_RECORDS_PER_THREAD)
+        , maxRecordBytes(DEFAULT_MAX_RECORD_BYTES)
+    {}
+
+    void SetEnabled(bool enabled)
+    {
+        Internal::enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void SetOptions(const Options& newOptions)
+    {
+        std::lock_guard<std::mutex> lock(optionsMutex);
+        options = newOptions;
+    }
+
+    Options GetOptions()
+    {
+        std::lock_guard<std::mutex> lock(optionsMutex);
+        return options;
+    }
+
+    void Record(int level, const char* text, size_t size)
+    {
+        thread_local LocalRing local;
+        if (!local.ring)
+        {
+            if (local.rejected)
+                return;
+            local.ring = acquireRing();
+            local.threadId = currentThreadId();
+            local.rejected = local.ring == nullptr;
+            if (!local.ring)
+                return;
+        }
+
+        Ring& ring = *local.ring;
+        const uint64_t number = ring.published.load(std::memory_order_relaxed);
+        std::atomic<uint64_t>* slot = ring.storage.get() + (number % ring.slots) * ring.slotWords;
+
+        if (size > ring.textWords * 8)
+        {
+            // UTF-8 글자 중간에서 자르지 않는다
+            size = ring.textWords * 8;
+            while (size > 0 && (static_cast<unsigned char>(text[size]) & 0xC0) == 0x80)
+                --size;
+            truncated.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        slot[0].store(2 * number + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        slot[1].store(static_cast<uint64_t>(now), std::memory_order_relaxed);
+        slot[2].store((static_cast<uint64_t>(level) << 32) | size, std::memory_order_relaxed);
+        slot[3].store(local.threadId, std::memory_order_relaxed);
+        for (size_t word = 0; word * 8 < size; ++word)
+        {
+            uint64_t value = 0;
+            std::memcpy(&value, text + word * 8, std::min<size_t>(8, size - word * 8));
+            slot[SLOT_HEADER_WORDS + word].store(value, std::memory_order_relaxed);
+        }
+
+        slot[0].store(2 * (number + 1), std::memory_order_release);
+        ring.published.store(number + 1, std::memory_order_release);
+    }
+
+    std::vector<Entry> Take()
+    {
+        std::vector<Entry> records;
+        std::unique_lock<std::mutex> lock(takeMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return records;
+
+        for (Ring* ring = rings.load(std::memory_order_acquire); ring; ring = ring->next)
+            readRing(*ring, &records);
+
+        std::stable_sort(records.begin(), records.end(), [](const Entry& a, const Entry& b)
+        {
+            return a.unixMilliseconds < b.unixMilliseconds;
+        });
+        return records;
+    }
+
+    Stats GetStats()
+    {
+        Stats stats;
+        stats.recorded = 0;
+        for (Ring* ring = rings.load(std::memory_order_acquire); ring; ring = ring->next)
+            stats.recorded += ring->published.load(std::memory_order_relaxed);
+        stats.truncated = truncated.load(std::memory_order_relaxed);
+        stats.overwritten = overwritten.load(std::memory_order_relaxed);
+        stats.rejectedThreads = rejectedThreads.load(std::memory_order_relaxed);
+        stats.threads = ringCount.load(std::memory_order_relaxed);
+        stats.memoryBytes = memoryBytes.load(std::memory_order_relaxed);
+        return stats;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 파일에 남지 않는 (trace level 보다 높은) 로그를 스레드별 ring 에 마지막 N 개만 남겨 둔다.
+// 남기는 쪽은 lock 없이 자기 ring 에만 쓰고, Warning, Critical, crash 때 Take 로 꺼내 파일에 쓴다
+namespace FlightRecorder
+{
+    struct Options
+    {
+        Options();
+
+        size_t memoryLimitBytes;        // 모든 스레드 ring 을 합한 상한. 넘으면 새 스레드는 남기지 않는다
+        size_t recordsPerThread;
+        size_t maxRecordBytes;          // 넘는 부분은 자른다
+    };
+
+    struct Entry
+    {
+        int64_t unixMilliseconds;
+        uint32_t threadId;
+        int level;
+        std::string text;
+    };
+
+    struct Stats
+    {
+        uint64_t recorded;
+        uint64_t truncated;             // maxRecordBytes 를 넘어 자른 것
+        uint64_t overwritten;           // 꺼내기 전에 ring 이 돌아 덮어쓴 것
+        uint64_t rejectedThreads;       // 메모리 상한 때문에 ring 을 받지 못한 스레드
+        size_t threads;                 // 할당된 ring 수 (끝난 스레드의 ring 은 다시 쓴다)
+        size_t memoryBytes;
+    };
+
+    namespace Internal
+    {
+        extern std::atomic<bool> enabled;
+    }
+
+    inline bool IsEnabled()
+    {
+        return Internal::enabled.load(std::memory_order_relaxed);
+    }
+
+    void SetEnabled(bool enabled);
+    // 이미 할당된 ring 에는 적용되지 않는다. 켜기 전에 호출
+    void SetOptions(const Options& options);
+    Options GetOptions();
+
+    void Record(int level, const char* text, size_t size);
+
+    // 지난 Take 이후에 남은 record 를 시간 순으로 꺼낸다. crash 중에도 부를 수 있도록 lock 을 기다리지 않는다 (다른 Take 중이면 빈 목록)
+    std::vector<Entry> Take();
+
+    Stats GetStats();
+}
\ No newline at end of file
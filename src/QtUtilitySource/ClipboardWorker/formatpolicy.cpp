@@ -0,0 +1,280 @@
+#include "formatpolicy.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    const uint64_t DEFAULT_EAGER_MAX_BYTES = 1024 * 1024;          // 512 x 512
+    const uint64_t DEFAULT_PNG_MIN_PIXELS = 64 * 64;
+    const double DEFAULT_PNG_BUDGET_MILLISECONDS = 1000.0;
+    const uint64_t DEFAULT_DIB_MAX_PIXELS = 8192ULL * 8192;         // 256MB
+    const uint64_t DEFAULT_BITMAP_MAX_PIXELS = 4096ULL * 4096;      // 64MB
+
+    // 너무 작은 이미지는 고정 비용이 대부분이라 측정값에 넣지 않는다
+    const uint64_t MIN_MEASURED_PIXELS = 256 * 256;
+    // 최근 측정값의 비중
+    const double MEASURE_WEIGHT = 0.3;
+
+    uint64_t pixelCount(const FormatPolicy::Image& image)
+    {
+        if (image.width <= 0 || image.height <= 0)
+            return 0;
+
+        return static_cast<uint64_t>(image.width) * static_cast<uint64_t>(image.height);
+    }
+
+    bool contains(const std::vector<ClipboardFormat>& formats, ClipboardFormat format)
+    {
+        return std::find(formats.begin(), formats.end(), format) != formats.end();
+    }
+}
+
+// Options struct
+
+FormatPolicy::Options::Options()
+    : eagerMaxBytes(DEFAULT_EAGER_MAX_BYTES)
+    , pngMinPixels(DEFAULT_PNG_MIN_PIXELS)
+    , pngBudgetMilliseconds(DEFAULT_PNG_BUDGET_MILLISECONDS)
+    , dibMaxPixels(DEFAULT_DIB_MAX_PIXELS)
+    , bitmapMaxPixels(DEFAULT_BITMAP_MAX_PIXELS)
+{}
+
+// Report struct
+
+FormatPolicy::Report::Report()
+    : image()
+    , pngEncoded(false)
+    , pngMillisecondsPerMegapixel(0.0)
+    , choices()
+{}
+
+std::string FormatPolicy::Report::ToString() const
+{
+    char header[128];
+    std::snprintf(header, sizeof(header), "%dx%d %s, PNG %.1f ms/MP%s:", image.width, image.height,
+                  image.hasAlpha ? "alpha" : "opaque", pngMillisecondsPerMegapixel, pngEncoded ? " (encoded)" : "");
+
+    std::string text = header;
+    for (const Choice& choice : choices)
+    {
+        text += ' ';
+        text += ClipboardFormatName(choice.format);
+        text += '=';
+        text += DeliveryName(choice.delivery);
+        text += '(';
+        text += choice.reason;
+        text += ')';
+    }
+    return text;
+}
+
+// Public
+
+FormatPolicy::FormatPolicy(const Options& options)
+    : mutex_()
+    , options_(options)
+    , pngMillisecondsPerMegapixel_(0.0)
+{}
+
+void FormatPolicy::SetOptions(const Options& options)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+}
+
+FormatPolicy::Options FormatPolicy::GetOptions() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return options_;
+}
+
+bool FormatPolicy::ShouldEncodePng(const Image& image, const char** reason) const
+{
+    const char* unused;
+    if (reason == nullptr)
+        reason = &unused;
+
+    Options options = GetOptions();
+    const uint64_t pixels = pixelCount(image);
+
+    // DIBV5 의 alpha 는 프로그램마다 다르게 읽으므로 alpha 가 있으면 항상 PNG 를 같이 올린다
+    if (image.hasAlpha)
+    {
+        *reason = "alpha";
+        return true;
+    }
+
+    if (pixels < options.pngMinPixels)
+    {
+        *reason = "small opaque";
+        return false;
+    }
+
+    // 너무 커서 DIB 를 올리지 않을 이미지는 PNG 가 유일한 포맷이다
+    if (options.dibMaxPixels != 0 && pixels > options.dibMaxPixels)
+    {
+        *reason = "only format";
+        return true;
+    }
+
+    double perMegapixel = PngMillisecondsPerMegapixel();
+    if (options.pngBudgetMilliseconds > 0.0 && perMegapixel * pixels / 1000000.0 > options.pngBudgetMilliseconds)
+    {
+        *reason = "over budget";
+        return false;
+    }
+
+    *reason = perMegapixel > 0.0 ? "within budget" : "not measured";
+    return true;
+}
+
+FormatPolicy::Report FormatPolicy::Choose(const Image& image, const std::vector<ClipboardFormat>& available, bool pngEncoded) const
+{
+    Options options = GetOptions();
+    const uint64_t pixels = pixelCount(image);
+
+    Report report;
+    report.image = image;
+    report.pngEncoded = pngEncoded;
+    report.pngMillisecondsPerMegapixel = PngMillisecondsPerMegapixel();
+
+    // 크기는 압축 전 픽셀 기준. 인코딩된 포맷은 이보다 작다
+    const bool eager = options.eagerMaxBytes != 0 && pixels * 4 <= options.eagerMaxBytes;
+    const Delivery keep = eager ? Delivery::Eager : Delivery::Delayed;
+
+    const char* pngReason = "encoded";
+    bool hasPng = contains(available, ClipboardFormat::Png);
+    if (hasPng && !pngEncoded)
+        hasPng = ShouldEncodePng(image, &pngReason);
+
+    const bool hasDib = contains(available, ClipboardFormat::DibV5)
+        && !(hasPng && options.dibMaxPixels != 0 && pixels > options.dibMaxPixels);
+
+    // SetPixmapData 에서 PNG 를 만들지 않았으면 그 이유도 남긴다
+    if (!contains(available, ClipboardFormat::Png))
+    {
+        ShouldEncodePng(image, &pngReason);
+        report.choices.push_back({ ClipboardFormat::Png, Delivery::Skip, pngReason });
+    }
+
+    for (ClipboardFormat format : available)
+    {
+        Choice choice;
+        choice.format = format;
+        choice.delivery = keep;
+        choice.reason = eager ? "small" : "on request";
+
+        switch (format)
+        {
+            case ClipboardFormat::Png:
+                if (!hasPng)
+                    choice.delivery = Delivery::Skip;
+                if (!hasPng || !pngEncoded)
+                    choice.reason = pngReason;
+                break;
+            case ClipboardFormat::DibV5:
+                if (!hasDib)
+                {
+                    choice.delivery = Delivery::Skip;
+                    choice.reason = "too large, PNG only";
+                }
+                break;
+            case ClipboardFormat::Bitmap:
+                if (!hasDib)
+                {
+                    choice.delivery = Delivery::Skip;
+                    choice.reason = "too large, PNG only";
+                }
+                else if (options.bitmapMaxPixels != 0 && pixels > options.bitmapMaxPixels)
+                {
+                    choice.delivery = Delivery::Skip;
+                    choice.reason = "synthesized from CF_DIBV5";
+                }
+                break;
+            default:
+                break;
+        }
+
+        report.choices.push_back(choice);
+    }
+
+    return report;
+}
+
+void FormatPolicy::RecordPngEncode(uint64_t pixels, double milliseconds, bool partial)
+{
+    if (partial || pixels < MIN_MEASURED_PIXELS || milliseconds <= 0.0)
+        return;
+
+    double perMegapixel = milliseconds * 1000000.0 / pixels;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pngMillisecondsPerMegapixel_ <= 0.0)
+        pngMillisecondsPerMegapixel_ = perMegapixel;
+    else
+        pngMillisecondsPerMegapixel_ += (perMegapixel - pngMillisecondsPerMegapixel_) * MEASURE_WEIGHT;
+}
+
+double FormatPolicy::PngMillisecondsPerMegapixel() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pngMillisecondsPerMegapixel_;
+}
+
+const char* FormatPolicy::DeliveryName(Delivery delivery)
+{
+    switch (delivery)
+    {
+        case Delivery::Skip:
+            return "skip";
+        case Delivery::Delayed:
+            return "delayed";
+        case Delivery::Eager:
+            return "eager";
+    }
+    return "";
+}
+
+// PolicyClipboardSource
+
+PolicyClipboardSource::PolicyClipboardSource(std::shared_ptr<const ClipboardSource> source, const FormatPolicy::Report& report)
+    : source_(std::move(source))
+    , formats_()
+    , eagerFormats_()
+{
+    for (const FormatPolicy::Choice& choice : report.choices)
+    {
+        if (choice.delivery == FormatPolicy::Delivery::Skip)
+            continue;
+
+        formats_.push_back(choice.format);
+        if (choice.delivery == FormatPolicy::Delivery::Eager)
+            eagerFormats_.push_back(choice.format);
+    }
+}
+
+std::vector<ClipboardFormat> PolicyClipboardSource::Formats() const
+{
+    return formats_;
+}
+
+std::vector<ClipboardFormat> PolicyClipboardSource::EagerFormats() const
+{
+    return eagerFormats_;
+}
+
+size_t PolicyClipboardSource::FormatSize(ClipboardFormat format) const
+{
+    return contains(formats_, format) ? source_->FormatSize(format) : 0;
+}
+
+bool PolicyClipboardSource::Render(ClipboardFormat format, uint8_t* dest, size_t size) const
+{
+    return contains(formats_, format) && source_->Render(format, dest, size);
+}
+
+ImageView PolicyClipboardSource::Pixels() const
+{
+    return source_->Pixels();
+}
\ No newline at end of file
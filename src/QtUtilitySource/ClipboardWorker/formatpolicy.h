@@ -0,0 +1,102 @@
+#pragma once
+
+#include "clipboardbackend.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 이미지 크기, alpha 유무, 이 프로세스에서 측정한 인코딩 시간으로 clipboard 에 올릴 포맷과 렌더링 시점을 정한다
+class FormatPolicy
+{
+public:
+    enum class Delivery
+    {
+        Skip,       // 올리지 않는다
+        Delayed,    // 약속만 하고 요청이 올 때 렌더링
+        Eager,      // 올릴 때 바로 렌더링 (작은 이미지는 지연 렌더링 왕복이 더 비싸다)
+    };
+
+    struct Options
+    {
+        Options();
+
+        uint64_t eagerMaxBytes;         // 이 크기 이하의 포맷은 바로 렌더링 (0 이면 항상 지연)
+        uint64_t pngMinPixels;          // 이보다 작고 불투명하면 PNG 를 만들지 않는다
+        double pngBudgetMilliseconds;   // 불투명 이미지의 예상 PNG 인코딩 시간이 이보다 길면 PNG 를 만들지 않는다 (0 이면 제한 없음)
+        uint64_t dibMaxPixels;          // 이보다 크고 PNG 가 있으면 CF_DIBV5 를 올리지 않는다 (0 이면 제한 없음)
+        uint64_t bitmapMaxPixels;       // 이보다 크면 CF_BITMAP 을 올리지 않는다. OS 가 CF_DIBV5 에서 만들어 준다 (0 이면 제한 없음)
+    };
+
+    struct Image
+    {
+        int width;
+        int height;
+        bool hasAlpha;
+    };
+
+    struct Choice
+    {
+        ClipboardFormat format;
+        Delivery delivery;
+        const char* reason;
+    };
+
+    // 복사할 때마다 남기는 "formats chosen" 기록
+    struct Report
+    {
+        Report();
+
+        Image image;
+        bool pngEncoded;                        // SetPixmapData 에서 PNG 를 만들었는지
+        double pngMillisecondsPerMegapixel;     // 지금까지 측정한 값 (0 이면 아직 없음)
+        std::vector<Choice> choices;
+
+        std::string ToString() const;
+    };
+
+public:
+    explicit FormatPolicy(const Options& options = Options());
+
+public:
+    void SetOptions(const Options& options);
+    Options GetOptions() const;
+
+    // SetPixmapData 에서 PNG 를 미리 인코딩할지
+    bool ShouldEncodePng(const Image& image, const char** reason = nullptr) const;
+    // available 은 source 가 만들 수 있는 포맷
+    Report Choose(const Image& image, const std::vector<ClipboardFormat>& available, bool pngEncoded) const;
+
+    // 실제 인코딩 시간을 알려주면 이후 예상에 반영한다.
+    // 일부 band 만 다시 압축한 시간 (partial) 은 전체 비용이 아니므로 넣지 않는다
+    void RecordPngEncode(uint64_t pixels, double milliseconds, bool partial = false);
+    double PngMillisecondsPerMegapixel() const;
+
+    static const char* DeliveryName(Delivery delivery);
+
+private:
+    mutable std::mutex mutex_;
+    Options options_;
+    double pngMillisecondsPerMegapixel_;
+};
+
+// source 중 policy 가 고른 포맷만 보이게 한다
+class PolicyClipboardSource : public ClipboardSource
+{
+public:
+    PolicyClipboardSource(std::shared_ptr<const ClipboardSource> source, const FormatPolicy::Report& report);
+
+public:
+    std::vector<ClipboardFormat> Formats() const override;
+    std::vector<ClipboardFormat> EagerFormats() const override;
+    size_t FormatSize(ClipboardFormat format) const override;
+    bool Render(ClipboardFormat format, uint8_t* dest, size_t size) const override;
+    ImageView Pixels() const override;
+
+private:
+    std::shared_ptr<const ClipboardSource> source_;
+    std::vector<ClipboardFormat> formats_;
+    std::vector<ClipboardFormat> eagerFormats_;
+};
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "framediff.h"
+#include "threadpool.h"
+
+#include <cstring>
+
+namespace
+{
+    const int ROWS_PER_BAND = 64;
+}
+
+std::vector<RowRange> FrameDiff::ChangedRows(const uint8_t* previous, size_t previousStride,
+                                             const uint8_t* current, size_t currentStride,
+                                             size_t rowBytes, int height, ThreadPool* pool)
+{
+    std::vector<RowRange> ranges;
+    if (height <= 0 || current == nullptr)
+        return ranges;
+
+    if (previous == nullptr)
+    {
+        ranges.push_back({ 0, height });
+        return ranges;
+    }
+
+    // 같은 메모리면 (QImage 암시적 공유) 바뀐 것이 없다
+    if (previous == current && previousStride == currentStride)
+        return ranges;
+
+    std::vector<uint8_t> changed(static_cast<size_t>(height), 0);
+    auto compare = [&](int begin, int end)
+    {
+        for (int y = begin; y < end; ++y)
+        {
+            changed[y] = std::memcmp(previous + static_cast<size_t>(y) * previousStride,
+                                     current + static_cast<size_t>(y) * currentStride, rowBytes) != 0;
+        }
+    };
+
+    if (pool)
+        pool->ParallelFor(0, height, ROWS_PER_BAND, compare);
+    else
+        compare(0, height);
+
+    for (int y = 0; y < height; ++y)
+    {
+        if (!changed[y])
+            continue;
+
+        if (!ranges.empty() && ranges.back().end == y)
+            ranges.back().end = y + 1;
+        else
+            ranges.push_back({ y, y + 1 });
+    }
+    return ranges;
+}
+
+std::vector<RowRange> FrameDiff::ChangedRows(const ImageView& previous, const ImageView& current, ThreadPool* pool)
+{
+    if (previous.bits == nullptr || previous.width != current.width || previous.height != current.height
+        || previous.format != current.format)
+    {
+        std::vector<RowRange> ranges;
+        if (current.bits != nullptr && current.height > 0)
+            ranges.push_back({ 0, current.height });
+        return ranges;
+    }
+
+    return ChangedRows(previous.bits, static_cast<size_t>(previous.stride), current.bits, static_cast<size_t>(current.stride),
+                       static_cast<size_t>(current.width) * 4, current.height, pool);
+}
+
+int FrameDiff::RowCount(const std::vector<RowRange>& ranges)
+{
+    int count = 0;
+    for (const RowRange& range : ranges)
+        count += range.end - range.begin;
+    return count;
+}
\ No newline at end of file
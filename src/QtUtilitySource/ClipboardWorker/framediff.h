@@ -0,0 +1,29 @@
+#pragma once
+
+#include "pixelbuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// [begin, end) row 범위
+struct RowRange
+{
+    int begin;
+    int end;
+};
+
+// 같은 크기의 두 이미지를 row 단위로 비교해 달라진 row 범위를 찾는다
+namespace FrameDiff
+{
+    // row 당 rowBytes 만 비교한다. previous 가 null 이면 전체가 바뀐 것으로 본다
+    std::vector<RowRange> ChangedRows(const uint8_t* previous, size_t previousStride,
+                                      const uint8_t* current, size_t currentStride,
+                                      size_t rowBytes, int height, ThreadPool* pool = nullptr);
+    // 크기나 포맷이 다르면 전체 한 범위
+    std::vector<RowRange> ChangedRows(const ImageView& previous, const ImageView& current, ThreadPool* pool = nullptr);
+
+    int RowCount(const std::vector<RowRange>& ranges);
+}
\ No newline at end of file
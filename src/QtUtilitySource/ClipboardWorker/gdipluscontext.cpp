@@ -1,27 +1,31 @@
 #include "gdipluscontext.h"
 
-#pragma comment(lib, "gdiplus.lib")
+#include <chrono>
 
-namespace
-{
-    static GdiplusContext& initObj = GdiplusContext::instance();
-}
+#pragma comment(lib, "gdiplus.lib")
 
 using namespace Gdiplus;
 
 GdiplusContext::GdiplusContext()
+    : gdiplusToken_(0)
+    , status_(GenericError)
+    , startupMilliseconds_(0)
 {
+    auto start = std::chrono::steady_clock::now();
     GdiplusStartupInput gdiplusStartupInput;
-    GdiplusStartup(&gdiplusToken_, &gdiplusStartupInput, NULL);
+    status_ = GdiplusStartup(&gdiplusToken_, &gdiplusStartupInput, NULL);
+    startupMilliseconds_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 GdiplusContext::~GdiplusContext()
 {
-    GdiplusShutdown(gdiplusToken_);
+    if (status_ == Ok)
+        GdiplusShutdown(gdiplusToken_);
 }
 
 GdiplusContext& GdiplusContext::instance()
 {
+    // 처음 호출할 때 시작한다. 동시에 호출한 스레드는 시작이 끝날 때까지 기다린다
     static GdiplusContext inst;
     return inst;
 }
@@ -29,4 +33,14 @@ GdiplusContext& GdiplusContext::instance()
 ULONG_PTR GdiplusContext::Token() const
 {
     return gdiplusToken_;
+}
+
+bool GdiplusContext::IsStarted() const
+{
+    return status_ == Ok;
+}
+
+double GdiplusContext::StartupMilliseconds() const
+{
+    return startupMilliseconds_;
 }
\ No newline at end of file
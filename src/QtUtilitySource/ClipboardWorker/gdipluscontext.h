@@ -3,6 +3,7 @@
 #include <windows.h>
 #include <gdiplus.h>
 
+// GDI+ 는 쓰는 곳이 처음 instance() 를 호출할 때 시작한다 (static 초기화에서 시작하지 않음)
 class GdiplusContext
 {
 private:
@@ -15,7 +16,11 @@ public:
 
 public:
     ULONG_PTR Token() const;
+    bool IsStarted() const;
+    double StartupMilliseconds() const;
 
 private:
     ULONG_PTR gdiplusToken_;
+    Gdiplus::Status status_;
+    double startupMilliseconds_;
 };
\ No newline at end of file
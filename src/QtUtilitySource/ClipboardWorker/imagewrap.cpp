@@ -0,0 +1,56 @@
+#include "imagewrap.h"
+
+#include <memory>
+
+namespace ImageWrap
+{
+    bool ToPixelFormat(QImage::Format imageFormat, PixelConverter::Format* format)
+    {
+        switch (imageFormat)
+        {
+            case QImage::Format_ARGB32:
+                *format = PixelConverter::Format::BGRA;
+                return true;
+            case QImage::Format_ARGB32_Premultiplied:
+                *format = PixelConverter::Format::BGRAPremultiplied;
+                return true;
+            case QImage::Format_RGB32:
+                *format = PixelConverter::Format::BGRX;
+                return true;
+            case QImage::Format_RGBA8888:
+                *format = PixelConverter::Format::RGBA;
+                return true;
+            case QImage::Format_RGBA8888_Premultiplied:
+                *format = PixelConverter::Format::RGBAPremultiplied;
+                return true;
+            case QImage::Format_RGBX8888:
+                *format = PixelConverter::Format::RGBX;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    PixelBuffer Wrap(QImage&& image, QImage* unsupported)
+    {
+        PixelConverter::Format format;
+        if (image.isNull() || !ToPixelFormat(image.format(), &format))
+        {
+            if (unsupported)
+                *unsupported = std::move(image);
+            return PixelBuffer();
+        }
+
+        auto holder = std::make_shared<QImage>(std::move(image));
+
+        ImageView view;
+        view.bits = holder->constBits();
+        view.width = holder->width();
+        view.height = holder->height();
+        view.stride = holder->bytesPerLine();
+        view.format = format;
+
+        // holder 가 release 와 함께 사라지면서 QImage 참조를 놓는다
+        return PixelBuffer::Wrap(view, [holder]() {});
+    }
+}
\ No newline at end of file
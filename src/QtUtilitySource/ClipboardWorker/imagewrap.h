@@ -0,0 +1,16 @@
+#pragma once
+
+#include "pixelbuffer.h"
+
+#include <QImage>
+
+// QImage 의 메모리를 복사 없이 PixelBuffer 로 감싼다
+namespace ImageWrap
+{
+    // 변환 kernel 이 직접 읽을 수 있는 32bpp 포맷인지 확인
+    bool ToPixelFormat(QImage::Format imageFormat, PixelConverter::Format* format);
+
+    // 읽을 수 있는 포맷이면 image 를 가져가 감싼 것을 돌려준다 (QImage 참조는 PixelBuffer 가 사라질 때 놓는다).
+    // 아니면 null 을 돌려주고 image 는 건드리지 않은 채 unsupported 로 옮긴다
+    PixelBuffer Wrap(QImage&& image, QImage* unsupported = nullptr);
+}
\ No newline at end of file
@@ -1,49 +1,307 @@
 #include "log.h"
+#include "segmentlogsink.h"
 
 #include <QApplication>
 #include <QFile>
 #include <QSettings>
-#include <QThread>
 #include <QDateTime>
 #include <QDir>
-#include <QTextStream>
 
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <windows.h>
 
 namespace
 {
-    const quint64 MAX_LOG_FILE_SIZE = 1 * 1024 * 1024; // 1MB
+    const quint64 LOG_SEGMENT_BYTES = 1 * 1024 * 1024; // 1MB
+    const int FATAL_FLUSH_MILLISECONDS = 2000;
     QString appId_;
     QString appDataRootPath_;
+    std::unique_ptr<AsyncLogWriter> writer_;
+
+    // trace level 을 registry 나 ini 가 바뀌었을 때만 다시 읽는다. handler 는 캐시된 값만 본다
+    class TraceLevelWatcher
+    {
+    public:
+        TraceLevelWatcher(const QString& appId, const QString& iniPath)
+            : registryPath_(QString("HKEY_CURRENT_USER\\Software\\ESTsoft\\%0\\Trace").arg(appId))
+            , iniPath_(iniPath)
+            , iniModified_(-1)
+            , iniSize_(-1)
+            , key_(nullptr)
+            , stopEvent_(::CreateEventW(nullptr, TRUE, FALSE, nullptr))
+            , registryEvent_(::CreateEventW(nullptr, FALSE, FALSE, nullptr))
+            , directoryChange_(INVALID_HANDLE_VALUE)
+            , thread_()
+        {
+            QString subKey = QString("Software\\ESTsoft\\%0\\Trace").arg(appId);
+            if (::RegCreateKeyExW(HKEY_CURRENT_USER, reinterpret_cast<const wchar_t*>(subKey.utf16()), 0, nullptr, 0, KEY_READ | KEY_NOTIFY, nullptr, &key_, nullptr) != ERROR_SUCCESS)
+                key_ = nullptr;
+
+            // ini 가 있는 폴더(로그 폴더)의 쓰기를 본다. 로그 파일 쓰기로도 깨므로 ini 의 시간, 크기가 바뀌었을 때만 다시 읽는다
+            QString directory = QFileInfo(iniPath_).absolutePath();
+            QDir().mkpath(directory);
+            directoryChange_ = ::FindFirstChangeNotificationW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(directory).utf16()), FALSE,
+                FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+
+            iniChanged();
+            Reload();
+            thread_ = std::thread(&TraceLevelWatcher::run, this);
+        }
+
+        ~TraceLevelWatcher()
+        {
+            ::SetEvent(stopEvent_);
+            if (thread_.joinable())
+                thread_.join();
+
+            if (directoryChange_ != INVALID_HANDLE_VALUE)
+                ::FindCloseChangeNotification(directoryChange_);
+            if (key_)
+                ::RegCloseKey(key_);
+            ::CloseHandle(registryEvent_);
+            ::CloseHandle(stopEvent_);
+        }
+
+        void Reload()
+        {
+            int traceLevel = 0;
+            if (iniSize_ >= 0)
+                traceLevel = QSettings(iniPath_, QSettings::IniFormat).value("Log/trace").toInt();
+
+            if (traceLevel == 0)
+            {
+                QSettings setting(registryPath_, QSettings::NativeFormat);
+                traceLevel = setting.value("trace").toInt();
+                if (traceLevel == 0)
+                {
+                    traceLevel = Log::DEFAULT_TRACE_LEVEL; // default log
+                    setting.setValue("trace", traceLevel);
+                }
+            }
+
+#ifdef _DEBUG
+            traceLevel = static_cast<int>(Log::Level::Debug);
+#endif
+
+            const int previous = Log::TraceLevel();
+            Log::SetTraceLevel(traceLevel);
+            if (previous != traceLevel)
+                LOG_INFO << "trace level" << previous << "->" << traceLevel;
+        }
+
+    private:
+        void run()
+        {
+            HANDLE handles[3] = { stopEvent_, registryEvent_, directoryChange_ };
+            const DWORD count = directoryChange_ != INVALID_HANDLE_VALUE ? 3 : 2;
+
+            // 알림은 등록한 스레드가 살아 있는 동안만 오므로 이 스레드에서 등록한다
+            armRegistry();
+            while (true)
+            {
+                DWORD result = ::WaitForMultipleObjects(count, handles, FALSE, INFINITE);
+                if (result == WAIT_OBJECT_0 + 1)
+                {
+                    // 알림은 한 번만 오므로 읽기 전에 다시 등록한다
+                    armRegistry();
+                    Reload();
+                }
+                else if (result == WAIT_OBJECT_0 + 2)
+                {
+                    ::FindNextChangeNotification(directoryChange_);
+                    if (iniChanged())
+                        Reload();
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+
+        void armRegistry()
+        {
+            if (key_)
+                ::RegNotifyChangeKeyValue(key_, FALSE, REG_NOTIFY_CHANGE_LAST_SET, registryEvent_, TRUE);
+        }
+
+        bool iniChanged()
+        {
+            QFileInfo info(iniPath_);
+            const qint64 modified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+            const qint64 size = info.exists() ? info.size() : -1;
+            if (modified == iniModified_ && size == iniSize_)
+                return false;
+
+            iniModified_ = modified;
+            iniSize_ = size;
+            return true;
+        }
+
+    private:
+        QString registryPath_;
+        QString iniPath_;
+        qint64 iniModified_;
+        qint64 iniSize_;
+        HKEY key_;
+        HANDLE stopEvent_;
+        HANDLE registryEvent_;
+        HANDLE directoryChange_;
+        std::thread thread_;
+    };
+
+    std::unique_ptr<TraceLevelWatcher> traceLevelWatcher_;
+
+    Log::Level levelOf(QtMsgType type)
+    {
+        switch (type)
+        {
+            case QtDebugMsg:
+                return Log::Level::Debug;
+            case QtInfoMsg:
+                return Log::Level::Info;
+            case QtWarningMsg:
+                return Log::Level::Warning;
+            default:
+                return Log::Level::Critical;
+        }
+    }
+
+    QtMsgType typeOf(int level)
+    {
+        switch (level)
+        {
+            case static_cast<int>(Log::Level::Debug):
+                return QtDebugMsg;
+            case static_cast<int>(Log::Level::Info):
+                return QtInfoMsg;
+            case static_cast<int>(Log::Level::Warning):
+                return QtWarningMsg;
+            default:
+                return QtCriticalMsg;
+        }
+    }
+
+    // flight recorder 에 쌓인 것을 원래 시각으로 한 묶음으로 쓴다
+    void dumpFlightRecorder(const QString& reason)
+    {
+        if (!writer_)
+            return;
+
+        std::vector<FlightRecorder::Entry> records = FlightRecorder::Take();
+        if (records.empty())
+            return;
+
+        std::string dump = Log::FormatRecord(QtInfoMsg, QString("----- flight recorder: %0 records before %1 -----").arg(records.size()).arg(reason));
+        for (const FlightRecorder::Entry& record : records)
+            dump += Log::FormatRecord(typeOf(record.level), QString::fromUtf8(record.text.data(), static_cast<int>(record.text.size())), record.unixMilliseconds);
+        dump += Log::FormatRecord(QtInfoMsg, "----- flight recorder end -----");
+        writer_->Push(std::move(dump));
+    }
+
+    // [Log] generations 는 남겨 둘 지난 segment 수. 설치할 때 한 번 읽는다
+    SegmentLogSink::Options segmentOptions()
+    {
+        SegmentLogSink::Options options;
+        options.segmentBytes = LOG_SEGMENT_BYTES;
+        QVariant generations = QSettings(QString("%0/%1.ini").arg(appDataRootPath_).arg(appId_), QSettings::IniFormat).value("Log/generations");
+        if (generations.isValid())
+            options.generations = generations.toInt();
+        return options;
+    }
 
     // https://doc.qt.io/qt-5/qtglobal.html#qInstallMessageHandler
     void logOutputHandler(QtMsgType type, const QMessageLogContext& context, const QString& msg)
     {
         Q_UNUSED(context);
 
-        QString keyBase = QString("HKEY_CURRENT_USER\\Software\\ESTsoft\\%0\\Trace").arg(appId_);
-        QSettings setting(keyBase, QSettings::NativeFormat, QCoreApplication::instance());
-        int traceLevel = setting.value("trace").toInt();
-        if (traceLevel == 0)
+        // LOG_* 매크로를 거치지 않은 qDebug() 등은 trace level 로 걸러진다. Fatal 은 항상 남긴다.
+        // 이미 만들어진 문자열이므로 capture level 이면 시각, 문자열만 ring 에 둔다
+        const Log::Level level = levelOf(type);
+        if (type != QtFatalMsg && !Log::IsEnabled(level))
         {
-            traceLevel = 3; // default log
-            setting.setValue("trace", traceLevel);
+            if (Log::IsCaptured(level) && FlightRecorder::IsEnabled())
+            {
+                QByteArray text = msg.toUtf8();
+                FlightRecorder::Record(static_cast<int>(level), text.constData(), static_cast<size_t>(text.size()));
+            }
+            return;
         }
 
+        // Warning 이상이면 그 앞의 debug 로그를 먼저 쓴다
+        if (FlightRecorder::IsEnabled() && type != QtDebugMsg && type != QtInfoMsg)
+            dumpFlightRecorder(type == QtWarningMsg ? "Warning" : type == QtCriticalMsg ? "Critical" : "Fatal");
+
+        std::string record = Log::FormatRecord(type, msg);
+        fwrite(record.data(), 1, record.size(), stderr);
 #ifdef _DEBUG
-        traceLevel = 4;
+#ifdef Q_OS_WIN // https://forum.qt.io/topic/136623/qinstallmessagehandler-not-showing-anything-when-in-debug-mode/5
+        ::OutputDebugStringA(record.c_str());
+#endif
 #endif
 
-        if (traceLevel < 1 && type == QtCriticalMsg)
-            return;
-        if (traceLevel < 2 && type == QtWarningMsg)
-            return;
-        if (traceLevel < 3 && type == QtInfoMsg)
+        if (!writer_)
             return;
-        if (traceLevel < 4 && type == QtDebugMsg)
+
+        writer_->Push(std::move(record));
+
+        // 이 handler 가 돌아가면 Qt 가 abort 하므로 쌓인 로그를 먼저 쓴다
+        if (type == QtFatalMsg)
+        {
+            if (BinaryLog::IsOpen())
+                BinaryLog::Flush(FATAL_FLUSH_MILLISECONDS);
+            writer_->Flush(FATAL_FLUSH_MILLISECONDS);
+        }
+    }
+
+    LPTOP_LEVEL_EXCEPTION_FILTER previousExceptionFilter_ = nullptr;
+
+    // 처리되지 않은 예외로 죽기 직전. 할당이 실패할 수도 있는 상황이라 최선만 다한다
+    LONG WINAPI crashFilter(EXCEPTION_POINTERS* exception)
+    {
+        if (writer_)
+        {
+            dumpFlightRecorder("crash");
+            writer_->Push(Log::FormatRecord(QtCriticalMsg, QString("unhandled exception 0x%0 at 0x%1")
+                .arg(static_cast<quint32>(exception->ExceptionRecord->ExceptionCode), 8, 16, QChar('0'))
+                .arg(reinterpret_cast<quintptr>(exception->ExceptionRecord->ExceptionAddress), 0, 16)));
+            if (BinaryLog::IsOpen())
+                BinaryLog::Flush(FATAL_FLUSH_MILLISECONDS);
+            writer_->Flush(FATAL_FLUSH_MILLISECONDS);
+        }
+
+        return previousExceptionFilter_ ? previousExceptionFilter_(exception) : EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    // main 이 끝난 뒤(static 소멸 중)에 남는 로그는 stderr 로만 나간다
+    void shutdownLogging()
+    {
+        traceLevelWatcher_.reset();
+        BinaryLog::Close();
+
+        if (!writer_)
             return;
 
-        QString dt = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss.zzz");
+        writer_->Flush(FATAL_FLUSH_MILLISECONDS);
+        AsyncLogWriter::Stats stats = writer_->GetStats();
+        if (stats.dropped != 0 || stats.failed != 0)
+            fprintf(stderr, "[Log] dropped %llu, failed %llu\n", static_cast<unsigned long long>(stats.dropped), static_cast<unsigned long long>(stats.failed));
+
+        std::unique_ptr<AsyncLogWriter> writer = std::move(writer_);
+        writer.reset();
+    }
+}
+
+namespace Log
+{
+    std::string FormatRecord(QtMsgType type, const QString& msg, qint64 unixMilliseconds)
+    {
+        QDateTime time = unixMilliseconds < 0 ? QDateTime::currentDateTime() : QDateTime::fromMSecsSinceEpoch(unixMilliseconds);
+        QString dt = time.toString("yyyy-MM-dd hh:mm:ss.zzz");
         QString logText = QString("[%0][%1] ").arg(dt).arg(QCoreApplication::applicationPid());
         switch (type) {
             case QtDebugMsg:
@@ -64,48 +322,11 @@ namespace
                 break;
         }
 
-        fprintf(stderr, "%s\n", qUtf8Printable(logText));
-        fflush(stderr);
-
-#ifdef _DEBUG
-#ifdef Q_OS_WIN // https://forum.qt.io/topic/136623/qinstallmessagehandler-not-showing-anything-when-in-debug-mode/5
-        ::OutputDebugStringA(qUtf8Printable(logText + "\n"));
-#endif
-#endif
-
-        QString logFilePath = QString("%0/%1.log").arg(appDataRootPath_).arg(appId_);
-        if (QDir(QFileInfo(logFilePath).absolutePath()).exists() == false)
-            QDir().mkpath(QFileInfo(logFilePath).absolutePath());
-        qint64 fileSize = QFile(logFilePath).size();
-        if (fileSize > MAX_LOG_FILE_SIZE)
-        {
-            QFile::remove(logFilePath + ".old");
-            QFile(logFilePath).rename(logFilePath + ".old");
-        }
-
-        static int retryCount = 0;
-        do
-        {
-            QFile logFile(logFilePath);
-            if (logFile.open(QIODevice::WriteOnly | QIODevice::Append))
-            {
-                QTextStream textStream(&logFile);
-                textStream << logText << "\n";
-                break;
-            }
-            else
-            {
-                Q_ASSERT(false);
-                ::OutputDebugStringW(L"[Lemon] Log write failed.");
-                ++retryCount;
-                QThread::msleep(100);
-            }
-        } while (retryCount % 3 && retryCount < 30);
+        QByteArray record = logText.toUtf8();
+        record.append('\n');
+        return std::string(record.constData(), static_cast<size_t>(record.size()));
     }
-}
 
-namespace Log
-{
     void InstallLogHandler(const QString& appId, const QString& appDataRootPath)
     {
         static bool isInstalled = false;
@@ -118,9 +339,64 @@ namespace Log
             isInstalled = true;
             appId_ = appId;
             appDataRootPath_ = appDataRootPath;
+
+            QString logFilePath = QString("%0/%1.log").arg(appDataRootPath_).arg(appId_);
+            traceLevelWatcher_.reset(new TraceLevelWatcher(appId_, QString("%0/%1.ini").arg(appDataRootPath_).arg(appId_)));
+            writer_.reset(new AsyncLogWriter(std::unique_ptr<LogSink>(new SegmentLogSink(logFilePath.toUtf8().toStdString(), segmentOptions()))));
+            std::atexit(shutdownLogging);
             qInstallMessageHandler(logOutputHandler);
+            previousExceptionFilter_ = ::SetUnhandledExceptionFilter(crashFilter);
+            if (QSettings(QString("%0/%1.ini").arg(appDataRootPath_).arg(appId_), QSettings::IniFormat).value("Log/flightRecorder", true).toBool())
+                SetFlightRecorderEnabled(true);
 
             LOG_INFO << "INSTALLED LOG HANDLER";
         }
     }
+
+    bool Flush(int timeoutMilliseconds)
+    {
+        return writer_ ? writer_->Flush(timeoutMilliseconds) : true;
+    }
+
+    void SetOverflowPolicy(AsyncLogWriter::OverflowPolicy policy)
+    {
+        if (writer_)
+            writer_->SetOverflowPolicy(policy);
+    }
+
+    AsyncLogWriter::Stats WriterStats()
+    {
+        return writer_ ? writer_->GetStats() : AsyncLogWriter::Stats();
+    }
+
+    void SetFlightRecorderEnabled(bool enabled, const FlightRecorder::Options& options)
+    {
+        FlightRecorder::SetOptions(options);
+        FlightRecorder::SetEnabled(enabled);
+        Log::SetCaptureLevel(enabled ? static_cast<int>(Level::Debug) : 0);
+    }
+
+    void DumpFlightRecorder(const QString& reason)
+    {
+        dumpFlightRecorder(reason);
+    }
+
+    void SetBinaryLogEnabled(bool enabled)
+    {
+        if (!enabled)
+        {
+            BinaryLog::Close();
+            return;
+        }
+
+        if (appId_.isEmpty() || BinaryLog::IsOpen())
+            return;
+
+        QString binaryLogPath = QString("%0/%1.blog").arg(appDataRootPath_).arg(appId_);
+        SegmentLogSink::Options options = segmentOptions();
+        options.preamble = BinaryLog::Preamble;
+        options.completeLength = BinaryLog::CompleteLength;
+        BinaryLog::Open(std::unique_ptr<LogSink>(new SegmentLogSink(binaryLogPath.toUtf8().toStdString(), options)));
+        LOG_INFO << "binary log:" << binaryLogPath;
+    }
 }
\ No newline at end of file
@@ -1,14 +1,73 @@
 #pragma once
 
+#include "asynclogwriter.h"
+#include "binarylog.h"
+#include "flightrecorder.h"
+#include "loglevel.h"
+
 #include <QDebug>
 #include <QString>
 
-#define LOG_DEBUG       qDebug() << __FUNCTION__
-#define LOG_INFO        qInfo() << __FUNCTION__
-#define LOG_WARNING     qWarning() << __FUNCTION__
-#define LOG_CRITICAL  qCritical() << __FUNCTION__
+#include <string>
+
+// level 이 꺼져 있으면 stream 을 만들지도, 인자를 계산하지도 않는다. if/else 형태라 감싸는 if 의 else 와 섞이지 않는다.
+// trace level 만 본다: 꺼진 LOG_* 는 flight recorder 가 켜져 있어도 만들지 않는다
+#define LOG_AT(level, stream)   if (!Log::IsEnabled(level)) {} else stream() << __FUNCTION__
+
+#define LOG_DEBUG       LOG_AT(Log::Level::Debug, qDebug)
+#define LOG_INFO        LOG_AT(Log::Level::Info, qInfo)
+#define LOG_WARNING     LOG_AT(Log::Level::Warning, qWarning)
+#define LOG_CRITICAL    LOG_AT(Log::Level::Critical, qCritical)
+
+// 자주 불리는 곳용. format 의 {} 에 인자(정수, 실수, bool, const char*, std::string)를 넣는다.
+// trace level 로는 꺼졌지만 capture level 이면 QDebug 를 거치지 않고 문자열 하나만 만들어 flight recorder 에 넣는다.
+// binary 로그가 켜져 있으면 format 은 처음 한 번만 등록하고 인자 값만 남긴다 (LogDecoder 로 text 로 바꾼다).
+// 꺼져 있으면 같은 문자열을 만들어 text 로그로 보낸다
+#define LOG_FORMAT_AT(level, stream, format, ...) \
+    if (!Log::IsCaptured(level)) {} \
+    else if (!Log::IsEnabled(level)) { if (FlightRecorder::IsEnabled()) Log::Internal::Capture(level, __FUNCTION__, BinaryLog::FormatText(format, ##__VA_ARGS__)); } \
+    else if (BinaryLog::IsOpen()) { static const uint32_t logSite = BinaryLog::RegisterSite(static_cast<int>(level), __FUNCTION__, format); BinaryLog::Write(logSite, ##__VA_ARGS__); } \
+    else stream().noquote() << __FUNCTION__ << BinaryLog::FormatText(format, ##__VA_ARGS__).c_str()
+
+#define LOGF_DEBUG(format, ...)     LOG_FORMAT_AT(Log::Level::Debug, qDebug, format, ##__VA_ARGS__)
+#define LOGF_INFO(format, ...)      LOG_FORMAT_AT(Log::Level::Info, qInfo, format, ##__VA_ARGS__)
+#define LOGF_WARNING(format, ...)   LOG_FORMAT_AT(Log::Level::Warning, qWarning, format, ##__VA_ARGS__)
+#define LOGF_CRITICAL(format, ...)  LOG_FORMAT_AT(Log::Level::Critical, qCritical, format, ##__VA_ARGS__)
 
 namespace Log
 {
+    // 파일 쓰기는 별도 스레드에서 한다. Fatal 은 쓰일 때까지 기다린다.
+    // trace level 은 registry(HKCU\Software\ESTsoft\appId\Trace) 와 appDataRootPath/appId.ini 의 [Log] trace 가 바뀔 때만 다시 읽는다 (ini 가 우선)
+    // 파일은 appDataRootPath/appId.log. 1MB 가 차면 appId.<번호>.log.gz 로 압축해 두고 ini 의 [Log] generations 개(기본 5)만 남긴다
     void InstallLogHandler(const QString& appId, const QString& appDataRootPath);
+
+    // 지금까지 남긴 로그가 파일에 쓰일 때까지 기다린다 (crash handler, 종료 직전)
+    bool Flush(int timeoutMilliseconds = 2000);
+    void SetOverflowPolicy(AsyncLogWriter::OverflowPolicy policy);
+    AsyncLogWriter::Stats WriterStats();
+
+    // text 로그 한 줄 ([날짜 시각][pid] [Level] msg + 줄바꿈, UTF-8). 시각이 없으면 지금
+    std::string FormatRecord(QtMsgType type, const QString& msg, qint64 unixMilliseconds = -1);
+
+    // trace level 때문에 파일에 남지 않는 Debug 로그를 스레드별 ring 에 두었다가 Warning, Critical, Fatal, crash 때 그 앞에 쓴다.
+    // ring 에 가는 것은 LOGF_DEBUG 와 매크로를 거치지 않은 qDebug() 문자열뿐이다. 꺼진 LOG_DEBUG 는 켜져 있어도 level 만 보고 끝난다.
+    // InstallLogHandler 가 기본 설정으로 켠다 (ini 의 [Log] flightRecorder=false 면 끈다)
+    void SetFlightRecorderEnabled(bool enabled, const FlightRecorder::Options& options = FlightRecorder::Options());
+    // 직접 만든 crash handler 등에서
+    void DumpFlightRecorder(const QString& reason);
+
+    // LOGF_* 를 appDataRootPath/appId.blog 에 binary 로 남긴다. InstallLogHandler 뒤에 호출
+    void SetBinaryLogEnabled(bool enabled);
+
+    namespace Internal
+    {
+        // LOGF_* 중 capture level 이라 파일에는 남지 않는 것 ("함수 메시지")
+        inline void Capture(Level level, const char* function, const std::string& text)
+        {
+            std::string record(function);
+            record.push_back(' ');
+            record += text;
+            FlightRecorder::Record(static_cast<int>(level), record.data(), record.size());
+        }
+    }
 }
\ No newline at end of file
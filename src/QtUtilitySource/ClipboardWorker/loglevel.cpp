@@ -0,0 +1,54 @@
+#include "loglevel.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace
+{
+    std::atomic<int> captureLevel(0);
+    std::mutex updateMutex;         // 두 값을 동시에 바꿀 때 capturedLevel 이 어긋나지 않도록
+
+    void updateCapturedLevel()
+    {
+        Log::Internal::capturedLevel.store(std::max(Log::Internal::enabledLevel.load(std::memory_order_relaxed), captureLevel.load(std::memory_order_relaxed)),
+                                           std::memory_order_relaxed);
+    }
+}
+
+namespace Log
+{
+    namespace Internal
+    {
+#ifdef _DEBUG
+        std::atomic<int> enabledLevel(static_cast<int>(Level::Debug));
+        std::atomic<int> capturedLevel(static_cast<int>(Level::Debug));
+#else
+        std::atomic<int> enabledLevel(DEFAULT_TRACE_LEVEL);
+        std::atomic<int> capturedLevel(DEFAULT_TRACE_LEVEL);
+#endif
+    }
+
+    void SetTraceLevel(int level)
+    {
+        std::lock_guard<std::mutex> lock(updateMutex);
+        Internal::enabledLevel.store(level, std::memory_order_relaxed);
+        updateCapturedLevel();
+    }
+
+    int TraceLevel()
+    {
+        return Internal::enabledLevel.load(std::memory_order_relaxed);
+    }
+
+    void SetCaptureLevel(int level)
+    {
+        std::lock_guard<std::mutex> lock(updateMutex);
+        captureLevel.store(level, std::memory_order_relaxed);
+        updateCapturedLevel();
+    }
+
+    int CaptureLevel()
+    {
+        return captureLevel.load(std::memory_order_relaxed);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+
+// 컴파일할 때 남길 가장 높은 level. Release 에서 LOG_COMPILED_LEVEL=3 으로 정의하면 LOG_DEBUG 는 코드가 남지 않는다
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL 4
+#endif
+
+// LOG_* 매크로가 인자를 만들기 전에 확인하는 level. 값은 registry/설정 파일의 trace 값과 같다.
+// 확인은 atomic 하나만 읽는다 (registry 는 바뀌었을 때만 다시 읽는다)
+namespace Log
+{
+    enum class Level
+    {
+        Critical = 1,
+        Warning = 2,
+        Info = 3,
+        Debug = 4,
+    };
+
+    const int DEFAULT_TRACE_LEVEL = 3;
+
+    namespace Internal
+    {
+        // trace level. LOG_* 매크로는 이것만 본다 (QDebug stream 은 만드는 비용이 커서 capture level 로 켜지 않는다)
+        extern std::atomic<int> enabledLevel;
+        // max(trace level, capture level). LOGF_* 매크로가 본다
+        extern std::atomic<int> capturedLevel;
+    }
+
+    inline bool IsEnabled(Level level)
+    {
+        return static_cast<int>(level) <= LOG_COMPILED_LEVEL
+            && static_cast<int>(level) <= Internal::enabledLevel.load(std::memory_order_relaxed);
+    }
+
+    // 파일에는 남지 않아도 flight recorder 로 보낼 만큼 켜져 있는지
+    inline bool IsCaptured(Level level)
+    {
+        return static_cast<int>(level) <= LOG_COMPILED_LEVEL
+            && static_cast<int>(level) <= Internal::capturedLevel.load(std::memory_order_relaxed);
+    }
+
+    // 파일에 남기는 level
+    void SetTraceLevel(int level);
+    int TraceLevel();
+
+    // trace level 보다 높아도 LOGF_* 를 만들어서 flight recorder 로 보낼 level (0 이면 없음)
+    void SetCaptureLevel(int level);
+    int CaptureLevel();
+}
\ No newline at end of file
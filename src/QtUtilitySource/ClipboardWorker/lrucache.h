@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+struct LruCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entryCount;
+    size_t bytes;
+    size_t budgetBytes;
+};
+
+// 항목마다 크기(byte)를 받아 전체 합이 budget 을 넘지 않게 오래된 것부터 버리는 LRU cache.
+// 모든 함수는 thread-safe
+template<typename Key, typename Value, typename KeyHash = std::hash<Key>>
+class LruCache
+{
+public:
+    explicit LruCache(size_t budgetBytes)
+        : mutex_()
+        , entries_()
+        , index_()
+        , stats_()
+    {
+        stats_.budgetBytes = budgetBytes;
+    }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+public:
+    bool Find(const Key& key, Value* value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto found = index_.find(key);
+        if (found == index_.end())
+        {
+            ++stats_.misses;
+            return false;
+        }
+
+        ++stats_.hits;
+        entries_.splice(entries_.begin(), entries_, found->second);
+        if (value)
+            *value = found->second->value;
+        return true;
+    }
+
+    // budget 보다 큰 항목은 넣지 않는다
+    bool Insert(const Key& key, const Value& value, size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        eraseLocked(key);
+        if (bytes > stats_.budgetBytes)
+            return false;
+
+        Entry entry;
+        entry.key = key;
+        entry.value = value;
+        entry.bytes = bytes;
+        entries_.push_front(std::move(entry));
+        index_[key] = entries_.begin();
+        stats_.bytes += bytes;
+        stats_.entryCount = entries_.size();
+
+        evictLocked();
+        return true;
+    }
+
+    void SetBudget(size_t budgetBytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.budgetBytes = budgetBytes;
+        evictLocked();
+    }
+
+    size_t Budget() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_.budgetBytes;
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        index_.clear();
+        stats_.bytes = 0;
+        stats_.entryCount = 0;
+    }
+
+    LruCacheStats Stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Value value;
+        size_t bytes;
+    };
+
+    void eraseLocked(const Key& key)
+    {
+        auto found = index_.find(key);
+        if (found == index_.end())
+            return;
+
+        stats_.bytes -= found->second->bytes;
+        entries_.erase(found->second);
+        index_.erase(found);
+        stats_.entryCount = entries_.size();
+    }
+
+    void evictLocked()
+    {
+        while (stats_.bytes > stats_.budgetBytes && !entries_.empty())
+        {
+            const Entry& oldest = entries_.back();
+            stats_.bytes -= oldest.bytes;
+            index_.erase(oldest.key);
+            entries_.pop_back();
+            ++stats_.evictions;
+        }
+        stats_.entryCount = entries_.size();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;
+    std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> index_;
+    LruCacheStats stats_;
+};
\ No newline at end of file
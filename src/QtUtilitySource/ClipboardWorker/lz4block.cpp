@@ -0,0 +1,212 @@
+#include "lz4block.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const size_t MIN_MATCH = 4;
+    const size_t LAST_LITERALS = 5;     // 마지막 5 byte 는 항상 literal
+    const size_t MATCH_LIMIT = 12;      // 끝에서 12 byte 안쪽에서는 match 를 시작하지 않는다
+    const size_t MAX_OFFSET = 65535;
+    const int HASH_BITS = 14;           // table 64KB, L1/L2 에 들어가는 크기
+    const int SKIP_SHIFT = 6;           // match 가 계속 없으면 건너뛰는 간격을 늘린다
+
+    inline uint32_t read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t hash(uint32_t sequence)
+    {
+        return (sequence * 2654435761U) >> (32 - HASH_BITS);
+    }
+
+    // 15 이상의 길이는 255 단위로 이어 쓴다
+    inline uint8_t* writeLength(uint8_t* op, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            *op++ = 255;
+        *op++ = static_cast<uint8_t>(length);
+        return op;
+    }
+
+    inline bool readLength(const uint8_t*& ip, const uint8_t* end, size_t* length)
+    {
+        uint8_t byte;
+        do
+        {
+            if (ip >= end)
+                return false;
+            byte = *ip++;
+            *length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // literal 과 그 뒤의 match 하나 (matchLength 는 MIN_MATCH 를 뺀 값, 마지막 sequence 는 match 없음)
+    uint8_t* writeSequence(uint8_t* op, const uint8_t* opEnd, const uint8_t* literals, size_t literalLength,
+                           bool hasMatch, size_t offset, size_t matchLength)
+    {
+        const size_t worst = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+        if (static_cast<size_t>(opEnd - op) < worst)
+            return nullptr;
+
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+        if (literalLength >= 15)
+            op = writeLength(op, literalLength - 15);
+
+        if (literalLength != 0)
+            std::memcpy(op, literals, literalLength);
+        op += literalLength;
+
+        if (!hasMatch)
+            return op;
+
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+
+        *token |= static_cast<uint8_t>(matchLength < 15 ? matchLength : 15);
+        if (matchLength >= 15)
+            op = writeLength(op, matchLength - 15);
+
+        return op;
+    }
+}
+
+size_t Lz4Block::CompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t Lz4Block::Compress(const uint8_t* source, size_t size, uint8_t* dest, size_t capacity)
+{
+    if (dest == nullptr || (source == nullptr && size != 0))
+        return 0;
+
+    const uint8_t* ip = source;
+    const uint8_t* anchor = source;
+    const uint8_t* end = source + size;
+    uint8_t* op = dest;
+    uint8_t* opEnd = dest + capacity;
+
+    if (size > MATCH_LIMIT)
+    {
+        // 위치는 source 기준 offset. 0 으로 시작해도 실제 내용을 비교하므로 틀린 match 는 나오지 않는다
+        std::vector<uint32_t> table(static_cast<size_t>(1) << HASH_BITS, 0);
+        const uint8_t* matchStartLimit = end - MATCH_LIMIT;
+        const uint8_t* matchEndLimit = end - LAST_LITERALS;
+
+        ++ip;
+        while (ip < matchStartLimit)
+        {
+            const uint32_t sequence = read32(ip);
+            uint32_t& slot = table[hash(sequence)];
+            const uint8_t* match = source + slot;
+            slot = static_cast<uint32_t>(ip - source);
+
+            if (match >= ip || static_cast<size_t>(ip - match) > MAX_OFFSET || read32(match) != sequence)
+            {
+                ip += 1 + ((ip - anchor) >> SKIP_SHIFT);
+                continue;
+            }
+
+            // 앞쪽으로도 같은 byte 가 있으면 match 를 늘린다
+            while (ip > anchor && match > source && ip[-1] == match[-1])
+            {
+                --ip;
+                --match;
+            }
+
+            const uint8_t* matchEnd = ip + MIN_MATCH;
+            const uint8_t* reference = match + MIN_MATCH;
+            while (matchEnd < matchEndLimit && *matchEnd == *reference)
+            {
+                ++matchEnd;
+                ++reference;
+            }
+
+            op = writeSequence(op, opEnd, anchor, static_cast<size_t>(ip - anchor), true,
+                               static_cast<size_t>(ip - match), static_cast<size_t>(matchEnd - ip) - MIN_MATCH);
+            if (op == nullptr)
+                return 0;
+
+            ip = matchEnd;
+            anchor = ip;
+
+            // match 바로 앞 위치도 넣어 두면 반복되는 패턴에서 다음 match 를 더 잘 찾는다
+            if (ip < matchStartLimit)
+                table[hash(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - source);
+        }
+    }
+
+    op = writeSequence(op, opEnd, anchor, static_cast<size_t>(end - anchor), false, 0, 0);
+    if (op == nullptr)
+        return 0;
+
+    return static_cast<size_t>(op - dest);
+}
+
+bool Lz4Block::Decompress(const uint8_t* source, size_t size, uint8_t* dest, size_t destSize)
+{
+    if (source == nullptr || (dest == nullptr && destSize != 0))
+        return false;
+
+    const uint8_t* ip = source;
+    const uint8_t* end = source + size;
+    uint8_t* op = dest;
+    uint8_t* opEnd = dest + destSize;
+
+    while (ip < end)
+    {
+        const uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, end, &literalLength))
+            return false;
+
+        if (literalLength > static_cast<size_t>(end - ip) || literalLength > static_cast<size_t>(opEnd - op))
+            return false;
+
+        if (literalLength != 0)
+            std::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // 마지막 sequence 는 literal 만 있다
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            return false;
+
+        const size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dest))
+            return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(ip, end, &matchLength))
+            return false;
+        matchLength += MIN_MATCH;
+
+        if (matchLength > static_cast<size_t>(opEnd - op))
+            return false;
+
+        // 겹치는 match 는 offset 주기의 반복이므로 이미 쓴 만큼씩 늘려 가며 복사한다
+        const uint8_t* match = op - offset;
+        while (matchLength != 0)
+        {
+            const size_t chunk = std::min(matchLength, static_cast<size_t>(op - match));
+            std::memcpy(op, match, chunk);
+            op += chunk;
+            matchLength -= chunk;
+        }
+    }
+
+    return op == opEnd;
+}
\ No newline at end of file
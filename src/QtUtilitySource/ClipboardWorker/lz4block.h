@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block 포맷 (frame header 없음) 의 압축/해제. 압축률보다 속도가 중요한 곳에 쓴다.
+// 결과는 표준 LZ4 block 이므로 다른 LZ4 구현으로도 풀 수 있다
+namespace Lz4Block
+{
+    // size byte 를 압축했을 때 나올 수 있는 최대 크기
+    size_t CompressBound(size_t size);
+
+    // 압축한 크기를 돌려준다. dest 가 모자라면 0
+    size_t Compress(const uint8_t* source, size_t size, uint8_t* dest, size_t capacity);
+
+    // 풀린 크기가 정확히 destSize 여야 성공. 손상된 입력에서도 dest 밖을 쓰지 않는다
+    bool Decompress(const uint8_t* source, size_t size, uint8_t* dest, size_t destSize);
+}
\ No newline at end of file
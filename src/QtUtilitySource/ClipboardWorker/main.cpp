@@ -4,6 +4,7 @@
 #include <QApplication>
 #include <QFile>
 #include <QPixmap>
+#include <QTimer>
 
 #include <thread>
 
@@ -13,22 +14,56 @@ int main(int argc, char *argv[])
 
     Log::InstallLogHandler("TestApp", "C:\\Test");
 
-    // clipboard  Ϸ 
-    QObject::connect(&g_Clipboard, &ClipboardWorker::sig_clipboard_copied, [&a]()
+    // 단계별 소요 시간을 남겨 두었다가 끝날 때 clipboard_trace.json 으로 저장
+    g_Clipboard.SetTracing(true);
+
+    // clipboard 복사 완료 시
+    QObject::connect(&g_Clipboard, &ClipboardWorker::sig_clipboard_copied, [&a](quint64 pixmapJobId)
     {
-        LOG_INFO << "Copy to Clipboard Completed!";
+        LOG_INFO << "Copy to Clipboard Completed!" << pixmapJobId;
+
+        ClipboardWorker::StartupReport startup = g_Clipboard.GetStartupReport();
+        LOG_INFO << "Startup deferred:" << startup.constructMilliseconds << "+" << startup.threadMilliseconds
+                 << "+" << startup.backendMilliseconds << "ms, warmup:" << startup.warmupMilliseconds << "ms";
+
+        // 올린 이미지를 다시 읽어 본다
+        g_Clipboard.ReadImageAsync();
+    });
+
+    // 다른 프로그램이 clipboard 를 놓지 않아 올리지 못한 경우
+    QObject::connect(&g_Clipboard, &ClipboardWorker::sig_clipboard_copy_failed, [&a](quint64 pixmapJobId, QString reason)
+    {
+        LOG_WARNING << "Copy to Clipboard Failed!" << pixmapJobId << reason;
+        a.exit(1);
+    });
 
-        // 
+    // clipboard 이미지 읽기 완료 시
+    QObject::connect(&g_Clipboard, &ClipboardWorker::sig_image_read, [&a](quint64 readJobId, QImage image)
+    {
+        LOG_INFO << "Read from Clipboard Completed!" << readJobId << image.size();
+        g_Clipboard.ExportTrace("clipboard_trace.json");
+
+        // 종료
         a.exit(0);
     });
 
-    // test.jpg ҷ
-    QPixmap pixmap(".\\test.jpg");
+    // 첫 창을 띄운 뒤 idle 시간에 clipboard 창, thread pool 을 미리 준비한다
+    QTimer::singleShot(0, []()
+    {
+        g_Clipboard.Warmup();
+    });
+
+    // test.jpg 불러오기. 원본 byte 를 같이 넘기면 PNG 로 다시 인코딩하지 않고 JFIF 로 그대로 올린다
+    QFile file(".\\test.jpg");
+    QByteArray sourceBytes = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+
+    QPixmap pixmap;
+    pixmap.loadFromData(sourceBytes);
 
-    // ̸ pixmap ͸ 
-    g_Clipboard.SetPixmapData(pixmap);
+    // 미리 pixmap 데이터를 가공
+    g_Clipboard.SetPixmapData(pixmap, sourceBytes);
 
-    // ʿ  clipboard 
+    // 필요할 때마다 clipboard에 복사
     g_Clipboard.CopyToClipboard();
 
     return a.exec();
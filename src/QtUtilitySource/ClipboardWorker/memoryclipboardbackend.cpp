@@ -0,0 +1,170 @@
+#include "memoryclipboardbackend.h"
+#include "pixelconverter.h"
+
+#include <algorithm>
+#include <chrono>
+
+MemoryClipboardBackend::MemoryClipboardBackend()
+    : ClipboardBackend()
+    , mutex_()
+    , source_()
+    , formats_()
+    , cache_()
+    , heldUntil_()
+    , rejectedAttempts_(0)
+{}
+
+MemoryClipboardBackend::~MemoryClipboardBackend()
+{}
+
+std::vector<ClipboardFormat> MemoryClipboardBackend::AvailableFormats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return formats_;
+}
+
+void MemoryClipboardBackend::SetData(ClipboardFormat format, std::vector<uint8_t> data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (source_)
+    {
+        source_.reset();
+        formats_.clear();
+        cache_.clear();
+    }
+
+    if (std::find(formats_.begin(), formats_.end(), format) == formats_.end())
+        formats_.push_back(format);
+    cache_[format] = std::move(data);
+}
+
+bool MemoryClipboardBackend::Request(ClipboardFormat format, std::vector<uint8_t>* data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const std::vector<uint8_t>* rendered = renderLocked(format);
+    if (rendered == nullptr)
+        return false;
+
+    if (data)
+        *data = *rendered;
+    return true;
+}
+
+void MemoryClipboardBackend::RenderAll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (ClipboardFormat format : formats_)
+        renderLocked(format);
+
+    // OS clipboard 와 같이 모두 렌더링한 뒤에는 source 를 놓는다
+    source_.reset();
+}
+
+void MemoryClipboardBackend::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    source_.reset();
+    formats_.clear();
+    cache_.clear();
+}
+
+void MemoryClipboardBackend::Hold(double milliseconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    heldUntil_ = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(milliseconds));
+}
+
+void MemoryClipboardBackend::Release()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    heldUntil_ = std::chrono::steady_clock::time_point();
+}
+
+int MemoryClipboardBackend::RejectedAttempts() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rejectedAttempts_;
+}
+
+// Protected
+
+ClipboardBackend::Attempt MemoryClipboardBackend::tryPublish(const std::shared_ptr<const ClipboardSource>& source)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (isHeldLocked())
+        return Attempt::Busy;
+
+    cache_.clear();
+    source_ = source;
+    formats_ = source->Formats();
+
+    for (ClipboardFormat format : formats_)
+        recordPromised(format);
+
+    for (ClipboardFormat format : source->EagerFormats())
+        renderLocked(format);
+
+    return formats_.empty() ? Attempt::Failed : Attempt::Done;
+}
+
+ClipboardBackend::Attempt MemoryClipboardBackend::tryRead(ClipboardFormat format, const Reader& reader)
+{
+    // 실제 clipboard 와 같이 읽는 동안에는 다른 요청을 막는다
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (isHeldLocked())
+        return Attempt::Busy;
+
+    const std::vector<uint8_t>* rendered = renderLocked(format);
+    if (rendered == nullptr || rendered->empty())
+        return Attempt::Failed;
+
+    return reader(rendered->data(), rendered->size()) ? Attempt::Done : Attempt::Failed;
+}
+
+// Private
+
+bool MemoryClipboardBackend::isHeldLocked()
+{
+    if (std::chrono::steady_clock::now() >= heldUntil_)
+        return false;
+
+    ++rejectedAttempts_;
+    return true;
+}
+
+const std::vector<uint8_t>* MemoryClipboardBackend::renderLocked(ClipboardFormat format)
+{
+    auto cached = cache_.find(format);
+    if (cached != cache_.end())
+        return &cached->second;
+
+    if (!source_ || std::find(formats_.begin(), formats_.end(), format) == formats_.end())
+        return nullptr;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> data;
+    if (format == ClipboardFormat::Bitmap)
+    {
+        // DIB section 의 bits 와 같은 top-down BGRA
+        ImageView pixels = source_->Pixels();
+        data.resize(static_cast<size_t>(pixels.width) * pixels.height * 4);
+        PixelConverter::ConvertRows(
+            pixels.bits, pixels.stride, pixels.format,
+            data.data(), pixels.width * 4, PixelConverter::Format::BGRA,
+            pixels.width, pixels.height);
+    }
+    else
+    {
+        data.resize(source_->FormatSize(format));
+        if (!source_->Render(format, data.data(), data.size()))
+            return nullptr;
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    recordRendered(format, data.size(), milliseconds);
+
+    return &(cache_[format] = std::move(data));
+}
\ No newline at end of file
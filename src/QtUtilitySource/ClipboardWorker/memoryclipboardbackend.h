@@ -0,0 +1,51 @@
+#pragma once
+
+#include "clipboardbackend.h"
+
+#include <chrono>
+#include <map>
+
+// 프로세스 안에서만 동작하는 clipboard. 지연 렌더링 동작을 OS clipboard 없이 확인하거나 측정할 때 사용
+class MemoryClipboardBackend : public ClipboardBackend
+{
+public:
+    MemoryClipboardBackend();
+    ~MemoryClipboardBackend() override;
+
+public:
+    std::vector<ClipboardFormat> AvailableFormats() const override;
+
+    // 다른 프로그램이 복사한 것처럼 이미 렌더링된 데이터를 올린다. 앞서 Publish 한 source 는 지운다
+    void SetData(ClipboardFormat format, std::vector<uint8_t> data);
+
+    // 붙여넣기 요청. 처음 요청된 포맷만 렌더링하고 이후에는 cache 를 돌려준다
+    bool Request(ClipboardFormat format, std::vector<uint8_t>* data);
+
+    // 소유자가 사라질 때(WM_RENDERALLFORMATS) 처럼 남은 포맷을 모두 렌더링
+    void RenderAll();
+
+    // 다른 프로그램이 clipboard 를 가져간 경우
+    void Clear();
+
+    // 다른 프로그램이 clipboard 를 열고 있는 것처럼 milliseconds 동안 Publish, Read 가 Busy 로 실패한다
+    void Hold(double milliseconds);
+    void Release();
+    // 열려 있는 동안 거절한 시도 수
+    int RejectedAttempts() const;
+
+protected:
+    Attempt tryPublish(const std::shared_ptr<const ClipboardSource>& source) override;
+    Attempt tryRead(ClipboardFormat format, const Reader& reader) override;
+
+private:
+    bool isHeldLocked();
+    const std::vector<uint8_t>* renderLocked(ClipboardFormat format);
+
+private:
+    mutable std::mutex mutex_;
+    std::shared_ptr<const ClipboardSource> source_;
+    std::vector<ClipboardFormat> formats_;
+    std::map<ClipboardFormat, std::vector<uint8_t>> cache_;
+    std::chrono::steady_clock::time_point heldUntil_;
+    int rejectedAttempts_;
+};
\ No newline at end of file
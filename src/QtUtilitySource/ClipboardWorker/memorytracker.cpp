@@ -0,0 +1,114 @@
+#include "memorytracker.h"
+
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+#elif defined(__linux__)
+#include <cstdio>
+#endif
+
+namespace
+{
+    std::atomic<size_t> currentBytes_(0);
+    std::atomic<size_t> peakBytes_(0);
+
+    void updatePeak(size_t current)
+    {
+        size_t peak = peakBytes_.load(std::memory_order_relaxed);
+        while (current > peak && !peakBytes_.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+namespace MemoryTracker
+{
+    void Allocated(size_t bytes)
+    {
+        size_t current = currentBytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        updatePeak(current);
+    }
+
+    void Released(size_t bytes)
+    {
+        currentBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    size_t CurrentBytes()
+    {
+        return currentBytes_.load(std::memory_order_relaxed);
+    }
+
+    size_t PeakBytes()
+    {
+        return peakBytes_.load(std::memory_order_relaxed);
+    }
+
+    void ResetPeak()
+    {
+        peakBytes_.store(currentBytes_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    ProcessMemory QueryProcessMemory()
+    {
+        ProcessMemory memory = {};
+
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS_EX counters = {};
+        counters.cb = sizeof(counters);
+        if (GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&counters), sizeof(counters)))
+        {
+            memory.workingSetBytes = counters.WorkingSetSize;
+            memory.peakWorkingSetBytes = counters.PeakWorkingSetSize;
+            memory.privateBytes = counters.PrivateUsage;
+        }
+#elif defined(__linux__)
+        // 단위는 kB
+        if (FILE* status = std::fopen("/proc/self/status", "r"))
+        {
+            char line[128];
+            unsigned long long kilobytes = 0;
+            while (std::fgets(line, sizeof(line), status))
+            {
+                if (std::sscanf(line, "VmRSS: %llu", &kilobytes) == 1)
+                    memory.workingSetBytes = kilobytes * 1024;
+                else if (std::sscanf(line, "VmHWM: %llu", &kilobytes) == 1)
+                    memory.peakWorkingSetBytes = kilobytes * 1024;
+                else if (std::sscanf(line, "RssAnon: %llu", &kilobytes) == 1)
+                    memory.privateBytes = kilobytes * 1024;
+            }
+            std::fclose(status);
+        }
+#endif
+
+        return memory;
+    }
+
+    // ScopedAllocation
+
+    ScopedAllocation::ScopedAllocation(size_t bytes)
+        : bytes_(0)
+    {
+        Reset(bytes);
+    }
+
+    ScopedAllocation::~ScopedAllocation()
+    {
+        Reset();
+    }
+
+    void ScopedAllocation::Reset(size_t bytes)
+    {
+        if (bytes_)
+            Released(bytes_);
+
+        bytes_ = bytes;
+
+        if (bytes_)
+            Allocated(bytes_);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MemoryTracker
+{
+    struct ProcessMemory
+    {
+        uint64_t workingSetBytes;
+        uint64_t peakWorkingSetBytes;
+        uint64_t privateBytes;
+    };
+
+    void Allocated(size_t bytes);
+    void Released(size_t bytes);
+
+    size_t CurrentBytes();
+    size_t PeakBytes();
+    void ResetPeak();
+
+    ProcessMemory QueryProcessMemory();
+
+    // 추적 대상이 아닌 메모리(QImage 등)를 scope 동안 집계
+    class ScopedAllocation
+    {
+    public:
+        explicit ScopedAllocation(size_t bytes = 0);
+        ~ScopedAllocation();
+
+        ScopedAllocation(const ScopedAllocation&) = delete;
+        ScopedAllocation& operator=(const ScopedAllocation&) = delete;
+
+        void Reset(size_t bytes = 0);
+
+    private:
+        size_t bytes_;
+    };
+}
\ No newline at end of file
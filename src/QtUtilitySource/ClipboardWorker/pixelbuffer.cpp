@@ -0,0 +1,137 @@
+#include "pixelbuffer.h"
+#include "bufferpool.h"
+
+#include <utility>
+
+namespace
+{
+    class ReleaseDeleter
+    {
+    public:
+        explicit ReleaseDeleter(std::function<void()> release)
+            : release_(std::move(release))
+        {}
+
+        void operator()(uint8_t*) const
+        {
+            if (release_)
+                release_();
+        }
+
+    private:
+        std::function<void()> release_;
+    };
+}
+
+PixelBuffer::PixelBuffer()
+    : data_()
+    , width_(0)
+    , height_(0)
+    , stride_(0)
+    , format_(PixelConverter::Format::BGRA)
+{}
+
+PixelBuffer PixelBuffer::Allocate(int width, int height, PixelConverter::Format format, BufferPool* pool)
+{
+    PixelBuffer buffer;
+    if (width <= 0 || height <= 0)
+        return buffer;
+
+    // DIB 와 같은 배치로 쓰기 위해 row 사이 padding 없이 할당
+    size_t stride = static_cast<size_t>(width) * 4;
+    size_t bytes = stride * static_cast<size_t>(height);
+
+    buffer.data_ = BufferPool::Allocate(pool, bytes);
+    if (buffer.data_ == nullptr)
+        return buffer;
+
+    buffer.width_ = width;
+    buffer.height_ = height;
+    buffer.stride_ = static_cast<int>(stride);
+    buffer.format_ = format;
+    return buffer;
+}
+
+PixelBuffer PixelBuffer::Wrap(const ImageView& view, std::function<void()> release)
+{
+    PixelBuffer buffer;
+    if (view.bits == nullptr || view.width <= 0 || view.height <= 0 || view.stride < view.width * 4)
+    {
+        if (release)
+            release();
+        return buffer;
+    }
+
+    buffer.data_ = std::shared_ptr<uint8_t>(const_cast<uint8_t*>(view.bits), ReleaseDeleter(std::move(release)));
+    buffer.width_ = view.width;
+    buffer.height_ = view.height;
+    buffer.stride_ = view.stride;
+    buffer.format_ = view.format;
+    return buffer;
+}
+
+bool PixelBuffer::IsNull() const
+{
+    return data_ == nullptr;
+}
+
+int PixelBuffer::Width() const
+{
+    return width_;
+}
+
+int PixelBuffer::Height() const
+{
+    return height_;
+}
+
+int PixelBuffer::Stride() const
+{
+    return stride_;
+}
+
+PixelConverter::Format PixelBuffer::Format() const
+{
+    return format_;
+}
+
+size_t PixelBuffer::ByteCount() const
+{
+    return static_cast<size_t>(stride_) * static_cast<size_t>(height_);
+}
+
+long PixelBuffer::UseCount() const
+{
+    return data_.use_count();
+}
+
+const uint8_t* PixelBuffer::ConstBits() const
+{
+    return data_.get();
+}
+
+const uint8_t* PixelBuffer::ConstScanLine(int y) const
+{
+    return data_.get() + static_cast<ptrdiff_t>(y) * stride_;
+}
+
+uint8_t* PixelBuffer::Bits()
+{
+    return data_.get();
+}
+
+uint8_t* PixelBuffer::ScanLine(int y)
+{
+    return data_.get() + static_cast<ptrdiff_t>(y) * stride_;
+}
+
+ImageView PixelBuffer::View() const
+{
+    ImageView view;
+    view.bits = data_.get();
+    view.width = width_;
+    view.height = height_;
+    view.stride = stride_;
+    view.format = format_;
+    return view;
+}
\ No newline at end of file
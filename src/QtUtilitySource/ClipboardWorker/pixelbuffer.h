@@ -0,0 +1,60 @@
+#pragma once
+
+#include "pixelconverter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class BufferPool;
+
+// 다른 곳이 소유한 32bpp 픽셀을 가리키는 view
+struct ImageView
+{
+    const uint8_t* bits;
+    int width;
+    int height;
+    int stride;
+    PixelConverter::Format format;
+
+    const uint8_t* ConstScanLine(int y) const
+    {
+        return bits + static_cast<ptrdiff_t>(y) * stride;
+    }
+};
+
+// 이미지 한 장의 32bpp 픽셀 버퍼. 복사하면 데이터를 공유한다 (ref-counted)
+class PixelBuffer
+{
+public:
+    PixelBuffer();
+
+    // pool 이 있으면 반납된 버퍼를 다시 쓴다
+    static PixelBuffer Allocate(int width, int height, PixelConverter::Format format, BufferPool* pool = nullptr);
+    // 다른 곳이 소유한 메모리를 복사 없이 감싼다 (읽기 전용).
+    // release 는 마지막 참조가 사라질 때 그 스레드에서 한 번 호출된다
+    static PixelBuffer Wrap(const ImageView& view, std::function<void()> release);
+
+public:
+    bool IsNull() const;
+    int Width() const;
+    int Height() const;
+    int Stride() const;
+    PixelConverter::Format Format() const;
+    size_t ByteCount() const;
+    long UseCount() const;
+
+    const uint8_t* ConstBits() const;
+    const uint8_t* ConstScanLine(int y) const;
+    uint8_t* Bits();
+    uint8_t* ScanLine(int y);
+    ImageView View() const;
+
+private:
+    std::shared_ptr<uint8_t> data_;
+    int width_;
+    int height_;
+    int stride_;
+    PixelConverter::Format format_;
+};
\ No newline at end of file
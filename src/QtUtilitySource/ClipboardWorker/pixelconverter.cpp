@@ -0,0 +1,538 @@
+#include "pixelconverter.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PIXELCONVERTER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(PIXELCONVERTER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PIXELCONVERTER_TARGET_SSE2 __attribute__((target("sse2")))
+#define PIXELCONVERTER_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PIXELCONVERTER_TARGET_SSE2
+#define PIXELCONVERTER_TARGET_AVX2
+#endif
+
+namespace
+{
+    using RowKernel = void (*)(const uint8_t*, uint8_t*, int);
+
+    struct Kernels
+    {
+        RowKernel swizzle;
+        RowKernel premultiply;
+        RowKernel unpremultiply;
+        RowKernel fillAlpha;
+    };
+
+    // Scalar
+
+    inline uint8_t premultiplyChannel(uint32_t c, uint32_t a)
+    {
+        // round(c * a / 255)
+        uint32_t t = c * a + 128;
+        return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+    }
+
+    inline uint8_t unpremultiplyChannel(uint32_t c, uint32_t a)
+    {
+        // round(c * 255 / a), 잘못된 premultiplied 값은 255 로 자름
+        uint32_t v = (c * 255 + a / 2) / a;
+        return static_cast<uint8_t>(v > 255 ? 255 : v);
+    }
+
+    void swizzleScalar(const uint8_t* src, uint8_t* dst, int width)
+    {
+        for (int x = 0; x < width; ++x, src += 4, dst += 4)
+        {
+            uint8_t c0 = src[0];
+            uint8_t c2 = src[2];
+            dst[0] = c2;
+            dst[1] = src[1];
+            dst[2] = c0;
+            dst[3] = src[3];
+        }
+    }
+
+    void premultiplyScalar(const uint8_t* src, uint8_t* dst, int width)
+    {
+        for (int x = 0; x < width; ++x, src += 4, dst += 4)
+        {
+            uint32_t a = src[3];
+            dst[0] = premultiplyChannel(src[0], a);
+            dst[1] = premultiplyChannel(src[1], a);
+            dst[2] = premultiplyChannel(src[2], a);
+            dst[3] = static_cast<uint8_t>(a);
+        }
+    }
+
+    void unpremultiplyScalar(const uint8_t* src, uint8_t* dst, int width)
+    {
+        for (int x = 0; x < width; ++x, src += 4, dst += 4)
+        {
+            uint32_t a = src[3];
+            if (a == 0)
+            {
+                std::memset(dst, 0, 4);
+            }
+            else if (a == 255)
+            {
+                if (dst != src)
+                    std::memcpy(dst, src, 4);
+            }
+            else
+            {
+                dst[0] = unpremultiplyChannel(src[0], a);
+                dst[1] = unpremultiplyChannel(src[1], a);
+                dst[2] = unpremultiplyChannel(src[2], a);
+                dst[3] = static_cast<uint8_t>(a);
+            }
+        }
+    }
+
+    void fillAlphaScalar(const uint8_t* src, uint8_t* dst, int width)
+    {
+        for (int x = 0; x < width; ++x, src += 4, dst += 4)
+        {
+            if (dst != src)
+                std::memcpy(dst, src, 3);
+            dst[3] = 0xFF;
+        }
+    }
+
+#ifdef PIXELCONVERTER_X86
+
+    // SSE2
+
+    PIXELCONVERTER_TARGET_SSE2
+    void swizzleSSE2(const uint8_t* src, uint8_t* dst, int width)
+    {
+        const __m128i agMask = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+        const __m128i rbMask = _mm_set1_epi32(0x00FF00FF);
+
+        int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+            __m128i ag = _mm_and_si128(v, agMask);
+            __m128i rb = _mm_and_si128(v, rbMask);
+            rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_or_si128(ag, rb));
+        }
+
+        swizzleScalar(src + x * 4, dst + x * 4, width - x);
+    }
+
+    PIXELCONVERTER_TARGET_SSE2
+    inline __m128i premultiplyHalfSSE2(__m128i v)
+    {
+        // 16bit lane: b g r a b g r a
+        __m128i alpha = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+        alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(v, alpha), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    PIXELCONVERTER_TARGET_SSE2
+    void premultiplySSE2(const uint8_t* src, uint8_t* dst, int width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+        int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+            __m128i lo = premultiplyHalfSSE2(_mm_unpacklo_epi8(v, zero));
+            __m128i hi = premultiplyHalfSSE2(_mm_unpackhi_epi8(v, zero));
+            __m128i color = _mm_andnot_si128(alphaMask, _mm_packus_epi16(lo, hi));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_or_si128(color, _mm_and_si128(v, alphaMask)));
+        }
+
+        premultiplyScalar(src + x * 4, dst + x * 4, width - x);
+    }
+
+    PIXELCONVERTER_TARGET_SSE2
+    inline __m128i unpremultiplyPixelSSE2(__m128i pixel32, __m128 scale, __m128 half)
+    {
+        // pixel32: 한 pixel 의 b g r a 를 32bit lane 으로 펼친 값
+        __m128 p = _mm_cvtepi32_ps(pixel32);
+        __m128 a = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3));
+        __m128 v = _mm_add_ps(_mm_div_ps(_mm_mul_ps(p, scale), a), half);
+        return _mm_cvttps_epi32(v);
+    }
+
+    PIXELCONVERTER_TARGET_SSE2
+    void unpremultiplySSE2(const uint8_t* src, uint8_t* dst, int width)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+
+        int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+            __m128i alpha = _mm_and_si128(v, alphaMask);
+
+            // 모두 불투명하면 그대로 복사
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alphaMask)) == 0xFFFF)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), v);
+                continue;
+            }
+
+            __m128i lo16 = _mm_unpacklo_epi8(v, zero);
+            __m128i hi16 = _mm_unpackhi_epi8(v, zero);
+            __m128i p0 = unpremultiplyPixelSSE2(_mm_unpacklo_epi16(lo16, zero), scale, half);
+            __m128i p1 = unpremultiplyPixelSSE2(_mm_unpackhi_epi16(lo16, zero), scale, half);
+            __m128i p2 = unpremultiplyPixelSSE2(_mm_unpacklo_epi16(hi16, zero), scale, half);
+            __m128i p3 = unpremultiplyPixelSSE2(_mm_unpackhi_epi16(hi16, zero), scale, half);
+
+            // 포화 pack 으로 255 초과 값을 자른다
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+
+            // alpha 0 인 pixel 은 0, alpha 채널은 원본 유지
+            __m128i transparent = _mm_cmpeq_epi32(alpha, zero);
+            __m128i color = _mm_andnot_si128(_mm_or_si128(transparent, alphaMask), packed);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_or_si128(color, alpha));
+        }
+
+        unpremultiplyScalar(src + x * 4, dst + x * 4, width - x);
+    }
+
+    PIXELCONVERTER_TARGET_SSE2
+    void fillAlphaSSE2(const uint8_t* src, uint8_t* dst, int width)
+    {
+        const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+        int x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_or_si128(v, alphaMask));
+        }
+
+        fillAlphaScalar(src + x * 4, dst + x * 4, width - x);
+    }
+
+    // AVX2
+
+    PIXELCONVERTER_TARGET_AVX2
+    void swizzleAVX2(const uint8_t* src, uint8_t* dst, int width)
+    {
+        const __m256i shuffle = _mm256_setr_epi8(
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_shuffle_epi8(v, shuffle));
+        }
+
+        swizzleSSE2(src + x * 4, dst + x * 4, width - x);
+    }
+
+    PIXELCONVERTER_TARGET_AVX2
+    inline __m256i premultiplyHalfAVX2(__m256i v)
+    {
+        __m256i alpha = _mm256_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+        alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(v, alpha), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    PIXELCONVERTER_TARGET_AVX2
+    void premultiplyAVX2(const uint8_t* src, uint8_t* dst, int width)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            // unpack/pack 모두 128bit lane 단위라 순서가 유지된다
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+            __m256i lo = premultiplyHalfAVX2(_mm256_unpacklo_epi8(v, zero));
+            __m256i hi = premultiplyHalfAVX2(_mm256_unpackhi_epi8(v, zero));
+            __m256i color = _mm256_andnot_si256(alphaMask, _mm256_packus_epi16(lo, hi));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_or_si256(color, _mm256_and_si256(v, alphaMask)));
+        }
+
+        premultiplySSE2(src + x * 4, dst + x * 4, width - x);
+    }
+
+    PIXELCONVERTER_TARGET_AVX2
+    inline __m256i unpremultiplyPairAVX2(const uint8_t* src, __m256 scale, __m256 half)
+    {
+        // 2 pixel 을 8 개의 float 로 펼친다. 128bit lane 하나가 pixel 하나
+        __m256i pixel32 = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+        __m256 p = _mm256_cvtepi32_ps(pixel32);
+        __m256 a = _mm256_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3));
+        __m256 v = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(p, scale), a), half);
+        return _mm256_cvttps_epi32(v);
+    }
+
+    PIXELCONVERTER_TARGET_AVX2
+    void unpremultiplyAVX2(const uint8_t* src, uint8_t* dst, int width)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+        const __m256 scale = _mm256_set1_ps(255.0f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            const uint8_t* s = src + x * 4;
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+            __m256i alpha = _mm256_and_si256(v, alphaMask);
+
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(alpha, alphaMask)) == -1)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), v);
+                continue;
+            }
+
+            __m256i p01 = unpremultiplyPairAVX2(s, scale, half);
+            __m256i p23 = unpremultiplyPairAVX2(s + 8, scale, half);
+            __m256i p45 = unpremultiplyPairAVX2(s + 16, scale, half);
+            __m256i p67 = unpremultiplyPairAVX2(s + 24, scale, half);
+
+            // packs 는 lane 단위로 섞이므로 마지막에 64bit 순서를 되돌린다
+            __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(p01, p23), _mm256_packs_epi32(p45, p67));
+            packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+
+            __m256i transparent = _mm256_cmpeq_epi32(alpha, zero);
+            __m256i color = _mm256_andnot_si256(_mm256_or_si256(transparent, alphaMask), packed);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_or_si256(color, alpha));
+        }
+
+        unpremultiplySSE2(src + x * 4, dst + x * 4, width - x);
+    }
+
+    PIXELCONVERTER_TARGET_AVX2
+    void fillAlphaAVX2(const uint8_t* src, uint8_t* dst, int width)
+    {
+        const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+        int x = 0;
+        for (; x + 8 <= width; x += 8)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_or_si256(v, alphaMask));
+        }
+
+        fillAlphaSSE2(src + x * 4, dst + x * 4, width - x);
+    }
+
+#endif // PIXELCONVERTER_X86
+
+    const Kernels SCALAR_KERNELS = { swizzleScalar, premultiplyScalar, unpremultiplyScalar, fillAlphaScalar };
+#ifdef PIXELCONVERTER_X86
+    const Kernels SSE2_KERNELS = { swizzleSSE2, premultiplySSE2, unpremultiplySSE2, fillAlphaSSE2 };
+    const Kernels AVX2_KERNELS = { swizzleAVX2, premultiplyAVX2, unpremultiplyAVX2, fillAlphaAVX2 };
+#endif
+
+    const Kernels* kernelsFor(PixelConverter::Isa isa)
+    {
+#ifdef PIXELCONVERTER_X86
+        switch (isa)
+        {
+            case PixelConverter::Isa::AVX2:
+                return &AVX2_KERNELS;
+            case PixelConverter::Isa::SSE2:
+                return &SSE2_KERNELS;
+            default:
+                break;
+        }
+#else
+        (void)isa;
+#endif
+        return &SCALAR_KERNELS;
+    }
+
+    std::atomic<PixelConverter::Isa>& activeIsa()
+    {
+        static std::atomic<PixelConverter::Isa> isa(PixelConverter::DetectIsa());
+        return isa;
+    }
+
+    const Kernels& activeKernels()
+    {
+        return *kernelsFor(activeIsa().load(std::memory_order_relaxed));
+    }
+
+    bool isRgbOrder(PixelConverter::Format format)
+    {
+        return format == PixelConverter::Format::RGBA
+            || format == PixelConverter::Format::RGBAPremultiplied
+            || format == PixelConverter::Format::RGBX;
+    }
+}
+
+namespace PixelConverter
+{
+    Isa DetectIsa()
+    {
+#if defined(PIXELCONVERTER_X86) && defined(_MSC_VER)
+        int info[4] = {};
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+
+        if (avx2)
+            return Isa::AVX2;
+        if (sse2)
+            return Isa::SSE2;
+#elif defined(PIXELCONVERTER_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return Isa::AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return Isa::SSE2;
+#endif
+        return Isa::Scalar;
+    }
+
+    Isa ActiveIsa()
+    {
+        return activeIsa().load(std::memory_order_relaxed);
+    }
+
+    bool SetActiveIsa(Isa isa)
+    {
+        // 지원하지 않는 ISA 는 선택할 수 없음
+        if (static_cast<int>(isa) > static_cast<int>(DetectIsa()))
+            return false;
+
+        activeIsa().store(isa, std::memory_order_relaxed);
+        return true;
+    }
+
+    const char* IsaName(Isa isa)
+    {
+        switch (isa)
+        {
+            case Isa::AVX2:
+                return "AVX2";
+            case Isa::SSE2:
+                return "SSE2";
+            default:
+                return "Scalar";
+        }
+    }
+
+    bool HasAlpha(Format format)
+    {
+        return format != Format::BGRX && format != Format::RGBX;
+    }
+
+    bool IsPremultiplied(Format format)
+    {
+        return format == Format::BGRAPremultiplied || format == Format::RGBAPremultiplied;
+    }
+
+    void SwizzleRow(const uint8_t* src, uint8_t* dst, int width)
+    {
+        activeKernels().swizzle(src, dst, width);
+    }
+
+    void PremultiplyRow(const uint8_t* src, uint8_t* dst, int width)
+    {
+        activeKernels().premultiply(src, dst, width);
+    }
+
+    void UnpremultiplyRow(const uint8_t* src, uint8_t* dst, int width)
+    {
+        activeKernels().unpremultiply(src, dst, width);
+    }
+
+    void FillAlphaRow(const uint8_t* src, uint8_t* dst, int width)
+    {
+        activeKernels().fillAlpha(src, dst, width);
+    }
+
+    void ConvertRow(const uint8_t* src, Format srcFormat, uint8_t* dst, Format dstFormat, int width)
+    {
+        ConvertRows(src, 0, srcFormat, dst, 0, dstFormat, width, 1);
+    }
+
+    void ConvertRows(const uint8_t* src, int srcStride, Format srcFormat,
+                     uint8_t* dst, int dstStride, Format dstFormat,
+                     int width, int height)
+    {
+        if (width <= 0 || height <= 0)
+            return;
+
+        const Kernels& kernels = activeKernels();
+
+        // 첫 단계는 src -> dst, 나머지 단계는 dst 에서 in-place 로 처리
+        RowKernel steps[3] = {};
+        int stepCount = 0;
+
+        if (isRgbOrder(srcFormat) != isRgbOrder(dstFormat))
+            steps[stepCount++] = kernels.swizzle;
+
+        if (!HasAlpha(srcFormat))
+        {
+            steps[stepCount++] = kernels.fillAlpha;
+        }
+        else if (!HasAlpha(dstFormat))
+        {
+            // alpha 를 버릴 때는 검은 배경에 합성한 값(= premultiplied) 을 쓴다
+            if (!IsPremultiplied(srcFormat))
+                steps[stepCount++] = kernels.premultiply;
+            steps[stepCount++] = kernels.fillAlpha;
+        }
+        else if (IsPremultiplied(srcFormat) && !IsPremultiplied(dstFormat))
+        {
+            steps[stepCount++] = kernels.unpremultiply;
+        }
+        else if (!IsPremultiplied(srcFormat) && IsPremultiplied(dstFormat))
+        {
+            steps[stepCount++] = kernels.premultiply;
+        }
+
+        const size_t rowBytes = static_cast<size_t>(width) * 4;
+        for (int y = 0; y < height; ++y)
+        {
+            const uint8_t* srcRow = src + static_cast<ptrdiff_t>(y) * srcStride;
+            uint8_t* dstRow = dst + static_cast<ptrdiff_t>(y) * dstStride;
+
+            if (stepCount == 0)
+            {
+                if (dstRow != srcRow)
+                    std::memcpy(dstRow, srcRow, rowBytes);
+                continue;
+            }
+
+            steps[0](srcRow, dstRow, width);
+            for (int i = 1; i < stepCount; ++i)
+                steps[i](dstRow, dstRow, width);
+        }
+    }
+}
\ No newline at end of file
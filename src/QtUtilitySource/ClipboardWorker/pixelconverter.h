@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+namespace PixelConverter
+{
+    // 32bpp 메모리 배치 (little endian 기준, 4번째 byte 는 항상 alpha)
+    enum class Format
+    {
+        BGRA,               // QImage::Format_ARGB32, DIB 32bpp
+        BGRAPremultiplied,  // QImage::Format_ARGB32_Premultiplied
+        BGRX,               // QImage::Format_RGB32
+        RGBA,               // QImage::Format_RGBA8888
+        RGBAPremultiplied,  // QImage::Format_RGBA8888_Premultiplied
+        RGBX,               // QImage::Format_RGBX8888
+    };
+
+    enum class Isa
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    Isa DetectIsa();
+    Isa ActiveIsa();
+    bool SetActiveIsa(Isa isa);
+    const char* IsaName(Isa isa);
+
+    bool HasAlpha(Format format);
+    bool IsPremultiplied(Format format);
+
+    // row 단위 변환. src 와 dst 는 같은 버퍼여도 된다
+    void SwizzleRow(const uint8_t* src, uint8_t* dst, int width);
+    void PremultiplyRow(const uint8_t* src, uint8_t* dst, int width);
+    void UnpremultiplyRow(const uint8_t* src, uint8_t* dst, int width);
+    void FillAlphaRow(const uint8_t* src, uint8_t* dst, int width);
+
+    void ConvertRow(const uint8_t* src, Format srcFormat, uint8_t* dst, Format dstFormat, int width);
+    void ConvertRows(const uint8_t* src, int srcStride, Format srcFormat,
+                     uint8_t* dst, int dstStride, Format dstFormat,
+                     int width, int height);
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "pixmapclipboardsource.h"
+#include "pixelconverter.h"
+#include "threadpool.h"
+#include "trace.h"
+
+#include <cstring>
+
+namespace
+{
+    const int ROWS_PER_BAND = 64;
+
+    // BITMAPV5HEADER 와 같은 배치 (windows.h 없이 렌더링하기 위해 따로 정의)
+#pragma pack(push, 1)
+    struct DibV5Header
+    {
+        uint32_t size;
+        int32_t width;
+        int32_t height;
+        uint16_t planes;
+        uint16_t bitCount;
+        uint32_t compression;
+        uint32_t sizeImage;
+        int32_t xPelsPerMeter;
+        int32_t yPelsPerMeter;
+        uint32_t clrUsed;
+        uint32_t clrImportant;
+        uint32_t redMask;
+        uint32_t greenMask;
+        uint32_t blueMask;
+        uint32_t alphaMask;
+        uint32_t csType;
+        int32_t endpoints[9];
+        uint32_t gammaRed;
+        uint32_t gammaGreen;
+        uint32_t gammaBlue;
+        uint32_t intent;
+        uint32_t profileData;
+        uint32_t profileSize;
+        uint32_t reserved;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(DibV5Header) == 124, "DibV5Header must match BITMAPV5HEADER");
+
+    const uint32_t DIB_BI_BITFIELDS = 3;
+    const uint32_t DIB_LCS_SRGB = 0x73524742;   // 'sRGB'
+    const uint32_t DIB_LCS_GM_IMAGES = 4;
+}
+
+PixmapClipboardSource::PixmapClipboardSource(const PixelBuffer& pixels, const EncodedBytes& png, ThreadPool* pool)
+    : pixels_(pixels)
+    , png_(png)
+    , pool_(pool)
+{}
+
+size_t PixmapClipboardSource::DibV5Size(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return 0;
+
+    return sizeof(DibV5Header) + static_cast<size_t>(width) * height * 4;
+}
+
+std::vector<ClipboardFormat> PixmapClipboardSource::Formats() const
+{
+    std::vector<ClipboardFormat> formats;
+    if (png_.size > 0)
+        formats.push_back(ClipboardFormat::Png);
+    if (!pixels_.IsNull())
+    {
+        formats.push_back(ClipboardFormat::DibV5);
+        formats.push_back(ClipboardFormat::Bitmap);
+    }
+    return formats;
+}
+
+size_t PixmapClipboardSource::FormatSize(ClipboardFormat format) const
+{
+    switch (format)
+    {
+        case ClipboardFormat::Png:
+            return png_.size;
+        case ClipboardFormat::DibV5:
+            return pixels_.IsNull() ? 0 : DibV5Size(pixels_.Width(), pixels_.Height());
+        default:
+            return 0;
+    }
+}
+
+bool PixmapClipboardSource::Render(ClipboardFormat format, uint8_t* dest, size_t size) const
+{
+    if (dest == nullptr || size < FormatSize(format) || size == 0)
+        return false;
+
+    switch (format)
+    {
+        case ClipboardFormat::Png:
+            std::memcpy(dest, png_.data, png_.size);
+            return true;
+        case ClipboardFormat::DibV5:
+            return renderDibV5(dest);
+        default:
+            return false;
+    }
+}
+
+ImageView PixmapClipboardSource::Pixels() const
+{
+    return pixels_.View();
+}
+
+bool PixmapClipboardSource::renderDibV5(uint8_t* dest) const
+{
+    const int width = pixels_.Width();
+    const int height = pixels_.Height();
+    Trace::Span span("DIBV5 build", nullptr, sizeof(DibV5Header) + static_cast<uint64_t>(width) * height * 4);
+
+    DibV5Header header = {};
+    header.size = sizeof(DibV5Header);
+    header.width = width;
+    header.height = -height;
+    header.planes = 1;
+    header.bitCount = 32;
+    header.compression = DIB_BI_BITFIELDS;
+    header.redMask = 0x00FF0000;
+    header.greenMask = 0x0000FF00;
+    header.blueMask = 0x000000FF;
+    header.alphaMask = 0xFF000000;
+    header.csType = DIB_LCS_SRGB;
+    header.intent = DIB_LCS_GM_IMAGES;
+    std::memcpy(dest, &header, sizeof(header));
+
+    // 버퍼가 이미 DIB 배치이므로 row band 단위로 나눠 복사
+    uint8_t* destPixels = dest + sizeof(DibV5Header);
+    auto copyRows = [&](int begin, int end)
+    {
+        PixelConverter::ConvertRows(
+            pixels_.ConstScanLine(begin), pixels_.Stride(), pixels_.Format(),
+            destPixels + static_cast<size_t>(begin) * width * 4, width * 4, PixelConverter::Format::BGRA,
+            width, end - begin);
+    };
+
+    if (pool_)
+        pool_->ParallelFor(0, height, ROWS_PER_BAND, copyRows);
+    else
+        copyRows(0, height);
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "clipboardbackend.h"
+#include "pixelbuffer.h"
+
+#include <memory>
+
+class ThreadPool;
+
+// SetPixmapData 에서 만들어 둔 픽셀과 PNG 로 clipboard 포맷을 만든다
+class PixmapClipboardSource : public ClipboardSource
+{
+public:
+    // 다른 곳이 소유한 인코딩 결과. owner 가 data 의 수명을 유지한다
+    struct EncodedBytes
+    {
+        std::shared_ptr<const void> owner;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    PixmapClipboardSource(const PixelBuffer& pixels, const EncodedBytes& png, ThreadPool* pool = nullptr);
+
+    // header 를 포함한 CF_DIBV5 크기
+    static size_t DibV5Size(int width, int height);
+
+public:
+    std::vector<ClipboardFormat> Formats() const override;
+    size_t FormatSize(ClipboardFormat format) const override;
+    bool Render(ClipboardFormat format, uint8_t* dest, size_t size) const override;
+    ImageView Pixels() const override;
+
+private:
+    bool renderDibV5(uint8_t* dest) const;
+
+private:
+    PixelBuffer pixels_;
+    EncodedBytes png_;
+    ThreadPool* pool_;
+};
\ No newline at end of file
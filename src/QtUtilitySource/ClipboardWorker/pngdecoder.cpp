@@ -0,0 +1,534 @@
+#include "pngdecoder.h"
+#include "zlibsupport.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    const uint32_t MAX_BUFFERED_CHUNK = 1024 * 1024;   // IHDR, PLTE, tRNS 외에는 buffer 하지 않는다
+
+    enum class Stage
+    {
+        Signature,
+        ChunkHeader,
+        ChunkData,
+        ChunkCrc,
+        Finished,
+        Failed,
+    };
+
+    uint32_t readUint32(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+            | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    int channelCount(int colorType)
+    {
+        switch (colorType)
+        {
+            case 0: return 1;   // gray
+            case 2: return 3;   // RGB
+            case 3: return 1;   // palette
+            case 4: return 2;   // gray + alpha
+            case 6: return 4;   // RGBA
+            default: return 0;
+        }
+    }
+
+    bool isValidDepth(int colorType, int bitDepth)
+    {
+        switch (colorType)
+        {
+            case 0:
+                return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16;
+            case 3:
+                return bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8;
+            case 2:
+            case 4:
+            case 6:
+                return bitDepth == 8 || bitDepth == 16;
+            default:
+                return false;
+        }
+    }
+
+    bool parseHeader(const uint8_t* ihdr, PngStreamDecoder::Info* info)
+    {
+        uint32_t width = readUint32(ihdr);
+        uint32_t height = readUint32(ihdr + 4);
+        if (width == 0 || height == 0 || width > 0x7FFFFFFF / 8 || height > 0x7FFFFFFF)
+            return false;
+
+        info->width = static_cast<int>(width);
+        info->height = static_cast<int>(height);
+        info->bitDepth = ihdr[8];
+        info->colorType = ihdr[9];
+        info->interlaced = ihdr[12] != 0;
+        info->hasAlpha = info->colorType == 4 || info->colorType == 6;
+
+        return isValidDepth(info->colorType, info->bitDepth) && ihdr[10] == 0 && ihdr[11] == 0;
+    }
+
+    uint8_t paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+            return static_cast<uint8_t>(a);
+        return static_cast<uint8_t>(pb <= pc ? b : c);
+    }
+
+    bool unfilterRow(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t rowBytes, size_t bpp)
+    {
+        switch (filter)
+        {
+            case 0:
+                return true;
+            case 1:
+                for (size_t i = bpp; i < rowBytes; ++i)
+                    row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+                return true;
+            case 2:
+                for (size_t i = 0; i < rowBytes; ++i)
+                    row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+                return true;
+            case 3:
+                for (size_t i = 0; i < bpp; ++i)
+                    row[i] = static_cast<uint8_t>(row[i] + (prior[i] >> 1));
+                for (size_t i = bpp; i < rowBytes; ++i)
+                    row[i] = static_cast<uint8_t>(row[i] + ((row[i - bpp] + prior[i]) >> 1));
+                return true;
+            case 4:
+                for (size_t i = 0; i < bpp; ++i)
+                    row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+                for (size_t i = bpp; i < rowBytes; ++i)
+                    row[i] = static_cast<uint8_t>(row[i] + paeth(row[i - bpp], prior[i], prior[i - bpp]));
+                return true;
+            default:
+                return false;
+        }
+    }
+}
+
+struct PngStreamDecoder::State
+{
+    explicit State(Allocator allocate)
+        : allocate(std::move(allocate))
+        , stage(Stage::Signature)
+        , pending()
+        , chunkType()
+        , chunkLength(0)
+        , chunkRemaining(0)
+        , chunkCrc(0)
+        , chunk()
+        , info()
+        , hasHeader(false)
+        , palette(256 * 4, 0)
+        , transparentKey()
+        , hasTransparentKey(false)
+        , stream()
+        , streamStarted(false)
+        , streamEnded(false)
+        , target()
+        , rowBytes(0)
+        , bpp(0)
+        , current()
+        , prior()
+        , filled(0)
+        , rowsDecoded(0)
+    {
+        // palette 기본 alpha 는 불투명
+        for (size_t i = 0; i < 256; ++i)
+            palette[i * 4 + 3] = 0xFF;
+    }
+
+    ~State()
+    {
+        if (streamStarted)
+            inflateEnd(&stream);
+    }
+
+    Allocator allocate;
+    Stage stage;
+    std::vector<uint8_t> pending;       // signature, chunk header, crc 처럼 고정 길이 부분을 모으는 곳
+    char chunkType[4];
+    uint32_t chunkLength;
+    uint32_t chunkRemaining;
+    uLong chunkCrc;
+    std::vector<uint8_t> chunk;         // IHDR, PLTE, tRNS 내용
+
+    Info info;
+    bool hasHeader;
+    std::vector<uint8_t> palette;       // BGRA
+    uint16_t transparentKey[3];
+    bool hasTransparentKey;
+
+    z_stream stream;
+    bool streamStarted;
+    bool streamEnded;
+    Target target;
+    size_t rowBytes;
+    size_t bpp;
+    std::vector<uint8_t> current;       // filter byte + row
+    std::vector<uint8_t> prior;
+    size_t filled;
+    int rowsDecoded;
+
+    bool isChunk(const char* type) const
+    {
+        return std::memcmp(chunkType, type, 4) == 0;
+    }
+
+    bool fail()
+    {
+        stage = Stage::Failed;
+        return false;
+    }
+
+    // 고정 길이 부분을 다 모았으면 true
+    bool collect(const uint8_t*& data, size_t& size, size_t length)
+    {
+        size_t take = std::min(size, length - pending.size());
+        pending.insert(pending.end(), data, data + take);
+        data += take;
+        size -= take;
+        return pending.size() == length;
+    }
+
+    bool beginImage()
+    {
+        if (!hasHeader || info.interlaced)
+            return false;
+
+        const int bitsPerPixel = channelCount(info.colorType) * info.bitDepth;
+        rowBytes = (static_cast<size_t>(info.width) * bitsPerPixel + 7) / 8;
+        bpp = std::max<size_t>(1, bitsPerPixel / 8);
+        current.assign(rowBytes + 1, 0);
+        prior.assign(rowBytes + 1, 0);
+        filled = 0;
+
+        target = allocate ? allocate(info) : Target();
+        if (target.bits == nullptr || target.stride < info.width * 4)
+            return false;
+
+        if (inflateInit(&stream) != Z_OK)
+            return false;
+        streamStarted = true;
+        return true;
+    }
+
+    uint16_t sample(const uint8_t* row, int index) const
+    {
+        const int depth = info.bitDepth;
+        if (depth == 8)
+            return row[index];
+        if (depth == 16)
+            return static_cast<uint16_t>((row[index * 2] << 8) | row[index * 2 + 1]);
+
+        const int perByte = 8 / depth;
+        const int shift = 8 - depth * (index % perByte + 1);
+        return static_cast<uint16_t>((row[index / perByte] >> shift) & ((1 << depth) - 1));
+    }
+
+    uint8_t toByte(uint16_t value) const
+    {
+        switch (info.bitDepth)
+        {
+            case 16: return static_cast<uint8_t>(value >> 8);
+            case 8: return static_cast<uint8_t>(value);
+            default: return static_cast<uint8_t>(value * 255 / ((1 << info.bitDepth) - 1));
+        }
+    }
+
+    void convertRow(const uint8_t* row, uint8_t* dest) const
+    {
+        const int width = info.width;
+
+        // 흔한 8bit RGBA / RGB 는 바로 처리
+        if (info.bitDepth == 8 && info.colorType == 6)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                dest[x * 4 + 0] = row[x * 4 + 2];
+                dest[x * 4 + 1] = row[x * 4 + 1];
+                dest[x * 4 + 2] = row[x * 4 + 0];
+                dest[x * 4 + 3] = row[x * 4 + 3];
+            }
+            return;
+        }
+        if (info.bitDepth == 8 && info.colorType == 2 && !hasTransparentKey)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                dest[x * 4 + 0] = row[x * 3 + 2];
+                dest[x * 4 + 1] = row[x * 3 + 1];
+                dest[x * 4 + 2] = row[x * 3 + 0];
+                dest[x * 4 + 3] = 0xFF;
+            }
+            return;
+        }
+
+        const int channels = channelCount(info.colorType);
+        for (int x = 0; x < width; ++x)
+        {
+            uint8_t* pixel = dest + x * 4;
+            const int base = x * channels;
+            switch (info.colorType)
+            {
+                case 0:
+                {
+                    uint16_t gray = sample(row, base);
+                    pixel[0] = pixel[1] = pixel[2] = toByte(gray);
+                    pixel[3] = hasTransparentKey && gray == transparentKey[0] ? 0 : 0xFF;
+                    break;
+                }
+                case 2:
+                {
+                    uint16_t r = sample(row, base);
+                    uint16_t g = sample(row, base + 1);
+                    uint16_t b = sample(row, base + 2);
+                    pixel[0] = toByte(b);
+                    pixel[1] = toByte(g);
+                    pixel[2] = toByte(r);
+                    pixel[3] = hasTransparentKey && r == transparentKey[0] && g == transparentKey[1] && b == transparentKey[2] ? 0 : 0xFF;
+                    break;
+                }
+                case 3:
+                    std::memcpy(pixel, palette.data() + sample(row, base) * 4, 4);
+                    break;
+                case 4:
+                    pixel[0] = pixel[1] = pixel[2] = toByte(sample(row, base));
+                    pixel[3] = toByte(sample(row, base + 1));
+                    break;
+                case 6:
+                    pixel[0] = toByte(sample(row, base + 2));
+                    pixel[1] = toByte(sample(row, base + 1));
+                    pixel[2] = toByte(sample(row, base));
+                    pixel[3] = toByte(sample(row, base + 3));
+                    break;
+            }
+        }
+    }
+
+    bool inflateData(const uint8_t* data, size_t size)
+    {
+        if (streamEnded || rowsDecoded == info.height)
+            return true;
+
+        stream.next_in = const_cast<uint8_t*>(data);
+        stream.avail_in = static_cast<uInt>(size);
+
+        while (rowsDecoded < info.height)
+        {
+            // 한 row (filter byte 포함) 가 찰 때까지 inflate
+            stream.next_out = current.data() + filled;
+            stream.avail_out = static_cast<uInt>(current.size() - filled);
+
+            int result = inflate(&stream, Z_NO_FLUSH);
+            if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+                return false;
+
+            filled = current.size() - stream.avail_out;
+            if (filled == current.size())
+            {
+                if (!unfilterRow(current[0], current.data() + 1, prior.data() + 1, rowBytes, bpp))
+                    return false;
+
+                convertRow(current.data() + 1, target.bits + static_cast<size_t>(rowsDecoded) * target.stride);
+                current.swap(prior);
+                filled = 0;
+                ++rowsDecoded;
+            }
+
+            if (result == Z_STREAM_END)
+            {
+                streamEnded = true;
+                break;
+            }
+            // 입력을 다 썼고 출력 공간이 남았으면 zlib 안에 남은 출력도 없다
+            if (result == Z_BUF_ERROR || (stream.avail_in == 0 && stream.avail_out != 0))
+                break;
+        }
+        return true;
+    }
+
+    bool endChunk()
+    {
+        if (isChunk("IHDR"))
+        {
+            if (chunk.size() != 13 || !parseHeader(chunk.data(), &info))
+                return false;
+            hasHeader = true;
+        }
+        else if (isChunk("PLTE"))
+        {
+            for (size_t i = 0; i < chunk.size() / 3 && i < 256; ++i)
+            {
+                palette[i * 4 + 0] = chunk[i * 3 + 2];
+                palette[i * 4 + 1] = chunk[i * 3 + 1];
+                palette[i * 4 + 2] = chunk[i * 3 + 0];
+            }
+        }
+        else if (isChunk("tRNS") && hasHeader)
+        {
+            if (info.colorType == 3)
+            {
+                for (size_t i = 0; i < chunk.size() && i < 256; ++i)
+                    palette[i * 4 + 3] = chunk[i];
+            }
+            else if (info.colorType == 0 && chunk.size() >= 2)
+            {
+                transparentKey[0] = static_cast<uint16_t>((chunk[0] << 8) | chunk[1]);
+                hasTransparentKey = true;
+            }
+            else if (info.colorType == 2 && chunk.size() >= 6)
+            {
+                for (int i = 0; i < 3; ++i)
+                    transparentKey[i] = static_cast<uint16_t>((chunk[i * 2] << 8) | chunk[i * 2 + 1]);
+                hasTransparentKey = true;
+            }
+            info.hasAlpha = true;
+        }
+        else if (isChunk("IEND"))
+        {
+            if (rowsDecoded != info.height)
+                return false;
+            stage = Stage::Finished;
+        }
+        return true;
+    }
+};
+
+PngStreamDecoder::PngStreamDecoder(Allocator allocate)
+    : state_(std::make_unique<State>(std::move(allocate)))
+{}
+
+PngStreamDecoder::~PngStreamDecoder()
+{}
+
+bool PngStreamDecoder::ReadInfo(const uint8_t* data, size_t size, Info* info)
+{
+    // signature(8) + IHDR length(4) + type(4) + data(13)
+    if (data == nullptr || size < 33 || std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0
+        || std::memcmp(data + 12, "IHDR", 4) != 0)
+        return false;
+
+    return parseHeader(data + 16, info);
+}
+
+bool PngStreamDecoder::Feed(const uint8_t* data, size_t size)
+{
+    State& state = *state_;
+
+    while (size > 0)
+    {
+        switch (state.stage)
+        {
+            case Stage::Signature:
+                if (!state.collect(data, size, sizeof(PNG_SIGNATURE)))
+                    break;
+                if (std::memcmp(state.pending.data(), PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0)
+                    return state.fail();
+                state.pending.clear();
+                state.stage = Stage::ChunkHeader;
+                break;
+
+            case Stage::ChunkHeader:
+            {
+                if (!state.collect(data, size, 8))
+                    break;
+
+                state.chunkLength = readUint32(state.pending.data());
+                std::memcpy(state.chunkType, state.pending.data() + 4, 4);
+                state.chunkRemaining = state.chunkLength;
+                state.chunkCrc = crc32(crc32(0L, Z_NULL, 0), state.pending.data() + 4, 4);
+                state.pending.clear();
+                state.chunk.clear();
+
+                if (state.chunkLength > 0x7FFFFFFF)
+                    return state.fail();
+                // IHDR 이 맨 앞에 와야 한다
+                if (!state.hasHeader && !state.isChunk("IHDR"))
+                    return state.fail();
+                if (state.isChunk("IDAT") && !state.streamStarted && !state.beginImage())
+                    return state.fail();
+
+                state.stage = Stage::ChunkData;
+                break;
+            }
+
+            case Stage::ChunkData:
+            {
+                size_t take = std::min<size_t>(size, state.chunkRemaining);
+                state.chunkCrc = crc32(state.chunkCrc, data, static_cast<uInt>(take));
+
+                if (state.isChunk("IDAT"))
+                {
+                    if (!state.inflateData(data, take))
+                        return state.fail();
+                }
+                else if (state.isChunk("IHDR") || state.isChunk("PLTE") || state.isChunk("tRNS"))
+                {
+                    if (state.chunkLength > MAX_BUFFERED_CHUNK)
+                        return state.fail();
+                    state.chunk.insert(state.chunk.end(), data, data + take);
+                }
+
+                data += take;
+                size -= take;
+                state.chunkRemaining -= static_cast<uint32_t>(take);
+                break;
+            }
+
+            case Stage::ChunkCrc:
+                if (!state.collect(data, size, 4))
+                    break;
+                if (readUint32(state.pending.data()) != static_cast<uint32_t>(state.chunkCrc))
+                    return state.fail();
+                state.pending.clear();
+                state.stage = Stage::ChunkHeader;
+                if (!state.endChunk())
+                    return state.fail();
+                break;
+
+            case Stage::Finished:
+                return true;
+
+            case Stage::Failed:
+                return false;
+        }
+
+        // 길이 0 인 chunk 도 crc 로 넘어가도록 data 를 다 쓴 뒤에도 확인
+        if (state.stage == Stage::ChunkData && state.chunkRemaining == 0)
+            state.stage = Stage::ChunkCrc;
+    }
+
+    return state.stage != Stage::Failed;
+}
+
+bool PngStreamDecoder::IsFinished() const
+{
+    return state_->stage == Stage::Finished;
+}
+
+bool PngStreamDecoder::HasFailed() const
+{
+    return state_->stage == Stage::Failed;
+}
+
+int PngStreamDecoder::RowsDecoded() const
+{
+    return state_->rowsDecoded;
+}
+
+const PngStreamDecoder::Info& PngStreamDecoder::ImageInfo() const
+{
+    return state_->info;
+}
\ No newline at end of file
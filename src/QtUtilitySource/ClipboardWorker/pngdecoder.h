@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// PNG 를 받은 만큼씩 decode 한다. 전체 raw 데이터를 따로 두지 않고 inflate 결과를 row 단위로 바로 결과 버퍼에 쓴다.
+// 결과는 BGRA (straight alpha). interlace 된 이미지는 지원하지 않는다
+class PngStreamDecoder
+{
+public:
+    struct Info
+    {
+        int width;
+        int height;
+        int bitDepth;
+        int colorType;
+        bool interlaced;
+        bool hasAlpha;      // alpha channel 이나 tRNS 가 있다
+    };
+
+    struct Target
+    {
+        uint8_t* bits;
+        int stride;
+    };
+
+    // 첫 IDAT 직전에 한 번 호출된다. bits 가 null 이면 decode 를 중단한다
+    using Allocator = std::function<Target(const Info& info)>;
+
+public:
+    explicit PngStreamDecoder(Allocator allocate);
+    ~PngStreamDecoder();
+
+    PngStreamDecoder(const PngStreamDecoder&) = delete;
+    PngStreamDecoder& operator=(const PngStreamDecoder&) = delete;
+
+    // 앞부분 header 만 읽어 크기와 포맷을 알아낸다
+    static bool ReadInfo(const uint8_t* data, size_t size, Info* info);
+
+public:
+    // 이어지는 byte 를 넣는다. 잘못된 데이터면 false
+    bool Feed(const uint8_t* data, size_t size);
+
+    bool IsFinished() const;
+    bool HasFailed() const;
+    int RowsDecoded() const;
+    const Info& ImageInfo() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
\ No newline at end of file
@@ -0,0 +1,914 @@
+#include "pngencoder.h"
+#include "bufferpool.h"
+#include "cancellationtoken.h"
+#include "threadpool.h"
+#include "trace.h"
+#include "zlibsupport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    const size_t DICTIONARY_SIZE = 32768;
+    const size_t TARGET_BAND_BYTES = 512 * 1024;
+    // 부분 갱신은 band 단위라서 더 잘게 나눈다
+    const size_t INCREMENTAL_TARGET_BAND_BYTES = 128 * 1024;
+    const int MIN_ROWS_PER_BAND = 8;
+    const int CANCEL_CHECK_ROWS = 16;
+
+    enum FilterType : uint8_t
+    {
+        FilterNone = 0,
+        FilterSub = 1,
+        FilterUp = 2,
+        FilterAverage = 3,
+        FilterPaeth = 4,
+    };
+
+    struct Layout
+    {
+        int width;
+        int height;
+        int bpp;
+        size_t rowBytes;
+    };
+
+    struct DeflateParams
+    {
+        int level;
+        int strategy;
+        bool useDictionary;
+        uint8_t zlibFlags;
+    };
+
+    struct Band
+    {
+        int firstRow;
+        int rowCount;
+        ByteBuffer data;
+        uLong adler;
+        size_t rawBytes;
+        bool ok;
+    };
+
+    DeflateParams deflateParamsFor(PngEncoder::Preset preset)
+    {
+        // zlibFlags: FLEVEL 을 포함한 zlib header 두번째 byte (CMF 0x78 기준 FCHECK 포함)
+        switch (preset)
+        {
+            case PngEncoder::Preset::Fastest:
+                return { 1, Z_HUFFMAN_ONLY, false, 0x01 };
+            case PngEncoder::Preset::Fast:
+                return { 1, Z_RLE, false, 0x01 };
+            case PngEncoder::Preset::Smallest:
+                return { 9, Z_DEFAULT_STRATEGY, true, 0xDA };
+            default:
+                return { 6, Z_DEFAULT_STRATEGY, true, 0x9C };
+        }
+    }
+
+    void writeUint32(uint8_t* p, uint32_t value)
+    {
+        p[0] = static_cast<uint8_t>(value >> 24);
+        p[1] = static_cast<uint8_t>(value >> 16);
+        p[2] = static_cast<uint8_t>(value >> 8);
+        p[3] = static_cast<uint8_t>(value);
+    }
+
+    // 원본 row 를 PNG 의 RGBA 또는 RGB 로 변환
+    void prepareRow(const ImageView& image, int y, const Layout& layout, uint8_t* scratch, uint8_t* out)
+    {
+        if (layout.bpp == 4)
+        {
+            PixelConverter::ConvertRow(image.ConstScanLine(y), image.format, out, PixelConverter::Format::RGBA, layout.width);
+            return;
+        }
+
+        PixelConverter::ConvertRow(image.ConstScanLine(y), image.format, scratch, PixelConverter::Format::RGBA, layout.width);
+        for (int x = 0; x < layout.width; ++x)
+        {
+            out[x * 3 + 0] = scratch[x * 4 + 0];
+            out[x * 3 + 1] = scratch[x * 4 + 1];
+            out[x * 3 + 2] = scratch[x * 4 + 2];
+        }
+    }
+
+    inline uint8_t paethPredictor(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+            return static_cast<uint8_t>(a);
+        if (pb <= pc)
+            return static_cast<uint8_t>(b);
+        return static_cast<uint8_t>(c);
+    }
+
+    void applyFilter(FilterType type, const uint8_t* row, const uint8_t* prior, size_t n, int bpp, uint8_t* out)
+    {
+        size_t head = std::min(n, static_cast<size_t>(bpp));
+        switch (type)
+        {
+            case FilterNone:
+                std::memcpy(out, row, n);
+                break;
+            case FilterSub:
+                std::memcpy(out, row, head);
+                for (size_t i = head; i < n; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - row[i - bpp]);
+                break;
+            case FilterUp:
+                for (size_t i = 0; i < n; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - prior[i]);
+                break;
+            case FilterAverage:
+                for (size_t i = 0; i < head; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - (prior[i] >> 1));
+                for (size_t i = head; i < n; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - ((row[i - bpp] + prior[i]) >> 1));
+                break;
+            case FilterPaeth:
+                for (size_t i = 0; i < head; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - prior[i]);
+                for (size_t i = head; i < n; ++i)
+                    out[i] = static_cast<uint8_t>(row[i] - paethPredictor(row[i - bpp], prior[i], prior[i - bpp]));
+                break;
+        }
+    }
+
+    inline uint32_t absSigned(uint8_t v)
+    {
+        return v < 128 ? v : 256 - v;
+    }
+
+    uint64_t sumAbs(const uint8_t* data, size_t n)
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; ++i)
+            sum += absSigned(data[i]);
+        return sum;
+    }
+
+    // out[0] 은 filter type, out[1..] 은 filter 된 row
+    void filterRow(PngEncoder::Preset preset, const uint8_t* row, const uint8_t* prior, const Layout& layout,
+                   std::vector<uint8_t>& candidates, uint8_t* out)
+    {
+        const size_t n = layout.rowBytes;
+        const int bpp = layout.bpp;
+
+        if (preset == PngEncoder::Preset::Fastest)
+        {
+            out[0] = FilterNone;
+            std::memcpy(out + 1, row, n);
+            return;
+        }
+
+        if (preset == PngEncoder::Preset::Fast)
+        {
+            // 몇 픽셀마다 하나씩만 보고 Sub/Up 중 고른다
+            uint64_t subSum = 0;
+            uint64_t upSum = 0;
+            const size_t step = static_cast<size_t>(bpp) * 4;
+            for (size_t i = bpp; i < n; i += step)
+            {
+                for (int c = 0; c < bpp && i + c < n; ++c)
+                {
+                    subSum += absSigned(static_cast<uint8_t>(row[i + c] - row[i + c - bpp]));
+                    upSum += absSigned(static_cast<uint8_t>(row[i + c] - prior[i + c]));
+                }
+            }
+
+            FilterType type = upSum < subSum ? FilterUp : FilterSub;
+            out[0] = type;
+            applyFilter(type, row, prior, n, bpp, out + 1);
+            return;
+        }
+
+        // 최소 절대값 합 (libpng 기본 heuristic)
+        candidates.resize(n * 5);
+        FilterType best = FilterNone;
+        uint64_t bestSum = UINT64_MAX;
+        for (int type = FilterNone; type <= FilterPaeth; ++type)
+        {
+            uint8_t* candidate = candidates.data() + n * type;
+            applyFilter(static_cast<FilterType>(type), row, prior, n, bpp, candidate);
+
+            uint64_t sum = sumAbs(candidate, n);
+            if (sum < bestSum)
+            {
+                bestSum = sum;
+                best = static_cast<FilterType>(type);
+            }
+        }
+
+        out[0] = best;
+        std::memcpy(out + 1, candidates.data() + n * best, n);
+    }
+
+    bool deflateInto(z_stream& stream, ByteBuffer& out, int flush)
+    {
+        while (true)
+        {
+            if (out.Size() == out.Capacity() && !out.Reserve(out.Capacity() + std::max<size_t>(out.Capacity() / 2, 4096)))
+                return false;
+
+            stream.next_out = out.Data() + out.Size();
+            stream.avail_out = static_cast<uInt>(out.Capacity() - out.Size());
+
+            int result = deflate(&stream, flush);
+            out.Resize(out.Capacity() - stream.avail_out);
+
+            if (result == Z_STREAM_ERROR)
+                return false;
+            if (flush == Z_FINISH)
+            {
+                if (result == Z_STREAM_END)
+                    return true;
+                continue;
+            }
+            if (stream.avail_in == 0 && stream.avail_out != 0)
+                return true;
+        }
+    }
+
+    // 0 번 row 이전에서 이어받는 상태. tile 단위로 나눠 인코딩할 때 앞 tile 의 끝을 기억한다
+    struct Carry
+    {
+        std::vector<uint8_t> prior;         // 0 번 row 의 prior row. 비어 있으면 0 (이미지 시작)
+        std::vector<uint8_t> dictionary;    // 0 번 row 직전까지 filter 된 byte (최대 32KB)
+    };
+
+    // firstRow 의 prior row 를 만들고, dictionary 가 있으면 그 앞 32KB 의 filter 된 byte 도 만든다
+    void prepareContext(const ImageView& image, int firstRow, const Layout& layout, PngEncoder::Preset preset,
+                        const Carry& carry, std::vector<uint8_t>& prior, std::vector<uint8_t>* dictionary)
+    {
+        const size_t filteredBytes = layout.rowBytes + 1;
+
+        int startRow = firstRow;
+        if (dictionary)
+            startRow = std::max(0, firstRow - static_cast<int>(DICTIONARY_SIZE / filteredBytes) - 1);
+
+        std::vector<uint8_t> scratch(static_cast<size_t>(layout.width) * 4);
+        prior.resize(layout.rowBytes);
+        if (startRow > 0)
+            prepareRow(image, startRow - 1, layout, scratch.data(), prior.data());
+        else if (!carry.prior.empty())
+            prior = carry.prior;
+        else
+            std::fill(prior.begin(), prior.end(), 0);
+
+        if (dictionary == nullptr)
+            return;
+
+        dictionary->clear();
+        if (startRow == 0)
+            dictionary->assign(carry.dictionary.begin(), carry.dictionary.end());
+
+        std::vector<uint8_t> current(layout.rowBytes);
+        std::vector<uint8_t> filtered(filteredBytes);
+        std::vector<uint8_t> candidates;
+        for (int y = startRow; y < firstRow; ++y)
+        {
+            prepareRow(image, y, layout, scratch.data(), current.data());
+            filterRow(preset, current.data(), prior.data(), layout, candidates, filtered.data());
+            dictionary->insert(dictionary->end(), filtered.begin(), filtered.end());
+            prior.swap(current);
+        }
+
+        if (dictionary->size() > DICTIONARY_SIZE)
+            dictionary->erase(dictionary->begin(), dictionary->end() - DICTIONARY_SIZE);
+    }
+
+    bool compressBand(const ImageView& image, const Layout& layout, PngEncoder::Preset preset, const DeflateParams& params,
+                      const Carry& carry, bool isLast, const CancellationToken* token, Band& band)
+    {
+        const size_t filteredBytes = layout.rowBytes + 1;
+        Trace::Span span("png band");
+
+        z_stream stream = {};
+        if (deflateInit2(&stream, params.level, Z_DEFLATED, -15, 8, params.strategy) != Z_OK)
+            return false;
+
+        // 앞 band 의 마지막 32KB 를 dictionary 로 주면 band 경계에서도 압축률이 유지된다
+        std::vector<uint8_t> prior;
+        std::vector<uint8_t> dictionary;
+        prepareContext(image, band.firstRow, layout, preset, carry, prior, params.useDictionary ? &dictionary : nullptr);
+        if (!dictionary.empty())
+            deflateSetDictionary(&stream, dictionary.data(), static_cast<uInt>(dictionary.size()));
+
+        std::vector<uint8_t> current(layout.rowBytes);
+        std::vector<uint8_t> scratch(static_cast<size_t>(layout.width) * 4);
+        std::vector<uint8_t> filtered(filteredBytes);
+        std::vector<uint8_t> candidates;
+
+        band.rawBytes = filteredBytes * band.rowCount;
+        band.adler = adler32(0L, Z_NULL, 0);
+        // 대부분 한 번에 들어가도록 잡되, 0 으로 채우지 않으므로 쓰지 않은 page 는 건드리지 않는다
+        bool ok = band.data.Reserve(deflateBound(&stream, static_cast<uLong>(band.rawBytes)) + 64);
+        for (int i = 0; i < band.rowCount && ok; ++i)
+        {
+            if (token && i % CANCEL_CHECK_ROWS == 0 && token->IsCanceled())
+            {
+                ok = false;
+                break;
+            }
+
+            prepareRow(image, band.firstRow + i, layout, scratch.data(), current.data());
+            filterRow(preset, current.data(), prior.data(), layout, candidates, filtered.data());
+            band.adler = adler32(band.adler, filtered.data(), static_cast<uInt>(filteredBytes));
+
+            stream.next_in = filtered.data();
+            stream.avail_in = static_cast<uInt>(filteredBytes);
+            ok = deflateInto(stream, band.data, Z_NO_FLUSH);
+
+            prior.swap(current);
+        }
+
+        // 마지막 band 만 stream 을 닫고 나머지는 byte 경계로 flush 해서 이어 붙인다
+        if (ok)
+            ok = deflateInto(stream, band.data, isLast ? Z_FINISH : Z_SYNC_FLUSH);
+
+        deflateEnd(&stream);
+        span.SetBytes(band.data.Size());
+        return ok;
+    }
+
+    bool isOpaqueRow(const ImageView& image, int y)
+    {
+        const uint8_t* row = image.ConstScanLine(y);
+        uint8_t alpha = 0xFF;
+        for (int x = 0; x < image.width; ++x)
+            alpha &= row[x * 4 + 3];
+
+        return alpha == 0xFF;
+    }
+
+    bool isOpaque(const ImageView& image, ThreadPool* pool)
+    {
+        if (!PixelConverter::HasAlpha(image.format))
+            return true;
+
+        std::atomic<bool> opaque(true);
+        auto scan = [&image, &opaque](int begin, int end)
+        {
+            for (int y = begin; y < end && opaque.load(std::memory_order_relaxed); ++y)
+            {
+                if (!isOpaqueRow(image, y))
+                    opaque.store(false, std::memory_order_relaxed);
+            }
+        };
+
+        if (pool)
+            pool->ParallelFor(0, image.height, 64, scan);
+        else
+            scan(0, image.height);
+
+        return opaque.load();
+    }
+
+    class ChunkWriter
+    {
+    public:
+        explicit ChunkWriter(const PngEncoder::Sink& sink)
+            : sink_(sink)
+            , crc_(0)
+            , ok_(true)
+        {}
+
+        void Begin(const char* type, uint32_t length)
+        {
+            uint8_t header[8];
+            writeUint32(header, length);
+            std::memcpy(header + 4, type, 4);
+            crc_ = crc32(0L, Z_NULL, 0);
+            write(header, 4);
+            Data(header + 4, 4);
+        }
+
+        void Data(const uint8_t* data, size_t size)
+        {
+            crc_ = crc32(crc_, data, static_cast<uInt>(size));
+            write(data, size);
+        }
+
+        // crc 를 이미 알고 있는 data. 다시 계산하지 않고 합친다
+        void Data(const uint8_t* data, size_t size, uLong crc)
+        {
+            crc_ = crc32_combine(crc_, crc, static_cast<z_off_t>(size));
+            write(data, size);
+        }
+
+        void End()
+        {
+            uint8_t crc[4];
+            writeUint32(crc, static_cast<uint32_t>(crc_));
+            write(crc, 4);
+        }
+
+        void Raw(const uint8_t* data, size_t size)
+        {
+            write(data, size);
+        }
+
+        bool IsOk() const
+        {
+            return ok_;
+        }
+
+    private:
+        void write(const uint8_t* data, size_t size)
+        {
+            if (ok_ && size > 0)
+                ok_ = sink_(data, size);
+        }
+
+    private:
+        const PngEncoder::Sink& sink_;
+        uLong crc_;
+        bool ok_;
+    };
+
+    void writeHeader(ChunkWriter& writer, int width, int height, bool hasAlpha)
+    {
+        writer.Raw(PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+
+        uint8_t ihdr[13];
+        writeUint32(ihdr, static_cast<uint32_t>(width));
+        writeUint32(ihdr + 4, static_cast<uint32_t>(height));
+        ihdr[8] = 8;                    // bit depth
+        ihdr[9] = hasAlpha ? 6 : 2;     // RGBA : RGB
+        ihdr[10] = 0;
+        ihdr[11] = 0;
+        ihdr[12] = 0;
+        writer.Begin("IHDR", sizeof(ihdr));
+        writer.Data(ihdr, sizeof(ihdr));
+        writer.End();
+    }
+
+    int rowsPerBandFor(const PngEncoder::Options& options, size_t rowBytes, size_t targetBandBytes)
+    {
+        if (options.rowsPerBand > 0)
+            return options.rowsPerBand;
+
+        return std::max(MIN_ROWS_PER_BAND, static_cast<int>(targetBandBytes / (rowBytes + 1)));
+    }
+}
+
+PngEncoder::Options::Options()
+    : preset(Preset::Fast)
+    , rowsPerBand(0)
+    , detectOpaque(true)
+{}
+
+PngEncoder::PngEncoder(const Options& options, ThreadPool* pool, BufferPool* buffers)
+    : options_(options)
+    , pool_(pool)
+    , buffers_(buffers)
+{}
+
+bool PngEncoder::Encode(const ImageView& image, const Sink& sink, const CancellationToken* token) const
+{
+    if (image.bits == nullptr || image.width <= 0 || image.height <= 0)
+        return false;
+
+    bool hasAlpha = PixelConverter::HasAlpha(image.format);
+    if (hasAlpha && options_.detectOpaque && isOpaque(image, pool_))
+        hasAlpha = false;
+
+    // 전체 이미지를 tile 하나로 넣는 것과 같다
+    PngStreamEncoder encoder(options_, pool_, buffers_);
+    return encoder.Begin(image.width, image.height, hasAlpha, sink)
+        && encoder.AddRows(image, token)
+        && encoder.Finish();
+}
+
+const char* PngEncoder::PresetName(PngEncoder::Preset preset)
+{
+    switch (preset)
+    {
+        case Preset::Fastest:
+            return "Fastest";
+        case Preset::Fast:
+            return "Fast";
+        case Preset::Smallest:
+            return "Smallest";
+        default:
+            return "Balanced";
+    }
+}
+
+// PngStreamEncoder
+
+struct PngStreamEncoder::State
+{
+    State(const PngEncoder::Options& options, ThreadPool* pool, BufferPool* buffers)
+        : options(options)
+        , pool(pool)
+        , buffers(buffers)
+        , params(deflateParamsFor(options.preset))
+        , sink()
+        , writer()
+        , layout()
+        , carry()
+        , adler(adler32(0L, Z_NULL, 0))
+        , rowsWritten(0)
+        , started(false)
+        , ok(true)
+    {}
+
+    PngEncoder::Options options;
+    ThreadPool* pool;
+    BufferPool* buffers;
+    DeflateParams params;
+    PngEncoder::Sink sink;
+    std::unique_ptr<ChunkWriter> writer;
+    Layout layout;
+    Carry carry;
+    uLong adler;
+    int rowsWritten;
+    bool started;
+    bool ok;
+};
+
+PngStreamEncoder::PngStreamEncoder(const PngEncoder::Options& options, ThreadPool* pool, BufferPool* buffers)
+    : state_(std::make_unique<State>(options, pool, buffers))
+{}
+
+PngStreamEncoder::~PngStreamEncoder()
+{}
+
+bool PngStreamEncoder::Begin(int width, int height, bool hasAlpha, const PngEncoder::Sink& sink)
+{
+    State& state = *state_;
+    if (state.started || width <= 0 || height <= 0)
+        return false;
+
+    state.started = true;
+    state.sink = sink;
+    state.writer = std::make_unique<ChunkWriter>(state.sink);
+
+    state.layout.width = width;
+    state.layout.height = height;
+    state.layout.bpp = hasAlpha ? 4 : 3;
+    state.layout.rowBytes = static_cast<size_t>(width) * state.layout.bpp;
+
+    ChunkWriter& writer = *state.writer;
+    writeHeader(writer, width, height, hasAlpha);
+
+    state.ok = writer.IsOk();
+    return state.ok;
+}
+
+bool PngStreamEncoder::AddRows(const ImageView& rows, const CancellationToken* token)
+{
+    State& state = *state_;
+    const Layout& layout = state.layout;
+    if (!state.started || !state.ok)
+        return false;
+    if (rows.bits == nullptr || rows.width != layout.width || rows.height <= 0 || state.rowsWritten + rows.height > layout.height)
+        return false;
+
+    const int rowsPerBand = std::min(rowsPerBandFor(state.options, layout.rowBytes, TARGET_BAND_BYTES), rows.height);
+
+    const bool isFinalRows = state.rowsWritten + rows.height == layout.height;
+    const int bandCount = (rows.height + rowsPerBand - 1) / rowsPerBand;
+    std::vector<Band> bands(bandCount);
+    for (int i = 0; i < bandCount; ++i)
+    {
+        bands[i].firstRow = i * rowsPerBand;
+        bands[i].rowCount = std::min(rowsPerBand, rows.height - bands[i].firstRow);
+        bands[i].data = ByteBuffer(state.buffers);
+        bands[i].ok = false;
+    }
+
+    const PngEncoder::Preset preset = state.options.preset;
+    auto compress = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            bool isLast = isFinalRows && i == bandCount - 1;
+            bands[i].ok = compressBand(rows, layout, preset, state.params, state.carry, isLast, token, bands[i]);
+        }
+    };
+
+    if (state.pool)
+        state.pool->ParallelFor(0, bandCount, 1, compress);
+    else
+        compress(0, bandCount);
+
+    for (const Band& band : bands)
+    {
+        if (!band.ok)
+        {
+            state.ok = false;
+            return false;
+        }
+    }
+
+    // band 하나가 IDAT 하나. 첫 IDAT 에 zlib header, 마지막 IDAT 에 adler32 를 붙인다
+    ChunkWriter& writer = *state.writer;
+    const uint8_t zlibHeader[2] = { 0x78, state.params.zlibFlags };
+    for (int i = 0; i < bandCount; ++i)
+    {
+        Band& band = bands[i];
+        state.adler = adler32_combine(state.adler, band.adler, static_cast<z_off_t>(band.rawBytes));
+
+        bool isFirst = state.rowsWritten == 0 && i == 0;
+        bool isLast = isFinalRows && i == bandCount - 1;
+        size_t length = band.data.Size() + (isFirst ? 2 : 0) + (isLast ? 4 : 0);
+
+        writer.Begin("IDAT", static_cast<uint32_t>(length));
+        if (isFirst)
+            writer.Data(zlibHeader, sizeof(zlibHeader));
+        writer.Data(band.data.ConstData(), band.data.Size());
+        if (isLast)
+        {
+            uint8_t trailer[4];
+            writeUint32(trailer, static_cast<uint32_t>(state.adler));
+            writer.Data(trailer, sizeof(trailer));
+        }
+        writer.End();
+
+        // 압축 결과는 바로 내보내고 pool 에 돌려줘서 tile 크기 이상 쌓이지 않게 한다
+        band.data.Clear();
+    }
+
+    // 다음 tile 의 첫 row 가 이어서 filter 되고 같은 dictionary 를 쓰도록 끝 상태를 남긴다
+    if (!isFinalRows)
+    {
+        Carry next;
+        prepareContext(rows, rows.height, layout, preset, state.carry, next.prior, state.params.useDictionary ? &next.dictionary : nullptr);
+        state.carry = std::move(next);
+    }
+
+    state.rowsWritten += rows.height;
+    state.ok = writer.IsOk();
+    return state.ok;
+}
+
+bool PngStreamEncoder::Finish()
+{
+    State& state = *state_;
+    if (!state.started || !state.ok || state.rowsWritten != state.layout.height)
+        return false;
+
+    ChunkWriter& writer = *state.writer;
+    writer.Begin("IEND", 0);
+    writer.End();
+
+    state.ok = writer.IsOk();
+    return state.ok;
+}
+
+int PngStreamEncoder::RowsWritten() const
+{
+    return state_->rowsWritten;
+}
+
+// IncrementalPngEncoder
+
+struct IncrementalPngEncoder::State
+{
+    struct CachedBand
+    {
+        Band band;
+        uLong crc;
+        bool opaque;
+    };
+
+    State(const PngEncoder::Options& options, ThreadPool* pool, BufferPool* buffers)
+        : options(options)
+        , pool(pool)
+        , buffers(buffers)
+        , width(0)
+        , height(0)
+        , format(PixelConverter::Format::BGRA)
+        , hasAlpha(false)
+        , rowsPerBand(0)
+        , bands()
+        , stats()
+    {}
+
+    void Clear()
+    {
+        width = 0;
+        height = 0;
+        rowsPerBand = 0;
+        bands.clear();
+    }
+
+    PngEncoder::Options options;
+    ThreadPool* pool;
+    BufferPool* buffers;
+    int width;
+    int height;
+    PixelConverter::Format format;
+    bool hasAlpha;
+    int rowsPerBand;
+    std::vector<CachedBand> bands;
+    Stats stats;
+};
+
+IncrementalPngEncoder::IncrementalPngEncoder(const PngEncoder::Options& options, ThreadPool* pool, BufferPool* buffers)
+    : state_(std::make_unique<State>(options, pool, buffers))
+{}
+
+IncrementalPngEncoder::~IncrementalPngEncoder()
+{}
+
+bool IncrementalPngEncoder::Encode(const ImageView& image, const std::vector<RowRange>& changedRows, const PngEncoder::Sink& sink,
+                                   const CancellationToken* token)
+{
+    State& state = *state_;
+    state.stats = Stats();
+    if (image.bits == nullptr || image.width <= 0 || image.height <= 0)
+        return false;
+
+    // band 나누는 기준은 alpha 와 관계없이 정해야 이전 band 와 맞춰 볼 수 있다
+    const int rowsPerBand = rowsPerBandFor(state.options, static_cast<size_t>(image.width) * 4, INCREMENTAL_TARGET_BAND_BYTES);
+    const int bandCount = (image.height + rowsPerBand - 1) / rowsPerBand;
+
+    const bool reuse = state.width == image.width && state.height == image.height && state.format == image.format
+        && state.rowsPerBand == rowsPerBand && static_cast<int>(state.bands.size()) == bandCount;
+
+    std::vector<uint8_t> dirty(static_cast<size_t>(bandCount), reuse ? 0 : 1);
+    if (reuse)
+    {
+        for (const RowRange& range : changedRows)
+        {
+            int begin = std::max(0, range.begin);
+            int end = std::min(image.height, range.end);
+            if (begin >= end)
+                continue;
+
+            // band 의 첫 row 는 바로 위 row 를 참조해서 filter 되므로 다음 band 도 다시 압축해야 할 수 있다
+            int last = std::min(bandCount - 1, end / rowsPerBand);
+            for (int i = begin / rowsPerBand; i <= last; ++i)
+                dirty[i] = 1;
+
+            state.stats.changedRows += end - begin;
+        }
+    }
+    else
+    {
+        state.bands.clear();
+        state.bands.resize(bandCount);
+        state.stats.changedRows = image.height;
+    }
+
+    // 바뀐 band 의 불투명 여부만 다시 확인
+    const bool checkOpaque = state.options.detectOpaque && PixelConverter::HasAlpha(image.format);
+    auto scan = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            if (!dirty[i])
+                continue;
+
+            State::CachedBand& cached = state.bands[i];
+            cached.band.firstRow = i * rowsPerBand;
+            cached.band.rowCount = std::min(rowsPerBand, image.height - cached.band.firstRow);
+            cached.opaque = true;
+            for (int y = 0; y < cached.band.rowCount && cached.opaque; ++y)
+                cached.opaque = isOpaqueRow(image, cached.band.firstRow + y);
+        }
+    };
+    if (checkOpaque)
+    {
+        if (state.pool)
+            state.pool->ParallelFor(0, bandCount, 1, scan);
+        else
+            scan(0, bandCount);
+    }
+
+    bool hasAlpha = PixelConverter::HasAlpha(image.format);
+    if (checkOpaque)
+    {
+        hasAlpha = std::any_of(state.bands.begin(), state.bands.end(), [](const State::CachedBand& cached)
+        {
+            return !cached.opaque;
+        });
+    }
+
+    // RGB 와 RGBA 가 바뀌면 모든 band 를 다시 압축
+    if (reuse && hasAlpha != state.hasAlpha)
+        std::fill(dirty.begin(), dirty.end(), 1);
+
+    Layout layout;
+    layout.width = image.width;
+    layout.height = image.height;
+    layout.bpp = hasAlpha ? 4 : 3;
+    layout.rowBytes = static_cast<size_t>(image.width) * layout.bpp;
+
+    DeflateParams params = deflateParamsFor(state.options.preset);
+    params.useDictionary = false;
+
+    const PngEncoder::Preset preset = state.options.preset;
+    const Carry carry;
+    auto compress = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            if (!dirty[i])
+                continue;
+
+            State::CachedBand& cached = state.bands[i];
+            Band& band = cached.band;
+            band.firstRow = i * rowsPerBand;
+            band.rowCount = std::min(rowsPerBand, image.height - band.firstRow);
+            band.data = ByteBuffer(state.buffers);
+            band.ok = compressBand(image, layout, preset, params, carry, i == bandCount - 1, token, band);
+            if (band.ok)
+                cached.crc = crc32(crc32(0L, Z_NULL, 0), band.data.ConstData(), static_cast<uInt>(band.data.Size()));
+        }
+    };
+
+    if (state.pool)
+        state.pool->ParallelFor(0, bandCount, 1, compress);
+    else
+        compress(0, bandCount);
+
+    for (int i = 0; i < bandCount; ++i)
+    {
+        if (dirty[i] && !state.bands[i].band.ok)
+        {
+            state.Clear();
+            return false;
+        }
+    }
+
+    state.width = image.width;
+    state.height = image.height;
+    state.format = image.format;
+    state.hasAlpha = hasAlpha;
+    state.rowsPerBand = rowsPerBand;
+    state.stats.bandCount = bandCount;
+    state.stats.encodedBands = static_cast<int>(std::count(dirty.begin(), dirty.end(), 1));
+
+    // 압축 결과는 그대로 두고 chunk 만 다시 쓴다. IDAT 의 crc 는 band 의 crc 를 합쳐서 만든다
+    ChunkWriter writer(sink);
+    writeHeader(writer, image.width, image.height, hasAlpha);
+
+    const uint8_t zlibHeader[2] = { 0x78, params.zlibFlags };
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (int i = 0; i < bandCount; ++i)
+    {
+        const State::CachedBand& cached = state.bands[i];
+        const Band& band = cached.band;
+        adler = adler32_combine(adler, band.adler, static_cast<z_off_t>(band.rawBytes));
+
+        bool isFirst = i == 0;
+        bool isLast = i == bandCount - 1;
+        size_t length = band.data.Size() + (isFirst ? 2 : 0) + (isLast ? 4 : 0);
+
+        writer.Begin("IDAT", static_cast<uint32_t>(length));
+        if (isFirst)
+            writer.Data(zlibHeader, sizeof(zlibHeader));
+        writer.Data(band.data.ConstData(), band.data.Size(), cached.crc);
+        if (isLast)
+        {
+            uint8_t trailer[4];
+            writeUint32(trailer, static_cast<uint32_t>(adler));
+            writer.Data(trailer, sizeof(trailer));
+        }
+        writer.End();
+    }
+
+    writer.Begin("IEND", 0);
+    writer.End();
+
+    if (!writer.IsOk())
+    {
+        state.Clear();
+        return false;
+    }
+    return true;
+}
+
+void IncrementalPngEncoder::Reset()
+{
+    state_->Clear();
+}
+
+void IncrementalPngEncoder::SetOptions(const PngEncoder::Options& options)
+{
+    State& state = *state_;
+    if (state.options.preset != options.preset || state.options.rowsPerBand != options.rowsPerBand
+        || state.options.detectOpaque != options.detectOpaque)
+        state.Clear();
+
+    state.options = options;
+}
+
+IncrementalPngEncoder::Stats IncrementalPngEncoder::LastStats() const
+{
+    return state_->stats;
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "framediff.h"
+#include "pixelbuffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class BufferPool;
+class CancellationToken;
+class ThreadPool;
+
+// 32bpp 픽셀을 PNG 로 인코딩한다.
+// row band 별로 독립적으로 압축(sync flush)한 뒤 하나의 zlib stream 으로 이어 붙이므로 band 들을 병렬로 처리할 수 있다
+class PngEncoder
+{
+public:
+    enum class Preset
+    {
+        Fastest,    // filter 없음 + huffman 만 사용 (거의 stored), 로컬 clipboard 전달용
+        Fast,       // Sub/Up 중 빠른 추정으로 선택 + RLE
+        Balanced,   // 5 개 filter 중 최소 합 선택 + 기본 압축
+        Smallest,   // 5 개 filter 중 최소 합 선택 + 최대 압축
+    };
+
+    struct Options
+    {
+        Options();
+
+        Preset preset;
+        int rowsPerBand;    // 0 이면 자동
+        bool detectOpaque;  // 모든 픽셀이 불투명하면 RGB 로 저장
+    };
+
+    using Sink = std::function<bool(const uint8_t* data, size_t size)>;
+
+public:
+    // buffers 가 있으면 band 별 압축 버퍼를 거기서 빌린다
+    explicit PngEncoder(const Options& options = Options(), ThreadPool* pool = nullptr, BufferPool* buffers = nullptr);
+
+public:
+    bool Encode(const ImageView& image, const Sink& sink, const CancellationToken* token = nullptr) const;
+
+    static const char* PresetName(Preset preset);
+
+private:
+    Options options_;
+    ThreadPool* pool_;
+    BufferPool* buffers_;
+};
+
+// 전체 이미지를 메모리에 두지 않고 위쪽부터 row 묶음(tile) 단위로 인코딩한다.
+// Begin → AddRows (여러 번) → Finish 순서로 호출하며, 결과는 한 번에 Encode 한 것과 같다
+class PngStreamEncoder
+{
+public:
+    explicit PngStreamEncoder(const PngEncoder::Options& options = PngEncoder::Options(), ThreadPool* pool = nullptr,
+                              BufferPool* buffers = nullptr);
+    ~PngStreamEncoder();
+
+    PngStreamEncoder(const PngStreamEncoder&) = delete;
+    PngStreamEncoder& operator=(const PngStreamEncoder&) = delete;
+
+public:
+    // hasAlpha 가 false 면 RGB 로 저장 (미리 전체를 볼 수 없으므로 불투명 검사는 하지 않는다)
+    bool Begin(int width, int height, bool hasAlpha, const PngEncoder::Sink& sink);
+    // rows 는 앞에서 넣은 row 바로 다음부터 이어지는 row 들
+    bool AddRows(const ImageView& rows, const CancellationToken* token = nullptr);
+    bool Finish();
+
+    int RowsWritten() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+// 같은 크기의 이미지를 반복해서 인코딩할 때 앞서 인코딩한 이미지와 달라진 row band 만 다시 압축한다.
+// band 는 dictionary 없이 각각 flush 한 deflate block 이라서 바뀌지 않은 band 의 압축 결과는 그대로 이어 붙인다
+class IncrementalPngEncoder
+{
+public:
+    struct Stats
+    {
+        int bandCount;
+        int encodedBands;   // 이번에 다시 압축한 band
+        int changedRows;
+    };
+
+public:
+    explicit IncrementalPngEncoder(const PngEncoder::Options& options = PngEncoder::Options(), ThreadPool* pool = nullptr,
+                                   BufferPool* buffers = nullptr);
+    ~IncrementalPngEncoder();
+
+    IncrementalPngEncoder(const IncrementalPngEncoder&) = delete;
+    IncrementalPngEncoder& operator=(const IncrementalPngEncoder&) = delete;
+
+public:
+    // changedRows 는 앞서 Encode 한 이미지와 달라진 row. 처음이거나 크기, 포맷, 옵션이 다르면 전체를 인코딩한다
+    bool Encode(const ImageView& image, const std::vector<RowRange>& changedRows, const PngEncoder::Sink& sink,
+                const CancellationToken* token = nullptr);
+
+    // 다음 Encode 는 전체를 인코딩한다 (압축 결과도 해제)
+    void Reset();
+    void SetOptions(const PngEncoder::Options& options);
+
+    Stats LastStats() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
\ No newline at end of file
@@ -0,0 +1,621 @@
+#include "segmentlogsink.h"
+
+#include "zlibsupport.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const uint64_t DEFAULT_SEGMENT_BYTES = 1024 * 1024; // 1MB
+    const int DEFAULT_GENERATIONS = 5;
+    const int DEFAULT_COMPRESSION_LEVEL = 6;
+    const size_t COMPRESS_CHUNK_BYTES = 64 * 1024;
+    const char* const COMPRESSED_SUFFIX = ".gz";
+    const char* const TEMPORARY_SUFFIX = ".tmp";
+
+    // 마지막 줄바꿈까지. text 로그에는 0 이 없으므로 첫 byte 를 쓰지 못한 batch (0) 앞에서 멈춘다
+    size_t lastLineLength(const char* data, size_t size)
+    {
+        const void* zero = std::memchr(data, '\0', size);
+        if (zero != nullptr)
+            size = static_cast<size_t>(static_cast<const char*>(zero) - data);
+        while (size != 0 && data[size - 1] != '\n')
+            --size;
+        return size;
+    }
+
+    uint32_t currentProcessId()
+    {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+        return static_cast<uint32_t>(getpid());
+#endif
+    }
+
+    // <stem>.<번호><extension>[.gz] 이면 번호를 돌려준다
+    bool parseSegmentName(const std::string& name, const std::string& stem, const std::string& extension, uint64_t* sequence, bool* compressed)
+    {
+        std::string rest = name;
+        *compressed = rest.size() > 3 && rest.compare(rest.size() - 3, 3, COMPRESSED_SUFFIX) == 0;
+        if (*compressed)
+            rest.resize(rest.size() - 3);
+
+        if (rest.size() <= stem.size() + 1 + extension.size()
+            || rest.compare(0, stem.size(), stem) != 0 || rest[stem.size()] != '.'
+            || rest.compare(rest.size() - extension.size(), extension.size(), extension) != 0)
+            return false;
+
+        const std::string digits = rest.substr(stem.size() + 1, rest.size() - stem.size() - 1 - extension.size());
+        if (digits.empty() || digits.size() > 18 || !std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; }))
+            return false;
+
+        *sequence = std::stoull(digits);
+        return true;
+    }
+}
+
+// 열린 segment 와 그 view
+struct SegmentLogSink::MappedFile
+{
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    char* data = nullptr;
+    uint64_t size = 0;
+
+    // 파일이 bytes 보다 작으면 늘려서 (늘어난 곳은 0) 통째로 map 한다.
+    // 다른 인스턴스와 같은 곳을 덮어쓰지 않도록 혼자 연다 (읽기만 공유). 이미 누가 쓰고 있으면 busy
+    bool Open(const fs::path& path, uint64_t bytes, uint64_t* fileBytes, bool* busy)
+    {
+        *busy = false;
+#ifdef _WIN32
+        file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                           nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            *busy = GetLastError() == ERROR_SHARING_VIOLATION;
+            return false;
+        }
+
+        LARGE_INTEGER current;
+        if (!GetFileSizeEx(file, &current))
+        {
+            Close(UINT64_MAX);
+            return false;
+        }
+        *fileBytes = static_cast<uint64_t>(current.QuadPart);
+        return Map(std::max(bytes, *fileBytes));
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return false;
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+        {
+            *busy = errno == EWOULDBLOCK;
+            Close(UINT64_MAX);
+            return false;
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) != 0)
+        {
+            Close(UINT64_MAX);
+            return false;
+        }
+        *fileBytes = static_cast<uint64_t>(status.st_size);
+        return Map(std::max(bytes, *fileBytes));
+#endif
+    }
+
+    bool Map(uint64_t bytes)
+    {
+#ifdef _WIN32
+        // 파일보다 크게 만든 mapping 은 파일을 그만큼 늘린다
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), nullptr);
+        if (mapping == nullptr)
+            return false;
+
+        data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(bytes)));
+        if (data == nullptr)
+        {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+#else
+        struct stat status;
+        if (fstat(fd, &status) != 0 || (static_cast<uint64_t>(status.st_size) < bytes && ftruncate(fd, static_cast<off_t>(bytes)) != 0))
+            return false;
+
+        void* view = mmap(nullptr, static_cast<size_t>(bytes), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED)
+            return false;
+        data = static_cast<char*>(view);
+#endif
+        size = bytes;
+        return true;
+    }
+
+    void Unmap()
+    {
+#ifdef _WIN32
+        if (data != nullptr)
+            UnmapViewOfFile(data);
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        if (data != nullptr)
+            munmap(data, static_cast<size_t>(size));
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    // UINT64_MAX 이면 크기는 그대로 둔다
+    void Close(uint64_t truncateTo)
+    {
+        Unmap();
+#ifdef _WIN32
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        if (truncateTo != UINT64_MAX)
+        {
+            LARGE_INTEGER position;
+            position.QuadPart = static_cast<LONGLONG>(truncateTo);
+            if (SetFilePointerEx(file, position, nullptr, FILE_BEGIN))
+                SetEndOfFile(file);
+        }
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (fd < 0)
+            return;
+        if (truncateTo != UINT64_MAX && ftruncate(fd, static_cast<off_t>(truncateTo)) != 0)
+        {
+            // 못 줄이면 끝이 0 으로 남고 다음에 열 때 recover 가 잘라 낸다
+        }
+        ::close(fd);
+        fd = -1;
+#endif
+    }
+};
+
+// Options struct
+
+SegmentLogSink::Options::Options()
+    : segmentBytes(DEFAULT_SEGMENT_BYTES)
+    , generations(DEFAULT_GENERATIONS)
+    , compressionLevel(DEFAULT_COMPRESSION_LEVEL)
+    , preamble()
+    , completeLength()
+{}
+
+// Public
+
+SegmentLogSink::SegmentLogSink(const std::string& path, const Options& options)
+    : path_(path)
+    , defaultStem_()
+    , stem_()
+    , extension_()
+    , options_(options)
+    , file_()
+    , offset_(0)
+    , preambleEnd_(0)
+    , nextSequence_(1)
+    , compressMutex_()
+    , compressCondition_()
+    , compressQueue_()
+    , stopping_(false)
+    , compressor_()
+    , rotations_(0)
+    , compressed_(0)
+    , compressFailures_(0)
+    , recoveredSegments_(0)
+    , discardedBytes_(0)
+{
+    options_.segmentBytes = std::max<uint64_t>(options_.segmentBytes, 4096);
+    options_.generations = std::max(options_.generations, 0);
+
+    const fs::path file = fs::u8path(path_);
+    stem_ = (file.parent_path() / file.stem()).u8string();
+    defaultStem_ = stem_;
+    extension_ = file.extension().u8string();
+
+    std::error_code error;
+    if (file.has_parent_path())
+        fs::create_directories(file.parent_path(), error);
+}
+
+SegmentLogSink::~SegmentLogSink()
+{
+    close();
+
+    {
+        std::lock_guard<std::mutex> lock(compressMutex_);
+        stopping_ = true;
+    }
+    compressCondition_.notify_all();
+    if (compressor_.joinable())
+        compressor_.join();
+}
+
+bool SegmentLogSink::Write(const char* data, size_t size)
+{
+    if (!file_ && !open())
+        return false;
+
+    if (offset_ + size > file_->size)
+    {
+        // record 가 있는 segment 만 넘긴다. 넘기지 못했거나 batch 하나가 segment 보다 크면 늘려서 쓴다
+        if (offset_ > preambleEnd_ && !rotate())
+            return false;
+        if (offset_ + size > file_->size && !grow(offset_ + size))
+            return false;
+    }
+
+    return append(data, size);
+}
+
+SegmentLogSink::Stats SegmentLogSink::GetStats() const
+{
+    Stats stats;
+    stats.rotations = rotations_.load(std::memory_order_relaxed);
+    stats.compressed = compressed_.load(std::memory_order_relaxed);
+    stats.compressFailures = compressFailures_.load(std::memory_order_relaxed);
+    stats.recoveredSegments = recoveredSegments_.load(std::memory_order_relaxed);
+    stats.discardedBytes = discardedBytes_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Private
+
+bool SegmentLogSink::open()
+{
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    uint64_t fileBytes = 0;
+    bool busy = false;
+    if (!file->Open(fs::u8path(path_), options_.segmentBytes, &fileBytes, &busy))
+    {
+        file->Close(UINT64_MAX);
+        // 같은 appId 의 다른 인스턴스가 쓰고 있으면 한 번만 프로세스별 이름으로 옮긴다.
+        // 번호 segment 로 읽히지 않는 이름이라 그 인스턴스가 넘기거나 지우지 않는다
+        if (!busy || compressor_.joinable() || stem_ != defaultStem_)
+            return false;
+
+        stem_ += ".pid" + std::to_string(currentProcessId());
+        path_ = stem_ + extension_;
+        return open();
+    }
+
+    // 번호는 쓸 파일이 정해진 뒤에 한 번만 찾는다
+    if (!compressor_.joinable())
+    {
+        scanSegments();
+        compressor_ = std::thread(&SegmentLogSink::runCompressor, this);
+    }
+
+    file_ = std::move(file);
+    offset_ = 0;
+    recover(fileBytes);
+
+    if (options_.preamble)
+    {
+        const std::string preamble = options_.preamble();
+        if (offset_ + preamble.size() > file_->size && !grow(offset_ + preamble.size()))
+            return false;
+        append(preamble.data(), preamble.size());
+    }
+    preambleEnd_ = offset_;
+    return true;
+}
+
+void SegmentLogSink::close()
+{
+    if (!file_)
+        return;
+
+    // 미리 잡아 둔 빈 자리를 잘라 낸다
+    file_->Close(offset_);
+    file_.reset();
+}
+
+bool SegmentLogSink::rotate()
+{
+    std::error_code error;
+    const std::string rotated = stem_ + "." + std::to_string(nextSequence_) + extension_;
+#ifdef _WIN32
+    // 읽기만 공유해 연 파일은 이름을 바꿀 수 없어 닫고 바꾼다
+    close();
+    fs::rename(fs::u8path(path_), fs::u8path(rotated), error);
+    if (error && !reopen())
+        return false;
+#else
+    // 잠금을 쥔 채로 바꿔 그 사이 다른 인스턴스가 이 파일을 잡지 못하게 한다
+    fs::rename(fs::u8path(path_), fs::u8path(rotated), error);
+    if (!error)
+        close();
+#endif
+
+    if (error)
+    {
+        // 이름을 못 바꿨으면 (다른 프로그램이 열고 있는 등) preamble 없이 늘려서 같은 파일에 이어 쓰고,
+        // segmentBytes 만큼 더 써서 다시 찼을 때 다시 넘긴다
+        return grow(offset_ + options_.segmentBytes);
+    }
+
+    ++nextSequence_;
+    rotations_.fetch_add(1, std::memory_order_relaxed);
+    queueCompression(rotated);
+    return open();
+}
+
+bool SegmentLogSink::reopen()
+{
+    // close 가 쓴 만큼으로 줄여 두었으므로 recover, preamble 없이 끝에 이어 쓴다
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    uint64_t fileBytes = 0;
+    bool busy = false;
+    if (!file->Open(fs::u8path(path_), offset_, &fileBytes, &busy))
+    {
+        file->Close(UINT64_MAX);
+        return false;
+    }
+    file_ = std::move(file);
+    return true;
+}
+
+bool SegmentLogSink::grow(uint64_t bytes)
+{
+    const uint64_t segments = (bytes + options_.segmentBytes - 1) / options_.segmentBytes;
+    file_->Unmap();
+    if (!file_->Map(segments * options_.segmentBytes))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SegmentLogSink::recover(uint64_t fileBytes)
+{
+    if (fileBytes == 0)
+        return;
+
+    // 정상 종료면 쓴 만큼으로 줄여져 있다. 비정상 종료면 끝에 미리 잡아 둔 0 과 반쯤 쓴 record 가 남는다.
+    // binary record 는 0 으로 끝날 수 있으므로 0 을 떼지 않고 통째로 넘긴다
+    const size_t size = static_cast<size_t>(fileBytes);
+    const uint64_t valid = options_.completeLength ? options_.completeLength(file_->data, size) : lastLineLength(file_->data, size);
+    if (valid == fileBytes)
+    {
+        offset_ = valid;
+        return;
+    }
+
+    uint64_t end = fileBytes;
+    while (end > valid && file_->data[end - 1] == '\0')
+        --end;
+    if (end != valid)
+    {
+        std::memset(file_->data + valid, 0, static_cast<size_t>(end - valid));
+        discardedBytes_.fetch_add(end - valid, std::memory_order_relaxed);
+    }
+    recoveredSegments_.fetch_add(1, std::memory_order_relaxed);
+    offset_ = valid;
+}
+
+bool SegmentLogSink::append(const char* data, size_t size)
+{
+    // 첫 byte 를 마지막에 쓴다. 복사 중에 죽으면 batch 의 첫 byte 가 0 으로 남아 recover 가 batch 통째로 버린다
+    // (미리 채워 둔 0 때문에 뒤가 잘린 frame 이 온전해 보이지 않도록)
+    if (size == 0)
+        return true;
+    std::memcpy(file_->data + offset_ + 1, data + 1, size - 1);
+    std::atomic_signal_fence(std::memory_order_release);
+    file_->data[offset_] = data[0];
+    offset_ += size;
+    return true;
+}
+
+void SegmentLogSink::scanSegments()
+{
+    const fs::path file = fs::u8path(path_);
+    const std::string stem = file.stem().u8string();
+    std::error_code error;
+    fs::directory_iterator it(file.has_parent_path() ? file.parent_path() : fs::path("."), error);
+    if (error)
+        return;
+
+    // 번호는 열 때 한 번만 찾는다. 압축하지 못하고 끝난 segment 는 다시 맡기고 쓰다 만 임시 파일은 지운다
+    std::vector<std::pair<uint64_t, std::string>> pending;
+    for (; it != fs::directory_iterator(); it.increment(error))
+    {
+        if (error)
+            break;
+
+        const std::string name = it->path().filename().u8string();
+        const size_t suffixSize = std::strlen(TEMPORARY_SUFFIX);
+        const bool temporary = name.size() > suffixSize && name.compare(name.size() - suffixSize, suffixSize, TEMPORARY_SUFFIX) == 0;
+
+        uint64_t sequence = 0;
+        bool compressed = false;
+        if (!parseSegmentName(temporary ? name.substr(0, name.size() - suffixSize) : name, stem, extension_, &sequence, &compressed))
+            continue;
+
+        if (temporary)
+        {
+            std::error_code ignored;
+            fs::remove(it->path(), ignored);
+            continue;
+        }
+
+        nextSequence_ = std::max(nextSequence_, sequence + 1);
+        if (!compressed)
+            pending.emplace_back(sequence, it->path().u8string());
+    }
+
+    std::sort(pending.begin(), pending.end());
+    for (const auto& segment : pending)
+        compressQueue_.push_back(segment.second);
+}
+
+void SegmentLogSink::queueCompression(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(compressMutex_);
+        compressQueue_.push_back(path);
+    }
+    compressCondition_.notify_one();
+}
+
+void SegmentLogSink::runCompressor()
+{
+    prune();
+
+    std::unique_lock<std::mutex> lock(compressMutex_);
+    while (true)
+    {
+        compressCondition_.wait(lock, [this]() { return stopping_ || !compressQueue_.empty(); });
+        if (compressQueue_.empty())
+            break;
+
+        // 끝낼 때도 남은 것은 압축한다
+        const std::string source = compressQueue_.front();
+        compressQueue_.pop_front();
+        lock.unlock();
+
+        // 그 사이 prune 으로 지워졌으면 넘어간다
+        std::error_code error;
+        if (options_.compressionLevel > 0 && fs::exists(fs::u8path(source), error))
+        {
+            if (compress(source))
+                compressed_.fetch_add(1, std::memory_order_relaxed);
+            else
+                compressFailures_.fetch_add(1, std::memory_order_relaxed);
+        }
+        prune();
+
+        lock.lock();
+    }
+}
+
+bool SegmentLogSink::compress(const std::string& source)
+{
+    const fs::path sourcePath = fs::u8path(source);
+    const fs::path target = fs::u8path(source + COMPRESSED_SUFFIX);
+    const fs::path temporary = fs::u8path(source + COMPRESSED_SUFFIX + TEMPORARY_SUFFIX);
+
+    std::ifstream in(sourcePath, std::ios::binary);
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!in || !out)
+        return false;
+
+    // windowBits 에 16 을 더하면 gzip header 를 붙인다
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, options_.compressionLevel, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    std::vector<char> input(COMPRESS_CHUNK_BYTES);
+    std::vector<char> output(COMPRESS_CHUNK_BYTES);
+    bool ok = true;
+    int flush = Z_NO_FLUSH;
+    while (ok && flush != Z_FINISH)
+    {
+        in.read(input.data(), static_cast<std::streamsize>(input.size()));
+        if (in.bad())
+        {
+            ok = false;
+            break;
+        }
+        flush = in.eof() ? Z_FINISH : Z_NO_FLUSH;
+        stream.next_in = reinterpret_cast<Bytef*>(input.data());
+        stream.avail_in = static_cast<uInt>(in.gcount());
+
+        do
+        {
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            if (deflate(&stream, flush) == Z_STREAM_ERROR)
+            {
+                ok = false;
+                break;
+            }
+            out.write(output.data(), static_cast<std::streamsize>(output.size() - stream.avail_out));
+        } while (stream.avail_out == 0);
+    }
+    deflateEnd(&stream);
+    in.close();
+    out.close();
+
+    std::error_code error;
+    if (!ok || !out)
+    {
+        fs::remove(temporary, error);
+        return false;
+    }
+
+    // 다 쓴 뒤에 이름을 바꾸므로 .gz 는 언제나 온전하다
+    fs::rename(temporary, target, error);
+    if (error)
+    {
+        fs::remove(temporary, error);
+        return false;
+    }
+    fs::remove(sourcePath, error);
+    return true;
+}
+
+void SegmentLogSink::prune()
+{
+    const fs::path file = fs::u8path(path_);
+    const std::string stem = file.stem().u8string();
+    std::error_code error;
+    fs::directory_iterator it(file.has_parent_path() ? file.parent_path() : fs::path("."), error);
+    if (error)
+        return;
+
+    std::vector<std::pair<uint64_t, fs::path>> segments;
+    for (; it != fs::directory_iterator(); it.increment(error))
+    {
+        if (error)
+            break;
+
+        uint64_t sequence = 0;
+        bool compressed = false;
+        if (parseSegmentName(it->path().filename().u8string(), stem, extension_, &sequence, &compressed))
+            segments.emplace_back(sequence, it->path());
+    }
+
+    // 같은 번호의 .log 와 .gz 가 같이 있으면 (압축 중) 하나로 센다
+    std::sort(segments.begin(), segments.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    size_t kept = 0;
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        if (i == 0 || segments[i].first != segments[i - 1].first)
+            ++kept;
+        if (kept > static_cast<size_t>(options_.generations))
+            fs::remove(segments[i].second, error);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "asynclogwriter.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 미리 segmentBytes 만큼 잡아 둔 파일을 memory map 해서 쓰는 sink. 쓴 위치는 직접 세므로 파일 크기를 묻지 않고,
+// 프로세스가 죽어도 map 된 내용은 OS 가 파일에 쓴다. 쓰는 중인 파일의 끝은 0 으로 채워져 있고 닫을 때 쓴 만큼으로 줄인다.
+// batch 는 첫 byte 를 마지막에 쓰므로 completeLength 는 0 으로 시작하는 곳을 온전하지 않은 것으로 보아야 한다.
+// 다 찬 segment 는 닫은 뒤 <이름>.<번호><확장자> 로 바꾸고, 별도 스레드에서 .gz 로 압축해 최근 generations 개만 남긴다.
+// 파일은 혼자 열고, 같은 path 를 다른 인스턴스가 쓰고 있으면 <이름>.pid<pid><확장자> 에 쓴다
+class SegmentLogSink : public LogSink
+{
+public:
+    struct Options
+    {
+        Options();
+
+        uint64_t segmentBytes;
+        int generations;                // 남겨 둘 지난 segment 수
+        int compressionLevel;           // zlib level. 0 이면 압축하지 않고 그대로 둔다
+        // segment 를 새로 열 때마다 먼저 쓴다 (binary 로그의 Start, Site frame)
+        std::function<std::string()> preamble;
+        // 비정상 종료로 남은 내용 중 온전한 앞부분의 길이. 없으면 첫 0 앞의 마지막 줄바꿈까지
+        std::function<size_t(const char* data, size_t size)> completeLength;
+    };
+
+    struct Stats
+    {
+        uint64_t rotations;
+        uint64_t compressed;
+        uint64_t compressFailures;
+        uint64_t recoveredSegments;     // 비정상 종료 뒤 이어 쓴 segment
+        uint64_t discardedBytes;        // 그때 잘라 낸 반쯤 쓴 record
+    };
+
+public:
+    // path 는 UTF-8
+    explicit SegmentLogSink(const std::string& path, const Options& options = Options());
+    // 쓴 만큼으로 줄여 닫고, 남은 압축을 마친다
+    ~SegmentLogSink() override;
+
+    SegmentLogSink(const SegmentLogSink&) = delete;
+    SegmentLogSink& operator=(const SegmentLogSink&) = delete;
+
+public:
+    bool Write(const char* data, size_t size) override;
+    Stats GetStats() const;
+
+private:
+    struct MappedFile;
+
+    bool open();
+    void close();
+    bool rotate();
+    bool reopen();
+    bool grow(uint64_t bytes);
+    void recover(uint64_t fileBytes);
+    bool append(const char* data, size_t size);
+
+    void scanSegments();
+    void queueCompression(const std::string& path);
+    void runCompressor();
+    bool compress(const std::string& source);
+    void prune();
+
+private:
+    std::string path_;
+    std::string defaultStem_;
+    std::string stem_;                  // 폴더/이름 (확장자 제외). 다른 인스턴스가 쓰고 있으면 <이름>.pid<pid>
+    std::string extension_;
+    Options options_;
+    std::unique_ptr<MappedFile> file_;
+    uint64_t offset_;
+    uint64_t preambleEnd_;              // 이 segment 에 record 가 있는지 (preamble 뒤)
+    uint64_t nextSequence_;
+
+    std::mutex compressMutex_;
+    std::condition_variable compressCondition_;
+    std::deque<std::string> compressQueue_;
+    bool stopping_;
+    std::thread compressor_;
+
+    std::atomic<uint64_t> rotations_;
+    std::atomic<uint64_t> compressed_;
+    std::atomic<uint64_t> compressFailures_;
+    std::atomic<uint64_t> recoveredSegments_;
+    std::atomic<uint64_t> discardedBytes_;
+};
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    struct ParallelForState
+    {
+        std::atomic<int> next;
+        std::atomic<int> done;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+}
+
+ThreadPool::ThreadPool(int maxThreadCount)
+    : mutex_()
+    , condition_()
+    , tasks_()
+    , threads_()
+    , maxThreadCount_(maxThreadCount > 0 ? maxThreadCount : DefaultThreadCount())
+    , liveThreadCount_(0)
+    , idleThreadCount_(0)
+    , stop_(false)
+{}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+
+    for (std::thread& thread : threads_)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+int ThreadPool::DefaultThreadCount()
+{
+    // UI 스레드 몫으로 코어 하나는 남긴다
+    int hardwareCount = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, hardwareCount - 1);
+}
+
+void ThreadPool::SetMaxThreadCount(int maxThreadCount)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxThreadCount_ = maxThreadCount > 0 ? maxThreadCount : DefaultThreadCount();
+    }
+
+    // 초과된 스레드는 깨어나서 스스로 종료한다
+    condition_.notify_all();
+}
+
+int ThreadPool::MaxThreadCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return maxThreadCount_;
+}
+
+void ThreadPool::Post(std::function<void()> task)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // pool 스레드를 둘 수 없는 설정이면 호출한 스레드에서 바로 실행
+        if (maxThreadCount_ <= 1)
+        {
+            lock.unlock();
+            task();
+            return;
+        }
+
+        tasks_.push_back(std::move(task));
+
+        if (static_cast<int>(tasks_.size()) > idleThreadCount_ && liveThreadCount_ < maxThreadCount_ - 1)
+        {
+            ++liveThreadCount_;
+            threads_.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    condition_.notify_one();
+}
+
+void ThreadPool::ParallelFor(int begin, int end, int grain, const std::function<void(int, int)>& fn)
+{
+    if (end <= begin)
+        return;
+
+    grain = std::max(1, grain);
+    const int chunkCount = (end - begin + grain - 1) / grain;
+
+    auto state = std::make_shared<ParallelForState>();
+    state->next = 0;
+    state->done = 0;
+
+    // 늦게 시작한 helper 는 남은 chunk 가 없으면 fn 을 건드리지 않고 끝난다
+    auto runChunks = [state, &fn, begin, end, grain, chunkCount]()
+    {
+        int finished = 0;
+        while (true)
+        {
+            int index = state->next.fetch_add(1);
+            if (index >= chunkCount)
+                break;
+
+            int chunkBegin = begin + index * grain;
+            fn(chunkBegin, std::min(end, chunkBegin + grain));
+            ++finished;
+        }
+
+        if (finished > 0 && state->done.fetch_add(finished) + finished == chunkCount)
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->condition.notify_all();
+        }
+    };
+
+    int helperCount = std::min(chunkCount - 1, MaxThreadCount() - 1);
+    for (int i = 0; i < helperCount; ++i)
+        Post(runChunks);
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&state, chunkCount]() { return state->done.load() == chunkCount; });
+}
+
+void ThreadPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        ++idleThreadCount_;
+        condition_.wait(lock, [this]()
+        {
+            return stop_ || !tasks_.empty() || liveThreadCount_ > maxThreadCount_ - 1;
+        });
+        --idleThreadCount_;
+
+        if (liveThreadCount_ > maxThreadCount_ - 1 || (stop_ && tasks_.empty()))
+            break;
+
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+
+    --liveThreadCount_;
+}
\ No newline at end of file
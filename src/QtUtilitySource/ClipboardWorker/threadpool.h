@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 작업 스레드 수를 제한할 수 있는 단순한 thread pool.
+// MaxThreadCount 는 호출한 스레드를 포함한 동시 실행 수이므로 pool 스레드는 하나 적게 만든다
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int maxThreadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static int DefaultThreadCount();
+
+public:
+    void SetMaxThreadCount(int maxThreadCount);
+    int MaxThreadCount() const;
+
+    void Post(std::function<void()> task);
+
+    // [begin, end) 를 grain 크기로 나눠 실행하고 모두 끝날 때까지 대기한다. 호출한 스레드도 참여
+    void ParallelFor(int begin, int end, int grain, const std::function<void(int, int)>& fn);
+
+private:
+    void workerLoop();
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+    int maxThreadCount_;
+    int liveThreadCount_;
+    int idleThreadCount_;
+    bool stop_;
+};
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "tiledpipeline.h"
+#include "cancellationtoken.h"
+#include "pixelbuffer.h"
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace
+{
+    const size_t DEFAULT_WORKING_SET_LIMIT = 64 * 1024 * 1024; // 64MB
+    const int ROWS_PER_BAND = 64;
+}
+
+TiledPipeline::Options::Options()
+    : workingSetLimit(DEFAULT_WORKING_SET_LIMIT)
+    , png()
+{}
+
+TiledPipeline::TiledPipeline(const Options& options, ThreadPool* pool, BufferPool* buffers)
+    : options_(options)
+    , pool_(pool)
+    , buffers_(buffers)
+{}
+
+int TiledPipeline::TileRows(int width, size_t workingSetLimit)
+{
+    if (width <= 0)
+        return 0;
+
+    // row 하나당 tile 버퍼 + 같은 크기의 압축 결과 (최악의 경우)
+    size_t bytesPerRow = static_cast<size_t>(width) * 4 * 2 + 1;
+    return static_cast<int>(std::max<size_t>(1, std::min<size_t>(workingSetLimit / bytesPerRow, INT32_MAX)));
+}
+
+TiledPipeline::Result TiledPipeline::Run(int width, int height, PixelConverter::Format format, const RowReader& reader,
+                                         uint8_t* dibPixels, int dibStride, const PngEncoder::Sink& pngSink,
+                                         const CancellationToken* token) const
+{
+    Result result = {};
+    if (width <= 0 || height <= 0 || !reader || (dibPixels && dibStride < width * 4))
+        return result;
+
+    result.tileRows = std::min(TileRows(width, options_.workingSetLimit), height);
+    result.tileCount = (height + result.tileRows - 1) / result.tileRows;
+
+    // 원본이 이미 DIB 배치면 결과 버퍼에 바로 읽어서 tile 버퍼도 쓰지 않는다
+    const bool readIntoDib = dibPixels && format == PixelConverter::Format::BGRA;
+    PixelBuffer tile;
+    if (!readIntoDib)
+    {
+        tile = PixelBuffer::Allocate(width, result.tileRows, format, buffers_);
+        if (tile.IsNull())
+            return result;
+    }
+    result.workingSetBytes = tile.ByteCount() + static_cast<size_t>(result.tileRows) * (static_cast<size_t>(width) * 4 + 1);
+
+    PngStreamEncoder encoder(options_.png, pool_, buffers_);
+    if (pngSink && !encoder.Begin(width, height, PixelConverter::HasAlpha(format), pngSink))
+        return result;
+
+    for (int firstRow = 0; firstRow < height; firstRow += result.tileRows)
+    {
+        if (token && token->IsCanceled())
+            return result;
+
+        const int rowCount = std::min(result.tileRows, height - firstRow);
+
+        ImageView rows;
+        rows.width = width;
+        rows.height = rowCount;
+        rows.format = format;
+        if (readIntoDib)
+        {
+            rows.bits = dibPixels + static_cast<size_t>(firstRow) * dibStride;
+            rows.stride = dibStride;
+        }
+        else
+        {
+            rows.bits = tile.ConstBits();
+            rows.stride = tile.Stride();
+        }
+
+        if (!reader(firstRow, rowCount, const_cast<uint8_t*>(rows.bits), rows.stride))
+            return result;
+
+        if (dibPixels && !readIntoDib)
+        {
+            uint8_t* dest = dibPixels + static_cast<size_t>(firstRow) * dibStride;
+            auto convertRows = [&](int begin, int end)
+            {
+                PixelConverter::ConvertRows(
+                    rows.ConstScanLine(begin), rows.stride, rows.format,
+                    dest + static_cast<size_t>(begin) * dibStride, dibStride, PixelConverter::Format::BGRA,
+                    width, end - begin);
+            };
+
+            if (pool_)
+                pool_->ParallelFor(0, rowCount, ROWS_PER_BAND, convertRows);
+            else
+                convertRows(0, rowCount);
+        }
+
+        if (pngSink && !encoder.AddRows(rows, token))
+            return result;
+    }
+
+    if (pngSink && !encoder.Finish())
+        return result;
+
+    result.ok = true;
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "pixelconverter.h"
+#include "pngencoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+class BufferPool;
+class CancellationToken;
+class ThreadPool;
+
+// 아주 큰 이미지를 위쪽부터 가로 띠(tile) 단위로 읽어 DIB 배치 버퍼와 PNG 를 함께 만든다.
+// 원본 전체를 메모리에 올리지 않으므로 결과 외에 쓰는 메모리는 workingSetLimit 로 제한된다
+class TiledPipeline
+{
+public:
+    // firstRow 부터 rowCount 개의 row 를 dest (destStride 간격) 에 채운다. 실패하면 false
+    using RowReader = std::function<bool(int firstRow, int rowCount, uint8_t* dest, int destStride)>;
+
+    struct Options
+    {
+        Options();
+
+        size_t workingSetLimit;     // tile 버퍼와 압축 중인 데이터의 상한
+        PngEncoder::Options png;
+    };
+
+    struct Result
+    {
+        bool ok;
+        int tileRows;
+        int tileCount;
+        size_t workingSetBytes;     // tile 하나를 처리하는 데 쓰는 메모리 (추정)
+    };
+
+public:
+    explicit TiledPipeline(const Options& options = Options(), ThreadPool* pool = nullptr, BufferPool* buffers = nullptr);
+
+    static int TileRows(int width, size_t workingSetLimit);
+
+public:
+    // dibPixels 가 있으면 BGRA 로 채운다. pngSink 가 비어 있으면 PNG 는 만들지 않는다
+    Result Run(int width, int height, PixelConverter::Format format, const RowReader& reader,
+               uint8_t* dibPixels, int dibStride, const PngEncoder::Sink& pngSink,
+               const CancellationToken* token = nullptr) const;
+
+private:
+    Options options_;
+    ThreadPool* pool_;
+    BufferPool* buffers_;
+};
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const size_t DEFAULT_CAPACITY = 16384;
+
+    struct Ring
+    {
+        std::mutex mutex;
+        std::vector<Trace::Event> events;
+        size_t capacity = DEFAULT_CAPACITY;
+        size_t next = 0;            // 다음에 쓸 위치
+        size_t count = 0;
+        uint64_t dropped = 0;
+    };
+
+    Ring& ring()
+    {
+        static Ring instance;
+        return instance;
+    }
+
+    uint32_t currentThreadId()
+    {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentThreadId());
+#else
+        return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+    }
+
+    uint32_t currentProcessId()
+    {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+        return static_cast<uint32_t>(getpid());
+#endif
+    }
+
+    void appendEscaped(std::string& json, const char* text)
+    {
+        for (; *text != '\0'; ++text)
+        {
+            const unsigned char c = static_cast<unsigned char>(*text);
+            if (c == '"' || c == '\\')
+            {
+                json += '\\';
+                json += static_cast<char>(c);
+            }
+            else if (c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                json += escaped;
+            }
+            else
+            {
+                json += static_cast<char>(c);
+            }
+        }
+    }
+}
+
+namespace Trace
+{
+    namespace Internal
+    {
+        std::atomic<bool> enabled(false);
+    }
+
+    void SetEnabled(bool enabled)
+    {
+        if (enabled)
+        {
+            Ring& state = ring();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.events.size() != state.capacity)
+                state.events.resize(state.capacity);
+        }
+
+        Internal::enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void SetCapacity(size_t events)
+    {
+        Ring& state = ring();
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        // 크기가 바뀌면 남아 있던 event 는 버린다
+        state.capacity = std::max<size_t>(events, 1);
+        state.events.assign(IsEnabled() ? state.capacity : 0, Event());
+        state.next = 0;
+        state.count = 0;
+    }
+
+    size_t Capacity()
+    {
+        Ring& state = ring();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.capacity;
+    }
+
+    void Clear()
+    {
+        Ring& state = ring();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.next = 0;
+        state.count = 0;
+        state.dropped = 0;
+    }
+
+    std::vector<Event> Events()
+    {
+        Ring& state = ring();
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        std::vector<Event> events;
+        events.reserve(state.count);
+        const size_t first = (state.next + state.events.size() - state.count) % std::max<size_t>(state.events.size(), 1);
+        for (size_t i = 0; i < state.count; ++i)
+            events.push_back(state.events[(first + i) % state.events.size()]);
+        return events;
+    }
+
+    uint64_t DroppedCount()
+    {
+        Ring& state = ring();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        return state.dropped;
+    }
+
+    std::string ToChromeJson()
+    {
+        std::vector<Event> events = Events();
+        const uint32_t processId = currentProcessId();
+
+        // "X" 는 시작과 길이를 같이 가진 complete event. 시간 단위는 us
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        char buffer[192];
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            const Event& event = events[i];
+            json += i == 0 ? "\n" : ",\n";
+            json += "{\"name\":\"";
+            appendEscaped(json, event.name);
+            std::snprintf(buffer, sizeof(buffer), "\",\"cat\":\"clipboard\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%u,\"tid\":%u,\"args\":{\"bytes\":%llu",
+                          static_cast<long long>(event.startMicroseconds), static_cast<long long>(event.durationMicroseconds),
+                          processId, event.threadId, static_cast<unsigned long long>(event.bytes));
+            json += buffer;
+            if (event.detail != nullptr)
+            {
+                json += ",\"detail\":\"";
+                appendEscaped(json, event.detail);
+                json += '"';
+            }
+            json += "}}";
+        }
+        json += "\n]}\n";
+        return json;
+    }
+
+    int64_t NowMicroseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Record(const char* name, const char* detail, int64_t startMicroseconds, int64_t endMicroseconds, uint64_t bytes)
+    {
+        Event event;
+        event.name = name;
+        event.detail = detail;
+        event.threadId = currentThreadId();
+        event.startMicroseconds = startMicroseconds;
+        event.durationMicroseconds = endMicroseconds - startMicroseconds;
+        event.bytes = bytes;
+
+        Ring& state = ring();
+        std::lock_guard<std::mutex> lock(state.mutex);
+
+        // 끄는 사이에 끝난 span 은 버리지 않고 남긴다. ring 이 아직 없으면 버린다
+        if (state.events.empty())
+            return;
+
+        state.events[state.next] = event;
+        state.next = (state.next + 1) % state.events.size();
+        if (state.count < state.events.size())
+            ++state.count;
+        else
+            ++state.dropped;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 단계별 실행 구간(span)을 메모리 ring 에 남기고 Chrome trace JSON 으로 내보낸다 (chrome://tracing, Perfetto).
+// 꺼져 있으면 Span 은 flag 하나만 읽고 시간도 재지 않는다
+namespace Trace
+{
+    struct Event
+    {
+        const char* name;               // 문자열 상수만 쓴다 (복사하지 않음)
+        const char* detail;             // 포맷 이름 등 (없으면 null)
+        uint32_t threadId;
+        int64_t startMicroseconds;
+        int64_t durationMicroseconds;
+        uint64_t bytes;
+    };
+
+    namespace Internal
+    {
+        extern std::atomic<bool> enabled;
+    }
+
+    inline bool IsEnabled()
+    {
+        return Internal::enabled.load(std::memory_order_relaxed);
+    }
+
+    // 처음 켤 때 ring 을 할당한다
+    void SetEnabled(bool enabled);
+    // ring 에 보관할 event 수. 넘치면 오래된 것부터 덮어쓴다
+    void SetCapacity(size_t events);
+    size_t Capacity();
+    void Clear();
+
+    // 오래된 것부터
+    std::vector<Event> Events();
+    // ring 이 넘쳐 덮어쓴 event 수
+    uint64_t DroppedCount();
+    std::string ToChromeJson();
+
+    int64_t NowMicroseconds();
+    void Record(const char* name, const char* detail, int64_t startMicroseconds, int64_t endMicroseconds, uint64_t bytes);
+
+    // scope 동안을 한 구간으로 남긴다
+    class Span
+    {
+    public:
+        explicit Span(const char* name, const char* detail = nullptr, uint64_t bytes = 0)
+            : name_(name)
+            , detail_(detail)
+            , bytes_(bytes)
+            , start_(IsEnabled() ? NowMicroseconds() : -1)
+        {}
+
+        ~Span()
+        {
+            if (start_ >= 0)
+                Record(name_, detail_, start_, NowMicroseconds(), bytes_);
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        // 끝나야 크기를 알 수 있는 단계 (인코딩 결과 등)
+        void SetBytes(uint64_t bytes)
+        {
+            bytes_ = bytes;
+        }
+
+    private:
+        const char* name_;
+        const char* detail_;
+        uint64_t bytes_;
+        int64_t start_;
+    };
+}
\ No newline at end of file
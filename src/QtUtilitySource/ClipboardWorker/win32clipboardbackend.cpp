@@ -0,0 +1,411 @@
+#include "win32clipboardbackend.h"
+#include "dibsection.h"
+#include "log.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    const wchar_t* WINDOW_CLASS_NAME = L"ClipboardWorkerBackendWindow";
+    const UINT WM_PUBLISH = WM_APP + 1;
+
+    double elapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void freeHandle(ClipboardFormat format, HANDLE handle)
+    {
+        if (format == ClipboardFormat::Bitmap)
+            DeleteObject(handle);
+        else
+            GlobalFree(handle);
+    }
+
+    // 누가 clipboard 를 열고 있는지 남긴다. 열고 있는 창이 없는 경우(NULL 로 연 경우)도 있다
+    void logClipboardHolder()
+    {
+        DWORD processId = 0;
+        HWND holder = GetOpenClipboardWindow();
+        if (holder != NULL)
+            GetWindowThreadProcessId(holder, &processId);
+        LOGF_INFO("Clipboard busy, held by process: {}", processId);
+    }
+}
+
+Win32ClipboardBackend::Win32ClipboardBackend(ThreadPool* pool)
+    : ClipboardBackend()
+    , pool_(pool)
+    , pngFormat_(RegisterClipboardFormatW(L"PNG"))
+    , jfifFormat_(RegisterClipboardFormatW(L"JFIF"))
+    , thread_()
+    , windowMutex_()
+    , windowCondition_()
+    , windowReady_(false)
+    , hwnd_(NULL)
+    , source_()
+    , pendingFormats_()
+    , prepared_()
+{
+    // 지연 렌더링 요청은 clipboard 소유 창으로 오므로 메시지 루프를 가진 스레드가 따로 필요하다
+    thread_ = std::thread(&Win32ClipboardBackend::run, this);
+
+    std::unique_lock<std::mutex> lock(windowMutex_);
+    windowCondition_.wait(lock, [this]() { return windowReady_; });
+}
+
+Win32ClipboardBackend::~Win32ClipboardBackend()
+{
+    // 창이 닫힐 때 WM_RENDERALLFORMATS 로 남은 포맷이 렌더링되어 프로그램 종료 후에도 붙여넣을 수 있다
+    if (hwnd_)
+        PostMessageW(hwnd_, WM_CLOSE, 0, 0);
+
+    if (thread_.joinable())
+        thread_.join();
+}
+
+std::vector<ClipboardFormat> Win32ClipboardBackend::AvailableFormats() const
+{
+    // CF_DIBV5 는 다른 bitmap 포맷만 있어도 OS 가 만들어 준다
+    std::vector<ClipboardFormat> formats;
+    for (int i = 0; i < CLIPBOARD_FORMAT_COUNT; ++i)
+    {
+        ClipboardFormat format = static_cast<ClipboardFormat>(i);
+        if (IsClipboardFormatAvailable(nativeFormat(format)))
+            formats.push_back(format);
+    }
+    return formats;
+}
+
+// Protected
+
+bool Win32ClipboardBackend::preparePublish(const std::shared_ptr<const ClipboardSource>& source)
+{
+    if (!source || hwnd_ == NULL)
+        return false;
+
+    // 작은 포맷은 지금 렌더링해서 붙여넣을 때 이 창까지 왕복하지 않게 한다
+    for (ClipboardFormat format : source->EagerFormats())
+    {
+        auto start = std::chrono::steady_clock::now();
+        HANDLE handle = createHandle(*source, format);
+        if (handle == NULL)
+        {
+            // 약속만 해 두고 요청이 오면 다시 시도한다
+            LOG_WARNING << "Render failed:" << ClipboardFormatName(format);
+            continue;
+        }
+
+        uint64_t bytes = format == ClipboardFormat::Bitmap
+            ? static_cast<uint64_t>(source->Pixels().width) * source->Pixels().height * 4
+            : source->FormatSize(format);
+        prepared_.push_back(PreparedHandle{ format, handle, bytes, elapsedMilliseconds(start) });
+    }
+    return true;
+}
+
+ClipboardBackend::Attempt Win32ClipboardBackend::tryPublish(const std::shared_ptr<const ClipboardSource>& source)
+{
+    return static_cast<Attempt>(SendMessageW(hwnd_, WM_PUBLISH, 0, reinterpret_cast<LPARAM>(&source)));
+}
+
+void Win32ClipboardBackend::finishPublish(bool /*published*/)
+{
+    for (const PreparedHandle& prepared : prepared_)
+    {
+        if (prepared.handle != NULL)
+            freeHandle(prepared.format, prepared.handle);
+    }
+    prepared_.clear();
+}
+
+ClipboardBackend::Attempt Win32ClipboardBackend::tryRead(ClipboardFormat format, const Reader& reader)
+{
+    // 아무 스레드에서나 열 수 있다. 우리가 약속만 해 둔 포맷이면 창 스레드로 WM_RENDERFORMAT 이 간다
+    if (!openClipboard(NULL))
+    {
+        logClipboardHolder();
+        return Attempt::Busy;
+    }
+
+    bool read = false;
+    Trace::Span span("GetClipboardData", ClipboardFormatName(format));
+    HANDLE handle = GetClipboardData(nativeFormat(format));
+    if (handle != NULL)
+    {
+        const uint8_t* data = static_cast<const uint8_t*>(GlobalLock(handle));
+        if (data != nullptr)
+        {
+            span.SetBytes(GlobalSize(handle));
+            read = reader(data, GlobalSize(handle));
+            GlobalUnlock(handle);
+        }
+    }
+
+    CloseClipboard();
+    return read ? Attempt::Done : Attempt::Failed;
+}
+
+// Private
+
+LRESULT CALLBACK Win32ClipboardBackend::windowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == WM_NCCREATE)
+    {
+        CREATESTRUCTW* create = reinterpret_cast<CREATESTRUCTW*>(lParam);
+        SetWindowLongPtrW(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create->lpCreateParams));
+    }
+
+    Win32ClipboardBackend* backend = reinterpret_cast<Win32ClipboardBackend*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+    if (backend == nullptr)
+        return DefWindowProcW(hwnd, message, wParam, lParam);
+
+    return backend->handleMessage(message, wParam, lParam);
+}
+
+void Win32ClipboardBackend::run()
+{
+    HINSTANCE instance = GetModuleHandleW(NULL);
+
+    WNDCLASSEXW windowClass = {};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = &Win32ClipboardBackend::windowProc;
+    windowClass.hInstance = instance;
+    windowClass.lpszClassName = WINDOW_CLASS_NAME;
+    RegisterClassExW(&windowClass);
+
+    HWND hwnd = CreateWindowExW(0, WINDOW_CLASS_NAME, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, instance, this);
+    if (hwnd == NULL)
+        LOG_WARNING << "CreateWindowEx failed:" << GetLastError();
+
+    {
+        std::lock_guard<std::mutex> lock(windowMutex_);
+        hwnd_ = hwnd;
+        windowReady_ = true;
+    }
+    windowCondition_.notify_all();
+
+    if (hwnd == NULL)
+        return;
+
+    MSG msg;
+    while (GetMessageW(&msg, NULL, 0, 0) > 0)
+    {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+}
+
+LRESULT Win32ClipboardBackend::handleMessage(UINT message, WPARAM wParam, LPARAM lParam)
+{
+    switch (message)
+    {
+        case WM_PUBLISH:
+            return static_cast<LRESULT>(publishImpl(*reinterpret_cast<const std::shared_ptr<const ClipboardSource>*>(lParam)));
+
+        case WM_RENDERFORMAT:
+        {
+            // 요청한 프로그램이 clipboard 를 열어둔 상태이므로 여기서 열면 안 된다
+            ClipboardFormat format;
+            if (fromNativeFormat(static_cast<UINT>(wParam), &format))
+                renderFormat(format);
+            return 0;
+        }
+
+        case WM_RENDERALLFORMATS:
+            renderAllFormats();
+            return 0;
+
+        case WM_DESTROYCLIPBOARD:
+            // 누군가 EmptyClipboard 를 호출해 더 이상 소유자가 아니다
+            source_.reset();
+            pendingFormats_.clear();
+            return 0;
+
+        case WM_CLOSE:
+            DestroyWindow(hwnd_);
+            return 0;
+
+        case WM_DESTROY:
+            PostQuitMessage(0);
+            return 0;
+    }
+
+    return DefWindowProcW(hwnd_, message, wParam, lParam);
+}
+
+ClipboardBackend::Attempt Win32ClipboardBackend::publishImpl(const std::shared_ptr<const ClipboardSource>& source)
+{
+    if (!openClipboard(hwnd_))
+    {
+        logClipboardHolder();
+        return Attempt::Busy;
+    }
+
+    // 이전 소유자(자기 자신 포함)에게 WM_DESTROYCLIPBOARD 가 먼저 전달된다
+    EmptyClipboard();
+
+    source_ = source;
+    pendingFormats_ = source->Formats();
+    const size_t formatCount = pendingFormats_.size();
+    for (ClipboardFormat format : pendingFormats_)
+    {
+        SetClipboardData(nativeFormat(format), NULL);
+        recordPromised(format);
+    }
+
+    // 미리 만들어 둔 handle 을 올린다. 소유권은 clipboard 로 넘어간다
+    for (PreparedHandle& prepared : prepared_)
+    {
+        auto pending = std::find(pendingFormats_.begin(), pendingFormats_.end(), prepared.format);
+        if (prepared.handle == NULL || pending == pendingFormats_.end())
+            continue;
+
+        Trace::Span span("SetClipboardData", ClipboardFormatName(prepared.format), prepared.bytes);
+        if (SetClipboardData(nativeFormat(prepared.format), prepared.handle) == NULL)
+            continue;
+
+        prepared.handle = NULL;
+        pendingFormats_.erase(pending);
+        recordRendered(prepared.format, prepared.bytes, prepared.milliseconds);
+    }
+
+    CloseClipboard();
+
+    LOGF_INFO("Promised formats: {} rendered now: {}", formatCount, formatCount - pendingFormats_.size());
+    return formatCount != 0 ? Attempt::Done : Attempt::Failed;
+}
+
+bool Win32ClipboardBackend::renderFormat(ClipboardFormat format)
+{
+    auto pending = std::find(pendingFormats_.begin(), pendingFormats_.end(), format);
+    if (!source_ || pending == pendingFormats_.end())
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    HANDLE handle = createHandle(*source_, format);
+    if (handle == NULL)
+    {
+        LOG_WARNING << "Render failed:" << ClipboardFormatName(format);
+        return false;
+    }
+
+    // 소유권은 clipboard 로 넘어간다
+    Trace::Span span("SetClipboardData", ClipboardFormatName(format));
+    if (SetClipboardData(nativeFormat(format), handle) == NULL)
+    {
+        freeHandle(format, handle);
+        return false;
+    }
+
+    pendingFormats_.erase(pending);
+
+    uint64_t bytes = format == ClipboardFormat::Bitmap
+        ? static_cast<uint64_t>(source_->Pixels().width) * source_->Pixels().height * 4
+        : source_->FormatSize(format);
+    span.SetBytes(bytes);
+    double milliseconds = elapsedMilliseconds(start);
+    recordRendered(format, bytes, milliseconds);
+
+    LOGF_INFO("Rendered {} {} bytes {} ms", ClipboardFormatName(format), bytes, milliseconds);
+    return true;
+}
+
+void Win32ClipboardBackend::renderAllFormats()
+{
+    if (!source_ || pendingFormats_.empty())
+        return;
+
+    if (!openClipboard(hwnd_))
+        return;
+
+    // 그 사이 다른 프로그램이 clipboard 를 가져갔으면 렌더링하지 않는다
+    if (GetClipboardOwner() == hwnd_)
+    {
+        std::vector<ClipboardFormat> formats = pendingFormats_;
+        for (ClipboardFormat format : formats)
+            renderFormat(format);
+    }
+
+    CloseClipboard();
+}
+
+HANDLE Win32ClipboardBackend::createHandle(const ClipboardSource& source, ClipboardFormat format)
+{
+    if (format == ClipboardFormat::Bitmap)
+    {
+        const ImageView pixels = source.Pixels();
+        Trace::Span span("HBITMAP", nullptr, static_cast<uint64_t>(pixels.width) * pixels.height * 4);
+        return DibSection::Create(pixels, pool_);
+    }
+
+    size_t size = source.FormatSize(format);
+    if (size == 0)
+        return NULL;
+
+    Trace::Span span("render", ClipboardFormatName(format), size);
+
+    HGLOBAL hGlobal = GlobalAlloc(GMEM_MOVEABLE, size);
+    if (!hGlobal)
+        return NULL;
+
+    uint8_t* dest = static_cast<uint8_t*>(GlobalLock(hGlobal));
+    if (!dest)
+    {
+        GlobalFree(hGlobal);
+        return NULL;
+    }
+
+    bool rendered = source.Render(format, dest, size);
+    GlobalUnlock(hGlobal);
+
+    if (!rendered)
+    {
+        GlobalFree(hGlobal);
+        return NULL;
+    }
+
+    return hGlobal;
+}
+
+bool Win32ClipboardBackend::openClipboard(HWND owner)
+{
+    // 다른 프로그램이 clipboard 를 열고 있으면 실패한다. 그 대기 시간을 trace 에서 따로 본다
+    Trace::Span span("OpenClipboard");
+    return OpenClipboard(owner) != FALSE;
+}
+
+UINT Win32ClipboardBackend::nativeFormat(ClipboardFormat format) const
+{
+    switch (format)
+    {
+        case ClipboardFormat::Png:
+            return pngFormat_;
+        case ClipboardFormat::DibV5:
+            return CF_DIBV5;
+        case ClipboardFormat::Bitmap:
+            return CF_BITMAP;
+        case ClipboardFormat::Jfif:
+            return jfifFormat_;
+    }
+    return 0;
+}
+
+bool Win32ClipboardBackend::fromNativeFormat(UINT nativeFormat, ClipboardFormat* format) const
+{
+    if (nativeFormat == pngFormat_)
+        *format = ClipboardFormat::Png;
+    else if (nativeFormat == CF_DIBV5)
+        *format = ClipboardFormat::DibV5;
+    else if (nativeFormat == CF_BITMAP)
+        *format = ClipboardFormat::Bitmap;
+    else if (nativeFormat == jfifFormat_)
+        *format = ClipboardFormat::Jfif;
+    else
+        return false;
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "clipboardbackend.h"
+
+#include <condition_variable>
+#include <thread>
+#include <windows.h>
+
+class ThreadPool;
+
+// Win32 clipboard. 포맷은 SetClipboardData(format, NULL) 로 약속만 하고,
+// 다른 프로그램이 요청하면(WM_RENDERFORMAT) 그때 렌더링한다. 렌더링된 데이터는 OS 가 보관한다.
+// 바로 올릴 포맷은 clipboard 를 열기 전에 렌더링해 두므로 다른 프로그램 때문에 다시 시도해도 다시 만들지 않는다.
+// Publish 는 한 스레드에서만 호출한다
+class Win32ClipboardBackend : public ClipboardBackend
+{
+public:
+    explicit Win32ClipboardBackend(ThreadPool* pool = nullptr);
+    ~Win32ClipboardBackend() override;
+
+public:
+    std::vector<ClipboardFormat> AvailableFormats() const override;
+
+protected:
+    bool preparePublish(const std::shared_ptr<const ClipboardSource>& source) override;
+    Attempt tryPublish(const std::shared_ptr<const ClipboardSource>& source) override;
+    void finishPublish(bool published) override;
+    Attempt tryRead(ClipboardFormat format, const Reader& reader) override;
+
+private:
+    // clipboard 를 열기 전에 만들어 둔 handle. 올리기 전까지는 우리가 해제해야 한다
+    struct PreparedHandle
+    {
+        ClipboardFormat format;
+        HANDLE handle;
+        uint64_t bytes;
+        double milliseconds;
+    };
+
+    static LRESULT CALLBACK windowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
+
+    // 아래 함수들은 모두 clipboard 창 스레드에서 실행된다
+    void run();
+    LRESULT handleMessage(UINT message, WPARAM wParam, LPARAM lParam);
+    Attempt publishImpl(const std::shared_ptr<const ClipboardSource>& source);
+    bool renderFormat(ClipboardFormat format);
+    void renderAllFormats();
+
+    HANDLE createHandle(const ClipboardSource& source, ClipboardFormat format);
+    bool openClipboard(HWND owner);
+    UINT nativeFormat(ClipboardFormat format) const;
+    bool fromNativeFormat(UINT nativeFormat, ClipboardFormat* format) const;
+
+private:
+    ThreadPool* pool_;
+    UINT pngFormat_;
+    UINT jfifFormat_;
+    std::thread thread_;
+    std::mutex windowMutex_;
+    std::condition_variable windowCondition_;
+    bool windowReady_;
+    HWND hwnd_;
+    std::shared_ptr<const ClipboardSource> source_;
+    std::vector<ClipboardFormat> pendingFormats_;
+    std::vector<PreparedHandle> prepared_;
+};
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+// Windows 빌드는 Qt 에 포함된 zlib (QtCore 에서 export) 을 사용한다
+#ifdef _WIN32
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
\ No newline at end of file
@@ -14,10 +14,10 @@ EventWrapper::~EventWrapper()
 
 bool EventWrapper::eventFilter(QObject* obj, QEvent* e)
 {
-    //  ƴҰ
+    // 대상 아닐경우
     if (target_ == obj)
     {
-        // event ŸԿ  ñ׳ ȣ
+        // event 타입에 따라 시그널 호출
         switch (e->type())
         {
             case QEvent::Move:
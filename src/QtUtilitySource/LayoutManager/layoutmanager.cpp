@@ -61,7 +61,7 @@ void LayoutManager::AdjustSize()
         SizeData data = initSizes_[child];
         if (lastAppliedScaleFactor < scaleFactor_)
         {
-            // Ŀ 
+            // 커져야할 때
             child->setMaximumSize(calc(data.maximumSize_.width()), calc(data.maximumSize_.height()));
             child->resize(
                 calc(child->width() / lastAppliedScaleFactor),
@@ -70,7 +70,7 @@ void LayoutManager::AdjustSize()
         }
         else
         {
-            // ۾ 
+            // 작아져야할 때
             child->setMinimumSize(calc(data.minimumSize_.width()), calc(data.minimumSize_.height()));
             child->resize(
                 calc(child->width() / lastAppliedScaleFactor),
@@ -96,7 +96,7 @@ void LayoutManager::AdjustSize()
 
     lastAppliedScaleFactor = scaleFactor_;
 
-    // signal ȣ
+    // signal 호출
     emit adjusted();
 }
 
@@ -118,12 +118,12 @@ void LayoutManager::Initialize()
 
         QWidget* widget = reinterpret_cast<QWidget*>(parent());
 
-        // parentwindow 
+        // parentwindow 가져오기
         setParentWindow(widget->window());
-        // parentwindow screen ̺Ʈ 
+        // parentwindow의 screen에 이벤트 연결
         updateScreenConnections(nullptr, getParentWindow()->screen());
 
-        // ڽ   ̾ƿ  
+        // 자식 위젯 및 레이아웃 사이즈 기억
         QList<QWidget*> children = widget->findChildren<QWidget*>(QString(), Qt::FindChildrenRecursively);
         for (QWidget* child : children)
         {
@@ -149,7 +149,7 @@ void LayoutManager::Initialize()
             initLayoutDatas_[layout] = layoutData;
         }
 
-        //  
+        // 사이즈 재조정
         AdjustSize();
     }
     else
@@ -197,14 +197,14 @@ void LayoutManager::updateScreenConnections(QScreen* currentScreen, QScreen* new
     if (currentScreen == newScreen)
         return;
 
-    //  ũ  connection 
+    // 이전 스크린에 대한 connection 해제
     if (currentScreen)
     {
         disconnect(currentScreen, &QScreen::logicalDotsPerInchChanged, this, &LayoutManager::On_screen_logicalDotsPerInchChanged);
         updateScaleFactor(DEFAULT_DPI_VALUE);
     }
 
-    // ο ũ connect
+    // 새로운 스크린 connect
     if (newScreen)
     {
         connect(newScreen, &QScreen::logicalDotsPerInchChanged, this, &LayoutManager::On_screen_logicalDotsPerInchChanged);
@@ -224,18 +224,18 @@ int LayoutManager::calc(int v) const
 
 void LayoutManager::On_screen_logicalDotsPerInchChanged(qreal dpi)
 {
-    // scaleFactor 
+    // scaleFactor 계산
     updateScaleFactor(dpi);
 
-    //  
+    // 사이즈 재조정
     AdjustSize();
 }
 
 void LayoutManager::On_window_screenChaged(QWindow* window, ScreenChangedEventPtr e)
 {
-    // ũ 
+    // 스크린 변경
     updateScreenConnections(e->currentScreen, e->newScreen);
 
-    //  
+    // 사이즈 재조정
     AdjustSize();
 }
\ No newline at end of file
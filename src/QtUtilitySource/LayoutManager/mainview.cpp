@@ -17,13 +17,13 @@ MainView::~MainView()
 
 void MainView::On_view_firstShown()
 {
-    // layoutmanager ʱȭ
+    // layoutmanager 초기화
     layoutManager_.Initialize();
 }
 
 void MainView::On_layoutManager_adjusted()
 {
-    // geometry ƴ ҵ 
+    // geometry가 아닌 요소들 조정
 
     qreal scalefactor = layoutManager_.ScaleFactor();
 
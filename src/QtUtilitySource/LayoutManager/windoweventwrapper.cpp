@@ -44,7 +44,7 @@ QScreen* WindowEventWrapper::getActualCurrentScreen(QWindow* window)
     if (isRectInScreen(windowScreen, windowRect))
         return windowScreen;
 
-    // ħ   ū ũ 
+    // 겹침 비율이 가장 큰 스크린을 구함
     double maxPercent = -1.0;
     QScreen* maxScreen = nullptr;
 
@@ -67,7 +67,7 @@ QScreen* WindowEventWrapper::getActualCurrentScreen(QWindow* window)
 
 bool WindowEventWrapper::isRectInScreen(QScreen* screen, const QRect& rect)
 {
-    // ģ  50% ٸ true, ƴϸ false
+    // 겹친 영역이 50%보다 많다면 true, 아니면 false
     return getPercentForIntersectInRect(screen, rect);
 }
 
@@ -78,7 +78,7 @@ double WindowEventWrapper::getPercentForIntersectInRect(QScreen* screen, const Q
     int rectArea = rect.width() * rect.height();
     int intersectArea = intersect.width() * intersect.height();
 
-    // ģ  
+    // 겹친영역의 비율 구함
     return static_cast<double>(intersectArea) / rectArea;
 }
 
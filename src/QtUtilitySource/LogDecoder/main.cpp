@@ -0,0 +1,51 @@
+#include "binarylogdecoder.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// LogDecoder <appId.blog> [output.log]: binary 로그를 text 로그 형식으로. output 이 없으면 stdout
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::fprintf(stderr, "usage: LogDecoder <input.blog> [output.log]\n");
+        return 2;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input)
+    {
+        std::fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    const std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    std::string text;
+    BinaryLogDecoder::Result result = {};
+    if (!BinaryLogDecoder::Decode(bytes, &text, &result))
+    {
+        std::fprintf(stderr, "%s is not a binary log\n", argv[1]);
+        return 1;
+    }
+
+    if (argc == 3)
+    {
+        std::ofstream output(argv[2], std::ios::binary);
+        if (!output.write(text.data(), static_cast<std::streamsize>(text.size())))
+        {
+            std::fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 1;
+        }
+    }
+    else
+    {
+        std::fwrite(text.data(), 1, text.size(), stdout);
+    }
+
+    std::fprintf(stderr, "%llu records, %llu sessions%s%s\n", static_cast<unsigned long long>(result.records),
+                 static_cast<unsigned long long>(result.sessions), result.unknownSites ? ", some sites unknown" : "",
+                 result.truncated ? ", last frame truncated" : "");
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "asynclogwriter.h"
+#include "testsupport.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace
+{
+    // 열어 줄 때까지 Write 안에서 기다리는 sink. writer 스레드를 세워 두고 queue 를 채운다
+    class GateSink : public LogSink
+    {
+    public:
+        struct State
+        {
+            std::mutex mutex;
+            std::condition_variable changed;
+            bool open = false;
+            int writing = 0;        // Write 에 들어온 횟수
+            int failuresLeft = 0;   // 이만큼 실패한 뒤 성공
+            std::string written;
+        };
+
+        explicit GateSink(std::shared_ptr<State> state)
+            : state_(std::move(state))
+        {}
+
+        bool Write(const char* data, size_t size) override
+        {
+            std::unique_lock<std::mutex> lock(state_->mutex);
+            ++state_->writing;
+            state_->changed.notify_all();
+            state_->changed.wait(lock, [this]() { return state_->open; });
+            if (state_->failuresLeft > 0)
+            {
+                --state_->failuresLeft;
+                return false;
+            }
+            state_->written.append(data, size);
+            return true;
+        }
+
+    private:
+        std::shared_ptr<State> state_;
+    };
+
+    struct Fixture
+    {
+        explicit Fixture(AsyncLogWriter::OverflowPolicy policy, size_t maxRecords = 4, size_t maxBytes = 1024 * 1024)
+            : state(std::make_shared<GateSink::State>())
+            , writer()
+        {
+            AsyncLogWriter::Options options;
+            options.maxQueuedRecords = maxRecords;
+            options.maxQueuedBytes = maxBytes;
+            options.overflowPolicy = policy;
+            options.writeRetryMilliseconds = 1;
+            writer.reset(new AsyncLogWriter(std::unique_ptr<LogSink>(new GateSink(state)), options));
+        }
+
+        // 첫 record 를 writer 스레드가 가져가 Write 안에서 멈출 때까지
+        void stallWriter()
+        {
+            CHECK(writer->Push("stalled\n"));
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->changed.wait(lock, [this]() { return state->writing > 0; });
+        }
+
+        void open()
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->open = true;
+            state->changed.notify_all();
+        }
+
+        std::string written()
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            return state->written;
+        }
+
+        std::shared_ptr<GateSink::State> state;
+        std::unique_ptr<AsyncLogWriter> writer;
+    };
+
+    std::string record(int i)
+    {
+        return "record " + std::to_string(i) + "\n";
+    }
+
+    // 가득 차면 버리고 개수만 센다
+    void testDrop()
+    {
+        Fixture fixture(AsyncLogWriter::OverflowPolicy::Drop);
+        fixture.stallWriter();
+
+        for (int i = 0; i < 4; ++i)
+            CHECK(fixture.writer->Push(record(i)));
+        for (int i = 4; i < 7; ++i)
+            CHECK(!fixture.writer->Push(record(i)));
+
+        AsyncLogWriter::Stats stats = fixture.writer->GetStats();
+        CHECK(stats.pushed == 5);
+        CHECK(stats.dropped == 3);
+        CHECK(stats.maxQueuedRecords == 4);
+
+        fixture.open();
+        CHECK(fixture.writer->Flush(5000));
+        CHECK(fixture.written() == "stalled\nrecord 0\nrecord 1\nrecord 2\nrecord 3\n");
+        stats = fixture.writer->GetStats();
+        CHECK(stats.written == 5);
+        CHECK(stats.blockedPushes == 0);
+    }
+
+    // 버린 개수를 다음 batch 앞에 한 줄 남긴다
+    void testDropAndReport()
+    {
+        Fixture fixture(AsyncLogWriter::OverflowPolicy::DropAndReport);
+        fixture.stallWriter();
+
+        for (int i = 0; i < 6; ++i)
+            fixture.writer->Push(record(i));
+        CHECK(fixture.writer->GetStats().dropped == 2);
+
+        fixture.open();
+        CHECK(fixture.writer->Flush(5000));
+        CHECK(fixture.written() == "stalled\n[Log] 2 messages dropped\nrecord 0\nrecord 1\nrecord 2\nrecord 3\n");
+
+        // 보고한 뒤에는 다시 0 부터
+        CHECK(fixture.writer->Push(record(6)));
+        CHECK(fixture.writer->Flush(5000));
+        CHECK(fixture.written().find("[Log] 2 messages dropped", fixture.written().find("record 3")) == std::string::npos);
+    }
+
+    // 마지막 batch 뒤에 버린 것은 끝날 때 남긴다
+    void testReportOnShutdown()
+    {
+        auto state = std::make_shared<GateSink::State>();
+        {
+            Fixture fixture(AsyncLogWriter::OverflowPolicy::DropAndReport, 1);
+            state = fixture.state;
+            fixture.stallWriter();
+            CHECK(fixture.writer->Push(record(0)));
+            CHECK(!fixture.writer->Push(record(1)));
+            fixture.open();
+        }
+        CHECK(state->written == "stalled\n[Log] 1 messages dropped\nrecord 0\n");
+    }
+
+    // 자리가 날 때까지 기다리고 하나도 잃지 않는다
+    void testBlock()
+    {
+        Fixture fixture(AsyncLogWriter::OverflowPolicy::Block);
+        fixture.stallWriter();
+
+        for (int i = 0; i < 4; ++i)
+            CHECK(fixture.writer->Push(record(i)));
+
+        std::atomic<bool> pushed(false);
+        std::thread producer([&fixture, &pushed]()
+        {
+            CHECK(fixture.writer->Push(record(4)));
+            pushed = true;
+        });
+
+        while (fixture.writer->GetStats().blockedPushes == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(!pushed);
+
+        fixture.open();
+        producer.join();
+        CHECK(pushed);
+        CHECK(fixture.writer->Flush(5000));
+        CHECK(fixture.written() == "stalled\nrecord 0\nrecord 1\nrecord 2\nrecord 3\nrecord 4\n");
+
+        AsyncLogWriter::Stats stats = fixture.writer->GetStats();
+        CHECK(stats.dropped == 0);
+        CHECK(stats.blockedPushes == 1);
+        CHECK(stats.written == 6);
+    }
+
+    // Block 에서 바꾸면 기다리던 Push 는 버리고 돌아온다
+    void testPolicyChangeReleasesBlocked()
+    {
+        Fixture fixture(AsyncLogWriter::OverflowPolicy::Block, 1);
+        fixture.stallWriter();
+        CHECK(fixture.writer->Push(record(0)));
+
+        bool result = true;
+        std::thread producer([&fixture, &result]()
+        {
+            result = fixture.writer->Push(record(1));
+        });
+        while (fixture.writer->GetStats().blockedPushes == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        fixture.writer->SetOverflowPolicy(AsyncLogWriter::OverflowPolicy::Drop);
+        producer.join();
+        CHECK(!result);
+        CHECK(fixture.writer->GetStats().dropped == 1);
+        fixture.open();
+    }
+
+    // 개수가 아니라 크기로 찬 경우. 비어 있으면 큰 record 도 받는다
+    void testByteLimit()
+    {
+        Fixture fixture(AsyncLogWriter::OverflowPolicy::Drop, 100, 32);
+        fixture.stallWriter();
+
+        CHECK(fixture.writer->Push(std::string(64, 'x') + "\n"));
+        CHECK(!fixture.writer->Push("small\n"));
+        fixture.open();
+        CHECK(fixture.writer->Flush(5000));
+        CHECK(fixture.writer->Push("small\n"));
+        CHECK(fixture.writer->Flush(5000));
+        CHECK(fixture.writer->GetStats().dropped == 1);
+    }
+
+    // sink 가 실패하면 writeRetryCount 만큼 다시 쓰고, 끝내 실패하면 failed 로 센다
+    void testWriteRetry()
+    {
+        {
+            Fixture fixture(AsyncLogWriter::OverflowPolicy::Drop);
+            fixture.state->failuresLeft = 2;
+            fixture.open();
+            CHECK(fixture.writer->Push(record(0)));
+            CHECK(fixture.writer->Flush(5000));
+            CHECK(fixture.written() == record(0));
+            CHECK(fixture.writer->GetStats().written == 1);
+            CHECK(fixture.writer->GetStats().failed == 0);
+        }
+        {
+            Fixture fixture(AsyncLogWriter::OverflowPolicy::Drop);
+            fixture.state->failuresLeft = 100;
+            fixture.open();
+            CHECK(fixture.writer->Push(record(0)));
+            CHECK(fixture.writer->Flush(5000));
+            CHECK(fixture.written().empty());
+            CHECK(fixture.writer->GetStats().failed == 1);
+            CHECK(fixture.state->failuresLeft == 100 - 4);
+        }
+    }
+}
+
+int main()
+{
+    testDrop();
+    testDropAndReport();
+    testReportOnShutdown();
+    testBlock();
+    testPolicyChangeReleasesBlocked();
+    testByteLimit();
+    testWriteRetry();
+    return Test::Result();
+}
\ No newline at end of file
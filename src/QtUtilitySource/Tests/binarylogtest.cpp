@@ -0,0 +1,230 @@
+#include "binarylog.h"
+#include "binarylogdecoder.h"
+#include "testsupport.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // 파일 대신 메모리에 쓴다. 처음 쓸 때 Preamble 을 먼저 (SegmentLogSink 가 파일을 열 때와 같이)
+    class MemorySink : public LogSink
+    {
+    public:
+        explicit MemorySink(std::shared_ptr<std::string> bytes)
+            : bytes_(std::move(bytes))
+            , started_(false)
+        {}
+
+        bool Write(const char* data, size_t size) override
+        {
+            if (!started_)
+            {
+                *bytes_ += BinaryLog::Preamble();
+                started_ = true;
+            }
+            bytes_->append(data, size);
+            return true;
+        }
+
+    private:
+        std::shared_ptr<std::string> bytes_;
+        bool started_;
+    };
+
+    int64_t nowMilliseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::vector<std::string> splitLines(const std::string& text)
+    {
+        std::vector<std::string> lines;
+        size_t begin = 0;
+        for (size_t end = text.find('\n'); end != std::string::npos; end = text.find('\n', begin))
+        {
+            lines.push_back(text.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        return lines;
+    }
+
+    // decode 한 한 줄이 text 로그 형식([날짜 시각][pid] [Level] 함수 메시지)이고 시각이 [from, to] 안인지
+    bool checkPrefix(const std::string& line, const std::string& from, const std::string& to, std::string* rest)
+    {
+        const size_t timestampEnd = line.find(']');
+        if (line.size() < 2 || line[0] != '[' || timestampEnd == std::string::npos)
+            return false;
+
+        const std::string timestamp = line.substr(1, timestampEnd - 1);
+        if (timestamp.size() != from.size() || timestamp < from || timestamp > to)
+            return false;
+
+        const size_t pidEnd = line.find("] ", timestampEnd + 1);
+        if (pidEnd == std::string::npos || line[timestampEnd + 1] != '[')
+            return false;
+
+        *rest = line.substr(pidEnd + 2);
+        return true;
+    }
+
+    struct Expected
+    {
+        std::string level;
+        std::string function;
+        std::string text;
+    };
+
+    // 같은 인자로 FormatText (binary 로그가 꺼져 있을 때 text 로그에 쓰는 것) 와 같은 줄이 나와야 한다
+    void testRoundTrip()
+    {
+        auto bytes = std::make_shared<std::string>();
+        const std::string from = BinaryLogDecoder::FormatTimestamp(nowMilliseconds());
+
+        BinaryLog::Open(std::unique_ptr<LogSink>(new MemorySink(bytes)));
+        const uint32_t info = BinaryLog::RegisterSite(3, "encode", "size {}x{} took {} ms");
+        const uint32_t warning = BinaryLog::RegisterSite(2, "publish", "failed: {} (retry {})");
+        const uint32_t debug = BinaryLog::RegisterSite(4, "cache", "hit {}");
+        const uint32_t critical = BinaryLog::RegisterSite(1, "crash", "no placeholders");
+        const uint32_t missing = BinaryLog::RegisterSite(3, "missing", "{} and {}");
+
+        std::vector<Expected> expected;
+        BinaryLog::Write(info, 1920, 1080u, 12.5);
+        expected.push_back({ "Info", "encode", BinaryLog::FormatText("size {}x{} took {} ms", 1920, 1080u, 12.5) });
+        BinaryLog::Write(warning, std::string("clipboard busy"), false);
+        expected.push_back({ "Warning", "publish", BinaryLog::FormatText("failed: {} (retry {})", std::string("clipboard busy"), false) });
+        BinaryLog::Write(debug, static_cast<const char*>(nullptr));
+        expected.push_back({ "Debug", "cache", BinaryLog::FormatText("hit {}", static_cast<const char*>(nullptr)) });
+        // 남는 인자는 공백으로 이어 붙인다
+        BinaryLog::Write(critical, -7, "extra", true);
+        expected.push_back({ "Critical", "crash", BinaryLog::FormatText("no placeholders", -7, "extra", true) });
+        // 모자라면 {} 가 그대로 남는다
+        BinaryLog::Write(missing, static_cast<int64_t>(INT64_MIN));
+        expected.push_back({ "Info", "missing", BinaryLog::FormatText("{} and {}", static_cast<int64_t>(INT64_MIN)) });
+        BinaryLog::Write(info, static_cast<uint64_t>(UINT64_MAX), static_cast<int16_t>(-1), 1e300);
+        expected.push_back({ "Info", "encode", BinaryLog::FormatText("size {}x{} took {} ms", static_cast<uint64_t>(UINT64_MAX), static_cast<int16_t>(-1), 1e300) });
+
+        BinaryLog::Close();
+        const std::string to = BinaryLogDecoder::FormatTimestamp(nowMilliseconds());
+
+        std::string text;
+        BinaryLogDecoder::Result result = {};
+        CHECK(BinaryLogDecoder::Decode(*bytes, &text, &result));
+        CHECK(result.records == expected.size());
+        CHECK(result.sessions == 1);
+        CHECK(result.unknownSites == 0);
+        CHECK(!result.truncated);
+
+        const std::vector<std::string> lines = splitLines(text);
+        CHECK(lines.size() == expected.size());
+        for (size_t i = 0; i < lines.size() && i < expected.size(); ++i)
+        {
+            std::string rest;
+            CHECK_CONTEXT(checkPrefix(lines[i], from, to, &rest), "line %zu: %s", i, lines[i].c_str());
+            const std::string want = "[" + expected[i].level + "] " + expected[i].function + " " + expected[i].text;
+            CHECK_CONTEXT(rest == want, "line %zu: '%s' != '%s'", i, rest.c_str(), want.c_str());
+        }
+        CHECK(text.find("size 1920x1080 took 12.5 ms") != std::string::npos);
+        CHECK(text.find("failed: clipboard busy (retry false)") != std::string::npos);
+    }
+
+    // 여러 스레드의 chunk 는 시간 순으로, 두 번 연 파일은 두 session 으로
+    void testThreadsAndSessions()
+    {
+        auto bytes = std::make_shared<std::string>();
+        const uint32_t site = BinaryLog::RegisterSite(3, "worker", "thread {} record {}");
+
+        for (int session = 0; session < 2; ++session)
+        {
+            BinaryLog::Open(std::unique_ptr<LogSink>(new MemorySink(bytes)));
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 3; ++t)
+            {
+                threads.emplace_back([site, t]()
+                {
+                    for (int i = 0; i < 500; ++i)
+                        BinaryLog::Write(site, t, i);
+                });
+            }
+            for (std::thread& thread : threads)
+                thread.join();
+            BinaryLog::Close();
+        }
+
+        std::string text;
+        BinaryLogDecoder::Result result = {};
+        CHECK(BinaryLogDecoder::Decode(*bytes, &text, &result));
+        CHECK(result.sessions == 2);
+        CHECK(result.records == 2 * 3 * 500);
+        CHECK(result.unknownSites == 0);
+
+        // 한 스레드 안의 순서는 그대로
+        std::vector<int> next(3, 0);
+        bool ordered = true;
+        for (const std::string& line : splitLines(text))
+        {
+            int thread = -1;
+            int record = -1;
+            const size_t at = line.find("worker thread ");
+            if (at == std::string::npos || std::sscanf(line.c_str() + at, "worker thread %d record %d", &thread, &record) != 2 || thread < 0 || thread > 2)
+            {
+                ordered = false;
+                break;
+            }
+            ordered = ordered && record == next[thread] % 500;
+            ++next[thread];
+        }
+        CHECK(ordered);
+    }
+
+    // 쓰는 중 끝난 파일: 온전한 frame 까지는 읽고 truncated 로 알린다
+    void testTruncated()
+    {
+        auto bytes = std::make_shared<std::string>();
+        BinaryLog::Open(std::unique_ptr<LogSink>(new MemorySink(bytes)));
+        const uint32_t site = BinaryLog::RegisterSite(3, "tail", "value {}");
+        for (int i = 0; i < 10; ++i)
+        {
+            BinaryLog::Write(site, i);
+            BinaryLog::Flush();
+        }
+        BinaryLog::Close();
+
+        const std::string cut = bytes->substr(0, bytes->size() - 3);
+        CHECK(BinaryLog::CompleteLength(cut.data(), cut.size()) < cut.size());
+
+        std::string text;
+        BinaryLogDecoder::Result result = {};
+        CHECK(BinaryLogDecoder::Decode(cut, &text, &result));
+        CHECK(result.truncated);
+        CHECK(result.records == 9);
+        CHECK(splitLines(text).size() == 9);
+
+        // Start frame 이 아니면 log 가 아니다
+        CHECK(!BinaryLogDecoder::Decode(std::string("plain text log\n"), &text));
+    }
+
+    // yyyy-MM-dd hh:mm:ss.zzz
+    void testTimestamp()
+    {
+        const std::string now = BinaryLogDecoder::FormatTimestamp(nowMilliseconds());
+        CHECK(now.size() == 23);
+        CHECK(now[4] == '-' && now[7] == '-' && now[10] == ' ' && now[13] == ':' && now[16] == ':' && now[19] == '.');
+        CHECK(BinaryLogDecoder::FormatTimestamp(nowMilliseconds() / 1000 * 1000 + 7).substr(20) == "007");
+    }
+}
+
+int main()
+{
+    testRoundTrip();
+    testThreadsAndSessions();
+    testTruncated();
+    testTimestamp();
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "bufferpool.h"
+#include "memorytracker.h"
+#include "testsupport.h"
+
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    const size_t KB = 1024;
+
+    // 64KB 아래는 모두 64KB, 그 위는 2 의 거듭제곱 사이를 4 단계로
+    void testSizeClass()
+    {
+        const size_t minBytes = BufferPool::MinPooledBytes();
+        CHECK(minBytes == 64 * KB);
+        CHECK(BufferPool::SizeClass(0) == minBytes);
+        CHECK(BufferPool::SizeClass(1) == minBytes);
+        CHECK(BufferPool::SizeClass(minBytes) == minBytes);
+        CHECK(BufferPool::SizeClass(minBytes + 1) == 80 * KB);
+        CHECK(BufferPool::SizeClass(100 * KB) == 112 * KB);
+        CHECK(BufferPool::SizeClass(128 * KB) == 128 * KB);
+        CHECK(BufferPool::SizeClass(128 * KB + 1) == 160 * KB);
+        CHECK(BufferPool::SizeClass(3 * 1024 * KB) == 3 * 1024 * KB);
+        CHECK(BufferPool::SizeClass(3 * 1024 * KB + 1) == 3584 * KB);
+
+        for (size_t bytes = minBytes; bytes < 64 * 1024 * KB; bytes = bytes * 9 / 8 + 4093)
+        {
+            const size_t classBytes = BufferPool::SizeClass(bytes);
+            CHECK_CONTEXT(classBytes >= bytes, "%zu", bytes);
+            CHECK_CONTEXT(classBytes - bytes <= bytes / 4, "%zu -> %zu", bytes, classBytes);
+            CHECK_CONTEXT(BufferPool::SizeClass(classBytes) == classBytes, "%zu", bytes);
+            CHECK_CONTEXT(classBytes % (16 * KB) == 0, "%zu", bytes);
+        }
+    }
+
+    // 같은 size class 는 반납된 버퍼를 다시 쓰고, 작은 버퍼는 보관하지 않는다
+    void testReuse()
+    {
+        BufferPool pool(64 * 1024 * KB);
+
+        size_t capacity = 0;
+        std::shared_ptr<uint8_t> buffer = pool.Acquire(100 * KB, &capacity);
+        CHECK(buffer && capacity == 112 * KB);
+        const uint8_t* first = buffer.get();
+        std::memset(buffer.get(), 0x5A, capacity);
+        CHECK(pool.Stats().outstandingBytes == 112 * KB);
+
+        buffer.reset();
+        BufferPoolStats stats = pool.Stats();
+        CHECK(stats.pooledCount == 1 && stats.pooledBytes == 112 * KB && stats.outstandingBytes == 0);
+        CHECK(stats.releases == 1);
+
+        buffer = pool.Acquire(110 * KB, &capacity);
+        CHECK(buffer.get() == first && capacity == 112 * KB);
+        stats = pool.Stats();
+        CHECK(stats.acquires == 2 && stats.reuses == 1 && stats.pooledCount == 0);
+
+        // 다른 size class 는 새로 할당한다
+        std::shared_ptr<uint8_t> other = pool.Acquire(120 * KB, &capacity);
+        CHECK(other && other.get() != first && capacity == 128 * KB);
+        CHECK(pool.Stats().reuses == 1);
+        CHECK(pool.Stats().peakOutstandingBytes == 240 * KB);
+
+        std::shared_ptr<uint8_t> small = pool.Acquire(1000, &capacity);
+        CHECK(small && capacity == 1000);
+        small.reset();
+        CHECK(pool.Stats().pooledCount == 0);
+        CHECK(pool.Stats().acquires == 3);
+
+        CHECK(!pool.Acquire(0, &capacity) && capacity == 0);
+
+        // pool 없이
+        std::shared_ptr<uint8_t> unpooled = BufferPool::Allocate(nullptr, 100 * KB, &capacity);
+        CHECK(unpooled && capacity == 100 * KB);
+        CHECK(BufferPool::Allocate(&pool, 100 * KB, &capacity).get() != nullptr && capacity == 112 * KB);
+    }
+
+    // 보관 한도를 넘으면 가장 오래전에 반납된 것부터 해제한다
+    void testRetainLimit()
+    {
+        BufferPool pool(200 * KB);
+        std::vector<std::shared_ptr<uint8_t>> buffers;
+        std::vector<const uint8_t*> addresses;
+        for (int i = 0; i < 4; ++i)
+        {
+            buffers.push_back(pool.Acquire(64 * KB));
+            addresses.push_back(buffers.back().get());
+        }
+
+        for (std::shared_ptr<uint8_t>& buffer : buffers)
+            buffer.reset();
+
+        BufferPoolStats stats = pool.Stats();
+        CHECK(stats.pooledCount == 3 && stats.pooledBytes == 192 * KB);
+        CHECK(stats.trimmedBytes == 64 * KB);
+
+        // 최근에 반납된 것부터 다시 쓴다
+        std::shared_ptr<uint8_t> reused = pool.Acquire(64 * KB);
+        CHECK(reused.get() == addresses[3]);
+        reused.reset();
+
+        pool.SetRetainLimit(64 * KB);
+        CHECK(pool.RetainLimit() == 64 * KB);
+        stats = pool.Stats();
+        CHECK(stats.pooledCount == 1 && stats.pooledBytes == 64 * KB && stats.trimmedBytes == 192 * KB);
+
+        pool.Trim();
+        CHECK(pool.Stats().pooledCount == 0 && pool.Stats().pooledBytes == 0);
+
+        // 한도보다 큰 버퍼는 반납하자마자 해제한다
+        pool.Acquire(1024 * KB).reset();
+        CHECK(pool.Stats().pooledCount == 0);
+        CHECK(pool.Stats().trimmedBytes == 1280 * KB);
+    }
+
+    // 할당이 실패하면 보관 중인 버퍼를 모두 놓고 다시 시도한다
+    void testTrimOnAllocationFailure()
+    {
+        BufferPool pool(64 * 1024 * KB);
+        pool.Acquire(64 * KB).reset();
+        pool.Acquire(200 * KB).reset();
+        CHECK(pool.Stats().pooledCount == 2);
+
+        size_t capacity = 1;
+        CHECK(!pool.Acquire(std::numeric_limits<size_t>::max() / 4, &capacity));
+        CHECK(capacity == 0);
+
+        const BufferPoolStats stats = pool.Stats();
+        CHECK(stats.pooledCount == 0 && stats.pooledBytes == 0);
+        CHECK(stats.trimmedBytes == 288 * KB);
+        CHECK(stats.outstandingBytes == 0);
+
+        // 그 뒤로도 정상 동작한다
+        CHECK(pool.Acquire(64 * KB) != nullptr);
+    }
+
+    // 빌려 간 버퍼는 pool 이 사라진 뒤 반납되어도 바로 해제된다
+    void testReleaseAfterPool()
+    {
+        const size_t before = MemoryTracker::CurrentBytes();
+
+        std::shared_ptr<uint8_t> buffer;
+        {
+            BufferPool pool(64 * 1024 * KB);
+            pool.Acquire(64 * KB).reset();
+            buffer = pool.Acquire(300 * KB);
+            CHECK(buffer != nullptr);
+            CHECK(MemoryTracker::CurrentBytes() == before + 64 * KB + 320 * KB);
+        }
+        CHECK(MemoryTracker::CurrentBytes() == before + 320 * KB);
+
+        // 아직 쓸 수 있다
+        std::memset(buffer.get(), 0x33, 300 * KB);
+        CHECK(buffer.get()[300 * KB - 1] == 0x33);
+
+        std::shared_ptr<uint8_t> copy = buffer;
+        buffer.reset();
+        CHECK(MemoryTracker::CurrentBytes() == before + 320 * KB);
+        copy.reset();
+        CHECK(MemoryTracker::CurrentBytes() == before);
+    }
+
+    // 모자라면 큰 size class 로 옮기며 내용을 유지한다
+    void testByteBuffer()
+    {
+        BufferPool pool(64 * 1024 * KB);
+        ByteBuffer bytes(&pool);
+        CHECK(bytes.IsEmpty() && bytes.ConstData() == nullptr);
+
+        std::vector<uint8_t> chunk(10000);
+        for (size_t i = 0; i < chunk.size(); ++i)
+            chunk[i] = static_cast<uint8_t>(i * 7);
+
+        for (int i = 0; i < 40; ++i)
+            CHECK(bytes.Append(chunk.data(), chunk.size()));
+        CHECK(bytes.Size() == 400000);
+        CHECK(bytes.Capacity() == BufferPool::SizeClass(bytes.Capacity()));
+        bool same = true;
+        for (size_t offset = 0; offset < bytes.Size(); offset += chunk.size())
+            same = same && std::memcmp(bytes.ConstData() + offset, chunk.data(), chunk.size()) == 0;
+        CHECK(same);
+
+        // 복사본은 데이터를 공유하고 원래 것을 비워도 남는다
+        ByteBuffer copy = bytes;
+        bytes.Clear();
+        CHECK(bytes.IsEmpty() && bytes.Capacity() == 0);
+        CHECK(copy.Size() == 400000 && std::memcmp(copy.ConstData(), chunk.data(), chunk.size()) == 0);
+
+        CHECK(copy.Resize(1000));
+        copy.ShrinkToFit();
+        CHECK(copy.Size() == 1000 && copy.Capacity() == 1000);
+        CHECK(std::memcmp(copy.ConstData(), chunk.data(), 1000) == 0);
+    }
+}
+
+int main()
+{
+    testSizeClass();
+    testReuse();
+    testRetainLimit();
+    testTrimOnAllocationFailure();
+    testReleaseAfterPool();
+    testByteBuffer();
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "cancellationtoken.h"
+#include "memoryclipboardbackend.h"
+#include "pixelbuffer.h"
+#include "testsupport.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // 바로 올리는 포맷(Png)을 몇 번 렌더링했는지 센다
+    class EagerSource : public ClipboardSource
+    {
+    public:
+        EagerSource()
+            : pixels_(PixelBuffer::Allocate(2, 2, PixelConverter::Format::BGRA))
+            , renders_(0)
+        {
+            std::memset(pixels_.Bits(), 0x40, pixels_.ByteCount());
+        }
+
+        std::vector<ClipboardFormat> Formats() const override { return { ClipboardFormat::Png, ClipboardFormat::DibV5 }; }
+        std::vector<ClipboardFormat> EagerFormats() const override { return { ClipboardFormat::Png }; }
+        size_t FormatSize(ClipboardFormat) const override { return 32; }
+
+        bool Render(ClipboardFormat format, uint8_t* dest, size_t size) const override
+        {
+            if (format == ClipboardFormat::Png)
+                ++renders_;
+            std::memset(dest, 1, size);
+            return true;
+        }
+
+        ImageView Pixels() const override { return pixels_.View(); }
+
+        int Renders() const { return renders_; }
+
+    private:
+        PixelBuffer pixels_;
+        mutable std::atomic<int> renders_;
+    };
+
+    ClipboardBackend::RetryPolicy makePolicy(int maxAttempts, double initialDelay, double maxDelay, double timeout)
+    {
+        ClipboardBackend::RetryPolicy policy;
+        policy.maxAttempts = maxAttempts;
+        policy.initialDelayMilliseconds = initialDelay;
+        policy.maxDelayMilliseconds = maxDelay;
+        policy.timeoutMilliseconds = timeout;
+        return policy;
+    }
+
+    bool readAny(MemoryClipboardBackend& backend, ClipboardBackend::Result* result, const CancellationToken* token = nullptr)
+    {
+        return backend.Read(ClipboardFormat::DibV5, [](const uint8_t*, size_t) { return true; }, result, token);
+    }
+
+    // 잡혀 있는 동안 기다렸다가 풀리면 올린다. 바로 올리는 포맷은 시도마다 다시 만들지 않는다
+    void testWaitsUntilReleased()
+    {
+        MemoryClipboardBackend backend;
+        backend.SetRetryPolicy(makePolicy(50, 2, 10, 2000));
+        backend.Hold(40);
+
+        auto source = std::make_shared<EagerSource>();
+        ClipboardBackend::Result result = {};
+        CHECK(backend.Publish(source, &result));
+        CHECK(result.failure == ClipboardFailure::None);
+        CHECK(result.attempts > 1);
+        CHECK(backend.RejectedAttempts() == result.attempts - 1);
+        CHECK_CONTEXT(result.contendedMilliseconds >= 30, "contended %.1f ms", result.contendedMilliseconds);
+        CHECK(result.contendedMilliseconds <= result.totalMilliseconds);
+        CHECK(source->Renders() == 1);
+
+        ClipboardBackend::ContentionStats stats = backend.Contention();
+        CHECK(stats.operations == 1);
+        CHECK(stats.contended == 1);
+        CHECK(stats.retries == static_cast<uint64_t>(result.attempts - 1));
+        CHECK(stats.busyFailures == 0);
+        CHECK(stats.contendedMilliseconds == result.contendedMilliseconds);
+        CHECK(stats.maxContendedMilliseconds == result.contendedMilliseconds);
+
+        // 기다리지 않은 작업은 operations 만 센다
+        CHECK(readAny(backend, &result));
+        CHECK(result.attempts == 1 && result.contendedMilliseconds == 0);
+        stats = backend.Contention();
+        CHECK(stats.operations == 2);
+        CHECK(stats.contended == 1);
+    }
+
+    // 대기 시간은 두 배씩 늘고 maxDelay 에서 멈춘다. maxAttempts 를 넘으면 Busy
+    void testBackoff()
+    {
+        MemoryClipboardBackend backend;
+        backend.SetRetryPolicy(makePolicy(6, 4, 16, 0));
+        backend.Hold(60 * 1000);
+
+        ClipboardBackend::Result result = {};
+        CHECK(!backend.Publish(std::make_shared<EagerSource>(), &result));
+        CHECK(result.failure == ClipboardFailure::Busy);
+        CHECK(result.attempts == 6);
+        CHECK(backend.RejectedAttempts() == 6);
+
+        // 4 + 8 + 16 + 16 + 16 (마지막 시도 뒤에는 기다리지 않는다)
+        CHECK_CONTEXT(result.totalMilliseconds >= 60, "total %.1f ms", result.totalMilliseconds);
+        CHECK_CONTEXT(result.totalMilliseconds < 1000, "total %.1f ms", result.totalMilliseconds);
+
+        ClipboardBackend::ContentionStats stats = backend.Contention();
+        CHECK(stats.operations == 1);
+        CHECK(stats.contended == 1);
+        CHECK(stats.retries == 5);
+        CHECK(stats.busyFailures == 1);
+
+        // 실패해도 Read 는 따로 센다
+        CHECK(!readAny(backend, &result));
+        CHECK(result.failure == ClipboardFailure::Busy);
+        stats = backend.Contention();
+        CHECK(stats.operations == 2);
+        CHECK(stats.busyFailures == 2);
+        CHECK(stats.retries == 10);
+    }
+
+    // timeout 이 maxAttempts 보다 먼저 끝낸다
+    void testTimeout()
+    {
+        MemoryClipboardBackend backend;
+        backend.SetRetryPolicy(makePolicy(100000, 5, 20, 100));
+        backend.Hold(60 * 1000);
+
+        ClipboardBackend::Result result = {};
+        CHECK(!backend.Publish(std::make_shared<EagerSource>(), &result));
+        CHECK(result.failure == ClipboardFailure::Busy);
+        CHECK(result.attempts < 100000);
+        // 다음 대기가 timeout 을 넘으면 기다리지 않고 끝낸다 (scheduling 여유 200ms)
+        CHECK_CONTEXT(result.totalMilliseconds <= 100 + 200, "total %.1f ms", result.totalMilliseconds);
+        CHECK_CONTEXT(result.totalMilliseconds >= 60, "total %.1f ms", result.totalMilliseconds);
+        CHECK(backend.Contention().busyFailures == 1);
+        CHECK(backend.AvailableFormats().empty());
+    }
+
+    // 기다리는 중에 다른 스레드가 Release 하거나 취소한다
+    void testReleaseAndCancel()
+    {
+        {
+            MemoryClipboardBackend backend;
+            backend.SetRetryPolicy(makePolicy(1000, 5, 5, 5000));
+            backend.Hold(60 * 1000);
+            std::thread releaser([&backend]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+                backend.Release();
+            });
+
+            ClipboardBackend::Result result = {};
+            CHECK(backend.Publish(std::make_shared<EagerSource>(), &result));
+            releaser.join();
+            CHECK(result.attempts > 1);
+            CHECK_CONTEXT(result.totalMilliseconds < 5000, "total %.1f ms", result.totalMilliseconds);
+        }
+
+        {
+            MemoryClipboardBackend backend;
+            backend.SetRetryPolicy(makePolicy(1000, 5, 5, 5000));
+            backend.Hold(60 * 1000);
+            CancellationToken token;
+            std::thread canceler([&token]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+                token.Cancel();
+            });
+
+            ClipboardBackend::Result result = {};
+            CHECK(!backend.Publish(std::make_shared<EagerSource>(), &result, &token));
+            canceler.join();
+            CHECK(result.failure == ClipboardFailure::Canceled);
+            CHECK(result.attempts > 1);
+            CHECK_CONTEXT(result.totalMilliseconds < 5000, "total %.1f ms", result.totalMilliseconds);
+
+            // 취소는 Busy 로 세지 않는다
+            ClipboardBackend::ContentionStats stats = backend.Contention();
+            CHECK(stats.busyFailures == 0);
+            CHECK(stats.contended == 1);
+        }
+
+        // 이미 취소된 token 이면 시도하지 않는다
+        {
+            MemoryClipboardBackend backend;
+            CancellationToken token;
+            token.Cancel();
+            ClipboardBackend::Result result = {};
+            CHECK(!readAny(backend, &result, &token));
+            CHECK(result.failure == ClipboardFailure::Canceled);
+            CHECK(result.attempts == 0);
+            CHECK(backend.RejectedAttempts() == 0);
+        }
+    }
+}
+
+int main()
+{
+    testWaitsUntilReleased();
+    testBackoff();
+    testTimeout();
+    testReleaseAndCancel();
+    return Test::Result();
+}
\ No newline at end of file
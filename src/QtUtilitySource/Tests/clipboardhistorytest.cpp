@@ -0,0 +1,352 @@
+#include "clipboardhistory.h"
+#include "lz4block.h"
+#include "testsupport.h"
+#include "threadpool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using PixelConverter::Format;
+
+    const uint8_t GUARD = 0xA5;
+    const size_t GUARD_BYTES = 64;
+
+    std::vector<uint8_t> randomBytes(size_t size, uint32_t seed)
+    {
+        std::vector<uint8_t> bytes(size);
+        for (uint8_t& byte : bytes)
+        {
+            seed = seed * 1664525 + 1013904223;
+            byte = static_cast<uint8_t>(seed >> 24);
+        }
+        return bytes;
+    }
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& source)
+    {
+        std::vector<uint8_t> compressed(Lz4Block::CompressBound(source.size()));
+        const size_t size = Lz4Block::Compress(source.data(), source.size(), compressed.data(), compressed.size());
+        compressed.resize(size);
+        return compressed;
+    }
+
+    // dest 뒤에 guard 를 두고 풀어서 밖을 쓰지 않았는지도 본다
+    bool decompress(const std::vector<uint8_t>& compressed, size_t destSize, std::vector<uint8_t>* result)
+    {
+        std::vector<uint8_t> dest(destSize + GUARD_BYTES, GUARD);
+        const bool ok = Lz4Block::Decompress(compressed.data(), compressed.size(), dest.data(), destSize);
+        for (size_t i = destSize; i < dest.size(); ++i)
+        {
+            if (dest[i] != GUARD)
+            {
+                std::fprintf(stderr, "wrote past dest at %zu\n", i - destSize);
+                ++Test::Failures();
+                break;
+            }
+        }
+        dest.resize(destSize);
+        if (result)
+            *result = dest;
+        return ok;
+    }
+
+    bool roundTrips(const std::vector<uint8_t>& source)
+    {
+        const std::vector<uint8_t> compressed = compress(source);
+        std::vector<uint8_t> restored;
+        return !compressed.empty() && compressed.size() <= Lz4Block::CompressBound(source.size())
+            && decompress(compressed, source.size(), &restored) && restored == source;
+    }
+
+    void testLz4RoundTrip()
+    {
+        CHECK(roundTrips(std::vector<uint8_t>()));
+        for (size_t size = 1; size <= 40; ++size)
+        {
+            CHECK_CONTEXT(roundTrips(randomBytes(size, static_cast<uint32_t>(size))), "random %zu", size);
+            CHECK_CONTEXT(roundTrips(std::vector<uint8_t>(size, 7)), "repeated %zu", size);
+        }
+
+        // 압축되지 않는 입력은 bound 안에서 literal 로 간다
+        const std::vector<uint8_t> noise = randomBytes(300000, 1);
+        CHECK(roundTrips(noise));
+        CHECK(compress(noise).size() > noise.size());
+
+        // 한 byte 반복 (offset 1 의 겹치는 match) 과 짧은 주기의 반복
+        const std::vector<uint8_t> zeros(1 << 20, 0);
+        CHECK(roundTrips(zeros));
+        CHECK(compress(zeros).size() < zeros.size() / 100);
+
+        std::vector<uint8_t> pattern(1 << 20);
+        for (size_t i = 0; i < pattern.size(); ++i)
+            pattern[i] = static_cast<uint8_t>("clipboard"[i % 9]);
+        CHECK(roundTrips(pattern));
+        CHECK(compress(pattern).size() < pattern.size() / 100);
+
+        // 반복과 잡음이 섞인 것 (65535 를 넘는 거리는 match 로 쓰지 않는다)
+        std::vector<uint8_t> mixed = randomBytes(200000, 2);
+        std::memcpy(mixed.data() + 100000, mixed.data(), 50000);
+        std::memcpy(mixed.data() + 160000, mixed.data() + 155000, 30000);
+        CHECK(roundTrips(mixed));
+
+        // dest 가 모자라면 0
+        std::vector<uint8_t> small(10);
+        CHECK(Lz4Block::Compress(noise.data(), noise.size(), small.data(), small.size()) == 0);
+    }
+
+    void testLz4RejectsCorruptInput()
+    {
+        std::vector<uint8_t> source = randomBytes(5000, 3);
+        std::memcpy(source.data() + 2500, source.data(), 2000);
+        const std::vector<uint8_t> compressed = compress(source);
+
+        // 풀린 크기가 정확히 맞아야 한다
+        CHECK(!decompress(compressed, source.size() - 1, nullptr));
+        CHECK(!decompress(compressed, source.size() + 1, nullptr));
+
+        // 어디서 잘려도 실패한다
+        for (size_t cut = 0; cut < compressed.size(); ++cut)
+        {
+            std::vector<uint8_t> truncated(compressed.begin(), compressed.begin() + cut);
+            CHECK_CONTEXT(!decompress(truncated, source.size(), nullptr), "cut at %zu", cut);
+        }
+
+        // 쓴 것보다 먼 offset, offset 0
+        const uint8_t farOffset[] = { 0x14, 'a', 0x10, 0x00, 0x00 };
+        CHECK(!decompress(std::vector<uint8_t>(farOffset, farOffset + sizeof(farOffset)), 9, nullptr));
+        const uint8_t zeroOffset[] = { 0x14, 'a', 0x00, 0x00, 0x00 };
+        CHECK(!decompress(std::vector<uint8_t>(zeroOffset, zeroOffset + sizeof(zeroOffset)), 9, nullptr));
+
+        // 남은 입력보다 긴 literal, 끝나지 않는 길이
+        const uint8_t longLiteral[] = { 0xF0, 0x20, 'a', 'b' };
+        CHECK(!decompress(std::vector<uint8_t>(longLiteral, longLiteral + sizeof(longLiteral)), 47, nullptr));
+        const uint8_t endlessLength[] = { 0xF0, 0xFF, 0xFF };
+        CHECK(!decompress(std::vector<uint8_t>(endlessLength, endlessLength + sizeof(endlessLength)), 1000, nullptr));
+
+        // 아무 byte 나 바꿔도 dest 밖을 쓰지 않는다 (실패하지 않을 수도 있다)
+        for (size_t i = 0; i < compressed.size(); i += 7)
+        {
+            std::vector<uint8_t> corrupt = compressed;
+            corrupt[i] ^= 0x5A;
+            decompress(corrupt, source.size(), nullptr);
+        }
+    }
+
+    PixelBuffer makePixels(int width, int height, uint32_t seed)
+    {
+        PixelBuffer pixels = PixelBuffer::Allocate(width, height, Format::BGRA);
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = pixels.ScanLine(y);
+            for (int x = 0; x < width; ++x)
+            {
+                seed = seed * 1664525 + 1013904223;
+                row[x * 4] = static_cast<uint8_t>(x / 16 + seed % 3);
+                row[x * 4 + 1] = static_cast<uint8_t>(y);
+                row[x * 4 + 2] = static_cast<uint8_t>(seed >> 28);
+                row[x * 4 + 3] = 255;
+            }
+        }
+        return pixels;
+    }
+
+    PixelBuffer copyPixels(const PixelBuffer& source)
+    {
+        PixelBuffer copy = PixelBuffer::Allocate(source.Width(), source.Height(), source.Format());
+        for (int y = 0; y < source.Height(); ++y)
+            std::memcpy(copy.ScanLine(y), source.ConstScanLine(y), static_cast<size_t>(source.Width()) * 4);
+        return copy;
+    }
+
+    bool samePixels(const PixelBuffer& a, const PixelBuffer& b)
+    {
+        if (a.Width() != b.Width() || a.Height() != b.Height() || a.Format() != b.Format())
+            return false;
+        for (int y = 0; y < a.Height(); ++y)
+        {
+            if (std::memcmp(a.ConstScanLine(y), b.ConstScanLine(y), static_cast<size_t>(a.Width()) * 4) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    ByteBuffer makeBytes(const std::string& text)
+    {
+        ByteBuffer bytes;
+        bytes.Append(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+        return bytes;
+    }
+
+    PixmapClipboardSource::EncodedBytes makeSource(const std::string& text)
+    {
+        std::shared_ptr<std::string> owner = std::make_shared<std::string>(text);
+        PixmapClipboardSource::EncodedBytes source;
+        source.owner = owner;
+        source.data = reinterpret_cast<const uint8_t*>(owner->data());
+        source.size = owner->size();
+        return source;
+    }
+
+    ClipboardHistory::Item makeItem(const PixelBuffer& pixels, const std::string& png, const std::string& source)
+    {
+        ClipboardHistory::Item item;
+        item.pixels = pixels;
+        if (!png.empty())
+            item.png = makeBytes(png);
+        if (!source.empty())
+            item.source = makeSource(source);
+        return item;
+    }
+
+    std::string text(const ByteBuffer& bytes)
+    {
+        return std::string(reinterpret_cast<const char*>(bytes.ConstData()), bytes.Size());
+    }
+
+    // block 여러 개로 나뉘는 이미지의 픽셀은 풀어서, PNG 와 원본은 보관한 것을 공유해서 돌려준다
+    void testRestore(ThreadPool* pool)
+    {
+        ClipboardHistory history(64 * 1024 * 1024, 10, pool);
+        const PixelBuffer pixels = makePixels(301, 700, 1);
+        const ClipboardHistory::Item item = makeItem(pixels, "png bytes", "original jpeg");
+
+        const uint64_t id = history.Add(item);
+        CHECK(id != 0);
+
+        ClipboardHistory::Item restored;
+        CHECK(history.Restore(id, &restored));
+        CHECK(samePixels(restored.pixels, pixels));
+        CHECK(restored.pixels.ConstBits() != pixels.ConstBits());
+        CHECK(text(restored.png) == "png bytes");
+        CHECK(restored.source.size == 13 && std::memcmp(restored.source.data, "original jpeg", 13) == 0);
+        CHECK(restored.source.data == item.source.data);
+
+        const std::vector<ClipboardHistory::EntryInfo> entries = history.Entries();
+        CHECK(entries.size() == 1);
+        if (entries.size() == 1)
+        {
+            CHECK(entries[0].width == 301 && entries[0].height == 700);
+            CHECK(entries[0].hasPng && entries[0].hasSource);
+            CHECK(entries[0].rawBytes == 301 * 700 * 4 + 9 + 13);
+            CHECK(entries[0].storedBytes < entries[0].rawBytes);
+        }
+        CHECK(history.Stats().restores == 1);
+
+        // 픽셀 없이 파일만
+        const uint64_t sourceOnly = history.Add(makeItem(PixelBuffer(), std::string(), "gif bytes"));
+        CHECK(sourceOnly != 0 && sourceOnly != id);
+        CHECK(history.Restore(sourceOnly, &restored));
+        CHECK(restored.pixels.IsNull());
+        CHECK(restored.source.size == 9);
+
+        CHECK(!history.Restore(12345, &restored));
+        CHECK(history.Add(ClipboardHistory::Item()) == 0);
+    }
+
+    // 같은 내용이면 다시 압축하지 않고 같은 id 를 돌려준다. hash 가 같아도 내용이 다르면 따로 보관한다
+    void testDeduplicate(ThreadPool* pool)
+    {
+        ClipboardHistory history(64 * 1024 * 1024, 10, pool);
+        const PixelBuffer pixels = makePixels(200, 150, 2);
+
+        const uint64_t first = history.Add(makeItem(pixels, "png", std::string()));
+        const uint64_t other = history.Add(makeItem(makePixels(200, 150, 3), "png", std::string()));
+        CHECK(first != 0 && other != 0 && first != other);
+
+        // 다른 버퍼에 담긴 같은 이미지
+        CHECK(history.Add(makeItem(copyPixels(pixels), "png", std::string())) == first);
+        CHECK(history.Stats().duplicates == 1);
+        CHECK(history.Stats().entryCount == 2);
+        // 가장 최근으로 옮겨진다
+        CHECK(!history.Entries().empty() && history.Entries().front().id == first);
+
+        // 픽셀이 있으면 hash 는 PNG 를 보지 않는다. PNG 가 다르면 다른 항목이다
+        const uint64_t otherPng = history.Add(makeItem(pixels, "another png", std::string()));
+        CHECK(otherPng != 0 && otherPng != first);
+        const uint64_t samePngSize = history.Add(makeItem(pixels, "PNG", std::string()));
+        CHECK(samePngSize != 0 && samePngSize != first && samePngSize != otherPng);
+
+        ClipboardHistory::Item restored;
+        CHECK(history.Restore(first, &restored) && text(restored.png) == "png");
+        CHECK(history.Restore(otherPng, &restored) && text(restored.png) == "another png");
+        CHECK(history.Restore(samePngSize, &restored) && text(restored.png) == "PNG");
+
+        // 가려진 항목도 그대로 지울 수 있고, 새 항목은 계속 찾아진다
+        CHECK(history.Remove(first));
+        CHECK(history.Add(makeItem(pixels, "PNG", std::string())) == samePngSize);
+        CHECK(history.Stats().duplicates == 2);
+    }
+
+    bool restores(ClipboardHistory& history, uint64_t id)
+    {
+        ClipboardHistory::Item item;
+        return history.Restore(id, &item);
+    }
+
+    // budget 과 최대 개수를 넘으면 가장 오래 쓰지 않은 것부터 지운다
+    void testEviction()
+    {
+        std::vector<PixelBuffer> images;
+        for (uint32_t i = 0; i < 4; ++i)
+            images.push_back(makePixels(128, 128, 10 + i));
+
+        ClipboardHistory history(64 * 1024 * 1024, 3);
+        std::vector<uint64_t> ids;
+        for (const PixelBuffer& image : images)
+            ids.push_back(history.Add(makeItem(image, std::string(), std::string())));
+        CHECK(history.Stats().entryCount == 3);
+        CHECK(history.Stats().evictions == 1);
+        CHECK(!restores(history, ids[0]));
+        CHECK(restores(history, ids[1]));
+
+        // Restore 한 것은 최근으로 옮겨져 남는다
+        history.SetMaxEntries(2);
+        CHECK(restores(history, ids[1]));
+        CHECK(!restores(history, ids[2]));
+        CHECK(restores(history, ids[3]));
+
+        // budget 은 압축한 크기로 센다
+        const std::vector<ClipboardHistory::EntryInfo> entries = history.Entries();
+        CHECK(entries.size() == 2);
+        if (entries.size() == 2)
+        {
+            history.SetBudget(entries[0].storedBytes + entries[1].storedBytes - 1);
+            CHECK(history.Stats().entryCount == 1);
+            CHECK(history.Entries().front().id == entries[0].id);
+            CHECK(history.Stats().storedBytes == entries[0].storedBytes);
+
+            // budget 보다 큰 항목은 보관하지 않는다
+            history.SetBudget(entries[0].storedBytes / 2);
+            CHECK(history.Stats().entryCount == 0);
+            CHECK(history.Add(makeItem(images[0], std::string(), std::string())) == 0);
+        }
+
+        history.SetBudget(64 * 1024 * 1024);
+        history.SetMaxEntries(0);
+        CHECK(history.Add(makeItem(images[0], std::string(), std::string())) == 0);
+
+        history.SetMaxEntries(3);
+        CHECK(history.Add(makeItem(images[0], std::string(), std::string())) != 0);
+        history.Clear();
+        CHECK(history.Stats().entryCount == 0 && history.Stats().storedBytes == 0 && history.Entries().empty());
+    }
+}
+
+int main()
+{
+    ThreadPool pool(4);
+
+    testLz4RoundTrip();
+    testLz4RejectsCorruptInput();
+    testRestore(nullptr);
+    testRestore(&pool);
+    testDeduplicate(nullptr);
+    testDeduplicate(&pool);
+    testEviction();
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include "cancellationtoken.h"
+#include "clipboardreader.h"
+#include "memoryclipboardbackend.h"
+#include "pixelbuffer.h"
+#include "pngencoder.h"
+#include "testsupport.h"
+#include "threadpool.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const size_t V5_HEADER_SIZE = 124;  // BITMAPV5HEADER
+    const uint32_t BI_RGB_COMPRESSION = 0;
+    const uint32_t BI_BITFIELDS_COMPRESSION = 3;
+
+    // 위쪽 row 부터 BGRA. alpha 가 없으면 0xFF
+    PixelBuffer makePixels(int width, int height, bool alpha)
+    {
+        PixelBuffer pixels = PixelBuffer::Allocate(width, height, PixelConverter::Format::BGRA);
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = pixels.ScanLine(y);
+            for (int x = 0; x < width; ++x)
+            {
+                row[x * 4 + 0] = static_cast<uint8_t>(x * 9);
+                row[x * 4 + 1] = static_cast<uint8_t>(y * 17);
+                row[x * 4 + 2] = static_cast<uint8_t>(x + y);
+                row[x * 4 + 3] = alpha ? static_cast<uint8_t>(x * 31 + y) : 0xFF;
+            }
+        }
+        return pixels;
+    }
+
+    void writeUint32(uint8_t* p, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+
+    // 32bpp BI_BITFIELDS (alphaMask 가 0 이 아니면 alpha 포함) 또는 24bpp BI_RGB 인 DIBV5
+    std::vector<uint8_t> makeDibV5(const PixelBuffer& pixels, bool topDown, int bitCount, uint32_t alphaMask = 0xFF000000)
+    {
+        const int width = pixels.Width();
+        const int height = pixels.Height();
+        const size_t stride = (static_cast<size_t>(width) * bitCount + 31) / 32 * 4;
+
+        std::vector<uint8_t> dib(V5_HEADER_SIZE + stride * height, 0);
+        uint8_t* header = dib.data();
+        writeUint32(header, static_cast<uint32_t>(V5_HEADER_SIZE));
+        writeUint32(header + 4, static_cast<uint32_t>(width));
+        writeUint32(header + 8, static_cast<uint32_t>(topDown ? -height : height));
+        header[12] = 1;
+        header[14] = static_cast<uint8_t>(bitCount);
+        writeUint32(header + 16, bitCount == 32 ? BI_BITFIELDS_COMPRESSION : BI_RGB_COMPRESSION);
+        writeUint32(header + 20, static_cast<uint32_t>(stride * height));
+        if (bitCount == 32)
+        {
+            writeUint32(header + 40, 0x00FF0000);
+            writeUint32(header + 44, 0x0000FF00);
+            writeUint32(header + 48, 0x000000FF);
+            writeUint32(header + 52, alphaMask);
+        }
+
+        for (int y = 0; y < height; ++y)
+        {
+            const uint8_t* src = pixels.ConstScanLine(y);
+            uint8_t* dest = dib.data() + V5_HEADER_SIZE + stride * (topDown ? y : height - 1 - y);
+            for (int x = 0; x < width; ++x)
+                std::memcpy(dest + x * (bitCount / 8), src + x * 4, bitCount / 8);
+        }
+        return dib;
+    }
+
+    std::vector<uint8_t> makePng(const PixelBuffer& pixels)
+    {
+        std::vector<uint8_t> png;
+        PngEncoder().Encode(pixels.View(), [&png](const uint8_t* data, size_t size)
+        {
+            png.insert(png.end(), data, data + size);
+            return true;
+        });
+        return png;
+    }
+
+    // 읽은 결과를 BGRA 로 받는다
+    struct Decoded
+    {
+        ClipboardReader::Result result;
+        std::vector<uint8_t> pixels;
+        int lastRowsDone = -1;
+    };
+
+    Decoded read(MemoryClipboardBackend& backend, ThreadPool* pool = nullptr, const CancellationToken* token = nullptr)
+    {
+        Decoded decoded;
+        ClipboardReader reader(pool);
+        decoded.result = reader.Read(backend, [&decoded](int width, int height, bool)
+        {
+            decoded.pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+            return ClipboardReader::Target{ decoded.pixels.data(), width * 4 };
+        }, [&decoded](int rowsDone, int)
+        {
+            decoded.lastRowsDone = rowsDone;
+        }, token);
+        return decoded;
+    }
+
+    bool samePixels(const Decoded& decoded, const PixelBuffer& pixels)
+    {
+        if (decoded.pixels.size() != pixels.ByteCount())
+            return false;
+        return std::memcmp(decoded.pixels.data(), pixels.ConstBits(), pixels.ByteCount()) == 0;
+    }
+
+    void testPng(ThreadPool* pool)
+    {
+        for (bool alpha : { true, false })
+        {
+            PixelBuffer pixels = makePixels(37, 21, alpha);
+            MemoryClipboardBackend backend;
+            backend.SetData(ClipboardFormat::Png, makePng(pixels));
+
+            Decoded decoded = read(backend, pool);
+            CHECK(decoded.result.ok);
+            CHECK(decoded.result.format == ClipboardFormat::Png);
+            CHECK(decoded.result.width == 37 && decoded.result.height == 21);
+            CHECK(decoded.result.hasAlpha == alpha);
+            CHECK(decoded.result.failure == ClipboardFailure::None);
+            CHECK(decoded.lastRowsDone == 21);
+            CHECK_CONTEXT(samePixels(decoded, pixels), "alpha %d", alpha);
+        }
+    }
+
+    // bottom-up 과 top-down, 32bpp alpha / 32bpp 불투명 / 24bpp (row 끝 padding)
+    void testDibV5(ThreadPool* pool)
+    {
+        for (bool topDown : { true, false })
+        {
+            for (int bitCount : { 32, 24 })
+            {
+                for (bool alpha : { true, false })
+                {
+                    if (bitCount == 24 && alpha)
+                        continue;
+
+                    PixelBuffer pixels = makePixels(13, 9, alpha);
+                    MemoryClipboardBackend backend;
+                    backend.SetData(ClipboardFormat::DibV5, makeDibV5(pixels, topDown, bitCount, alpha ? 0xFF000000 : 0));
+
+                    Decoded decoded = read(backend, pool);
+                    CHECK(decoded.result.ok);
+                    CHECK(decoded.result.format == ClipboardFormat::DibV5);
+                    CHECK(decoded.result.width == 13 && decoded.result.height == 9);
+                    CHECK(decoded.result.hasAlpha == alpha);
+                    CHECK(decoded.lastRowsDone == 9);
+                    CHECK_CONTEXT(samePixels(decoded, pixels), "top-down %d, %d bpp, alpha %d", topDown, bitCount, alpha);
+                }
+            }
+        }
+    }
+
+    // alpha mask 가 있어도 alpha 가 모두 0 이면 불투명
+    void testDibV5ZeroAlpha()
+    {
+        PixelBuffer pixels = makePixels(6, 4, false);
+        std::vector<uint8_t> dib = makeDibV5(pixels, true, 32);
+        for (size_t i = V5_HEADER_SIZE + 3; i < dib.size(); i += 4)
+            dib[i] = 0;
+
+        MemoryClipboardBackend backend;
+        backend.SetData(ClipboardFormat::DibV5, dib);
+        Decoded decoded = read(backend);
+        CHECK(decoded.result.ok);
+        CHECK(!decoded.result.hasAlpha);
+        CHECK(samePixels(decoded, pixels));
+    }
+
+    // 잘리거나 깨진 PNG 는 DIBV5 로 넘어가고, DIBV5 도 없으면 실패
+    void testCorruptPng()
+    {
+        PixelBuffer pixels = makePixels(40, 30, true);
+        const std::vector<uint8_t> png = makePng(pixels);
+
+        std::vector<uint8_t> truncated(png.begin(), png.begin() + png.size() / 2);
+        std::vector<uint8_t> corrupt = png;
+        // IDAT 내용 (signature 8 + IHDR 25 + IDAT length, type 8 뒤)
+        for (size_t i = 8 + 25 + 8 + 2; i < corrupt.size() - 12; i += 7)
+            corrupt[i] ^= 0xA5;
+        std::vector<uint8_t> header(png.begin(), png.begin() + 20);
+
+        for (const std::vector<uint8_t>* payload : { &truncated, &corrupt, &header })
+        {
+            MemoryClipboardBackend pngOnly;
+            pngOnly.SetData(ClipboardFormat::Png, *payload);
+            Decoded decoded = read(pngOnly);
+            CHECK(!decoded.result.ok);
+
+            MemoryClipboardBackend withDib;
+            withDib.SetData(ClipboardFormat::Png, *payload);
+            withDib.SetData(ClipboardFormat::DibV5, makeDibV5(pixels, false, 32));
+            decoded = read(withDib);
+            CHECK(decoded.result.ok);
+            CHECK(decoded.result.format == ClipboardFormat::DibV5);
+            CHECK(samePixels(decoded, pixels));
+        }
+    }
+
+    // header 가 틀렸거나 픽셀이 모자란 DIBV5 는 실패
+    void testCorruptDibV5()
+    {
+        PixelBuffer pixels = makePixels(16, 8, true);
+        const std::vector<uint8_t> dib = makeDibV5(pixels, false, 32);
+
+        std::vector<std::vector<uint8_t>> payloads;
+        payloads.emplace_back(dib.begin(), dib.end() - 1);                  // 마지막 row 가 모자람
+        payloads.emplace_back(dib.begin(), dib.begin() + 30);               // header 도 모자람
+        payloads.push_back(dib);
+        writeUint32(payloads.back().data(), 4096);                          // header 크기가 data 보다 큼
+        payloads.push_back(dib);
+        writeUint32(payloads.back().data() + 4, 0);                         // 폭 0
+        payloads.push_back(dib);
+        payloads.back()[14] = 16;                                           // 지원하지 않는 bpp
+        payloads.push_back(dib);
+        writeUint32(payloads.back().data() + 40, 0x00F0F000);               // 8bit 가 아닌 mask
+        payloads.push_back(dib);
+        writeUint32(payloads.back().data() + 8, 0x80000000);                // INT32_MIN 높이
+
+        for (size_t i = 0; i < payloads.size(); ++i)
+        {
+            MemoryClipboardBackend backend;
+            backend.SetData(ClipboardFormat::DibV5, payloads[i]);
+            Decoded decoded = read(backend);
+            CHECK_CONTEXT(!decoded.result.ok, "payload %zu", i);
+            CHECK(decoded.result.format == ClipboardFormat::DibV5);
+        }
+    }
+
+    // 올라간 이미지를 읽는 경우: PixmapClipboardSource 가 만든 PNG 를 먼저 읽는다
+    void testPublishedSource()
+    {
+        PixelBuffer pixels = makePixels(33, 17, true);
+        MemoryClipboardBackend backend;
+        backend.SetData(ClipboardFormat::DibV5, makeDibV5(pixels, true, 32));
+        backend.SetData(ClipboardFormat::Png, makePng(pixels));
+
+        Decoded decoded = read(backend);
+        CHECK(decoded.result.ok);
+        CHECK(decoded.result.format == ClipboardFormat::Png);
+        CHECK(samePixels(decoded, pixels));
+    }
+
+    void testEmptyAndCanceled()
+    {
+        MemoryClipboardBackend empty;
+        Decoded decoded = read(empty);
+        CHECK(!decoded.result.ok);
+        CHECK(decoded.pixels.empty());
+
+        MemoryClipboardBackend backend;
+        backend.SetData(ClipboardFormat::Png, makePng(makePixels(8, 8, true)));
+        CancellationToken token;
+        token.Cancel();
+        decoded = read(backend, nullptr, &token);
+        CHECK(!decoded.result.ok);
+        CHECK(decoded.result.failure == ClipboardFailure::Canceled);
+    }
+}
+
+int main()
+{
+    ThreadPool pool(4);
+    for (ThreadPool* p : { static_cast<ThreadPool*>(nullptr), &pool })
+    {
+        testPng(p);
+        testDibV5(p);
+    }
+    testDibV5ZeroAlpha();
+    testCorruptPng();
+    testCorruptDibV5();
+    testPublishedSource();
+    testEmptyAndCanceled();
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "flightrecorder.h"
+#include "testsupport.h"
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const size_t RECORDS_PER_THREAD = 8;
+    const size_t MAX_RECORD_BYTES = 24;
+
+    void record(int level, const std::string& text)
+    {
+        FlightRecorder::Record(level, text.data(), text.size());
+    }
+
+    // ring 이 돌면 가장 오래된 것부터 덮어쓰고, Take 는 남은 것을 순서대로 꺼낸다
+    void testOverwrite()
+    {
+        const FlightRecorder::Stats before = FlightRecorder::GetStats();
+        for (int i = 0; i < 20; ++i)
+            record(4, "debug " + std::to_string(i));
+
+        std::vector<FlightRecorder::Entry> records = FlightRecorder::Take();
+        CHECK(records.size() == RECORDS_PER_THREAD);
+        bool ordered = records.size() == RECORDS_PER_THREAD;
+        for (size_t i = 0; ordered && i < records.size(); ++i)
+            ordered = records[i].text == "debug " + std::to_string(12 + i) && records[i].level == 4;
+        CHECK(ordered);
+
+        const FlightRecorder::Stats after = FlightRecorder::GetStats();
+        CHECK(after.recorded - before.recorded == 20);
+        CHECK(after.overwritten - before.overwritten == 12);
+
+        // 한 번 꺼낸 것은 다시 나오지 않는다
+        CHECK(FlightRecorder::Take().empty());
+
+        record(3, "after take");
+        records = FlightRecorder::Take();
+        CHECK(records.size() == 1 && records[0].text == "after take" && records[0].level == 3);
+        CHECK(records.size() == 1 && records[0].unixMilliseconds > 0);
+    }
+
+    // maxRecordBytes (8 byte 단위로 올림) 를 넘는 부분은 자르되 UTF-8 글자 중간에서 자르지 않는다
+    void testTruncate()
+    {
+        const uint64_t truncatedBefore = FlightRecorder::GetStats().truncated;
+
+        record(4, std::string(40, 'a'));
+        // 3 byte 글자 (U+D55C) 가 24 byte 경계에 걸친다
+        record(4, std::string(22, 'b') + "\xED\x95\x9C" + "tail");
+
+        std::vector<FlightRecorder::Entry> records = FlightRecorder::Take();
+        CHECK(records.size() == 2);
+        if (records.size() == 2)
+        {
+            CHECK(records[0].text == std::string(24, 'a'));
+            CHECK(records[1].text == std::string(22, 'b'));
+        }
+        CHECK(FlightRecorder::GetStats().truncated - truncatedBefore == 2);
+    }
+
+    // 스레드마다 ring 이 따로 있고, 끝난 스레드의 ring 은 남은 record 와 함께 다음 스레드가 이어 쓴다
+    void testThreads()
+    {
+        FlightRecorder::Take();
+        const size_t ringsBefore = FlightRecorder::GetStats().threads;
+
+        // 모두 ring 을 잡은 뒤에 끝나야 ring 이 세 개 생긴다
+        std::atomic<int> ready(0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 3; ++t)
+        {
+            threads.emplace_back([t, &ready]()
+            {
+                for (int i = 0; i < 4; ++i)
+                    record(4, "thread " + std::to_string(t) + " " + std::to_string(i));
+                ++ready;
+                while (ready < 3)
+                    std::this_thread::yield();
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        CHECK(FlightRecorder::GetStats().threads == ringsBefore + 3);
+
+        std::thread reuse([]()
+        {
+            record(4, "reused");
+        });
+        reuse.join();
+        CHECK(FlightRecorder::GetStats().threads == ringsBefore + 3);
+
+        std::vector<FlightRecorder::Entry> records = FlightRecorder::Take();
+        CHECK(records.size() == 3 * 4 + 1);
+
+        // 이어 쓴 ring 에 남아 있던 record 도 원래 스레드의 id 로 나온다
+        std::map<std::string, std::set<uint32_t>> threadIds;
+        for (const FlightRecorder::Entry& entry : records)
+            threadIds[entry.text.substr(0, 8)].insert(entry.threadId);
+        CHECK(threadIds.size() == 4);
+        std::set<uint32_t> allIds;
+        for (const auto& ids : threadIds)
+        {
+            CHECK_CONTEXT(ids.second.size() == 1, "%s", ids.first.c_str());
+            allIds.insert(ids.second.begin(), ids.second.end());
+        }
+        CHECK(allIds.size() == 4);
+
+        // 시간 순
+        bool sorted = true;
+        for (size_t i = 1; i < records.size(); ++i)
+            sorted = sorted && records[i - 1].unixMilliseconds <= records[i].unixMilliseconds;
+        CHECK(sorted);
+    }
+
+    // 메모리 상한을 넘는 스레드는 ring 을 받지 못하고 남기지 않는다
+    void testMemoryLimit()
+    {
+        FlightRecorder::Options options = FlightRecorder::GetOptions();
+        options.memoryLimitBytes = FlightRecorder::GetStats().memoryBytes;
+        FlightRecorder::SetOptions(options);
+
+        // 지금 있는 ring 이 모두 쓰이도록 여러 스레드를 동시에 세운다
+        const size_t rings = FlightRecorder::GetStats().threads;
+        const uint64_t rejectedBefore = FlightRecorder::GetStats().rejectedThreads;
+        std::vector<std::thread> threads;
+        std::atomic<int> ready(0);
+        std::atomic<bool> release(false);
+        for (size_t t = 0; t < rings + 2; ++t)
+        {
+            threads.emplace_back([&ready, &release]()
+            {
+                record(4, "limited");
+                ++ready;
+                while (!release)
+                    std::this_thread::yield();
+            });
+        }
+        while (ready < static_cast<int>(rings + 2))
+            std::this_thread::yield();
+        release = true;
+        for (std::thread& thread : threads)
+            thread.join();
+
+        const FlightRecorder::Stats stats = FlightRecorder::GetStats();
+        CHECK(stats.threads == rings);
+        // 주 스레드가 ring 하나를 계속 가지고 있다
+        CHECK(stats.rejectedThreads - rejectedBefore == 3);
+        CHECK(FlightRecorder::Take().size() == rings - 1);
+    }
+}
+
+int main()
+{
+    FlightRecorder::Options options;
+    options.recordsPerThread = RECORDS_PER_THREAD;
+    options.maxRecordBytes = MAX_RECORD_BYTES;
+    FlightRecorder::SetOptions(options);
+    FlightRecorder::SetEnabled(true);
+
+    testOverwrite();
+    testTruncate();
+    testThreads();
+    testMemoryLimit();
+    return Test::Result();
+}
\ No newline at end of file
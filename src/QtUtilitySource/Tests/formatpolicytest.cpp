@@ -0,0 +1,240 @@
+#include "formatpolicy.h"
+#include "testsupport.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    const std::vector<ClipboardFormat> ALL_FORMATS = { ClipboardFormat::Png, ClipboardFormat::DibV5, ClipboardFormat::Bitmap };
+    const std::vector<ClipboardFormat> NO_PNG = { ClipboardFormat::DibV5, ClipboardFormat::Bitmap };
+
+    FormatPolicy::Image opaque(int width, int height)
+    {
+        return { width, height, false };
+    }
+
+    FormatPolicy::Image alpha(int width, int height)
+    {
+        return { width, height, true };
+    }
+
+    // report 에 format 이 없으면 reason 이 nullptr 인 Choice
+    FormatPolicy::Choice find(const FormatPolicy::Report& report, ClipboardFormat format)
+    {
+        for (const FormatPolicy::Choice& choice : report.choices)
+        {
+            if (choice.format == format)
+                return choice;
+        }
+        return { format, FormatPolicy::Delivery::Skip, nullptr };
+    }
+
+    bool delivered(const FormatPolicy::Report& report, ClipboardFormat format, FormatPolicy::Delivery delivery)
+    {
+        return find(report, format).delivery == delivery;
+    }
+
+    bool hasReason(const FormatPolicy::Report& report, ClipboardFormat format, const char* reason)
+    {
+        const char* actual = find(report, format).reason;
+        return actual != nullptr && std::strcmp(actual, reason) == 0;
+    }
+
+    bool near(double a, double b)
+    {
+        return std::fabs(a - b) < 1e-9;
+    }
+
+    // 압축 전 크기가 eagerMaxBytes 이하면 바로 렌더링한다
+    void testEagerThreshold()
+    {
+        FormatPolicy policy;
+        const FormatPolicy::Report small = policy.Choose(alpha(512, 512), ALL_FORMATS, true);
+        CHECK(small.choices.size() == 3);
+        CHECK(delivered(small, ClipboardFormat::Png, FormatPolicy::Delivery::Eager));
+        CHECK(delivered(small, ClipboardFormat::DibV5, FormatPolicy::Delivery::Eager));
+        CHECK(delivered(small, ClipboardFormat::Bitmap, FormatPolicy::Delivery::Eager));
+        CHECK(hasReason(small, ClipboardFormat::DibV5, "small"));
+
+        const FormatPolicy::Report large = policy.Choose(alpha(513, 512), ALL_FORMATS, true);
+        CHECK(delivered(large, ClipboardFormat::Png, FormatPolicy::Delivery::Delayed));
+        CHECK(delivered(large, ClipboardFormat::DibV5, FormatPolicy::Delivery::Delayed));
+        CHECK(hasReason(large, ClipboardFormat::DibV5, "on request"));
+
+        FormatPolicy::Options options;
+        options.eagerMaxBytes = 0;
+        policy.SetOptions(options);
+        CHECK(delivered(policy.Choose(alpha(1, 1), ALL_FORMATS, true), ClipboardFormat::DibV5, FormatPolicy::Delivery::Delayed));
+    }
+
+    // alpha 가 있으면 항상 PNG, 작은 불투명 이미지는 PNG 없이
+    void testPngThresholds()
+    {
+        FormatPolicy policy;
+        const char* reason = nullptr;
+
+        CHECK(policy.ShouldEncodePng(alpha(1, 1), &reason) && std::strcmp(reason, "alpha") == 0);
+        CHECK(!policy.ShouldEncodePng(opaque(64, 63), &reason) && std::strcmp(reason, "small opaque") == 0);
+        CHECK(policy.ShouldEncodePng(opaque(64, 64), &reason) && std::strcmp(reason, "not measured") == 0);
+        CHECK(policy.ShouldEncodePng(opaque(0, 100)) == false);
+
+        // PNG 가 준비되지 않았으면 Choose 도 같은 이유로 뺀다
+        const FormatPolicy::Report small = policy.Choose(opaque(32, 32), ALL_FORMATS, false);
+        CHECK(delivered(small, ClipboardFormat::Png, FormatPolicy::Delivery::Skip));
+        CHECK(hasReason(small, ClipboardFormat::Png, "small opaque"));
+        CHECK(delivered(small, ClipboardFormat::DibV5, FormatPolicy::Delivery::Eager));
+
+        // source 에 PNG 가 없어도 왜 안 만들었는지 남긴다
+        const FormatPolicy::Report noPng = policy.Choose(opaque(32, 32), NO_PNG, false);
+        CHECK(noPng.choices.size() == 3);
+        CHECK(delivered(noPng, ClipboardFormat::Png, FormatPolicy::Delivery::Skip));
+        CHECK(hasReason(noPng, ClipboardFormat::Png, "small opaque"));
+    }
+
+    // 아주 큰 이미지는 PNG 만, CF_BITMAP 은 OS 가 CF_DIBV5 에서 만든다
+    void testSizeLimits()
+    {
+        FormatPolicy::Options options;
+        options.dibMaxPixels = 1000 * 1000;
+        options.bitmapMaxPixels = 600 * 600;
+        FormatPolicy policy(options);
+
+        const FormatPolicy::Report medium = policy.Choose(opaque(600, 601), ALL_FORMATS, true);
+        CHECK(delivered(medium, ClipboardFormat::DibV5, FormatPolicy::Delivery::Delayed));
+        CHECK(delivered(medium, ClipboardFormat::Bitmap, FormatPolicy::Delivery::Skip));
+        CHECK(hasReason(medium, ClipboardFormat::Bitmap, "synthesized from CF_DIBV5"));
+        CHECK(delivered(policy.Choose(opaque(600, 600), ALL_FORMATS, true), ClipboardFormat::Bitmap, FormatPolicy::Delivery::Delayed));
+
+        const char* reason = nullptr;
+        CHECK(policy.ShouldEncodePng(opaque(1000, 1001), &reason) && std::strcmp(reason, "only format") == 0);
+
+        const FormatPolicy::Report huge = policy.Choose(opaque(1000, 1001), ALL_FORMATS, true);
+        CHECK(delivered(huge, ClipboardFormat::Png, FormatPolicy::Delivery::Delayed));
+        CHECK(delivered(huge, ClipboardFormat::DibV5, FormatPolicy::Delivery::Skip));
+        CHECK(delivered(huge, ClipboardFormat::Bitmap, FormatPolicy::Delivery::Skip));
+        CHECK(hasReason(huge, ClipboardFormat::DibV5, "too large, PNG only"));
+
+        // PNG 가 없으면 DIB 라도 올린다
+        const FormatPolicy::Report hugeNoPng = policy.Choose(opaque(1000, 1001), NO_PNG, false);
+        CHECK(delivered(hugeNoPng, ClipboardFormat::DibV5, FormatPolicy::Delivery::Delayed));
+
+        options.dibMaxPixels = 0;
+        options.bitmapMaxPixels = 0;
+        policy.SetOptions(options);
+        const FormatPolicy::Report unlimited = policy.Choose(opaque(1000, 1001), ALL_FORMATS, true);
+        CHECK(delivered(unlimited, ClipboardFormat::DibV5, FormatPolicy::Delivery::Delayed));
+        CHECK(delivered(unlimited, ClipboardFormat::Bitmap, FormatPolicy::Delivery::Delayed));
+    }
+
+    // 측정한 인코딩 시간이 budget 을 넘을 불투명 이미지는 PNG 를 만들지 않는다
+    void testMeasuredCost()
+    {
+        FormatPolicy::Options options;
+        options.pngBudgetMilliseconds = 1000.0;
+        FormatPolicy policy(options);
+        CHECK(policy.PngMillisecondsPerMegapixel() == 0.0);
+
+        // 작은 이미지와 0 이하의 시간은 넣지 않는다
+        policy.RecordPngEncode(255 * 256, 1000.0);
+        policy.RecordPngEncode(1000 * 1000, 0.0);
+        CHECK(policy.PngMillisecondsPerMegapixel() == 0.0);
+
+        policy.RecordPngEncode(1000 * 1000, 100.0);
+        CHECK(near(policy.PngMillisecondsPerMegapixel(), 100.0));
+        policy.RecordPngEncode(2000 * 1000, 400.0);
+        CHECK(near(policy.PngMillisecondsPerMegapixel(), 130.0));
+        policy.RecordPngEncode(1000 * 1000, 30.0);
+        CHECK(near(policy.PngMillisecondsPerMegapixel(), 100.0));
+
+        // 100 ms/MP 이면 10MP 까지 (budget 1000 ms)
+        const char* reason = nullptr;
+        CHECK(policy.ShouldEncodePng(opaque(2500, 3990), &reason) && std::strcmp(reason, "within budget") == 0);
+        CHECK(!policy.ShouldEncodePng(opaque(2500, 4001), &reason) && std::strcmp(reason, "over budget") == 0);
+        CHECK(policy.ShouldEncodePng(alpha(2500, 4001)));
+
+        const FormatPolicy::Report report = policy.Choose(opaque(2500, 4001), ALL_FORMATS, false);
+        CHECK(near(report.pngMillisecondsPerMegapixel, 100.0));
+        CHECK(delivered(report, ClipboardFormat::Png, FormatPolicy::Delivery::Skip));
+        CHECK(hasReason(report, ClipboardFormat::Png, "over budget"));
+        CHECK(delivered(report, ClipboardFormat::DibV5, FormatPolicy::Delivery::Delayed));
+
+        // 이미 만들어 둔 PNG 는 그대로 올린다
+        CHECK(delivered(policy.Choose(opaque(2500, 4001), ALL_FORMATS, true), ClipboardFormat::Png, FormatPolicy::Delivery::Delayed));
+
+        // 더 빠르게 측정되면 다시 PNG 를 만든다
+        for (int i = 0; i < 20; ++i)
+            policy.RecordPngEncode(1000 * 1000, 10.0);
+        CHECK(policy.ShouldEncodePng(opaque(2500, 4001)));
+
+        options.pngBudgetMilliseconds = 0.0;
+        policy.SetOptions(options);
+        for (int i = 0; i < 20; ++i)
+            policy.RecordPngEncode(1000 * 1000, 100000.0);
+        CHECK(policy.ShouldEncodePng(opaque(5000, 5000), &reason) && std::strcmp(reason, "within budget") == 0);
+    }
+
+    // 일부 band 만 다시 압축한 시간은 예상에 넣지 않는다
+    void testPartialEncodeIgnored()
+    {
+        FormatPolicy policy;
+        policy.RecordPngEncode(1000 * 1000, 5.0, true);
+        CHECK(policy.PngMillisecondsPerMegapixel() == 0.0);
+
+        policy.RecordPngEncode(1000 * 1000, 100.0);
+        policy.RecordPngEncode(1000 * 1000, 5.0, true);
+        CHECK(near(policy.PngMillisecondsPerMegapixel(), 100.0));
+        policy.RecordPngEncode(1000 * 1000, 100.0, false);
+        CHECK(near(policy.PngMillisecondsPerMegapixel(), 100.0));
+    }
+
+    class FixedSource : public ClipboardSource
+    {
+    public:
+        std::vector<ClipboardFormat> Formats() const override { return ALL_FORMATS; }
+        std::vector<ClipboardFormat> EagerFormats() const override { return std::vector<ClipboardFormat>(); }
+        size_t FormatSize(ClipboardFormat) const override { return 8; }
+
+        bool Render(ClipboardFormat format, uint8_t* dest, size_t size) const override
+        {
+            std::memset(dest, static_cast<int>(format) + 1, size);
+            return true;
+        }
+
+        ImageView Pixels() const override { return ImageView(); }
+    };
+
+    // 고른 포맷만 보이고, 고르지 않은 포맷은 렌더링하지 않는다
+    void testPolicySource()
+    {
+        FormatPolicy::Options options;
+        options.bitmapMaxPixels = 100;
+        FormatPolicy policy(options);
+        const FormatPolicy::Report report = policy.Choose(alpha(10, 11), ALL_FORMATS, true);
+
+        PolicyClipboardSource source(std::make_shared<FixedSource>(), report);
+        CHECK(source.Formats() == std::vector<ClipboardFormat>({ ClipboardFormat::Png, ClipboardFormat::DibV5 }));
+        CHECK(source.EagerFormats() == source.Formats());
+        CHECK(source.FormatSize(ClipboardFormat::DibV5) == 8);
+        CHECK(source.FormatSize(ClipboardFormat::Bitmap) == 0);
+
+        uint8_t bytes[8] = {};
+        CHECK(source.Render(ClipboardFormat::Png, bytes, sizeof(bytes)) && bytes[7] == 1);
+        CHECK(!source.Render(ClipboardFormat::Bitmap, bytes, sizeof(bytes)));
+
+        CHECK(!report.ToString().empty());
+    }
+}
+
+int main()
+{
+    testEagerThreshold();
+    testPngThresholds();
+    testSizeLimits();
+    testMeasuredCost();
+    testPartialEncodeIgnored();
+    testPolicySource();
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "imagewrap.h"
+#include "testsupport.h"
+
+#include <QColor>
+#include <QImage>
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    const int WIDTH = 7;
+    const int HEIGHT = 5;
+
+    bool isZeroCopyFormat(QImage::Format format)
+    {
+        return format == QImage::Format_ARGB32 || format == QImage::Format_ARGB32_Premultiplied || format == QImage::Format_RGB32
+            || format == QImage::Format_RGBA8888 || format == QImage::Format_RGBA8888_Premultiplied || format == QImage::Format_RGBX8888;
+    }
+
+    QImage makeImage(QImage::Format format)
+    {
+        QImage image(WIDTH, HEIGHT, format);
+        if (image.colorCount() == 0 && (format == QImage::Format_Mono || format == QImage::Format_MonoLSB || format == QImage::Format_Indexed8))
+            image.setColorTable({ qRgb(0, 0, 0), qRgb(255, 255, 255) });
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            for (int x = 0; x < WIDTH; ++x)
+                image.setPixelColor(x, y, QColor((x * 40) % 256, (y * 60) % 256, (x + y) % 2 ? 255 : 0, x == 0 ? 255 : 128));
+        }
+        return image;
+    }
+
+    // 감싼 픽셀을 BGRA 로 바꾼 것과 Qt 가 ARGB32 로 바꾼 것이 같아야 한다
+    bool samePixels(const PixelBuffer& pixels, const QImage& image)
+    {
+        const QImage expected = image.convertToFormat(QImage::Format_ARGB32);
+        std::vector<uint8_t> row(static_cast<size_t>(pixels.Width()) * 4);
+        for (int y = 0; y < pixels.Height(); ++y)
+        {
+            PixelConverter::ConvertRow(pixels.ConstScanLine(y), pixels.Format(), row.data(), PixelConverter::Format::BGRA, pixels.Width());
+            if (std::memcmp(row.data(), expected.constScanLine(y), row.size()) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // 모든 QImage 포맷: 바로 읽을 수 있으면 복사 없이 감싸고, 아니면 image 를 그대로 돌려받는다
+    void testEveryFormat()
+    {
+        for (int i = QImage::Format_Mono; i < QImage::NImageFormats; ++i)
+        {
+            const QImage::Format format = static_cast<QImage::Format>(i);
+            QImage image = makeImage(format);
+            if (image.isNull())
+                continue;
+
+            const QImage reference = image.copy();
+            const qint64 cacheKey = image.cacheKey();
+            const uchar* bits = image.constBits();
+
+            QImage unsupported;
+            PixelBuffer pixels = ImageWrap::Wrap(std::move(image), &unsupported);
+
+            if (isZeroCopyFormat(format))
+            {
+                CHECK_CONTEXT(!pixels.IsNull(), "format %d", i);
+                CHECK_CONTEXT(pixels.ConstBits() == bits, "format %d copied", i);
+                CHECK_CONTEXT(pixels.Width() == WIDTH && pixels.Height() == HEIGHT && pixels.Stride() == reference.bytesPerLine(), "format %d", i);
+                CHECK_CONTEXT(unsupported.isNull(), "format %d", i);
+                CHECK_CONTEXT(samePixels(pixels, reference), "format %d pixels", i);
+            }
+            else
+            {
+                // 변환 경로: image 는 바뀌지 않은 채로 옮겨져야 한다
+                CHECK_CONTEXT(pixels.IsNull(), "format %d", i);
+                CHECK_CONTEXT(unsupported.cacheKey() == cacheKey && unsupported.constBits() == bits, "format %d not handed back", i);
+                CHECK_CONTEXT(unsupported == reference, "format %d changed", i);
+
+                PixelBuffer converted = ImageWrap::Wrap(unsupported.convertToFormat(QImage::Format_ARGB32));
+                CHECK_CONTEXT(!converted.IsNull() && samePixels(converted, reference), "format %d converted pixels", i);
+            }
+        }
+    }
+
+    // PixelBuffer 가 사라질 때 QImage 참조를 놓는다
+    void testReleasesImage()
+    {
+        QImage image = makeImage(QImage::Format_ARGB32);
+        QImage copy = image;
+        {
+            PixelBuffer pixels = ImageWrap::Wrap(std::move(image));
+            CHECK(!pixels.IsNull());
+            CHECK(!copy.isDetached());
+        }
+        CHECK(copy.isDetached());
+    }
+
+    // 바깥 메모리를 쓰는 QImage (row 마다 여백)
+    void testPaddedStride()
+    {
+        const int stride = WIDTH * 4 + 24;
+        std::vector<uchar> memory(static_cast<size_t>(stride) * HEIGHT, 0x33);
+        QImage image(memory.data(), WIDTH, HEIGHT, stride, QImage::Format_RGBA8888);
+        const QImage reference = image.copy();
+
+        PixelBuffer pixels = ImageWrap::Wrap(std::move(image));
+        CHECK(!pixels.IsNull());
+        CHECK(pixels.Stride() == stride);
+        CHECK(pixels.ConstBits() == memory.data());
+        CHECK(samePixels(pixels, reference));
+    }
+
+    void testNullImage()
+    {
+        QImage unsupported = makeImage(QImage::Format_RGB888);
+        CHECK(ImageWrap::Wrap(QImage(), &unsupported).IsNull());
+        CHECK(unsupported.isNull());
+    }
+}
+
+int main()
+{
+    testEveryFormat();
+    testReleasesImage();
+    testPaddedStride();
+    testNullImage();
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "loglevel.h"
+#include "testsupport.h"
+
+#include <thread>
+#include <vector>
+
+#ifdef TESTS_WITH_QT
+#include "log.h"
+#endif
+
+namespace
+{
+    using Log::Level;
+
+    // LOG_COMPILED_LEVEL 보다 높은 level 은 설정과 관계없이 꺼져 있다
+    bool expected(Level level, int enabledLevel)
+    {
+        return static_cast<int>(level) <= LOG_COMPILED_LEVEL && static_cast<int>(level) <= enabledLevel;
+    }
+
+    // LOG_* 는 trace level 만, LOGF_* 는 max(trace level, capture level) 을 본다
+    bool matches(int trace, int capture = 0)
+    {
+        for (Level level : { Level::Critical, Level::Warning, Level::Info, Level::Debug })
+        {
+            if (Log::IsEnabled(level) != expected(level, trace) || Log::IsCaptured(level) != expected(level, trace > capture ? trace : capture))
+                return false;
+        }
+        return true;
+    }
+
+    void testDefault()
+    {
+        CHECK(Log::TraceLevel() == Log::DEFAULT_TRACE_LEVEL);
+        CHECK(Log::CaptureLevel() == 0);
+        CHECK(matches(Log::DEFAULT_TRACE_LEVEL));
+        CHECK(!Log::IsEnabled(Level::Debug));
+        CHECK(!Log::IsCaptured(Level::Debug));
+    }
+
+    void testTraceAndCapture()
+    {
+        for (int trace = 0; trace <= 4; ++trace)
+        {
+            for (int capture = 0; capture <= 4; ++capture)
+            {
+                Log::SetTraceLevel(trace);
+                Log::SetCaptureLevel(capture);
+                CHECK(Log::TraceLevel() == trace);
+                CHECK(Log::CaptureLevel() == capture);
+                CHECK_CONTEXT(matches(trace, capture), "trace %d capture %d", trace, capture);
+            }
+        }
+
+        // capture level 로는 LOG_* 가 켜지지 않는다
+        Log::SetTraceLevel(2);
+        Log::SetCaptureLevel(4);
+        CHECK(!Log::IsEnabled(Level::Debug));
+        CHECK(Log::IsCaptured(Level::Debug) == (LOG_COMPILED_LEVEL >= 4));
+
+        // capture 를 끄면 trace level 로 돌아온다
+        Log::SetTraceLevel(2);
+        Log::SetCaptureLevel(4);
+        Log::SetCaptureLevel(0);
+        CHECK(matches(2));
+        CHECK(!Log::IsEnabled(Level::Info));
+
+        Log::SetTraceLevel(Log::DEFAULT_TRACE_LEVEL);
+    }
+
+    // 두 값을 여러 스레드에서 바꿔도 마지막 값과 어긋나지 않는다
+    void testConcurrentUpdates()
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([t]()
+            {
+                for (int i = 0; i < 10000; ++i)
+                {
+                    if (t % 2 == 0)
+                        Log::SetTraceLevel((i + t) % 5);
+                    else
+                        Log::SetCaptureLevel((i + t) % 5);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+
+        const int trace = Log::TraceLevel();
+        const int capture = Log::CaptureLevel();
+        CHECK_CONTEXT(matches(trace, capture), "trace %d capture %d", trace, capture);
+
+        Log::SetTraceLevel(Log::DEFAULT_TRACE_LEVEL);
+        Log::SetCaptureLevel(0);
+    }
+
+#ifdef TESTS_WITH_QT
+    int messages = 0;
+
+    void countMessages(QtMsgType, const QMessageLogContext&, const QString&)
+    {
+        ++messages;
+    }
+
+    int evaluated = 0;
+
+    int expensiveArgument()
+    {
+        ++evaluated;
+        return 42;
+    }
+
+    // 꺼진 level 의 LOG_*, LOGF_* 는 인자를 계산하지도, 메시지를 만들지도 않는다
+    void testMacrosSkipArguments()
+    {
+        QtMessageHandler previous = qInstallMessageHandler(countMessages);
+        Log::SetTraceLevel(static_cast<int>(Level::Info));
+
+        messages = 0;
+        evaluated = 0;
+        LOG_DEBUG << expensiveArgument();
+        LOGF_DEBUG("value {}", expensiveArgument());
+        CHECK(evaluated == 0);
+        CHECK(messages == 0);
+
+        LOG_INFO << expensiveArgument();
+        LOGF_INFO("value {}", expensiveArgument());
+        CHECK(evaluated == 2);
+        CHECK(messages == 2);
+
+        // if/else 형태라 감싸는 if 의 else 를 가져가지 않는다
+        bool elseTaken = false;
+        if (evaluated < 0)
+            LOG_INFO << "never";
+        else
+            elseTaken = true;
+        CHECK(elseTaken);
+
+        Log::SetTraceLevel(Log::DEFAULT_TRACE_LEVEL);
+        qInstallMessageHandler(previous);
+    }
+
+    // capture level 로만 켜진 LOGF_* 는 QDebug 를 거치지 않고 flight recorder 에 바로 남고, LOG_* 는 만들지 않는다
+    void testCaptureBypassesQDebug()
+    {
+        QtMessageHandler previous = qInstallMessageHandler(countMessages);
+        Log::SetTraceLevel(static_cast<int>(Level::Info));
+        Log::SetCaptureLevel(static_cast<int>(Level::Debug));
+        FlightRecorder::SetEnabled(true);
+        FlightRecorder::Take();
+
+        messages = 0;
+        LOGF_DEBUG("value {}", 7);
+        CHECK(messages == 0);
+
+        // LOG_DEBUG 는 recorder 가 켜져 있어도 stream 을 만들지 않는다
+        evaluated = 0;
+        LOG_DEBUG << expensiveArgument();
+        CHECK(evaluated == 0);
+        CHECK(messages == 0);
+
+        std::vector<FlightRecorder::Entry> records = FlightRecorder::Take();
+        CHECK(records.size() == 1);
+        if (records.size() == 1)
+        {
+            CHECK(records[0].level == static_cast<int>(Level::Debug));
+            CHECK(records[0].text.find("value 7") != std::string::npos);
+        }
+
+        // recorder 가 꺼져 있으면 아무것도 남지 않는다
+        FlightRecorder::SetEnabled(false);
+        LOGF_DEBUG("value {}", 8);
+        CHECK(messages == 0);
+        CHECK(FlightRecorder::Take().empty());
+
+        Log::SetCaptureLevel(0);
+        Log::SetTraceLevel(Log::DEFAULT_TRACE_LEVEL);
+        qInstallMessageHandler(previous);
+    }
+#endif
+}
+
+int main()
+{
+    testDefault();
+    testTraceAndCapture();
+    testConcurrentUpdates();
+#ifdef TESTS_WITH_QT
+    testMacrosSkipArguments();
+    testCaptureBypassesQDebug();
+#endif
+    return Test::Result();
+}
\ No newline at end of file
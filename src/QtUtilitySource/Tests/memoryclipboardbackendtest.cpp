@@ -0,0 +1,275 @@
+#include "encodedclipboardsource.h"
+#include "memoryclipboardbackend.h"
+#include "pixelbuffer.h"
+#include "pixmapclipboardsource.h"
+#include "pngencoder.h"
+#include "testsupport.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    // 포맷별로 Render 가 몇 번 불렸는지 센다. 내용은 포맷 번호로 채운다
+    class CountingSource : public ClipboardSource
+    {
+    public:
+        CountingSource(std::vector<ClipboardFormat> formats, std::vector<ClipboardFormat> eager = std::vector<ClipboardFormat>())
+            : formats_(std::move(formats))
+            , eager_(std::move(eager))
+            , pixels_(PixelBuffer::Allocate(4, 2, PixelConverter::Format::BGRA))
+            , renders_()
+        {
+            std::memset(pixels_.Bits(), 0x7F, pixels_.ByteCount());
+        }
+
+        std::vector<ClipboardFormat> Formats() const override { return formats_; }
+        std::vector<ClipboardFormat> EagerFormats() const override { return eager_; }
+        size_t FormatSize(ClipboardFormat format) const override { return 16 + static_cast<size_t>(format); }
+
+        bool Render(ClipboardFormat format, uint8_t* dest, size_t size) const override
+        {
+            ++renders_[static_cast<size_t>(format)];
+            std::memset(dest, static_cast<int>(format) + 1, size);
+            return true;
+        }
+
+        ImageView Pixels() const override { return pixels_.View(); }
+
+        int Renders(ClipboardFormat format) const { return renders_[static_cast<size_t>(format)]; }
+
+    private:
+        std::vector<ClipboardFormat> formats_;
+        std::vector<ClipboardFormat> eager_;
+        PixelBuffer pixels_;
+        mutable std::array<std::atomic<int>, CLIPBOARD_FORMAT_COUNT> renders_;
+    };
+
+    // 올릴 때는 약속만 하고, 읽을 때 한 번만 렌더링한다
+    void testRendersOnRead()
+    {
+        MemoryClipboardBackend backend;
+        auto source = std::make_shared<CountingSource>(std::vector<ClipboardFormat>{ ClipboardFormat::Png, ClipboardFormat::DibV5 });
+
+        CHECK(backend.Publish(source));
+        CHECK(backend.AvailableFormats().size() == 2);
+        CHECK(source->Renders(ClipboardFormat::Png) == 0);
+        CHECK(source->Renders(ClipboardFormat::DibV5) == 0);
+        CHECK(backend.Stats(ClipboardFormat::Png).promised == 1);
+        CHECK(backend.Stats(ClipboardFormat::Png).rendered == 0);
+
+        std::vector<uint8_t> data;
+        CHECK(backend.Request(ClipboardFormat::DibV5, &data));
+        CHECK(data.size() == 16 + static_cast<size_t>(ClipboardFormat::DibV5));
+        CHECK(source->Renders(ClipboardFormat::DibV5) == 1);
+        CHECK(source->Renders(ClipboardFormat::Png) == 0);
+
+        // 두 번째부터는 cache
+        CHECK(backend.Request(ClipboardFormat::DibV5, &data));
+        size_t readSize = 0;
+        CHECK(backend.Read(ClipboardFormat::DibV5, [&readSize](const uint8_t*, size_t size)
+        {
+            readSize = size;
+            return true;
+        }));
+        CHECK(readSize == data.size());
+        CHECK(source->Renders(ClipboardFormat::DibV5) == 1);
+        CHECK(backend.Stats(ClipboardFormat::DibV5).rendered == 1);
+
+        // 약속하지 않은 포맷은 없다
+        CHECK(!backend.Request(ClipboardFormat::Jfif, &data));
+        CHECK(source->Renders(ClipboardFormat::Jfif) == 0);
+    }
+
+    void testEagerFormats()
+    {
+        MemoryClipboardBackend backend;
+        auto source = std::make_shared<CountingSource>(std::vector<ClipboardFormat>{ ClipboardFormat::Png, ClipboardFormat::DibV5 },
+                                                       std::vector<ClipboardFormat>{ ClipboardFormat::Png });
+
+        CHECK(backend.Publish(source));
+        CHECK(source->Renders(ClipboardFormat::Png) == 1);
+        CHECK(source->Renders(ClipboardFormat::DibV5) == 0);
+
+        std::vector<uint8_t> data;
+        CHECK(backend.Request(ClipboardFormat::Png, &data));
+        CHECK(source->Renders(ClipboardFormat::Png) == 1);
+    }
+
+    // 새로 올리면 앞의 source 와 렌더링해 둔 것을 놓는다
+    void testReleasedOnReplace()
+    {
+        MemoryClipboardBackend backend;
+
+        std::weak_ptr<CountingSource> first;
+        {
+            auto source = std::make_shared<CountingSource>(std::vector<ClipboardFormat>{ ClipboardFormat::Png });
+            first = source;
+            CHECK(backend.Publish(source));
+            CHECK(backend.Request(ClipboardFormat::Png, nullptr));
+        }
+        CHECK(!first.expired());
+
+        auto second = std::make_shared<CountingSource>(std::vector<ClipboardFormat>{ ClipboardFormat::DibV5 });
+        CHECK(backend.Publish(second));
+        CHECK(first.expired());
+
+        std::vector<ClipboardFormat> formats = backend.AvailableFormats();
+        CHECK(formats.size() == 1 && formats[0] == ClipboardFormat::DibV5);
+        CHECK(!backend.Request(ClipboardFormat::Png, nullptr));
+        CHECK(second->Renders(ClipboardFormat::DibV5) == 0);
+
+        // 다른 프로그램이 복사한 경우도 놓는다
+        std::weak_ptr<CountingSource> secondWeak = second;
+        second.reset();
+        CHECK(!secondWeak.expired());
+        backend.SetData(ClipboardFormat::Png, std::vector<uint8_t>(3, 1));
+        CHECK(secondWeak.expired());
+    }
+
+    // 소유자가 사라질 때처럼 모두 렌더링하면 source 를 놓고 cache 로 계속 읽을 수 있다
+    void testRenderAll()
+    {
+        MemoryClipboardBackend backend;
+        std::weak_ptr<CountingSource> weak;
+        {
+            auto source = std::make_shared<CountingSource>(std::vector<ClipboardFormat>{ ClipboardFormat::Png, ClipboardFormat::DibV5 });
+            weak = source;
+            CHECK(backend.Publish(source));
+        }
+
+        backend.RenderAll();
+        CHECK(weak.expired());
+        std::vector<uint8_t> data;
+        CHECK(backend.Request(ClipboardFormat::Png, &data));
+        CHECK(backend.Request(ClipboardFormat::DibV5, &data));
+        CHECK(backend.Stats(ClipboardFormat::Png).rendered == 1);
+        CHECK(backend.Stats(ClipboardFormat::DibV5).rendered == 1);
+    }
+
+    // 실제 source: 감싼 픽셀은 새 이미지로 바뀔 때 release 된다
+    void testPixmapSourceReleasesPixels()
+    {
+        std::vector<uint8_t> owned(8 * 4 * 4, 0x40);
+        std::atomic<int> released(0);
+        ImageView view = { owned.data(), 8, 4, 8 * 4, PixelConverter::Format::BGRA };
+
+        MemoryClipboardBackend backend;
+        {
+            PixelBuffer pixels = PixelBuffer::Wrap(view, [&released]() { ++released; });
+            PixmapClipboardSource::EncodedBytes png = { nullptr, nullptr, 0 };
+            CHECK(backend.Publish(std::make_shared<PixmapClipboardSource>(pixels, png)));
+        }
+        CHECK(released == 0);
+
+        std::vector<uint8_t> dib;
+        CHECK(backend.Request(ClipboardFormat::DibV5, &dib));
+        CHECK(dib.size() == PixmapClipboardSource::DibV5Size(8, 4));
+        CHECK(backend.Stats(ClipboardFormat::DibV5).rendered == 1);
+
+        backend.Clear();
+        CHECK(released == 1);
+    }
+
+    PixmapClipboardSource::EncodedBytes shareBytes(const std::shared_ptr<std::vector<uint8_t>>& bytes)
+    {
+        PixmapClipboardSource::EncodedBytes shared = { bytes, bytes->data(), bytes->size() };
+        return shared;
+    }
+
+    // SOF0 에 크기만 있는 JPEG. 실제 decode 는 테스트의 decoder 가 대신한다
+    std::vector<uint8_t> makeJpeg(int width, int height)
+    {
+        std::vector<uint8_t> jpeg = { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00 };
+        const uint8_t startOfFrame[] = { 0xFF, 0xC0, 0x00, 0x0B, 0x08,
+                                         static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+                                         static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+                                         0x01, 0x01, 0x11, 0x00 };
+        jpeg.insert(jpeg.end(), startOfFrame, startOfFrame + sizeof(startOfFrame));
+        const uint8_t scan[] = { 0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00, 0x12, 0x34, 0xFF, 0xD9 };
+        jpeg.insert(jpeg.end(), scan, scan + sizeof(scan));
+        return jpeg;
+    }
+
+    // 원본 파일은 다시 인코딩하지 않고 byte 그대로 올린다. 픽셀 포맷을 요청할 때만 decode 한다
+    void testEncodedSourcePublishesOriginalBytes()
+    {
+        PixelBuffer pixels = PixelBuffer::Allocate(13, 7, PixelConverter::Format::BGRA);
+        for (int y = 0; y < pixels.Height(); ++y)
+            std::memset(pixels.ScanLine(y), 0x20 + y * 16, static_cast<size_t>(pixels.Width()) * 4);
+
+        int decodes = 0;
+        auto decode = [&decodes, pixels]()
+        {
+            ++decodes;
+            return pixels;
+        };
+
+        // PNG 는 PNG 로
+        auto png = std::make_shared<std::vector<uint8_t>>();
+        CHECK(PngEncoder().Encode(pixels.View(), [&png](const uint8_t* data, size_t size)
+        {
+            png->insert(png->end(), data, data + size);
+            return true;
+        }));
+        // 같은 픽셀을 다시 인코딩하면 구별할 수 없으므로 뒤에 byte 를 붙여 원본임을 표시한다
+        png->push_back(0xEE);
+
+        EncodedImage pngImage = EncodedImage::Probe(shareBytes(png));
+        CHECK(pngImage.kind == EncodedImage::Kind::Png && pngImage.width == 13 && pngImage.height == 7);
+
+        MemoryClipboardBackend backend;
+        auto pngSource = std::make_shared<EncodedClipboardSource>(pngImage, PixelBuffer(), decode);
+        CHECK(backend.Publish(pngSource));
+        CHECK(backend.AvailableFormats() == std::vector<ClipboardFormat>({ ClipboardFormat::Png, ClipboardFormat::DibV5, ClipboardFormat::Bitmap }));
+
+        std::vector<uint8_t> data;
+        CHECK(backend.Request(ClipboardFormat::Png, &data));
+        CHECK(data == *png);
+        CHECK(decodes == 0 && !pngSource->IsDecoded() && !pngSource->IsPngEncoded());
+
+        CHECK(backend.Request(ClipboardFormat::DibV5, &data));
+        CHECK(data.size() == PixmapClipboardSource::DibV5Size(13, 7));
+        CHECK(decodes == 1 && pngSource->IsDecoded() && !pngSource->IsPngEncoded());
+
+        // JPEG 는 JFIF 로. PNG 는 요청이 오면 decode 해서 만든다
+        auto jpeg = std::make_shared<std::vector<uint8_t>>(makeJpeg(13, 7));
+        EncodedImage jpegImage = EncodedImage::Probe(shareBytes(jpeg));
+        CHECK(jpegImage.kind == EncodedImage::Kind::Jpeg && jpegImage.width == 13 && jpegImage.height == 7);
+
+        decodes = 0;
+        auto jpegSource = std::make_shared<EncodedClipboardSource>(jpegImage, PixelBuffer(), decode);
+        CHECK(backend.Publish(jpegSource));
+        CHECK(backend.AvailableFormats() == std::vector<ClipboardFormat>({ ClipboardFormat::Png, ClipboardFormat::Jfif,
+                                                                           ClipboardFormat::DibV5, ClipboardFormat::Bitmap }));
+
+        CHECK(backend.Request(ClipboardFormat::Jfif, &data));
+        CHECK(data == *jpeg);
+        CHECK(decodes == 0);
+
+        CHECK(backend.Request(ClipboardFormat::Png, &data));
+        CHECK(data.size() > 8 && data[0] == 0x89 && data[1] == 'P' && data.back() != 0xEE);
+        CHECK(decodes == 1 && jpegSource->IsPngEncoded());
+
+        // 알 수 없는 byte 는 아무것도 약속하지 않는다
+        auto unknown = std::make_shared<std::vector<uint8_t>>(64, 0x42);
+        EncodedImage unknownImage = EncodedImage::Probe(shareBytes(unknown));
+        CHECK(unknownImage.IsNull());
+        CHECK(EncodedClipboardSource(unknownImage, PixelBuffer(), decode).Formats().empty());
+    }
+}
+
+
+int main()
+{
+    testRendersOnRead();
+    testEagerFormats();
+    testReleasedOnReplace();
+    testRenderAll();
+    testPixmapSourceReleasesPixels();
+    testEncodedSourcePublishesOriginalBytes();
+    return Test::Result();
+}
\ No newline at end of file
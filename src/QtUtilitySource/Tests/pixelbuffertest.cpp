@@ -0,0 +1,124 @@
+#include "pixelbuffer.h"
+#include "pixmapclipboardsource.h"
+#include "pngdecoder.h"
+#include "pngencoder.h"
+#include "testsupport.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using PixelConverter::Format;
+
+    const Format FORMATS[] = { Format::BGRA, Format::BGRAPremultiplied, Format::BGRX, Format::RGBA, Format::RGBAPremultiplied, Format::RGBX };
+
+    // 호출한 쪽이 소유한 메모리 (ClipboardWorker::RawImage). row 마다 padding 만큼 여백이 있다
+    struct RawImage
+    {
+        std::vector<uint8_t> memory;
+        ImageView view;
+    };
+
+    RawImage makeRawImage(int width, int height, int padding, Format format)
+    {
+        RawImage image;
+        const int stride = width * 4 + padding;
+        image.memory.assign(static_cast<size_t>(stride) * height, 0xA5);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width * 4; ++x)
+            {
+                uint8_t value = static_cast<uint8_t>(x * 7 + y * 13);
+                // premultiplied 입력은 색이 alpha 를 넘지 않게
+                if (PixelConverter::IsPremultiplied(format) && x % 4 != 3)
+                    value = static_cast<uint8_t>(value / 2);
+                if (PixelConverter::IsPremultiplied(format) && x % 4 == 3)
+                    value = static_cast<uint8_t>(value | 0x80);
+                image.memory[static_cast<size_t>(y) * stride + x] = value;
+            }
+        }
+        image.view = { image.memory.data(), width, height, stride, format };
+        return image;
+    }
+
+    // 여백 없는 복사본
+    PixelBuffer compactCopy(const ImageView& view)
+    {
+        PixelBuffer pixels = PixelBuffer::Allocate(view.width, view.height, view.format);
+        for (int y = 0; y < view.height; ++y)
+            std::memcpy(pixels.ScanLine(y), view.ConstScanLine(y), static_cast<size_t>(view.width) * 4);
+        return pixels;
+    }
+
+    std::vector<uint8_t> renderDibV5(const PixelBuffer& pixels)
+    {
+        PixmapClipboardSource source(pixels, PixmapClipboardSource::EncodedBytes{ nullptr, nullptr, 0 });
+        std::vector<uint8_t> dib(source.FormatSize(ClipboardFormat::DibV5));
+        if (!source.Render(ClipboardFormat::DibV5, dib.data(), dib.size()))
+            dib.clear();
+        return dib;
+    }
+
+    std::vector<uint8_t> encodePng(const PixelBuffer& pixels)
+    {
+        std::vector<uint8_t> png;
+        PngEncoder().Encode(pixels.View(), [&png](const uint8_t* data, size_t size)
+        {
+            png.insert(png.end(), data, data + size);
+            return true;
+        });
+        return png;
+    }
+
+    // 감싼 view 는 복사하지 않고, stride 여백이 있어도 여백 없는 이미지와 같은 결과를 만든다
+    void testPaddedViews()
+    {
+        const int widths[] = { 1, 5, 13 };
+        const int paddings[] = { 0, 4, 28 };
+        for (Format format : FORMATS)
+        {
+            for (int width : widths)
+            {
+                for (int padding : paddings)
+                {
+                    RawImage raw = makeRawImage(width, 6, padding, format);
+                    PixelBuffer wrapped = PixelBuffer::Wrap(raw.view, []() {});
+                    PixelBuffer compact = compactCopy(raw.view);
+
+                    CHECK(wrapped.ConstBits() == raw.memory.data());
+                    CHECK(wrapped.Stride() == width * 4 + padding);
+                    CHECK(wrapped.Format() == format);
+                    CHECK_CONTEXT(renderDibV5(wrapped) == renderDibV5(compact), "DIBV5 format %d width %d padding %d", static_cast<int>(format), width, padding);
+                    CHECK_CONTEXT(encodePng(wrapped) == encodePng(compact), "PNG format %d width %d padding %d", static_cast<int>(format), width, padding);
+                }
+            }
+        }
+    }
+
+    // release 는 마지막 참조가 사라질 때 (다른 스레드여도) 한 번만
+    void testReleaseOnce()
+    {
+        RawImage raw = makeRawImage(4, 4, 8, Format::BGRA);
+        std::atomic<int> released(0);
+        {
+            PixelBuffer wrapped = PixelBuffer::Wrap(raw.view, [&released]() { ++released; });
+            PixelBuffer copy = wrapped;
+            CHECK(wrapped.UseCount() == 2);
+
+            std::thread other([copy]() mutable { copy = PixelBuffer(); });
+            other.join();
+            CHECK(released == 0);
+        }
+        CHECK(released == 1);
+    }
+}
+
+int main()
+{
+    testPaddedViews();
+    testReleaseOnce();
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "pixelconverter.h"
+#include "testsupport.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    using PixelConverter::Format;
+    using PixelConverter::Isa;
+
+    const Format FORMATS[] = { Format::BGRA, Format::BGRAPremultiplied, Format::BGRX, Format::RGBA, Format::RGBAPremultiplied, Format::RGBX };
+    const Isa ISAS[] = { Isa::Scalar, Isa::SSE2, Isa::AVX2 };
+
+    // SIMD 의 4, 8 픽셀 단위와 나머지 처리를 모두 지나가도록
+    const int WIDTHS[] = { 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 67 };
+    const int HEIGHT = 3;
+    const int PADDING_BYTES = 12;
+    const uint8_t GUARD = 0xCD;
+
+    const char* formatName(Format format)
+    {
+        switch (format)
+        {
+            case Format::BGRA:
+                return "BGRA";
+            case Format::BGRAPremultiplied:
+                return "BGRAPremultiplied";
+            case Format::BGRX:
+                return "BGRX";
+            case Format::RGBA:
+                return "RGBA";
+            case Format::RGBAPremultiplied:
+                return "RGBAPremultiplied";
+            case Format::RGBX:
+                return "RGBX";
+        }
+        return "";
+    }
+
+    // alpha 0, 255 와 중간 값이 골고루 섞이게. premultiplied 입력은 색이 alpha 를 넘지 않게 만든다
+    std::vector<uint8_t> makeSource(Format format, int width, int stride)
+    {
+        std::vector<uint8_t> pixels(static_cast<size_t>(stride) * HEIGHT, GUARD);
+        uint32_t seed = 12345;
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            uint8_t* row = pixels.data() + static_cast<size_t>(y) * stride;
+            for (int x = 0; x < width; ++x)
+            {
+                uint8_t* pixel = row + x * 4;
+                for (int c = 0; c < 4; ++c)
+                {
+                    seed = seed * 1664525 + 1013904223;
+                    pixel[c] = static_cast<uint8_t>(seed >> 24);
+                }
+                if (x % 5 == 0)
+                    pixel[3] = 0;
+                else if (x % 5 == 1)
+                    pixel[3] = 255;
+                if (PixelConverter::IsPremultiplied(format))
+                {
+                    for (int c = 0; c < 3; ++c)
+                        pixel[c] = static_cast<uint8_t>(pixel[c] * pixel[3] / 255);
+                }
+            }
+        }
+        return pixels;
+    }
+
+    std::vector<uint8_t> convert(const std::vector<uint8_t>& source, int srcStride, Format srcFormat, Format dstFormat, int width, int dstStride)
+    {
+        std::vector<uint8_t> result(static_cast<size_t>(dstStride) * HEIGHT, GUARD);
+        PixelConverter::ConvertRows(source.data(), srcStride, srcFormat, result.data(), dstStride, dstFormat, width, HEIGHT);
+        return result;
+    }
+
+    // ISA 마다 결과가 byte 단위로 같아야 하고 stride 의 여백은 건드리지 않아야 한다
+    void testIsasMatch()
+    {
+        for (Format srcFormat : FORMATS)
+        {
+            for (Format dstFormat : FORMATS)
+            {
+                for (int width : WIDTHS)
+                {
+                    const int srcStride = width * 4 + PADDING_BYTES;
+                    const int dstStride = width * 4 + PADDING_BYTES + 4;
+                    const std::vector<uint8_t> source = makeSource(srcFormat, width, srcStride);
+
+                    PixelConverter::SetActiveIsa(Isa::Scalar);
+                    const std::vector<uint8_t> expected = convert(source, srcStride, srcFormat, dstFormat, width, dstStride);
+
+                    for (Isa isa : ISAS)
+                    {
+                        if (!PixelConverter::SetActiveIsa(isa))
+                            continue;
+
+                        const std::vector<uint8_t> actual = convert(source, srcStride, srcFormat, dstFormat, width, dstStride);
+                        CHECK_CONTEXT(actual == expected, "%s -> %s, width %d, %s", formatName(srcFormat), formatName(dstFormat), width,
+                                      PixelConverter::IsaName(isa));
+
+                        // 같은 버퍼 안에서 변환 (src == dst)
+                        std::vector<uint8_t> inPlace = source;
+                        PixelConverter::ConvertRows(inPlace.data(), srcStride, srcFormat, inPlace.data(), srcStride, dstFormat, width, HEIGHT);
+                        bool same = true;
+                        for (int y = 0; y < HEIGHT; ++y)
+                        {
+                            same = same && std::memcmp(inPlace.data() + static_cast<size_t>(y) * srcStride,
+                                                       expected.data() + static_cast<size_t>(y) * dstStride, static_cast<size_t>(width) * 4) == 0;
+                        }
+                        CHECK_CONTEXT(same, "in place %s -> %s, width %d, %s", formatName(srcFormat), formatName(dstFormat), width,
+                                      PixelConverter::IsaName(isa));
+                    }
+
+                    for (int y = 0; y < HEIGHT; ++y)
+                    {
+                        const uint8_t* padding = expected.data() + static_cast<size_t>(y) * dstStride + width * 4;
+                        for (int i = 0; i < dstStride - width * 4; ++i)
+                            CHECK_CONTEXT(padding[i] == GUARD, "padding written, width %d", width);
+                    }
+                }
+            }
+        }
+    }
+
+    // 기준이 되는 scalar 결과 자체
+    void testScalarValues()
+    {
+        PixelConverter::SetActiveIsa(Isa::Scalar);
+
+        const uint8_t bgra[4] = { 10, 20, 30, 128 };
+        uint8_t out[4] = {};
+        PixelConverter::ConvertRow(bgra, Format::BGRA, out, Format::RGBA, 1);
+        CHECK(out[0] == 30 && out[1] == 20 && out[2] == 10 && out[3] == 128);
+
+        PixelConverter::ConvertRow(bgra, Format::BGRX, out, Format::BGRA, 1);
+        CHECK(out[0] == 10 && out[1] == 20 && out[2] == 30 && out[3] == 255);
+
+        const uint8_t opaque[4] = { 10, 20, 30, 255 };
+        PixelConverter::ConvertRow(opaque, Format::BGRA, out, Format::BGRAPremultiplied, 1);
+        CHECK(out[0] == 10 && out[1] == 20 && out[2] == 30 && out[3] == 255);
+
+        const uint8_t transparent[4] = { 10, 20, 30, 0 };
+        PixelConverter::ConvertRow(transparent, Format::BGRA, out, Format::BGRAPremultiplied, 1);
+        CHECK(out[0] == 0 && out[1] == 0 && out[2] == 0 && out[3] == 0);
+
+        // alpha 를 버리면 검은 배경에 합성한 값
+        const uint8_t half[4] = { 200, 100, 50, 128 };
+        PixelConverter::ConvertRow(half, Format::BGRA, out, Format::BGRX, 1);
+        CHECK(out[0] >= 99 && out[0] <= 101 && out[3] == 255);
+    }
+}
+
+int main()
+{
+    std::printf("detected ISA: %s\n", PixelConverter::IsaName(PixelConverter::DetectIsa()));
+
+    testScalarValues();
+    testIsasMatch();
+
+    PixelConverter::SetActiveIsa(PixelConverter::DetectIsa());
+    return Test::Result();
+}
\ No newline at end of file
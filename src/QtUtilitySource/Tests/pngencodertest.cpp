@@ -0,0 +1,374 @@
+#include "pixelbuffer.h"
+#include "pngdecoder.h"
+#include "pngencoder.h"
+#include "testsupport.h"
+#include "threadpool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef TESTS_WITH_QT
+#include <QImage>
+#endif
+
+namespace
+{
+    using PixelConverter::Format;
+
+    const PngEncoder::Preset PRESETS[] = { PngEncoder::Preset::Fastest, PngEncoder::Preset::Fast, PngEncoder::Preset::Balanced, PngEncoder::Preset::Smallest };
+
+    struct Size
+    {
+        int width;
+        int height;
+    };
+
+    const Size SIZES[] = { { 1, 1 }, { 1, 7 }, { 7, 1 }, { 3, 5 }, { 31, 17 }, { 257, 33 } };
+    // 0 은 자동, 1 은 row 마다 band, 100 은 row 수보다 큰 band
+    const int ROWS_PER_BAND[] = { 0, 1, 3, 100 };
+
+    // 같은 값이 이어지는 곳과 잡음이 섞이게 해서 filter 마다 다른 경로를 지나게 한다
+    PixelBuffer makeImage(int width, int height, bool opaque, Format format = Format::BGRA)
+    {
+        PixelBuffer pixels = PixelBuffer::Allocate(width, height, format);
+        uint32_t seed = static_cast<uint32_t>(width * 31 + height);
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = pixels.ScanLine(y);
+            for (int x = 0; x < width; ++x)
+            {
+                uint8_t* pixel = row + x * 4;
+                seed = seed * 1664525 + 1013904223;
+                const bool flat = (x / 8 + y / 4) % 2 == 0;
+                pixel[0] = flat ? 40 : static_cast<uint8_t>(seed >> 24);
+                pixel[1] = static_cast<uint8_t>(x * 3 + y);
+                pixel[2] = flat ? 200 : static_cast<uint8_t>(seed >> 16);
+                pixel[3] = opaque ? 255 : static_cast<uint8_t>(x % 3 == 0 ? 0 : (seed >> 8));
+            }
+        }
+        return pixels;
+    }
+
+    std::vector<uint8_t> encode(const ImageView& image, const PngEncoder::Options& options, ThreadPool* pool)
+    {
+        std::vector<uint8_t> png;
+        PngEncoder encoder(options, pool);
+        bool ok = encoder.Encode(image, [&png](const uint8_t* data, size_t size)
+        {
+            png.insert(png.end(), data, data + size);
+            return true;
+        });
+        if (!ok)
+            png.clear();
+        return png;
+    }
+
+    // 결과는 BGRA. 한 byte 씩 나눠 넣어도 같은 결과가 나와야 한다
+    std::vector<uint8_t> decode(const std::vector<uint8_t>& png, int width, int height, bool byteByByte, PngStreamDecoder::Info* info)
+    {
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+        PngStreamDecoder decoder([&](const PngStreamDecoder::Info& header)
+        {
+            PngStreamDecoder::Target target = { nullptr, 0 };
+            if (header.width == width && header.height == height)
+                target = { pixels.data(), width * 4 };
+            return target;
+        });
+
+        bool ok = true;
+        if (byteByByte)
+        {
+            for (size_t i = 0; ok && i < png.size(); ++i)
+                ok = decoder.Feed(&png[i], 1);
+        }
+        else
+        {
+            ok = decoder.Feed(png.data(), png.size());
+        }
+
+        if (!ok || !decoder.IsFinished())
+            return std::vector<uint8_t>();
+        *info = decoder.ImageInfo();
+        return pixels;
+    }
+
+    std::vector<uint8_t> expectedBgra(const PixelBuffer& pixels)
+    {
+        std::vector<uint8_t> expected(static_cast<size_t>(pixels.Width()) * pixels.Height() * 4);
+        PixelConverter::ConvertRows(pixels.ConstBits(), pixels.Stride(), pixels.Format(), expected.data(), pixels.Width() * 4,
+                                    Format::BGRA, pixels.Width(), pixels.Height());
+        return expected;
+    }
+
+#ifdef TESTS_WITH_QT
+    std::vector<uint8_t> decodeWithQt(const std::vector<uint8_t>& png)
+    {
+        QImage image;
+        if (!image.loadFromData(png.data(), static_cast<int>(png.size()), "PNG"))
+            return std::vector<uint8_t>();
+
+        image = image.convertToFormat(QImage::Format_ARGB32);
+        std::vector<uint8_t> pixels(static_cast<size_t>(image.width()) * image.height() * 4);
+        for (int y = 0; y < image.height(); ++y)
+            std::memcpy(pixels.data() + static_cast<size_t>(y) * image.width() * 4, image.constScanLine(y), static_cast<size_t>(image.width()) * 4);
+        return pixels;
+    }
+#endif
+
+    void testRoundTrip(ThreadPool* pool)
+    {
+        for (PngEncoder::Preset preset : PRESETS)
+        {
+            for (const Size& size : SIZES)
+            {
+                for (int rowsPerBand : ROWS_PER_BAND)
+                {
+                    for (int opaque = 0; opaque < 2; ++opaque)
+                    {
+                        PixelBuffer pixels = makeImage(size.width, size.height, opaque != 0);
+                        PngEncoder::Options options;
+                        options.preset = preset;
+                        options.rowsPerBand = rowsPerBand;
+
+                        std::vector<uint8_t> png = encode(pixels.View(), options, pool);
+                        CHECK_CONTEXT(!png.empty(), "%s %dx%d", PngEncoder::PresetName(preset), size.width, size.height);
+
+                        PngStreamDecoder::Info info = {};
+                        const std::vector<uint8_t> expected = expectedBgra(pixels);
+                        CHECK_CONTEXT(decode(png, size.width, size.height, false, &info) == expected, "%s %dx%d, %d rows per band, opaque %d",
+                                      PngEncoder::PresetName(preset), size.width, size.height, rowsPerBand, opaque);
+                        // 불투명하면 RGB 로 저장한다
+                        CHECK(info.hasAlpha == (opaque == 0));
+#ifdef TESTS_WITH_QT
+                        CHECK_CONTEXT(decodeWithQt(png) == expected, "Qt: %s %dx%d, %d rows per band, opaque %d",
+                                      PngEncoder::PresetName(preset), size.width, size.height, rowsPerBand, opaque);
+#endif
+                    }
+                }
+            }
+        }
+    }
+
+    // 입력 포맷, stride 여백과 상관없이 같은 BGRA 로 돌아온다
+    void testInputFormats()
+    {
+        const Format formats[] = { Format::BGRA, Format::BGRX, Format::RGBA, Format::RGBX };
+        for (Format format : formats)
+        {
+            PixelBuffer source = makeImage(13, 9, false, format);
+
+            // 한 row 에 20 byte 여백이 있는 view
+            const int stride = 13 * 4 + 20;
+            std::vector<uint8_t> padded(static_cast<size_t>(stride) * 9, 0xEE);
+            for (int y = 0; y < 9; ++y)
+                std::memcpy(padded.data() + static_cast<size_t>(y) * stride, source.ConstScanLine(y), 13 * 4);
+            ImageView view = { padded.data(), 13, 9, stride, format };
+
+            std::vector<uint8_t> png = encode(view, PngEncoder::Options(), nullptr);
+            PngStreamDecoder::Info info = {};
+            CHECK_CONTEXT(decode(png, 13, 9, true, &info) == expectedBgra(source), "format %d", static_cast<int>(format));
+        }
+    }
+
+    // tile 이 band 경계에 맞으면 나눠서 넣은 결과는 한 번에 Encode 한 것과 byte 단위로 같다
+    void testStreamEncoder(ThreadPool* pool)
+    {
+        PixelBuffer pixels = makeImage(45, 29, false);
+        PngEncoder::Options options;
+        options.rowsPerBand = 4;
+        const std::vector<uint8_t> expected = encode(pixels.View(), options, pool);
+
+        std::vector<uint8_t> png;
+        PngStreamEncoder encoder(options, pool);
+        bool ok = encoder.Begin(45, 29, true, [&png](const uint8_t* data, size_t size)
+        {
+            png.insert(png.end(), data, data + size);
+            return true;
+        });
+        for (int y = 0; ok && y < 29; y += 8)
+        {
+            const int rows = y + 8 <= 29 ? 8 : 29 - y;
+            ImageView tile = { pixels.ConstScanLine(y), 45, rows, pixels.Stride(), pixels.Format() };
+            ok = encoder.AddRows(tile);
+        }
+        ok = ok && encoder.Finish();
+
+        CHECK(ok);
+        CHECK(encoder.RowsWritten() == 29);
+        CHECK(png == expected);
+    }
+
+    std::vector<uint8_t> encodeIncremental(IncrementalPngEncoder& encoder, const ImageView& image, const std::vector<RowRange>& changedRows)
+    {
+        std::vector<uint8_t> png;
+        bool ok = encoder.Encode(image, changedRows, [&png](const uint8_t* data, size_t size)
+        {
+            png.insert(png.end(), data, data + size);
+            return true;
+        });
+        if (!ok)
+            png.clear();
+        return png;
+    }
+
+    // 처음 인코딩하는 encoder 의 결과
+    std::vector<uint8_t> encodeFresh(const ImageView& image, const PngEncoder::Options& options, ThreadPool* pool)
+    {
+        IncrementalPngEncoder encoder(options, pool);
+        return encodeIncremental(encoder, image, std::vector<RowRange>());
+    }
+
+    // 위아래로 비슷한 이미지. Fast 도 Up filter 를 골라 band 의 첫 row 가 앞 band 의 마지막 row 를 참조한다
+    PixelBuffer makeSmoothImage(int width, int height)
+    {
+        PixelBuffer pixels = PixelBuffer::Allocate(width, height, Format::BGRA);
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* row = pixels.ScanLine(y);
+            for (int x = 0; x < width; ++x)
+            {
+                row[x * 4] = static_cast<uint8_t>(x * 37 + y);
+                row[x * 4 + 1] = static_cast<uint8_t>(x * 91);
+                row[x * 4 + 2] = static_cast<uint8_t>(x * x + y);
+                row[x * 4 + 3] = static_cast<uint8_t>(x % 2 == 0 ? 255 : 100 + x);
+            }
+        }
+        return pixels;
+    }
+
+    // alpha 는 그대로 두고 색만 바꾼다
+    void editRows(PixelBuffer& pixels, int begin, int end)
+    {
+        for (int y = begin; y < end; ++y)
+        {
+            uint8_t* row = pixels.ScanLine(y);
+            for (int x = 0; x < pixels.Width(); ++x)
+            {
+                row[x * 4] = static_cast<uint8_t>(row[x * 4] + 17 + y);
+                row[x * 4 + 2] = static_cast<uint8_t>(row[x * 4 + 2] ^ (x * 5));
+            }
+        }
+    }
+
+    // 바뀐 band (와 band 의 마지막 row 가 바뀌면 다음 band) 만 다시 압축해도 처음부터 인코딩한 것과 byte 단위로 같다
+    void testIncrementalEdits(PngEncoder::Preset preset, ThreadPool* pool)
+    {
+        const int ROWS_PER_BAND = 4;
+        const int WIDTH = 37;
+        const int HEIGHT = 30;      // band 8 개, 마지막은 2 row
+        PngEncoder::Options options;
+        options.preset = preset;
+        options.rowsPerBand = ROWS_PER_BAND;
+
+        struct Edit
+        {
+            int begin;
+            int end;
+            int encodedBands;
+        };
+        const Edit edits[] = {
+            { 0, 1, 1 },            // 첫 band
+            { 29, 30, 1 },          // 마지막 band
+            { 28, 29, 1 },          // 마지막 band 의 첫 row
+            { 3, 4, 2 },            // band 의 마지막 row: 다음 band 의 첫 row 가 이 row 를 참조한다
+            { 4, 5, 1 },            // band 의 첫 row
+            { 7, 13, 3 },           // 경계에 걸친 범위
+            { 0, HEIGHT, 8 },
+        };
+
+        PixelBuffer pixels = makeSmoothImage(WIDTH, HEIGHT);
+        IncrementalPngEncoder encoder(options, pool);
+        CHECK(encodeIncremental(encoder, pixels.View(), std::vector<RowRange>()) == encodeFresh(pixels.View(), options, pool));
+        CHECK(encoder.LastStats().bandCount == 8 && encoder.LastStats().encodedBands == 8);
+
+        // 바뀐 것이 없으면 다시 압축하지 않는다
+        CHECK(encodeIncremental(encoder, pixels.View(), std::vector<RowRange>()) == encodeFresh(pixels.View(), options, pool));
+        CHECK(encoder.LastStats().encodedBands == 0);
+
+        for (const Edit& edit : edits)
+        {
+            editRows(pixels, edit.begin, edit.end);
+            const std::vector<uint8_t> png = encodeIncremental(encoder, pixels.View(), { { edit.begin, edit.end } });
+            CHECK_CONTEXT(png == encodeFresh(pixels.View(), options, pool), "%s rows %d-%d", PngEncoder::PresetName(preset), edit.begin, edit.end);
+            CHECK_CONTEXT(encoder.LastStats().encodedBands == edit.encodedBands, "%s rows %d-%d: %d bands",
+                          PngEncoder::PresetName(preset), edit.begin, edit.end, encoder.LastStats().encodedBands);
+            CHECK(encoder.LastStats().changedRows == edit.end - edit.begin);
+
+            PngStreamDecoder::Info info = {};
+            CHECK_CONTEXT(decode(png, WIDTH, HEIGHT, false, &info) == expectedBgra(pixels), "rows %d-%d", edit.begin, edit.end);
+        }
+    }
+
+    // 바뀐 row 때문에 RGB 와 RGBA 가 바뀌면 모든 band 를 다시 압축한다
+    void testIncrementalAlphaSwitch(ThreadPool* pool)
+    {
+        PngEncoder::Options options;
+        options.rowsPerBand = 4;
+        PixelBuffer pixels = makeImage(21, 18, true);
+        IncrementalPngEncoder encoder(options, pool);
+
+        PngStreamDecoder::Info info = {};
+        std::vector<uint8_t> png = encodeIncremental(encoder, pixels.View(), std::vector<RowRange>());
+        CHECK(decode(png, 21, 18, false, &info) == expectedBgra(pixels));
+        CHECK(!info.hasAlpha);
+
+        pixels.ScanLine(9)[5 * 4 + 3] = 128;
+        png = encodeIncremental(encoder, pixels.View(), { { 9, 10 } });
+        CHECK(png == encodeFresh(pixels.View(), options, pool));
+        CHECK(encoder.LastStats().encodedBands == encoder.LastStats().bandCount);
+        CHECK(decode(png, 21, 18, false, &info) == expectedBgra(pixels));
+        CHECK(info.hasAlpha);
+
+        pixels.ScanLine(9)[5 * 4 + 3] = 255;
+        png = encodeIncremental(encoder, pixels.View(), { { 9, 10 } });
+        CHECK(png == encodeFresh(pixels.View(), options, pool));
+        CHECK(encoder.LastStats().encodedBands == encoder.LastStats().bandCount);
+        CHECK(decode(png, 21, 18, false, &info) == expectedBgra(pixels));
+        CHECK(!info.hasAlpha);
+    }
+
+    // 크기가 바뀌면 changedRows 와 관계없이 처음부터 인코딩한다. Reset 뒤에도 같다
+    void testIncrementalReset(ThreadPool* pool)
+    {
+        PngEncoder::Options options;
+        options.rowsPerBand = 4;
+        IncrementalPngEncoder encoder(options, pool);
+
+        const Size sizes[] = { { 21, 18 }, { 21, 19 }, { 22, 19 }, { 22, 19 } };
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+        {
+            PixelBuffer pixels = makeImage(sizes[i].width, sizes[i].height, false);
+            const std::vector<uint8_t> png = encodeIncremental(encoder, pixels.View(), { { 0, 1 } });
+            CHECK_CONTEXT(png == encodeFresh(pixels.View(), options, pool), "%dx%d", sizes[i].width, sizes[i].height);
+            const bool sameSize = i > 0 && sizes[i].width == sizes[i - 1].width && sizes[i].height == sizes[i - 1].height;
+            CHECK_CONTEXT(encoder.LastStats().encodedBands == (sameSize ? 1 : encoder.LastStats().bandCount), "%dx%d", sizes[i].width, sizes[i].height);
+        }
+
+        PixelBuffer pixels = makeImage(22, 19, false);
+        encoder.Reset();
+        CHECK(encodeIncremental(encoder, pixels.View(), { { 0, 1 } }) == encodeFresh(pixels.View(), options, pool));
+        CHECK(encoder.LastStats().encodedBands == encoder.LastStats().bandCount);
+    }
+}
+
+int main()
+{
+    ThreadPool pool(4);
+
+    testRoundTrip(nullptr);
+    testRoundTrip(&pool);
+    testInputFormats();
+    testStreamEncoder(nullptr);
+    testStreamEncoder(&pool);
+    for (PngEncoder::Preset preset : PRESETS)
+    {
+        testIncrementalEdits(preset, nullptr);
+        testIncrementalEdits(preset, &pool);
+    }
+    testIncrementalAlphaSwitch(nullptr);
+    testIncrementalAlphaSwitch(&pool);
+    testIncrementalReset(nullptr);
+    testIncrementalReset(&pool);
+    return Test::Result();
+}
\ No newline at end of file
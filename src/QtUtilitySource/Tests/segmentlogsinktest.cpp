@@ -0,0 +1,389 @@
+#include "binarylog.h"
+#include "binarylogdecoder.h"
+#include "segmentlogsink.h"
+#include "testsupport.h"
+#include "zlibsupport.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const uint64_t SEGMENT_BYTES = 4096;
+
+    // 테스트마다 빈 폴더를 쓴다
+    class TemporaryFolder
+    {
+    public:
+        explicit TemporaryFolder(const std::string& name)
+            : path_(fs::temp_directory_path() / ("SegmentLogSinkTest-" + name + "-"
+                + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())))
+        {
+            fs::create_directories(path_);
+        }
+
+        ~TemporaryFolder()
+        {
+            std::error_code error;
+            fs::remove_all(path_, error);
+        }
+
+        std::string File(const std::string& name) const
+        {
+            return (path_ / name).u8string();
+        }
+
+        std::set<std::string> Names() const
+        {
+            std::set<std::string> names;
+            for (const fs::directory_entry& entry : fs::directory_iterator(path_))
+                names.insert(entry.path().filename().u8string());
+            return names;
+        }
+
+    private:
+        fs::path path_;
+    };
+
+    std::string readFile(const std::string& path)
+    {
+        std::ifstream in(fs::u8path(path), std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::string& path, const std::string& bytes)
+    {
+        std::ofstream out(fs::u8path(path), std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    // 비정상 종료한 segment 처럼 쓴 내용 뒤를 미리 잡아 둔 0 으로 채운다
+    std::string zeroFilled(const std::string& written, uint64_t bytes = SEGMENT_BYTES)
+    {
+        std::string segment = written;
+        segment.resize(static_cast<size_t>(bytes), '\0');
+        return segment;
+    }
+
+    bool writeText(SegmentLogSink& sink, const std::string& text)
+    {
+        return sink.Write(text.data(), text.size());
+    }
+
+    std::string gunzip(const std::string& bytes)
+    {
+        z_stream stream;
+        std::memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, 15 + 16) != Z_OK)
+            return std::string();
+
+        std::string text;
+        std::vector<char> output(16 * 1024);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(bytes.data()));
+        stream.avail_in = static_cast<uInt>(bytes.size());
+        int status = Z_OK;
+        while (status == Z_OK)
+        {
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            status = inflate(&stream, Z_NO_FLUSH);
+            text.append(output.data(), output.size() - stream.avail_out);
+        }
+        inflateEnd(&stream);
+        return status == Z_STREAM_END ? text : std::string();
+    }
+
+    SegmentLogSink::Options smallSegments()
+    {
+        SegmentLogSink::Options options;
+        options.segmentBytes = SEGMENT_BYTES;
+        return options;
+    }
+
+    // 정상 종료하면 미리 잡아 둔 자리를 잘라 쓴 만큼만 남는다
+    void testCleanClose()
+    {
+        TemporaryFolder folder("clean");
+        const std::string path = folder.File("app.log");
+        {
+            SegmentLogSink sink(path, smallSegments());
+            CHECK(writeText(sink, "first\n"));
+            CHECK(writeText(sink, "second\n"));
+            CHECK(fs::file_size(fs::u8path(path)) == SEGMENT_BYTES);
+        }
+        CHECK(readFile(path) == "first\nsecond\n");
+
+        // 다시 열면 회복 없이 이어 쓴다
+        {
+            SegmentLogSink sink(path, smallSegments());
+            CHECK(writeText(sink, "third\n"));
+            CHECK(sink.GetStats().recoveredSegments == 0);
+            CHECK(sink.GetStats().discardedBytes == 0);
+        }
+        CHECK(readFile(path) == "first\nsecond\nthird\n");
+    }
+
+    // 끝이 0 으로 채워진 segment 는 마지막 줄 뒤에서 이어 쓴다
+    void testZeroFilled()
+    {
+        TemporaryFolder folder("zero");
+        const std::string path = folder.File("app.log");
+        writeFile(path, zeroFilled("first\nsecond\n"));
+        {
+            SegmentLogSink sink(path, smallSegments());
+            CHECK(writeText(sink, "third\n"));
+            CHECK(sink.GetStats().recoveredSegments == 1);
+            CHECK(sink.GetStats().discardedBytes == 0);
+        }
+        CHECK(readFile(path) == "first\nsecond\nthird\n");
+
+        // 쓰기 전에 죽어 통째로 0 인 segment
+        writeFile(path, zeroFilled(std::string()));
+        {
+            SegmentLogSink sink(path, smallSegments());
+            CHECK(writeText(sink, "only\n"));
+            CHECK(sink.GetStats().recoveredSegments == 1);
+            CHECK(sink.GetStats().discardedBytes == 0);
+        }
+        CHECK(readFile(path) == "only\n");
+    }
+
+    // 반쯤 쓴 줄은 잘라 내고 그 자리부터 쓴다. 뒤에 남은 글자가 새 줄에 섞이지 않는다
+    void testHalfWritten()
+    {
+        TemporaryFolder folder("half");
+        const std::string path = folder.File("app.log");
+        writeFile(path, zeroFilled("first\nhalf of a very long line"));
+        {
+            SegmentLogSink sink(path, smallSegments());
+            CHECK(writeText(sink, "next\n"));
+            CHECK(sink.GetStats().recoveredSegments == 1);
+            CHECK(sink.GetStats().discardedBytes == std::strlen("half of a very long line"));
+        }
+        CHECK(readFile(path) == "first\nnext\n");
+
+        // 0 으로 채우기 전에 죽어 (파일 크기만큼) 반쯤 쓴 줄로 끝나는 segment
+        writeFile(path, "first\nhalf");
+        {
+            SegmentLogSink sink(path, smallSegments());
+            CHECK(writeText(sink, "next\n"));
+            CHECK(sink.GetStats().recoveredSegments == 1);
+            CHECK(sink.GetStats().discardedBytes == 4);
+        }
+        CHECK(readFile(path) == "first\nnext\n");
+
+        // 첫 byte 를 쓰기 전에 죽은 batch 는 줄바꿈으로 끝나도 버린다
+        writeFile(path, zeroFilled(std::string("first\n") + '\0' + "econd\nthird\n"));
+        {
+            SegmentLogSink sink(path, smallSegments());
+            CHECK(writeText(sink, "next\n"));
+            CHECK(sink.GetStats().recoveredSegments == 1);
+            CHECK(sink.GetStats().discardedBytes == 13);
+        }
+        CHECK(readFile(path) == "first\nnext\n");
+    }
+
+    // binary 로그: 끊긴 frame 을 잘라 내고, 이어 쓴 session 과 함께 decode 된다
+    void testBinaryRecovery()
+    {
+        TemporaryFolder folder("binary");
+        const std::string path = folder.File("app.blog");
+        SegmentLogSink::Options options = smallSegments();
+        options.preamble = BinaryLog::Preamble;
+        options.completeLength = BinaryLog::CompleteLength;
+
+        static const uint32_t site = BinaryLog::RegisterSite(2, "testBinaryRecovery", "record {}");
+        BinaryLog::Open(std::unique_ptr<LogSink>(new SegmentLogSink(path, options)));
+        for (int i = 0; i < 10; ++i)
+        {
+            BinaryLog::Write(site, i);
+            CHECK(BinaryLog::Flush());
+        }
+        BinaryLog::Close();
+
+        // 마지막 frame 을 복사하는 중에 죽은 것처럼 만든다: 첫 byte 는 아직 0 이고 끝 몇 byte 도 쓰지 못했다.
+        // 뒤는 미리 채워 둔 0 이라 frame header 만 보면 온전해 보인다
+        std::string crashed = readFile(path);
+        const size_t valid = BinaryLog::CompleteLength(crashed.data(), crashed.size() - 1);
+        CHECK(valid < crashed.size());
+        const size_t halfWritten = crashed.size() - 3 - valid;
+        crashed.resize(crashed.size() - 3);
+        crashed[valid] = '\0';
+        writeFile(path, zeroFilled(crashed));
+
+        SegmentLogSink* sink = new SegmentLogSink(path, options);
+        BinaryLog::Open(std::unique_ptr<LogSink>(sink));
+        BinaryLog::Write(site, 100);
+        CHECK(BinaryLog::Flush());
+        CHECK(sink->GetStats().recoveredSegments == 1);
+        // 반쯤 쓴 frame 끝의 0 은 미리 채워 둔 0 과 구별하지 못해 세지 않는다
+        CHECK(sink->GetStats().discardedBytes > 0 && sink->GetStats().discardedBytes <= halfWritten);
+        BinaryLog::Close();
+
+        std::string text;
+        BinaryLogDecoder::Result result = {};
+        CHECK(BinaryLogDecoder::Decode(readFile(path), &text, &result));
+        CHECK(!result.truncated);
+        CHECK(result.records == 10);
+        CHECK(text.find("record 8") != std::string::npos);
+        CHECK(text.find("record 9") == std::string::npos);
+        CHECK(text.find("record 100") != std::string::npos);
+    }
+
+    // 다 찬 segment 는 번호를 붙여 넘기고 압축해서 최근 generations 개만 남긴다
+    void testRotation()
+    {
+        TemporaryFolder folder("rotation");
+        const std::string path = folder.File("app.log");
+        SegmentLogSink::Options options = smallSegments();
+        options.generations = 2;
+        options.compressionLevel = 1;
+
+        // 100 byte 줄 40 개가 segment 하나
+        std::vector<std::string> lines;
+        for (int i = 0; i < 200; ++i)
+        {
+            std::string line = "line " + std::to_string(i) + " ";
+            line.resize(99, 'x');
+            lines.push_back(line + "\n");
+        }
+
+        SegmentLogSink::Stats stats = {};
+        {
+            SegmentLogSink sink(path, options);
+            for (const std::string& line : lines)
+                CHECK(writeText(sink, line));
+            stats = sink.GetStats();
+        }
+        CHECK(stats.rotations == 4);
+        CHECK(stats.compressFailures == 0);
+
+        // 1, 2 는 지워졌고 3, 4 는 압축, 임시 파일은 남지 않는다
+        const std::set<std::string> expected = { "app.3.log.gz", "app.4.log.gz", "app.log" };
+        CHECK(folder.Names() == expected);
+
+        std::string kept;
+        for (int i = 80; i < 200; ++i)
+            kept += lines[i];
+        CHECK(gunzip(readFile(folder.File("app.3.log.gz"))) + gunzip(readFile(folder.File("app.4.log.gz"))) + readFile(path) == kept);
+    }
+
+    // 압축하지 못하고 끝난 segment 는 다시 압축하고, 쓰다 만 임시 파일은 지우고, 번호는 이어 붙인다
+    void testLeftoverSegments()
+    {
+        TemporaryFolder folder("leftover");
+        const std::string path = folder.File("app.log");
+        writeFile(folder.File("app.5.log"), "old\n");
+        writeFile(folder.File("app.7.log.gz.tmp"), "partial");
+
+        SegmentLogSink::Options options = smallSegments();
+        options.compressionLevel = 1;
+        {
+            SegmentLogSink sink(path, options);
+            const std::string line(SEGMENT_BYTES / 2, 'y');
+            for (int i = 0; i < 3; ++i)
+                CHECK(writeText(sink, line.substr(1) + "\n"));
+            CHECK(sink.GetStats().rotations == 1);
+        }
+
+        const std::set<std::string> expected = { "app.5.log.gz", "app.6.log.gz", "app.log" };
+        CHECK(folder.Names() == expected);
+        CHECK(gunzip(readFile(folder.File("app.5.log.gz"))) == "old\n");
+    }
+
+    // 이름을 바꾸지 못해도 preamble 을 다시 쓰거나 batch 마다 넘기려 하지 않고, segmentBytes 만큼 더 쓴 뒤에 다시 넘긴다
+    void testRenameFailure()
+    {
+        TemporaryFolder folder("rename");
+        const std::string path = folder.File("app.log");
+        SegmentLogSink::Options options = smallSegments();
+        options.compressionLevel = 0;
+        options.preamble = []() { return std::string("preamble\n"); };
+
+        const std::string line = std::string(99, 'z') + "\n";
+        std::string written = "preamble\n";
+        {
+            SegmentLogSink sink(path, options);
+            CHECK(writeText(sink, line));
+            written += line;
+
+            // 넘길 이름에 비어 있지 않은 폴더가 있으면 rename 이 실패한다
+            fs::create_directories(fs::u8path(folder.File("app.1.log/blocked")));
+            for (int i = 0; i < 100; ++i)
+            {
+                CHECK(writeText(sink, line));
+                written += line;
+            }
+            CHECK(sink.GetStats().rotations == 0);
+            CHECK(fs::file_size(fs::u8path(path)) <= written.size() + 2 * SEGMENT_BYTES);
+
+            // 막힌 것이 풀리면 다음에 찼을 때 넘긴다
+            fs::remove_all(fs::u8path(folder.File("app.1.log")));
+            for (int i = 0; i < 50; ++i)
+                CHECK(writeText(sink, line));
+            CHECK(sink.GetStats().rotations == 1);
+        }
+        // 넘긴 segment 에는 막혀 있던 동안 쓴 것이 모두 있고 preamble 은 처음 한 번뿐이다
+        const std::string rotated = readFile(folder.File("app.1.log"));
+        CHECK(rotated.compare(0, written.size(), written) == 0);
+        CHECK(rotated.find("preamble", 1) == std::string::npos);
+        const std::string current = readFile(path);
+        CHECK(current.compare(0, 9, "preamble\n") == 0);
+        CHECK(rotated.size() + current.size() - 9 == written.size() + 50 * line.size());
+    }
+
+    // 같은 path 를 두 인스턴스가 열면 두 번째는 프로세스별 파일에 쓰고 서로 덮어쓰지 않는다
+    void testTwoInstances()
+    {
+        TemporaryFolder folder("shared");
+        const std::string path = folder.File("app.log");
+        std::string fallback;
+        {
+            SegmentLogSink first(path, smallSegments());
+            SegmentLogSink second(path, smallSegments());
+            for (int i = 0; i < 3; ++i)
+            {
+                CHECK(writeText(first, "first " + std::to_string(i) + "\n"));
+                CHECK(writeText(second, "second " + std::to_string(i) + "\n"));
+            }
+
+            // 첫 번째의 번호 segment 로 보이지 않는다
+            const std::set<std::string> names = folder.Names();
+            CHECK(names.size() == 2);
+            for (const std::string& name : names)
+            {
+                if (name != "app.log")
+                    fallback = name;
+            }
+            CHECK(fallback.compare(0, 7, "app.pid") == 0);
+
+            // 이미 둘이 쓰고 있으면 세 번째는 쓰지 못한다
+            SegmentLogSink third(path, smallSegments());
+            CHECK(!writeText(third, "third\n"));
+        }
+        CHECK(readFile(path) == "first 0\nfirst 1\nfirst 2\n");
+        CHECK(readFile(folder.File(fallback)) == "second 0\nsecond 1\nsecond 2\n");
+    }
+}
+
+int main()
+{
+    testCleanClose();
+    testZeroFilled();
+    testHalfWritten();
+    testBinaryRecovery();
+    testRotation();
+    testLeftoverSegments();
+    testRenameFailure();
+    testTwoInstances();
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+
+// 실패한 CHECK 를 stderr 에 남기고 세기만 한다 (한 번 실패해도 나머지를 계속 확인). main 은 Test::Result() 를 돌려준다
+#define CHECK(condition) \
+    do { if (!(condition)) { std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); ++Test::Failures(); } } while (0)
+
+// 실패하면 반복문의 어느 경우였는지 같이 남긴다
+#define CHECK_CONTEXT(condition, ...) \
+    do { if (!(condition)) { std::fprintf(stderr, "%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #condition); std::fprintf(stderr, __VA_ARGS__); std::fprintf(stderr, "\n"); ++Test::Failures(); } } while (0)
+
+namespace Test
+{
+    inline int& Failures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline int Result()
+    {
+        if (Failures() != 0)
+        {
+            std::fprintf(stderr, "%d check(s) failed\n", Failures());
+            return 1;
+        }
+        std::printf("ok\n");
+        return 0;
+    }
+}
\ No newline at end of file
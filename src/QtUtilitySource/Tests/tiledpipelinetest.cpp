@@ -0,0 +1,174 @@
+#include "memorytracker.h"
+#include "pngdecoder.h"
+#include "testsupport.h"
+#include "threadpool.h"
+#include "tiledpipeline.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    using PixelConverter::Format;
+
+    const size_t MB = 1024 * 1024;
+    const size_t WORKING_SET_LIMIT = 16 * MB;
+    // zlib 상태, thread stack 등 추적하지 않는 메모리
+    const size_t UNTRACKED_SLACK = 32 * MB;
+
+    // row, column 으로 정해지는 합성 이미지. 메모리에 전체를 두지 않는다. 앞 4 byte 는 row 번호
+    uint8_t syntheticByte(int row, int column)
+    {
+        if (column < 4)
+            return static_cast<uint8_t>(row >> (column * 8));
+        return static_cast<uint8_t>((column >> 2) ^ (column & 3 ? 0x5A : 0xFF));
+    }
+
+    TiledPipeline::RowReader syntheticReader(int width)
+    {
+        // row 마다 같은 부분은 미리 만들어 두고 복사한다
+        auto pattern = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(width) * 4);
+        for (int x = 0; x < width * 4; ++x)
+            (*pattern)[x] = syntheticByte(0, x);
+
+        return [width, pattern](int firstRow, int rowCount, uint8_t* dest, int destStride)
+        {
+            for (int y = 0; y < rowCount; ++y)
+            {
+                uint8_t* row = dest + static_cast<size_t>(y) * destStride;
+                std::memcpy(row, pattern->data(), pattern->size());
+                for (int x = 0; x < 4; ++x)
+                    row[x] = syntheticByte(firstRow + y, x);
+            }
+            return true;
+        };
+    }
+
+    // 원본(width * height * 4)을 메모리에 올리지 않고 문서에 적힌 상한(workingSetLimit) 안에서 끝나야 한다
+    void testGigapixelWorkingSet(int width, int height)
+    {
+        ThreadPool pool(4);
+        TiledPipeline::Options options;
+        options.workingSetLimit = WORKING_SET_LIMIT;
+        options.png.preset = PngEncoder::Preset::Fastest;
+        TiledPipeline pipeline(options, &pool);
+
+        const MemoryTracker::ProcessMemory before = MemoryTracker::QueryProcessMemory();
+        MemoryTracker::ResetPeak();
+        const size_t trackedBefore = MemoryTracker::CurrentBytes();
+
+        uint64_t pngBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        TiledPipeline::Result result = pipeline.Run(width, height, Format::RGBA, syntheticReader(width), nullptr, 0,
+            [&pngBytes](const uint8_t*, size_t size)
+            {
+                pngBytes += size;
+                return true;
+            });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const size_t trackedPeak = MemoryTracker::PeakBytes() - trackedBefore;
+        const MemoryTracker::ProcessMemory after = MemoryTracker::QueryProcessMemory();
+
+        std::printf("%dx%d: %d tiles of %d rows, working set %zu, tracked peak %zu, png %llu bytes, %.1f s\n",
+                    width, height, result.tileCount, result.tileRows, result.workingSetBytes, trackedPeak,
+                    static_cast<unsigned long long>(pngBytes), seconds);
+
+        CHECK(result.ok);
+        CHECK(result.tileCount > 1);
+        CHECK(result.workingSetBytes <= WORKING_SET_LIMIT);
+        CHECK_CONTEXT(trackedPeak <= WORKING_SET_LIMIT, "tracked peak %zu", trackedPeak);
+        CHECK(pngBytes > 0);
+
+        // RSS 를 읽을 수 있는 곳에서만 (Windows, Linux)
+        if (before.peakWorkingSetBytes != 0)
+        {
+            const uint64_t growth = after.peakWorkingSetBytes - before.peakWorkingSetBytes;
+            std::printf("peak RSS growth %llu bytes\n", static_cast<unsigned long long>(growth));
+            CHECK_CONTEXT(growth <= WORKING_SET_LIMIT + UNTRACKED_SLACK, "peak RSS growth %llu", static_cast<unsigned long long>(growth));
+        }
+    }
+
+    // DIB 와 PNG 가 tile 로 나누지 않은 결과와 같다
+    void testOutputMatchesSource()
+    {
+        const int width = 301;
+        const int height = 257;
+        TiledPipeline::Options options;
+        // row 하나당 tile 버퍼와 압축 결과 (TiledPipeline::TileRows) 로 10 row
+        options.workingSetLimit = (static_cast<size_t>(width) * 8 + 1) * 10;
+        TiledPipeline pipeline(options);
+
+        std::vector<uint8_t> dib(static_cast<size_t>(width) * 4 * height);
+        std::vector<uint8_t> png;
+        TiledPipeline::Result result = pipeline.Run(width, height, Format::RGBA, syntheticReader(width), dib.data(), width * 4,
+            [&png](const uint8_t* data, size_t size)
+            {
+                png.insert(png.end(), data, data + size);
+                return true;
+            });
+        CHECK(result.ok);
+        CHECK(result.tileRows == 10);
+        CHECK(result.tileCount == (height + 9) / 10);
+
+        bool dibMatches = true;
+        for (int y = 0; y < height && dibMatches; ++y)
+        {
+            for (int x = 0; x < width && dibMatches; ++x)
+            {
+                const uint8_t* pixel = &dib[(static_cast<size_t>(y) * width + x) * 4];
+                dibMatches = pixel[0] == syntheticByte(y, x * 4 + 2) && pixel[1] == syntheticByte(y, x * 4 + 1)
+                    && pixel[2] == syntheticByte(y, x * 4) && pixel[3] == syntheticByte(y, x * 4 + 3);
+            }
+        }
+        CHECK(dibMatches);
+
+        std::vector<uint8_t> decoded(dib.size());
+        PngStreamDecoder decoder([&](const PngStreamDecoder::Info& header)
+        {
+            PngStreamDecoder::Target target = { nullptr, 0 };
+            if (header.width == width && header.height == height)
+                target = { decoded.data(), width * 4 };
+            return target;
+        });
+        CHECK(decoder.Feed(png.data(), png.size()));
+        CHECK(decoder.IsFinished());
+        CHECK(decoded == dib);
+    }
+
+    // reader 가 실패하거나 취소되면 ok 가 아니다
+    void testReaderFailure()
+    {
+        TiledPipeline::Options options;
+        options.workingSetLimit = 64 * 8 * 4;
+        TiledPipeline pipeline(options);
+        int calls = 0;
+        TiledPipeline::Result result = pipeline.Run(64, 64, Format::BGRA, [&calls](int, int, uint8_t*, int)
+        {
+            return ++calls < 3;
+        }, nullptr, 0, [](const uint8_t*, size_t) { return true; });
+        CHECK(!result.ok);
+        CHECK(calls == 3);
+    }
+}
+
+// 인자로 크기를 줄 수 있다: TiledPipelineTest [width height]
+int main(int argc, char* argv[])
+{
+    int width = 32768;
+    int height = 32768;
+    if (argc == 3)
+    {
+        width = std::atoi(argv[1]);
+        height = std::atoi(argv[2]);
+    }
+
+    testOutputMatchesSource();
+    testReaderFailure();
+    testGigapixelWorkingSet(width, height);
+    return Test::Result();
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "testsupport.h"
+#include "trace.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const char* const NAMES[] = { "e0", "e1", "e2", "e3", "e4", "e5", "e6", "e7", "e8", "e9" };
+
+    bool contains(const std::string& text, const char* part)
+    {
+        return text.find(part) != std::string::npos;
+    }
+
+    // 켜기 전, 끈 뒤에 시작한 span 은 시간도 재지 않고 남지 않는다
+    void testDisabled()
+    {
+        CHECK(!Trace::IsEnabled());
+        {
+            Trace::Span span("never");
+        }
+        CHECK(Trace::Events().empty());
+
+        // ring 이 없으면 직접 Record 해도 버린다
+        Trace::Record("direct", nullptr, 0, 10, 0);
+        CHECK(Trace::Events().empty());
+
+        Trace::SetEnabled(true);
+        Trace::SetEnabled(false);
+        {
+            Trace::Span span("after disable", "detail", 5);
+            span.SetBytes(10);
+        }
+        CHECK(Trace::Events().empty());
+        CHECK(Trace::ToChromeJson() == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n]}\n");
+
+        // 켜져 있을 때 시작한 span 은 끈 뒤에 끝나도 남는다
+        Trace::SetEnabled(true);
+        {
+            Trace::Span span("straddle");
+            Trace::SetEnabled(false);
+        }
+        const std::vector<Trace::Event> events = Trace::Events();
+        CHECK(events.size() == 1 && std::strcmp(events[0].name, "straddle") == 0);
+        Trace::Clear();
+    }
+
+    void testSpan()
+    {
+        Trace::SetEnabled(true);
+        const int64_t before = Trace::NowMicroseconds();
+        {
+            Trace::Span span("encode", "PNG");
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            span.SetBytes(1234);
+        }
+        std::thread([]()
+        {
+            Trace::Span span("other thread");
+        }).join();
+        const int64_t after = Trace::NowMicroseconds();
+
+        const std::vector<Trace::Event> events = Trace::Events();
+        CHECK(events.size() == 2);
+        if (events.size() == 2)
+        {
+            CHECK(std::strcmp(events[0].name, "encode") == 0 && std::strcmp(events[0].detail, "PNG") == 0);
+            CHECK(events[0].bytes == 1234);
+            CHECK(events[0].startMicroseconds >= before);
+            CHECK(events[0].durationMicroseconds >= 2000);
+            CHECK(events[0].startMicroseconds + events[0].durationMicroseconds <= after);
+            CHECK(events[1].detail == nullptr && events[1].bytes == 0);
+            CHECK(events[1].threadId != events[0].threadId);
+        }
+        Trace::SetEnabled(false);
+        Trace::Clear();
+    }
+
+    // 넘치면 오래된 것부터 덮어쓰고 그 수를 센다
+    void testRingWraparound()
+    {
+        Trace::SetEnabled(true);
+        Trace::SetCapacity(4);
+        CHECK(Trace::Capacity() == 4);
+
+        for (int i = 0; i < 3; ++i)
+            Trace::Record(NAMES[i], nullptr, i, i + 1, 0);
+        std::vector<Trace::Event> events = Trace::Events();
+        CHECK(events.size() == 3 && Trace::DroppedCount() == 0);
+        CHECK(events.size() == 3 && std::strcmp(events[0].name, "e0") == 0 && std::strcmp(events[2].name, "e2") == 0);
+
+        for (int i = 3; i < 10; ++i)
+            Trace::Record(NAMES[i], nullptr, i, i + 1, static_cast<uint64_t>(i));
+        events = Trace::Events();
+        CHECK(Trace::DroppedCount() == 6);
+        CHECK(events.size() == 4);
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            CHECK_CONTEXT(std::strcmp(events[i].name, NAMES[6 + i]) == 0, "%zu: %s", i, events[i].name);
+            CHECK_CONTEXT(events[i].startMicroseconds == static_cast<int64_t>(6 + i) && events[i].durationMicroseconds == 1, "%zu", i);
+        }
+
+        // Clear 는 dropped 도 지운다
+        Trace::Clear();
+        CHECK(Trace::Events().empty() && Trace::DroppedCount() == 0);
+        Trace::Record("after clear", nullptr, 0, 1, 0);
+        CHECK(Trace::Events().size() == 1);
+
+        // capacity 가 바뀌면 남아 있던 event 는 버린다
+        Trace::SetCapacity(0);
+        CHECK(Trace::Capacity() == 1 && Trace::Events().empty());
+        Trace::Record("a", nullptr, 0, 1, 0);
+        Trace::Record("b", nullptr, 0, 1, 0);
+        events = Trace::Events();
+        CHECK(events.size() == 1 && std::strcmp(events[0].name, "b") == 0);
+        CHECK(Trace::DroppedCount() == 1);
+
+        Trace::SetEnabled(false);
+        Trace::SetCapacity(16);
+        Trace::Clear();
+    }
+
+    // 이름과 detail 의 따옴표, backslash, 제어 문자는 escape 한다
+    void testJsonEscaping()
+    {
+        Trace::SetEnabled(true);
+        Trace::Record("quote\" back\\slash", "line\nfeed\ttab\x01", 100, 150, 42);
+        Trace::Record("utf8 \xED\x81\xB4\xEB\xA6\xBD", nullptr, 200, 200, 0);
+        const std::string json = Trace::ToChromeJson();
+        Trace::SetEnabled(false);
+        Trace::Clear();
+
+        CHECK(contains(json, "\"name\":\"quote\\\" back\\\\slash\""));
+        CHECK(contains(json, "\"detail\":\"line\\u000afeed\\u0009tab\\u0001\""));
+        CHECK(contains(json, "\"ph\":\"X\",\"ts\":100,\"dur\":50,"));
+        CHECK(contains(json, "\"args\":{\"bytes\":42,"));
+        CHECK(contains(json, "\"name\":\"utf8 \xED\x81\xB4\xEB\xA6\xBD\""));
+        CHECK(contains(json, "\"args\":{\"bytes\":0}}"));
+
+        // 문자열 안에 escape 되지 않은 제어 문자나 따옴표가 없으면 괄호가 맞게 닫힌다
+        bool inString = false;
+        bool balanced = true;
+        int depth = 0;
+        for (size_t i = 0; i < json.size(); ++i)
+        {
+            const char c = json[i];
+            if (inString)
+            {
+                if (c == '\\')
+                    ++i;
+                else if (c == '"')
+                    inString = false;
+                else if (static_cast<unsigned char>(c) < 0x20)
+                    balanced = false;
+            }
+            else if (c == '"')
+                inString = true;
+            else if (c == '{' || c == '[')
+                ++depth;
+            else if (c == '}' || c == ']')
+            {
+                --depth;
+                balanced = balanced && depth >= 0;
+            }
+        }
+        CHECK(balanced && !inString && depth == 0);
+    }
+}
+
+int main()
+{
+    testDisabled();
+    testSpan();
+    testRingWraparound();
+    testJsonEscaping();
+    return Test::Result();
+}
\ No newline at end of file